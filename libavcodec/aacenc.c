@@ -152,6 +152,14 @@ static void put_audio_specific_config(AVCodecContext *avctx)
     flush_put_bits(&pb);
 }
 
+/**
+ * Quantizer search input for one channel.
+ */
+typedef struct AACSearchJob {
+    SingleChannelElement *sce;
+    const FFPsyWindowInfo *wi;
+} AACSearchJob;
+
 static av_cold int aac_encode_init(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
@@ -209,6 +217,35 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
 
     ff_aac_tableinit();
 
+    s->thread = av_mallocz(FFMAX(avctx->thread_count, 1) * sizeof(*s->thread));
+    if (!s->thread)
+        return AVERROR(ENOMEM);
+    s->thread[0] = s;
+    for (i = 1; i < avctx->thread_count; i++) {
+        s->thread[i] = av_malloc(sizeof(AACEncContext));
+        if (!s->thread[i])
+            return AVERROR(ENOMEM);
+        memcpy(s->thread[i], s, sizeof(AACEncContext));
+    }
+
+    return 0;
+}
+
+/**
+ * Run the psychoacoustic band analysis and the quantizer search for one
+ * channel. Channels are independent, so they can be searched in parallel;
+ * each thread uses its own copy of the context for the scratch buffers.
+ */
+static int search_quantizers_thread(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
+{
+    AACEncContext *s   = avctx->priv_data;
+    AACEncContext *t   = s->thread[threadnr];
+    AACSearchJob  *job = (AACSearchJob *)arg + jobnr;
+
+    t->cur_channel = jobnr;
+    ff_psy_set_band_info(&s->psy, jobnr, job->sce->coeffs, job->wi);
+    s->coder->search_for_quantizers(avctx, t, job->sce, s->lambda);
     return 0;
 }
 
@@ -485,6 +522,7 @@ static int aac_encode_frame(AVCodecContext *avctx,
     const uint8_t *chan_map = aac_chan_configs[avctx->channels-1];
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    AACSearchJob jobs[AAC_MAX_CHANNELS];
 
     if (s->last_frame)
         return 0;
@@ -544,6 +582,8 @@ static int aac_encode_frame(AVCodecContext *avctx,
                 ics->group_len[k] = wi[j].grouping[k];
 
             apply_window_and_mdct(avctx, s, &cpe->ch[j], samples2);
+            jobs[cur_channel].sce = &cpe->ch[j];
+            jobs[cur_channel].wi  = &wi[j];
         }
         start_ch += chans;
     }
@@ -552,6 +592,7 @@ static int aac_encode_frame(AVCodecContext *avctx,
         init_put_bits(&s->pb, frame, buf_size*8);
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(avctx, s, LIBAVCODEC_IDENT);
+        avctx->execute2(avctx, search_quantizers_thread, jobs, NULL, avctx->channels);
         start_ch = 0;
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < chan_map[0]; i++) {
@@ -561,11 +602,6 @@ static int aac_encode_frame(AVCodecContext *avctx,
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (j = 0; j < chans; j++) {
-                s->cur_channel = start_ch + j;
-                ff_psy_set_band_info(&s->psy, s->cur_channel, cpe->ch[j].coeffs, &wi[j]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[j], s->lambda);
-            }
             cpe->common_window = 0;
             if (chans > 1
                 && wi[0].window_type[0] == wi[1].window_type[0]
@@ -626,6 +662,7 @@ static int aac_encode_frame(AVCodecContext *avctx,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
     ff_mdct_end(&s->mdct1024);
     ff_mdct_end(&s->mdct128);
@@ -633,6 +670,11 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     ff_psy_preprocess_end(s->psypp);
     av_freep(&s->samples);
     av_freep(&s->cpe);
+    if (s->thread) {
+        for (i = 1; i < avctx->thread_count; i++)
+            av_freep(&s->thread[i]);
+        av_freep(&s->thread);
+    }
     return 0;
 }
 
@@ -66,6 +66,7 @@ typedef struct AACEncContext {
     float lambda;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(16, float, scoefs)[1024];    ///< scaled coefficients
+    struct AACEncContext **thread;               ///< per-thread copies used for the quantizer search, thread[0] is this context
 } AACEncContext;
 
 #endif /* AVCODEC_AACENC_H */
@@ -27,10 +27,11 @@
 //#define DEBUG_BITALLOC
 #include "libavutil/crc.h"
 #include "avcodec.h"
-#include "libavutil/common.h" /* for av_reverse */
+#include "libavutil/common.h"
 #include "put_bits.h"
 #include "ac3.h"
 #include "audioconvert.h"
+#include "fft.h"
 
 typedef struct AC3EncodeContext {
     PutBitContext pb;
@@ -63,12 +64,12 @@ typedef struct AC3EncodeContext {
     int fine_snr_offset[AC3_MAX_CHANNELS];
     /* mantissa encoding */
     int mant1_cnt, mant2_cnt, mant4_cnt;
-} AC3EncodeContext;
 
-static int16_t costab[64];
-static int16_t sintab[64];
-static int16_t xcos1[128];
-static int16_t xsin1[128];
+    FFTContext mdct;
+    DECLARE_ALIGNED(16, float, window)[256]; /* first half of the KBD window */
+    DECLARE_ALIGNED(16, FFTSample, windowed_samples)[512];
+    DECLARE_ALIGNED(16, FFTSample, mdct_out)[256];
+} AC3EncodeContext;
 
 #define MDCT_NBITS 9
 #define N         (1 << MDCT_NBITS)
@@ -76,157 +77,6 @@ static int16_t xsin1[128];
 /* new exponents are sent if their Norm 1 exceed this number */
 #define EXP_DIFF_THRESHOLD 1000
 
-static inline int16_t fix15(float a)
-{
-    int v;
-    v = (int)(a * (float)(1 << 15));
-    if (v < -32767)
-        v = -32767;
-    else if (v > 32767)
-        v = 32767;
-    return v;
-}
-
-typedef struct IComplex {
-    short re,im;
-} IComplex;
-
-static av_cold void fft_init(int ln)
-{
-    int i, n;
-    float alpha;
-
-    n = 1 << ln;
-
-    for(i=0;i<(n/2);i++) {
-        alpha = 2 * M_PI * (float)i / (float)n;
-        costab[i] = fix15(cos(alpha));
-        sintab[i] = fix15(sin(alpha));
-    }
-}
-
-/* butter fly op */
-#define BF(pre, pim, qre, qim, pre1, pim1, qre1, qim1) \
-{\
-  int ax, ay, bx, by;\
-  bx=pre1;\
-  by=pim1;\
-  ax=qre1;\
-  ay=qim1;\
-  pre = (bx + ax) >> 1;\
-  pim = (by + ay) >> 1;\
-  qre = (bx - ax) >> 1;\
-  qim = (by - ay) >> 1;\
-}
-
-#define CMUL(pre, pim, are, aim, bre, bim) \
-{\
-   pre = (MUL16(are, bre) - MUL16(aim, bim)) >> 15;\
-   pim = (MUL16(are, bim) + MUL16(bre, aim)) >> 15;\
-}
-
-
-/* do a 2^n point complex fft on 2^ln points. */
-static void fft(IComplex *z, int ln)
-{
-    int        j, l, np, np2;
-    int        nblocks, nloops;
-    register IComplex *p,*q;
-    int tmp_re, tmp_im;
-
-    np = 1 << ln;
-
-    /* reverse */
-    for(j=0;j<np;j++) {
-        int k = av_reverse[j] >> (8 - ln);
-        if (k < j)
-            FFSWAP(IComplex, z[k], z[j]);
-    }
-
-    /* pass 0 */
-
-    p=&z[0];
-    j=(np >> 1);
-    do {
-        BF(p[0].re, p[0].im, p[1].re, p[1].im,
-           p[0].re, p[0].im, p[1].re, p[1].im);
-        p+=2;
-    } while (--j != 0);
-
-    /* pass 1 */
-
-    p=&z[0];
-    j=np >> 2;
-    do {
-        BF(p[0].re, p[0].im, p[2].re, p[2].im,
-           p[0].re, p[0].im, p[2].re, p[2].im);
-        BF(p[1].re, p[1].im, p[3].re, p[3].im,
-           p[1].re, p[1].im, p[3].im, -p[3].re);
-        p+=4;
-    } while (--j != 0);
-
-    /* pass 2 .. ln-1 */
-
-    nblocks = np >> 3;
-    nloops = 1 << 2;
-    np2 = np >> 1;
-    do {
-        p = z;
-        q = z + nloops;
-        for (j = 0; j < nblocks; ++j) {
-
-            BF(p->re, p->im, q->re, q->im,
-               p->re, p->im, q->re, q->im);
-
-            p++;
-            q++;
-            for(l = nblocks; l < np2; l += nblocks) {
-                CMUL(tmp_re, tmp_im, costab[l], -sintab[l], q->re, q->im);
-                BF(p->re, p->im, q->re, q->im,
-                   p->re, p->im, tmp_re, tmp_im);
-                p++;
-                q++;
-            }
-            p += nloops;
-            q += nloops;
-        }
-        nblocks = nblocks >> 1;
-        nloops = nloops << 1;
-    } while (nblocks != 0);
-}
-
-/* do a 512 point mdct */
-static void mdct512(int32_t *out, int16_t *in)
-{
-    int i, re, im, re1, im1;
-    int16_t rot[N];
-    IComplex x[N/4];
-
-    /* shift to simplify computations */
-    for(i=0;i<N/4;i++)
-        rot[i] = -in[i + 3*N/4];
-    for(i=N/4;i<N;i++)
-        rot[i] = in[i - N/4];
-
-    /* pre rotation */
-    for(i=0;i<N/4;i++) {
-        re = ((int)rot[2*i] - (int)rot[N-1-2*i]) >> 1;
-        im = -((int)rot[N/2+2*i] - (int)rot[N/2-1-2*i]) >> 1;
-        CMUL(x[i].re, x[i].im, re, im, -xcos1[i], xsin1[i]);
-    }
-
-    fft(x, MDCT_NBITS - 2);
-
-    /* post rotation */
-    for(i=0;i<N/4;i++) {
-        re = x[i].re;
-        im = x[i].im;
-        CMUL(re1, im1, re, im, xsin1[i], xcos1[i]);
-        out[2*i] = im1;
-        out[N/2-1-2*i] = re1;
-    }
-}
-
 /* XXX: use another norm ? */
 static int calc_exp_diff(uint8_t *exp1, uint8_t *exp2, int n)
 {
@@ -476,7 +326,9 @@ static int bit_alloc(AC3EncodeContext *s,
     return 16 * s->frame_size - frame_bits;
 }
 
-#define SNR_INC1 4
+/* initial step of the SNR offset search, in fine offset units */
+#define SNR_INC1 16
+#define SNR_OFFSET_MAX ((63 << 4) + 15)
 
 static int compute_bit_allocation(AC3EncodeContext *s,
                                   uint8_t bap[NB_BLOCKS][AC3_MAX_CHANNELS][N/2],
@@ -486,7 +338,10 @@ static int compute_bit_allocation(AC3EncodeContext *s,
 {
     int i, ch;
     int coarse_snr_offset, fine_snr_offset;
+    int snr_offset, lo, hi, step;
     uint8_t bap1[NB_BLOCKS][AC3_MAX_CHANNELS][N/2];
+    uint8_t (*bap_buf[2])[AC3_MAX_CHANNELS][N/2];
+    int cur;
     int16_t psd[NB_BLOCKS][AC3_MAX_CHANNELS][N/2];
     int16_t mask[NB_BLOCKS][AC3_MAX_CHANNELS][50];
     static const int frame_bits_inc[8] = { 0, 0, 2, 2, 2, 4, 2, 4 };
@@ -552,39 +407,59 @@ static int compute_bit_allocation(AC3EncodeContext *s,
     /* now the big work begins : do the bit allocation. Modify the snr
        offset until we can pack everything in the requested frame size */
 
-    coarse_snr_offset = s->coarse_snr_offset;
-    while (coarse_snr_offset >= 0 &&
-           bit_alloc(s, mask, psd, bap, frame_bits, coarse_snr_offset, 0) < 0)
-        coarse_snr_offset -= SNR_INC1;
-    if (coarse_snr_offset < 0) {
-        av_log(NULL, AV_LOG_ERROR, "Bit allocation failed. Try increasing the bitrate.\n");
-        return -1;
-    }
-    while ((coarse_snr_offset + SNR_INC1) <= 63 &&
-           bit_alloc(s, mask, psd, bap1, frame_bits,
-                     coarse_snr_offset + SNR_INC1, 0) >= 0) {
-        coarse_snr_offset += SNR_INC1;
-        memcpy(bap, bap1, sizeof(bap1));
-    }
-    while ((coarse_snr_offset + 1) <= 63 &&
-           bit_alloc(s, mask, psd, bap1, frame_bits, coarse_snr_offset + 1, 0) >= 0) {
-        coarse_snr_offset++;
-        memcpy(bap, bap1, sizeof(bap1));
+    /* Bit usage grows monotonically with the combined offset
+       (coarse_snr_offset << 4) + fine_snr_offset, so we look for the largest
+       one that fits: gallop away from the offset used for the previous frame
+       to bracket it, then bisect. bap_buf[cur] always holds the allocation
+       for lo, the other buffer is scratch for the next trial. */
+    bap_buf[0] = bap;
+    bap_buf[1] = bap1;
+    cur = 0;
+    snr_offset = (s->coarse_snr_offset << 4) + s->fine_snr_offset[0];
+    step = SNR_INC1;
+    if (bit_alloc(s, mask, psd, bap_buf[!cur], frame_bits, snr_offset >> 4, snr_offset & 15) >= 0) {
+        cur ^= 1;
+        lo = snr_offset;
+        hi = SNR_OFFSET_MAX + 1;
+        while (lo + step <= SNR_OFFSET_MAX) {
+            if (bit_alloc(s, mask, psd, bap_buf[!cur], frame_bits,
+                          (lo + step) >> 4, (lo + step) & 15) < 0) {
+                hi = lo + step;
+                break;
+            }
+            cur ^= 1;
+            lo += step;
+            step <<= 1;
+        }
+    } else {
+        hi = snr_offset;
+        for (;;) {
+            if (!hi) {
+                av_log(NULL, AV_LOG_ERROR, "Bit allocation failed. Try increasing the bitrate.\n");
+                return -1;
+            }
+            lo = FFMAX(hi - step, 0);
+            if (bit_alloc(s, mask, psd, bap_buf[!cur], frame_bits, lo >> 4, lo & 15) >= 0) {
+                cur ^= 1;
+                break;
+            }
+            hi = lo;
+            step <<= 1;
+        }
     }
-
-    fine_snr_offset = 0;
-    while ((fine_snr_offset + SNR_INC1) <= 15 &&
-           bit_alloc(s, mask, psd, bap1, frame_bits,
-                     coarse_snr_offset, fine_snr_offset + SNR_INC1) >= 0) {
-        fine_snr_offset += SNR_INC1;
-        memcpy(bap, bap1, sizeof(bap1));
+    while (hi - lo > 1) {
+        snr_offset = (lo + hi) >> 1;
+        if (bit_alloc(s, mask, psd, bap_buf[!cur], frame_bits, snr_offset >> 4, snr_offset & 15) >= 0) {
+            cur ^= 1;
+            lo = snr_offset;
+        } else {
+            hi = snr_offset;
+        }
     }
-    while ((fine_snr_offset + 1) <= 15 &&
-           bit_alloc(s, mask, psd, bap1, frame_bits,
-                     coarse_snr_offset, fine_snr_offset + 1) >= 0) {
-        fine_snr_offset++;
+    if (cur)
         memcpy(bap, bap1, sizeof(bap1));
-    }
+    coarse_snr_offset = lo >> 4;
+    fine_snr_offset   = lo & 15;
 
     s->coarse_snr_offset = coarse_snr_offset;
     for(ch=0;ch<s->nb_all_channels;ch++)
@@ -658,7 +533,6 @@ static av_cold int AC3_encode_init(AVCodecContext *avctx)
     int bitrate = avctx->bit_rate;
     AC3EncodeContext *s = avctx->priv_data;
     int i, j, ch;
-    float alpha;
     int bw_code;
 
     avctx->frame_size = AC3_FRAME_SIZE;
@@ -726,13 +600,10 @@ static av_cold int AC3_encode_init(AVCodecContext *avctx)
     /* initial snr offset */
     s->coarse_snr_offset = 40;
 
-    /* mdct init */
-    fft_init(MDCT_NBITS - 2);
-    for(i=0;i<N/4;i++) {
-        alpha = 2 * M_PI * (i + 1.0 / 8.0) / (float)N;
-        xcos1[i] = fix15(-cos(alpha));
-        xsin1[i] = fix15(-sin(alpha));
-    }
+    /* mdct init, scaled like the AC-3 decoder expects: X[k] = -2/N * sum(...) */
+    if (ff_mdct_init(&s->mdct, MDCT_NBITS, 0, -2.0 / N) < 0)
+        return -1;
+    ff_kbd_window_init(s->window, 5.0, N/2);
 
     avctx->coded_frame= avcodec_alloc_frame();
     avctx->coded_frame->key_frame= 1;
@@ -1114,34 +985,6 @@ static unsigned int pow_poly(unsigned int a, unsigned int n, unsigned int poly)
 }
 
 
-/* compute log2(max(abs(tab[]))) */
-static int log2_tab(int16_t *tab, int n)
-{
-    int i, v;
-
-    v = 0;
-    for(i=0;i<n;i++) {
-        v |= abs(tab[i]);
-    }
-    return av_log2(v);
-}
-
-static void lshift_tab(int16_t *tab, int n, int lshift)
-{
-    int i;
-
-    if (lshift > 0) {
-        for(i=0;i<n;i++) {
-            tab[i] <<= lshift;
-        }
-    } else if (lshift < 0) {
-        lshift = -lshift;
-        for(i=0;i<n;i++) {
-            tab[i] >>= lshift;
-        }
-    }
-}
-
 /* fill the end of the frame and compute the two crcs */
 static int output_frame_end(AC3EncodeContext *s)
 {
@@ -1183,7 +1026,7 @@ static int AC3_encode_frame(AVCodecContext *avctx,
     AC3EncodeContext *s = avctx->priv_data;
     const int16_t *samples = data;
     int i, j, k, v, ch;
-    int16_t input_samples[N];
+    FFTSample *input_samples = s->windowed_samples;
     int32_t mdct_coef[NB_BLOCKS][AC3_MAX_CHANNELS][N/2];
     uint8_t exp[NB_BLOCKS][AC3_MAX_CHANNELS][N/2];
     uint8_t exp_strategy[NB_BLOCKS][AC3_MAX_CHANNELS];
@@ -1199,36 +1042,34 @@ static int AC3_encode_frame(AVCodecContext *avctx,
         for(i=0;i<NB_BLOCKS;i++) {
             const int16_t *sptr;
             int sinc;
+            float max_abs, scale;
 
-            /* compute input samples */
-            memcpy(input_samples, s->last_samples[ich], N/2 * sizeof(int16_t));
+            /* compute input samples and apply the MDCT window */
             sinc = s->nb_all_channels;
             sptr = samples + (sinc * (N/2) * i) + ich;
             for(j=0;j<N/2;j++) {
                 v = *sptr;
-                input_samples[j + N/2] = v;
+                input_samples[j]       = s->last_samples[ich][j] * s->window[j];
+                input_samples[j + N/2] = v * s->window[N/2-1-j];
                 s->last_samples[ich][j] = v;
                 sptr += sinc;
             }
 
-            /* apply the MDCT window */
-            for(j=0;j<N/2;j++) {
-                input_samples[j] = MUL16(input_samples[j],
-                                         ff_ac3_window[j]) >> 15;
-                input_samples[N-j-1] = MUL16(input_samples[N-j-1],
-                                             ff_ac3_window[j]) >> 15;
-            }
-
-            /* Normalize the samples to use the maximum available
-               precision */
-            v = 14 - log2_tab(input_samples, N);
+            /* Normalize the coefficients to use the maximum available
+               precision of the fixed point quantizer */
+            max_abs = 0;
+            for(j=0;j<N;j++)
+                max_abs = FFMAX(max_abs, fabsf(input_samples[j]));
+            v = 14 - av_log2((int)max_abs);
             if (v < 0)
                 v = 0;
             exp_samples[i][ch] = v - 9;
-            lshift_tab(input_samples, N, v);
 
             /* do the MDCT */
-            mdct512(mdct_coef[i][ch], input_samples);
+            ff_mdct_calc(&s->mdct, s->mdct_out, input_samples);
+            scale = 1 << v;
+            for(j=0;j<N/2;j++)
+                mdct_coef[i][ch][j] = lrintf(s->mdct_out[j] * scale);
 
             /* compute "exponents". We take into account the
                normalization there */
@@ -1294,103 +1135,12 @@ static int AC3_encode_frame(AVCodecContext *avctx,
 
 static av_cold int AC3_encode_close(AVCodecContext *avctx)
 {
+    AC3EncodeContext *s = avctx->priv_data;
+    ff_mdct_end(&s->mdct);
     av_freep(&avctx->coded_frame);
     return 0;
 }
 
-#if 0
-/*************************************************************************/
-/* TEST */
-
-#undef random
-#define FN (N/4)
-
-void fft_test(void)
-{
-    IComplex in[FN], in1[FN];
-    int k, n, i;
-    float sum_re, sum_im, a;
-
-    /* FFT test */
-
-    for(i=0;i<FN;i++) {
-        in[i].re = random() % 65535 - 32767;
-        in[i].im = random() % 65535 - 32767;
-        in1[i] = in[i];
-    }
-    fft(in, 7);
-
-    /* do it by hand */
-    for(k=0;k<FN;k++) {
-        sum_re = 0;
-        sum_im = 0;
-        for(n=0;n<FN;n++) {
-            a = -2 * M_PI * (n * k) / FN;
-            sum_re += in1[n].re * cos(a) - in1[n].im * sin(a);
-            sum_im += in1[n].re * sin(a) + in1[n].im * cos(a);
-        }
-        printf("%3d: %6d,%6d %6.0f,%6.0f\n",
-               k, in[k].re, in[k].im, sum_re / FN, sum_im / FN);
-    }
-}
-
-void mdct_test(void)
-{
-    int16_t input[N];
-    int32_t output[N/2];
-    float input1[N];
-    float output1[N/2];
-    float s, a, err, e, emax;
-    int i, k, n;
-
-    for(i=0;i<N;i++) {
-        input[i] = (random() % 65535 - 32767) * 9 / 10;
-        input1[i] = input[i];
-    }
-
-    mdct512(output, input);
-
-    /* do it by hand */
-    for(k=0;k<N/2;k++) {
-        s = 0;
-        for(n=0;n<N;n++) {
-            a = (2*M_PI*(2*n+1+N/2)*(2*k+1) / (4 * N));
-            s += input1[n] * cos(a);
-        }
-        output1[k] = -2 * s / N;
-    }
-
-    err = 0;
-    emax = 0;
-    for(i=0;i<N/2;i++) {
-        printf("%3d: %7d %7.0f\n", i, output[i], output1[i]);
-        e = output[i] - output1[i];
-        if (e > emax)
-            emax = e;
-        err += e * e;
-    }
-    printf("err2=%f emax=%f\n", err / (N/2), emax);
-}
-
-void test_ac3(void)
-{
-    AC3EncodeContext ctx;
-    unsigned char frame[AC3_MAX_CODED_FRAME_SIZE];
-    short samples[AC3_FRAME_SIZE];
-    int ret, i;
-
-    AC3_encode_init(&ctx, 44100, 64000, 1);
-
-    fft_test();
-    mdct_test();
-
-    for(i=0;i<AC3_FRAME_SIZE;i++)
-        samples[i] = (int)(sin(2*M_PI*i*1000.0/44100) * 10000);
-    ret = AC3_encode_frame(&ctx, frame, samples);
-    printf("ret=%d\n", ret);
-}
-#endif
-
 AVCodec ac3_encoder = {
     "ac3",
     AVMEDIA_TYPE_AUDIO,
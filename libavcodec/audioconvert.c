@@ -27,6 +27,7 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/libm.h"
+#include "libavutil/mathematics.h"
 #include "avcodec.h"
 #include "audioconvert.h"
 
@@ -171,39 +172,304 @@ int avcodec_channel_layout_num_channels(int64_t channel_layout)
     return count;
 }
 
-struct AVAudioConvert {
-    int in_channels, out_channels;
-    int fmt_pair;
-};
+static int mix_to(float *matrix, int in_channels, int64_t out_layout,
+                  int in_ch, int64_t target, double coeff)
+{
+    int i, o;
+
+    if (!target || (out_layout & target) != target)
+        return 0;
+    for (i = 0, o = 0; i < 64; i++) {
+        if (!(out_layout & (1LL << i)))
+            continue;
+        if (target & (1LL << i))
+            matrix[o*in_channels + in_ch] += coeff;
+        o++;
+    }
+    return 1;
+}
+
+int av_audio_convert_matrix(float *matrix, int64_t out_layout, int64_t in_layout)
+{
+    int in_channels  = avcodec_channel_layout_num_channels(in_layout);
+    int out_channels = avcodec_channel_layout_num_channels(out_layout);
+    int i, in_ch, o;
+    float max = 0;
+
+    if (!in_channels  || in_channels  > 6 ||
+        !out_channels || out_channels > 6)
+        return -1;
+    memset(matrix, 0, in_channels*out_channels*sizeof(*matrix));
+
+    for (i = 0, in_ch = 0; i < 64; i++) {
+        int64_t ch = 1LL << i, left, side, back;
+        if (!(in_layout & ch))
+            continue;
+        left = ch & (CH_FRONT_LEFT | CH_FRONT_LEFT_OF_CENTER |
+                     CH_BACK_LEFT  | CH_SIDE_LEFT);
+        side = left ? CH_SIDE_LEFT  : CH_SIDE_RIGHT;
+        back = left ? CH_BACK_LEFT  : CH_BACK_RIGHT;
+
+        if (out_layout & ch) {
+            mix_to(matrix, in_channels, out_layout, in_ch, ch, 1.0);
+        } else switch (ch) {
+        case CH_FRONT_CENTER:
+            mix_to(matrix, in_channels, out_layout, in_ch, CH_LAYOUT_STEREO, M_SQRT1_2);
+            break;
+        case CH_FRONT_LEFT:
+        case CH_FRONT_RIGHT:
+            mix_to(matrix, in_channels, out_layout, in_ch, CH_FRONT_CENTER, M_SQRT1_2);
+            break;
+        case CH_FRONT_LEFT_OF_CENTER:
+        case CH_FRONT_RIGHT_OF_CENTER:
+            if (!mix_to(matrix, in_channels, out_layout, in_ch,
+                        left ? CH_FRONT_LEFT : CH_FRONT_RIGHT, 1.0))
+                mix_to(matrix, in_channels, out_layout, in_ch, CH_FRONT_CENTER, M_SQRT1_2);
+            break;
+        case CH_BACK_LEFT:
+        case CH_BACK_RIGHT:
+        case CH_SIDE_LEFT:
+        case CH_SIDE_RIGHT:
+            if (!mix_to(matrix, in_channels, out_layout, in_ch, ch == side ? back : side, 1.0) &&
+                !mix_to(matrix, in_channels, out_layout, in_ch, CH_BACK_CENTER, M_SQRT1_2)     &&
+                !mix_to(matrix, in_channels, out_layout, in_ch,
+                        left ? CH_FRONT_LEFT : CH_FRONT_RIGHT, M_SQRT1_2))
+                mix_to(matrix, in_channels, out_layout, in_ch, CH_FRONT_CENTER, 0.5);
+            break;
+        case CH_BACK_CENTER:
+            if (!mix_to(matrix, in_channels, out_layout, in_ch,
+                        CH_BACK_LEFT | CH_BACK_RIGHT, M_SQRT1_2)                               &&
+                !mix_to(matrix, in_channels, out_layout, in_ch,
+                        CH_SIDE_LEFT | CH_SIDE_RIGHT, M_SQRT1_2)                               &&
+                !mix_to(matrix, in_channels, out_layout, in_ch, CH_LAYOUT_STEREO, 0.5))
+                mix_to(matrix, in_channels, out_layout, in_ch, CH_FRONT_CENTER, M_SQRT1_2);
+            break;
+        /* LFE and the other channels are dropped */
+        }
+        in_ch++;
+    }
+
+    for (o = 0; o < out_channels; o++) {
+        float sum = 0;
+        for (i = 0; i < in_channels; i++)
+            sum += FFABS(matrix[o*in_channels + i]);
+        max = FFMAX(max, sum);
+    }
+    if (max > 1)
+        for (i = 0; i < in_channels*out_channels; i++)
+            matrix[i] /= max;
+    return 0;
+}
+
+#define CONV_CONTIG(name, otype, itype, expr)                               \
+static void name(uint8_t *dst, const uint8_t *src, int len)                 \
+{                                                                           \
+    otype *po = (otype*)dst;                                                \
+    const itype *pi = (const itype*)src;                                    \
+    int i;                                                                  \
+    for (i = 0; i < len; i++)                                               \
+        po[i] = expr;                                                       \
+}
+
+CONV_CONTIG(conv_s16_to_flt, float  , int16_t, pi[i]*(1.0 / (1<<15)))
+CONV_CONTIG(conv_flt_to_s16, int16_t, float  , av_clip_int16(lrintf(pi[i] * (1<<15))))
+
+static void mix_c(AVAudioConvert *ctx, float * const *out,
+                  const float * const *in, int len)
+{
+    int o, k, i;
+
+    for (o = 0; o < ctx->out_channels; o++) {
+        const int    *idx   = ctx->coeff_idx[o];
+        const float  *coeff = ctx->coeff[o];
+        float *dst = out[o];
+
+        if (!dst)
+            continue;
+        for (i = 0; i < len; i++) {
+            float sum = 0;
+            for (k = 0; k < ctx->nb_coeffs[o]; k++)
+                sum += coeff[k] * in[idx[k]][i];
+            dst[i] = sum;
+        }
+    }
+}
 
 AVAudioConvert *av_audio_convert_alloc(enum SampleFormat out_fmt, int out_channels,
                                        enum SampleFormat in_fmt, int in_channels,
                                        const float *matrix, int flags)
 {
     AVAudioConvert *ctx;
-    if (in_channels!=out_channels)
-        return NULL;  /* FIXME: not supported */
-    ctx = av_malloc(sizeof(AVAudioConvert));
+    int o, i;
+
+    if ((unsigned)in_fmt  >= SAMPLE_FMT_NB ||
+        (unsigned)out_fmt >= SAMPLE_FMT_NB)
+        return NULL;
+    if (matrix ? in_channels  <= 0 || in_channels  > 6 ||
+                 out_channels <= 0 || out_channels > 6
+               : in_channels != out_channels)
+        return NULL;
+    ctx = av_mallocz(sizeof(AVAudioConvert));
     if (!ctx)
         return NULL;
     ctx->in_channels = in_channels;
     ctx->out_channels = out_channels;
     ctx->fmt_pair = out_fmt + SAMPLE_FMT_NB*in_fmt;
+    ctx->in_fmt   = in_fmt;
+    ctx->out_fmt  = out_fmt;
+    ctx->in_size  = av_get_bits_per_sample_format(in_fmt)  >> 3;
+    ctx->out_size = av_get_bits_per_sample_format(out_fmt) >> 3;
+
+    if (matrix) {
+        ctx->remix = 1;
+        for (o = 0; o < out_channels; o++)
+            for (i = 0; i < in_channels; i++) {
+                float c = matrix[o*in_channels + i];
+                if (c) {
+                    ctx->coeff_idx[o][ctx->nb_coeffs[o]  ] = i;
+                    ctx->coeff    [o][ctx->nb_coeffs[o]++] = c;
+                }
+            }
+        ctx->mix = mix_c;
+        if (!(ctx->to_flt   = av_audio_convert_alloc(SAMPLE_FMT_FLT, 1, in_fmt, 1, NULL, flags)) ||
+            !(ctx->from_flt = av_audio_convert_alloc(out_fmt, 1, SAMPLE_FMT_FLT, 1, NULL, flags))) {
+            av_audio_convert_free(ctx);
+            return NULL;
+        }
+    } else {
+        if (ctx->fmt_pair == SAMPLE_FMT_FLT + SAMPLE_FMT_NB*SAMPLE_FMT_S16)
+            ctx->conv_contig = conv_s16_to_flt;
+        if (ctx->fmt_pair == SAMPLE_FMT_S16 + SAMPLE_FMT_NB*SAMPLE_FMT_FLT)
+            ctx->conv_contig = conv_flt_to_s16;
+    }
+
+    if (!flags)
+        flags = av_get_cpu_flags();
+#if HAVE_MMX
+    ff_audio_convert_init_mmx(ctx, flags);
+#endif
     return ctx;
 }
 
 void av_audio_convert_free(AVAudioConvert *ctx)
 {
+    if (ctx) {
+        av_audio_convert_free(ctx->to_flt);
+        av_audio_convert_free(ctx->from_flt);
+    }
     av_free(ctx);
 }
 
+static int convert_channel(AVAudioConvert *ctx, void *dst, int dst_stride,
+                           const void *src, int src_stride, int len)
+{
+    void       *out[6]        = { dst };
+    const void *in[6]         = { src };
+    const int   out_stride[6] = { dst_stride };
+    const int   in_stride[6]  = { src_stride };
+
+    return av_audio_convert(ctx, out, out_stride, in, in_stride, len);
+}
+
+static int remix(AVAudioConvert *ctx,
+                       void * const out[6], const int out_stride[6],
+                 const void * const  in[6], const int  in_stride[6], int len)
+{
+    const float *mix_in[6];
+    float *mix_out[6];
+    int off, ch;
+
+    for (off = 0; off < len; off += AUDIO_MIX_BLOCK) {
+        int n = FFMIN(len - off, AUDIO_MIX_BLOCK);
+
+        for (ch = 0; ch < ctx->in_channels; ch++) {
+            const uint8_t *src = (const uint8_t*)in[ch] + off*in_stride[ch];
+            if (ctx->in_fmt == SAMPLE_FMT_FLT && in_stride[ch] == sizeof(float)) {
+                mix_in[ch] = (const float*)src;
+            } else {
+                if (convert_channel(ctx->to_flt, ctx->mix_buf[ch], sizeof(float),
+                                    src, in_stride[ch], n) < 0)
+                    return -1;
+                mix_in[ch] = ctx->mix_buf[ch];
+            }
+        }
+        for (ch = 0; ch < ctx->out_channels; ch++) {
+            if (!out[ch])
+                mix_out[ch] = NULL;
+            else if (ctx->out_fmt == SAMPLE_FMT_FLT && out_stride[ch] == sizeof(float))
+                mix_out[ch] = (float*)out[ch] + off;
+            else
+                mix_out[ch] = ctx->mix_buf[6 + ch];
+        }
+
+        ctx->mix(ctx, mix_out, mix_in, n);
+
+        for (ch = 0; ch < ctx->out_channels; ch++) {
+            if (!mix_out[ch] || mix_out[ch] != ctx->mix_buf[6 + ch])
+                continue;
+            if (convert_channel(ctx->from_flt,
+                                (uint8_t*)out[ch] + off*out_stride[ch], out_stride[ch],
+                                mix_out[ch], sizeof(float), n) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @return 1 if the first channels buffers of ptr are interleaved without
+ * gaps, starting at ptr[0]
+ */
+static int is_interleaved(const void * const ptr[6], const int stride[6],
+                          int channels, int size)
+{
+    int ch;
+    for (ch = 0; ch < channels; ch++)
+        if (!ptr[ch] || stride[ch] != size*channels ||
+            (const uint8_t*)ptr[ch] != (const uint8_t*)ptr[0] + ch*size)
+            return 0;
+    return 1;
+}
+
 int av_audio_convert(AVAudioConvert *ctx,
                            void * const out[6], const int out_stride[6],
                      const void * const  in[6], const int  in_stride[6], int len)
 {
     int ch;
 
-    //FIXME optimize common cases
+    if (ctx->remix)
+        return remix(ctx, out, out_stride, in, in_stride, len);
+
+    if (len <= 0)
+        return 0;
+
+    if (ctx->conv_contig) {
+        /* interleaved buffers are just one long contiguous channel */
+        if (ctx->in_channels > 1 &&
+            is_interleaved(in, in_stride, ctx->in_channels, ctx->in_size) &&
+            is_interleaved((const void * const *)out, out_stride,
+                           ctx->out_channels, ctx->out_size)) {
+            ctx->conv_contig(out[0], in[0], len*ctx->in_channels);
+            return 0;
+        }
+    }
+
+    if (ctx->in_channels == 2 && ctx->in_fmt == ctx->out_fmt &&
+        out[0] && out[1]) {
+        const int size = ctx->in_size;
+        if (ctx->interleave2 &&
+            in_stride[0] == size && in_stride[1] == size &&
+            is_interleaved((const void * const *)out, out_stride, 2, size)) {
+            ctx->interleave2(out[0], in[0], in[1], len);
+            return 0;
+        }
+        if (ctx->deinterleave2 &&
+            out_stride[0] == size && out_stride[1] == size &&
+            is_interleaved(in, in_stride, 2, size)) {
+            ctx->deinterleave2(out[0], out[1], in[0], len);
+            return 0;
+        }
+    }
 
     for(ch=0; ch<ctx->out_channels; ch++){
         const int is=  in_stride[ch];
@@ -214,6 +480,11 @@ int av_audio_convert(AVAudioConvert *ctx,
         if(!out[ch])
             continue;
 
+        if (ctx->conv_contig && is == ctx->in_size && os == ctx->out_size) {
+            ctx->conv_contig(po, pi, len);
+            continue;
+        }
+
 #define CONV(ofmt, otype, ifmt, expr)\
 if(ctx->fmt_pair == ofmt + SAMPLE_FMT_NB*ifmt){\
     do{\
@@ -237,8 +508,8 @@ if(ctx->fmt_pair == ofmt + SAMPLE_FMT_NB*ifmt){\
         else CONV(SAMPLE_FMT_U8 , uint8_t, SAMPLE_FMT_S32, (*(const int32_t*)pi>>24) + 0x80)
         else CONV(SAMPLE_FMT_S16, int16_t, SAMPLE_FMT_S32,  *(const int32_t*)pi>>16)
         else CONV(SAMPLE_FMT_S32, int32_t, SAMPLE_FMT_S32,  *(const int32_t*)pi)
-        else CONV(SAMPLE_FMT_FLT, float  , SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1<<31)))
-        else CONV(SAMPLE_FMT_DBL, double , SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1<<31)))
+        else CONV(SAMPLE_FMT_FLT, float  , SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
+        else CONV(SAMPLE_FMT_DBL, double , SAMPLE_FMT_S32,  *(const int32_t*)pi*(1.0 / (1U<<31)))
         else CONV(SAMPLE_FMT_U8 , uint8_t, SAMPLE_FMT_FLT, av_clip_uint8(  lrintf(*(const float*)pi * (1<<7)) + 0x80))
         else CONV(SAMPLE_FMT_S16, int16_t, SAMPLE_FMT_FLT, av_clip_int16(  lrintf(*(const float*)pi * (1<<15))))
         else CONV(SAMPLE_FMT_S32, int32_t, SAMPLE_FMT_FLT, av_clipl_int32(llrintf(*(const float*)pi * (1U<<31))))
@@ -253,3 +524,161 @@ if(ctx->fmt_pair == ofmt + SAMPLE_FMT_NB*ifmt){\
     }
     return 0;
 }
+
+#ifdef TEST
+
+#include <stdio.h>
+#include "libavutil/crc.h"
+#include "libavutil/lfg.h"
+
+#undef printf
+#undef fprintf
+
+/* not a multiple of 8 samples nor of AUDIO_MIX_BLOCK, for the tails */
+#define LEN 1003
+
+static void fill(AVLFG *lfg, uint8_t *buf, enum SampleFormat fmt, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        switch (fmt) {
+        case SAMPLE_FMT_S16: ((int16_t*)buf)[i] = av_lfg_get(lfg);             break;
+        case SAMPLE_FMT_S32: ((int32_t*)buf)[i] = av_lfg_get(lfg);             break;
+        /* in [-1, 1), the SIMD code only differs for out of range values */
+        case SAMPLE_FMT_FLT: ((float  *)buf)[i] = (int)av_lfg_get(lfg) / 2147483648.0; break;
+        default:             buf[i] = av_lfg_get(lfg);                         break;
+        }
+    }
+}
+
+/**
+ * Set up the channel pointers of a buffer, either interleaved or with
+ * 16 byte aligned planes, like the ones of a decoder.
+ */
+static void set_channels(uint8_t *buf, int channels, int size, int planar,
+                         uint8_t *ptr[6], int stride[6])
+{
+    int ch;
+    for (ch = 0; ch < channels; ch++) {
+        ptr[ch]    = buf + ch * (planar ? FFALIGN(LEN * size, 16) : size);
+        stride[ch] = planar ? size : size * channels;
+    }
+}
+
+/**
+ * Convert random samples once with the code picked for the CPU and once
+ * with the C code only, and compare.
+ */
+static int test_convert(const char *name,
+                        enum SampleFormat out_fmt, int out_channels, int out_planar,
+                        enum SampleFormat  in_fmt, int  in_channels, int  in_planar,
+                        const float *matrix)
+{
+    const int in_size  = av_get_bits_per_sample_format(in_fmt)  >> 3;
+    const int out_size = av_get_bits_per_sample_format(out_fmt) >> 3;
+    const int in_buf_size  = 6 * FFALIGN(LEN *  in_size, 16);
+    const int out_buf_size = 6 * FFALIGN(LEN * out_size, 16);
+    uint8_t *in_buf = av_malloc(in_buf_size);
+    uint8_t *out_buf[2] = { av_mallocz(out_buf_size), av_mallocz(out_buf_size) };
+    uint8_t *in[6], *out[6];
+    int in_stride[6], out_stride[6];
+    int j, ret = 0;
+    AVLFG lfg;
+
+    if (!in_buf || !out_buf[0] || !out_buf[1]) {
+        fprintf(stderr, "cannot allocate the buffers\n");
+        return 1;
+    }
+    av_lfg_init(&lfg, in_fmt + 8 * in_channels);
+    fill(&lfg, in_buf, in_fmt, in_buf_size / in_size);
+    set_channels(in_buf, in_channels, in_size, in_planar, in, in_stride);
+
+    for (j = 0; j < 2; j++) {
+        AVAudioConvert *ctx = av_audio_convert_alloc(out_fmt, out_channels,
+                                                     in_fmt, in_channels, matrix,
+                                                     j ? AV_CPU_FLAG_FORCE : 0);
+        if (!ctx) {
+            fprintf(stderr, "%s: cannot create the converter\n", name);
+            return 1;
+        }
+        set_channels(out_buf[j], out_channels, out_size, out_planar, out, out_stride);
+        if (av_audio_convert(ctx, (void * const *)out, out_stride,
+                             (const void * const *)in, in_stride, LEN) < 0) {
+            fprintf(stderr, "%s: conversion failed\n", name);
+            ret = 1;
+        }
+        av_audio_convert_free(ctx);
+    }
+
+    if (memcmp(out_buf[0], out_buf[1], out_buf_size)) {
+        printf("%s: differs from C\n", name);
+        ret = 1;
+    }
+    printf("%s: CRC=%08x\n", name,
+           av_crc(av_crc_get_table(AV_CRC_32_IEEE), 0, out_buf[1], out_buf_size));
+
+    av_free(in_buf);
+    av_free(out_buf[0]);
+    av_free(out_buf[1]);
+    return ret;
+}
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        int64_t out_layout, in_layout;
+    } remixes[] = {
+        { "5.1 -> stereo", CH_LAYOUT_STEREO,  CH_LAYOUT_5POINT1 },
+        { "5.1 -> mono",   CH_LAYOUT_MONO,    CH_LAYOUT_5POINT1 },
+        { "stereo -> 5.1", CH_LAYOUT_5POINT1, CH_LAYOUT_STEREO  },
+    };
+    static const struct {
+        const char *name;
+        enum SampleFormat out_fmt, in_fmt;
+    } formats[] = {
+        { "s16 -> flt", SAMPLE_FMT_FLT, SAMPLE_FMT_S16 },
+        { "flt -> s16", SAMPLE_FMT_S16, SAMPLE_FMT_FLT },
+        { "s16 -> s32", SAMPLE_FMT_S32, SAMPLE_FMT_S16 },
+        { "s32 -> s16", SAMPLE_FMT_S16, SAMPLE_FMT_S32 },
+        { "s32 -> flt", SAMPLE_FMT_FLT, SAMPLE_FMT_S32 },
+        { "flt -> s32", SAMPLE_FMT_S32, SAMPLE_FMT_FLT },
+        { "s16 -> s16", SAMPLE_FMT_S16, SAMPLE_FMT_S16 },
+        { "flt -> flt", SAMPLE_FMT_FLT, SAMPLE_FMT_FLT },
+    };
+    float matrix[36];
+    char name[64];
+    int i, ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(remixes); i++) {
+        const int out_channels = avcodec_channel_layout_num_channels(remixes[i].out_layout);
+        const int  in_channels = avcodec_channel_layout_num_channels(remixes[i].in_layout);
+
+        if (av_audio_convert_matrix(matrix, remixes[i].out_layout, remixes[i].in_layout) < 0) {
+            fprintf(stderr, "%s: no matrix\n", remixes[i].name);
+            return 1;
+        }
+        snprintf(name, sizeof(name), "%s, s16 interleaved", remixes[i].name);
+        ret |= test_convert(name, SAMPLE_FMT_S16, out_channels, 0,
+                                  SAMPLE_FMT_S16,  in_channels, 0, matrix);
+        snprintf(name, sizeof(name), "%s, flt planar", remixes[i].name);
+        ret |= test_convert(name, SAMPLE_FMT_FLT, out_channels, 1,
+                                  SAMPLE_FMT_FLT,  in_channels, 1, matrix);
+    }
+    if (av_audio_convert_alloc(SAMPLE_FMT_S16, 2, SAMPLE_FMT_S16, 0, matrix, 0)) {
+        printf("0 input channels accepted with a matrix\n");
+        ret = 1;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        snprintf(name, sizeof(name), "%s, stereo interleaved", formats[i].name);
+        ret |= test_convert(name, formats[i].out_fmt, 2, 0, formats[i].in_fmt, 2, 0, NULL);
+        snprintf(name, sizeof(name), "%s, stereo planar to interleaved", formats[i].name);
+        ret |= test_convert(name, formats[i].out_fmt, 2, 0, formats[i].in_fmt, 2, 1, NULL);
+        snprintf(name, sizeof(name), "%s, stereo interleaved to planar", formats[i].name);
+        ret |= test_convert(name, formats[i].out_fmt, 2, 1, formats[i].in_fmt, 2, 0, NULL);
+    }
+    return ret;
+}
+
+#endif /* TEST */
@@ -30,6 +30,7 @@
 
 
 #include "libavutil/cpu.h"
+#include "libavutil/mem.h"
 #include "avcodec.h"
 
 
@@ -84,8 +85,52 @@ int64_t avcodec_guess_channel_layout(int nb_channels, enum CodecID codec_id, con
  */
 int avcodec_channel_layout_num_channels(int64_t channel_layout);
 
-struct AVAudioConvert;
-typedef struct AVAudioConvert AVAudioConvert;
+/**
+ * Number of samples per channel remixed in one pass.
+ */
+#define AUDIO_MIX_BLOCK 256
+
+/**
+ * Audio converter context.
+ * Only the generic code in audioconvert.c and the arch-specific init
+ * functions should touch the fields.
+ */
+typedef struct AVAudioConvert {
+    int in_channels, out_channels;
+    int fmt_pair;
+    int in_fmt, out_fmt;
+    int in_size, out_size;          ///< bytes per sample
+
+    /**
+     * Convert len samples between two contiguous buffers of the
+     * context sample formats, NULL if there is no fast version.
+     */
+    void (*conv_contig)(uint8_t *dst, const uint8_t *src, int len);
+
+    /**
+     * Interleave two contiguous channels of equal sample format, and the
+     * inverse, NULL if there is no fast version.
+     */
+    void (*interleave2)(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, int len);
+    void (*deinterleave2)(uint8_t *dst0, uint8_t *dst1, const uint8_t *src, int len);
+
+    /**
+     * Remix len contiguous float samples.
+     * Output channel o is the sum of coeff[k]*in[idx[k]] over the
+     * nb_coeffs[o] nonzero coefficients of its matrix row, accumulated
+     * in the row order, starting from 0.
+     */
+    void (*mix)(struct AVAudioConvert *ctx, float * const *out,
+                const float * const *in, int len);
+
+    /* remixing state, only set up when a matrix is given */
+    int remix;
+    int nb_coeffs[6];
+    int coeff_idx[6][6];
+    float coeff[6][6];
+    struct AVAudioConvert *to_flt, *from_flt;
+    DECLARE_ALIGNED(16, float, mix_buf)[12][AUDIO_MIX_BLOCK];
+} AVAudioConvert;
 
 /**
  * Create an audio sample format converter context
@@ -93,14 +138,30 @@ typedef struct AVAudioConvert AVAudioConvert;
  * @param out_channels Number of output channels
  * @param in_fmt Input sample format
  * @param in_channels Number of input channels
- * @param[in] matrix Channel mixing matrix (of dimension in_channel*out_channels). Set to NULL to ignore.
- * @param flags See AV_CPU_FLAG_xx
+ * @param[in] matrix Channel mixing matrix of out_channels rows of in_channels
+ *                   coefficients each, matrix[o*in_channels+i] being the
+ *                   weight of input channel i in output channel o.
+ *                   Set to NULL to ignore, in_channels must then equal
+ *                   out_channels.
+ * @param flags See AV_CPU_FLAG_xx, 0 selects what the running CPU supports
  * @return NULL on error
  */
 AVAudioConvert *av_audio_convert_alloc(enum SampleFormat out_fmt, int out_channels,
                                        enum SampleFormat in_fmt, int in_channels,
                                        const float *matrix, int flags);
 
+/**
+ * Fill a remix matrix for av_audio_convert_alloc() converting
+ * in_layout into out_layout.
+ * Channels missing from the output are folded into their nearest
+ * neighbours with -3dB weights, the LFE is dropped, and the matrix is
+ * normalized so that no output channel can clip.
+ * @param[out] matrix array of at least out_channels*in_channels floats
+ * @return 0 on success, a negative value if a layout is empty or has more
+ *         than 6 channels
+ */
+int av_audio_convert_matrix(float *matrix, int64_t out_layout, int64_t in_layout);
+
 /**
  * Free audio sample format converter context
  */
@@ -113,9 +174,12 @@ void av_audio_convert_free(AVAudioConvert *ctx);
  * @param[in] in array of input buffers for each channel
  * @param[in] in_stride distance between consecutive input samples (measured in bytes)
  * @param len length of audio frame size (measured in samples)
+ * @return 0 on success, a negative value if the conversion is not supported
  */
 int av_audio_convert(AVAudioConvert *ctx,
                            void * const out[6], const int out_stride[6],
                      const void * const  in[6], const int  in_stride[6], int len);
 
+void ff_audio_convert_init_mmx(AVAudioConvert *ctx, int flags);
+
 #endif /* AVCODEC_AUDIOCONVERT_H */
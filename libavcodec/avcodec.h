@@ -31,7 +31,7 @@
 #include "libavutil/cpu.h"
 
 #define LIBAVCODEC_VERSION_MAJOR 52
-#define LIBAVCODEC_VERSION_MINOR 89
+#define LIBAVCODEC_VERSION_MINOR 92
 #define LIBAVCODEC_VERSION_MICRO  0
 
 #define LIBAVCODEC_VERSION_INT  AV_VERSION_INT(LIBAVCODEC_VERSION_MAJOR, \
@@ -961,6 +961,13 @@ typedef struct AVPanScan{
      * - decoding: Set by libavcodec\
      */\
     void *hwaccel_picture_private;\
+\
+    /**\
+     * buffer pool entry backing a picture from avcodec_default_get_buffer()\
+     * - encoding: Set by libavcodec.\
+     * - decoding: Set by libavcodec.\
+     */\
+    void *internal_buffer;\
 
 
 #define FF_QSCALE_TYPE_MPEG1 0
@@ -3056,6 +3063,21 @@ struct AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter
  */
 int av_resample(struct AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx);
 
+/**
+ * Resample interleaved samples of several channels in one pass, this is
+ * faster than calling av_resample() once per deinterleaved channel.
+ * @param src an array of unconsumed interleaved samples
+ * @param consumed the number of samples per channel of src which have been consumed are returned here
+ * @param src_size the number of unconsumed samples per channel available
+ * @param dst_size the amount of space in samples per channel available in dst
+ * @param channels the number of interleaved channels in src and dst, at most 8
+ * @param update_ctx If this is 0 then the context will not be modified.
+ * @return the number of samples per channel written in dst or -1 if an error occurred
+ */
+int av_resample_interleaved(struct AVResampleContext *c, short *dst, const short *src,
+                            int *consumed, int src_size, int dst_size,
+                            int channels, int update_ctx);
+
 
 /**
  * Compensate samplerate/timestamp drift. The compensation is done by changing
@@ -3378,6 +3400,25 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic);
 void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic);
 int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic);
 
+/**
+ * Add a reference to a picture allocated by avcodec_default_get_buffer().
+ * The picture's buffer is not handed out again until all references
+ * have been dropped, so decoded frames can be passed on to filters or
+ * encoders without copying them, even after the decoder released the
+ * picture or the codec context was closed.
+ * The buffer pool is thread safe if a lock manager has been registered
+ * with av_lockmgr_register().
+ *
+ * @return 0 on success, a negative value if pic is not an internal buffer
+ */
+int avcodec_default_ref_buffer(AVFrame *pic);
+
+/**
+ * Drop a reference added with avcodec_default_ref_buffer() and clear the
+ * data pointers of pic.
+ */
+void avcodec_default_unref_buffer(AVFrame *pic);
+
 /**
  * Return the amount of padding in pixels which the get_buffer callback must
  * provide around the edge of the image for codecs which do not have the
@@ -2817,6 +2817,14 @@ static inline int pix_abs16_c(void *v, uint8_t *pix1, uint8_t *pix2, int line_si
     return s;
 }
 
+static void sad16_x4_c(uint8_t *blk, uint8_t *ref[4], int line_size, int h, int *scores)
+{
+    int i;
+
+    for(i=0; i<4; i++)
+        scores[i]= pix_abs16_c(NULL, blk, ref[i], line_size, h);
+}
+
 static int pix_abs16_x2_c(void *v, uint8_t *pix1, uint8_t *pix2, int line_size, int h)
 {
     int s, i;
@@ -3758,6 +3766,29 @@ static void vector_fmul_c(float *dst, const float *src, int len){
         dst[i] *= src[i];
 }
 
+static void aac_abs_pow34_c(float *out, const float *in, int size)
+{
+    int i;
+    for (i = 0; i < size; i++) {
+        float a = fabsf(in[i]);
+        out[i] = sqrtf(a * sqrtf(a));
+    }
+}
+
+static void aac_quantize_bands_c(int *out, const float *in, const float *scaled,
+                                 int size, float Q34, int is_signed, int maxval)
+{
+    int i;
+    double qc;
+    for (i = 0; i < size; i++) {
+        qc = scaled[i] * Q34;
+        out[i] = (int)FFMIN(qc + 0.4054, (double)maxval);
+        if (is_signed && in[i] < 0.0f) {
+            out[i] = -out[i];
+        }
+    }
+}
+
 static void vector_fmul_reverse_c(float *dst, const float *src0, const float *src1, int len){
     int i;
     src1 += len-1;
@@ -4240,6 +4271,7 @@ av_cold void dsputil_init(DSPContext* c, AVCodecContext *avctx)
     c->pix_abs[1][1] = pix_abs8_x2_c;
     c->pix_abs[1][2] = pix_abs8_y2_c;
     c->pix_abs[1][3] = pix_abs8_xy2_c;
+    c->sad16_x4 = sad16_x4_c;
 
 #define dspfunc(PFX, IDX, NUM) \
     c->PFX ## _pixels_tab[IDX][0] = PFX ## _pixels ## NUM ## _c;     \
@@ -4434,7 +4466,11 @@ av_cold void dsputil_init(DSPContext* c, AVCodecContext *avctx)
 #endif
 #if CONFIG_LPC
     c->lpc_compute_autocorr = ff_lpc_compute_autocorr;
+    c->lpc_compute_residual = ff_lpc_compute_residual;
+    c->lpc_rice_partition_sums = ff_lpc_rice_partition_sums;
 #endif
+    c->aac_abs_pow34 = aac_abs_pow34_c;
+    c->aac_quantize_bands = aac_quantize_bands_c;
     c->vector_fmul = vector_fmul_c;
     c->vector_fmul_reverse = vector_fmul_reverse_c;
     c->vector_fmul_add = vector_fmul_add_c;
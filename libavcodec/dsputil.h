@@ -339,6 +339,16 @@ typedef struct DSPContext {
 
     me_cmp_func pix_abs[2][4];
 
+    /**
+     * Compute the SAD of one 16 pixel wide block against 4 candidate blocks.
+     * The source rows are loaded once and compared against all candidates,
+     * which is cheaper than 4 separate pix_abs[0][0] calls.
+     * @param blk    source block
+     * @param ref    the 4 candidate blocks (align 1)
+     * @param scores receives the SAD of each candidate
+     */
+    void (*sad16_x4)(uint8_t *blk, uint8_t *ref[4], int line_size, int h, int *scores);
+
     /* huffyuv specific */
     void (*add_bytes)(uint8_t *dst/*align 16*/, uint8_t *src/*align 16*/, int w);
     void (*add_bytes_l2)(uint8_t *dst/*align 16*/, uint8_t *src1/*align 16*/, uint8_t *src2/*align 16*/, int w);
@@ -370,8 +380,33 @@ typedef struct DSPContext {
     /* assume len is a multiple of 4, and arrays are 16-byte aligned */
     void (*vorbis_inverse_coupling)(float *mag, float *ang, int blocksize);
     void (*ac3_downmix)(float (*samples)[256], float (*matrix)[2], int out_ch, int in_ch, int len);
+    /* AAC encoder */
+    /**
+     * Compute out[i] = |in[i]|^(3/4).
+     * @param size multiple of 4
+     */
+    void (*aac_abs_pow34)(float *out, const float *in, int size);
+    /**
+     * Quantize scaled = |in|^(3/4) coefficients with the AAC rounding offset,
+     * clipped to maxval and optionally carrying the sign of in.
+     * @param size multiple of 4
+     */
+    void (*aac_quantize_bands)(int *out, const float *in, const float *scaled,
+                               int size, float Q34, int is_signed, int maxval);
     /* no alignment needed */
     void (*lpc_compute_autocorr)(const int32_t *data, int len, int lag, double *autoc);
+    /**
+     * Compute the LPC prediction residual of n samples. The first order
+     * samples are copied as warm-up; res must have room for n+1 values.
+     */
+    void (*lpc_compute_residual)(int32_t *res, const int32_t *smp, int n,
+                                 int order, const int32_t *coefs, int shift);
+    /**
+     * Sum the rice-mapped residual over the 2^porder partitions of a block
+     * of n samples, skipping the first pred_order samples.
+     */
+    void (*lpc_rice_partition_sums)(uint32_t *sums, const int32_t *res, int n,
+                                    int porder, int pred_order);
     /* assume len is a multiple of 8, and arrays are 16-byte aligned */
     void (*vector_fmul)(float *dst, const float *src, int len);
     void (*vector_fmul_reverse)(float *dst, const float *src0, const float *src1, int len);
@@ -25,6 +25,7 @@
  * FF Video Codec 1 (a lossless codec)
  */
 
+#include "libavutil/intreadwrite.h"
 #include "avcodec.h"
 #include "get_bits.h"
 #include "put_bits.h"
@@ -35,6 +36,7 @@
 
 #define MAX_PLANES 4
 #define CONTEXT_SIZE 32
+#define MAX_SLICES 256
 
 extern const uint8_t ff_log2_run[32];
 
@@ -239,6 +241,15 @@ typedef struct FFV1Context{
     int colorspace;
     int_fast16_t *sample_buffer;
 
+    struct FFV1Context *slice_context[MAX_SLICES];
+    int slice_count;
+    int num_v_slices;
+    int num_h_slices;
+    int slice_width;
+    int slice_height;
+    int slice_x;
+    int slice_y;
+
     DSPContext dsp;
 }FFV1Context;
 
@@ -617,6 +628,32 @@ static void write_header(FFV1Context *f){
     for(i=0; i<5; i++)
         write_quant_table(c, f->quant_table[i]);
 }
+
+/**
+ * Store the version 2 header, which also describes the slice layout,
+ * in extradata instead of repeating it in every keyframe.
+ */
+static av_cold int write_extra_header(FFV1Context *f){
+    RangeCoder * const c= &f->c;
+    uint8_t state[CONTEXT_SIZE];
+    int size= 16384;
+
+    memset(state, 128, sizeof(state));
+
+    f->avctx->extradata= av_mallocz(size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if(!f->avctx->extradata)
+        return AVERROR(ENOMEM);
+    ff_init_range_encoder(c, f->avctx->extradata, size);
+    ff_build_rac_states(c, 0.05*(1LL<<32), 256-8);
+
+    write_header(f);
+    put_symbol(c, state, f->num_h_slices-1, 0);
+    put_symbol(c, state, f->num_v_slices-1, 0);
+
+    f->avctx->extradata_size= ff_rac_terminate(c);
+
+    return 0;
+}
 #endif /* CONFIG_FFV1_ENCODER */
 
 static av_cold int common_init(AVCodecContext *avctx){
@@ -632,13 +669,99 @@ static av_cold int common_init(AVCodecContext *avctx){
 
     assert(s->width && s->height);
 
-    s->sample_buffer = av_malloc(6 * (s->width+6) * sizeof(*s->sample_buffer));
-    if (!s->sample_buffer)
-        return AVERROR(ENOMEM);
+    return 0;
+}
+
+/**
+ * Position of the n-th of num slice boundaries along a dimension of the
+ * given size, aligned so that chroma planes are split at the same lines.
+ */
+static int slice_pos(int size, int n, int num, int shift){
+    if(n == num)
+        return size;
+    return ((size * (int64_t)n / num) >> shift) << shift;
+}
+
+static av_cold int init_slice_contexts(FFV1Context *f){
+    int i;
 
+    f->slice_count= f->num_h_slices * f->num_v_slices;
+
+    for(i=0; i<f->slice_count; i++){
+        FFV1Context *fs= av_mallocz(sizeof(*fs));
+        int sx= i % f->num_h_slices;
+        int sy= i / f->num_h_slices;
+        int sxs= slice_pos(f->width , sx  , f->num_h_slices, f->chroma_h_shift);
+        int sxe= slice_pos(f->width , sx+1, f->num_h_slices, f->chroma_h_shift);
+        int sys= slice_pos(f->height, sy  , f->num_v_slices, f->chroma_v_shift);
+        int sye= slice_pos(f->height, sy+1, f->num_v_slices, f->chroma_v_shift);
+
+        if(!fs)
+            return AVERROR(ENOMEM);
+        f->slice_context[i]= fs;
+
+        fs->avctx       = f->avctx;
+        fs->slice_x     = sxs;
+        fs->slice_y     = sys;
+        fs->slice_width = sxe - sxs;
+        fs->slice_height= sye - sys;
+
+        fs->sample_buffer = av_malloc(9 * (fs->slice_width+6) * sizeof(*fs->sample_buffer));
+        if (!fs->sample_buffer)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
+/**
+ * Propagate the coding parameters to the slices and allocate their
+ * context states.
+ */
+static int init_slice_state(FFV1Context *f){
+    int i, j;
+
+    for(i=0; i<f->slice_count; i++){
+        FFV1Context *fs= f->slice_context[i];
+
+        fs->ac         = f->ac;
+        fs->colorspace = f->colorspace;
+        fs->plane_count= f->plane_count;
+        memcpy(fs->quant_table, f->quant_table, sizeof(fs->quant_table));
+
+        for(j=0; j<f->plane_count; j++){
+            PlaneContext * const p= &fs->plane[j];
+
+            p->context_count= f->plane[j].context_count;
+
+            if(fs->ac){
+                if(!p->state) p->state= av_malloc(CONTEXT_SIZE*p->context_count*sizeof(uint8_t));
+                if(!p->state)
+                    return AVERROR(ENOMEM);
+            }else{
+                if(!p->vlc_state) p->vlc_state= av_malloc(p->context_count*sizeof(VlcState));
+                if(!p->vlc_state)
+                    return AVERROR(ENOMEM);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Set up a range coder for one slice, using the state transition
+ * table of the stream.
+ */
+static void init_slice_rac(FFV1Context *f, RangeCoder *c){
+    ff_build_rac_states(c, 0.05*(1LL<<32), 256-8);
+    if(f->ac>1){
+        int i;
+        for(i=1; i<256; i++){
+            c->one_state[i]= f->state_transition[i];
+            c->zero_state[256-i]= 256-c->one_state[i];
+        }
+    }
+}
+
 #if CONFIG_FFV1_ENCODER
 static av_cold int encode_init(AVCodecContext *avctx)
 {
@@ -687,12 +810,6 @@ static av_cold int encode_init(AVCodecContext *avctx)
         }else{
             p->context_count= (11*11*5*5*5+1)/2;
         }
-
-        if(s->ac){
-            if(!p->state) p->state= av_malloc(CONTEXT_SIZE*p->context_count*sizeof(uint8_t));
-        }else{
-            if(!p->vlc_state) p->vlc_state= av_malloc(p->context_count*sizeof(VlcState));
-        }
     }
 
     avctx->coded_frame= &s->picture;
@@ -725,6 +842,24 @@ static av_cold int encode_init(AVCodecContext *avctx)
     }
     avcodec_get_chroma_sub_sample(avctx->pix_fmt, &s->chroma_h_shift, &s->chroma_v_shift);
 
+    s->num_h_slices= 1;
+    s->num_v_slices= 1;
+    if(avctx->thread_count > 1){
+        if(avctx->strict_std_compliance > FF_COMPLIANCE_EXPERIMENTAL){
+            av_log(avctx, AV_LOG_WARNING, "Slices need the experimental version 2 bitstream, "
+                   "use -strict -2 to enable it\n");
+        }else{
+            s->version= 2;
+            s->num_v_slices= av_clip(avctx->thread_count, 1,
+                                     FFMIN(MAX_SLICES, FFMAX(s->height >> s->chroma_v_shift, 1)));
+        }
+    }
+    if(s->version>1 && write_extra_header(s) < 0)
+        return AVERROR(ENOMEM);
+
+    if(init_slice_contexts(s) < 0 || init_slice_state(s) < 0)
+        return AVERROR(ENOMEM);
+
     s->picture_number=0;
 
     return 0;
@@ -755,15 +890,48 @@ static void clear_state(FFV1Context *f){
 }
 
 #if CONFIG_FFV1_ENCODER
+/* room encode_line() wants left at the end of a line, plus the size trailer */
+#define SLICE_MARGIN(fs) (20*(fs)->slice_width + 3)
+
+static int encode_slice(AVCodecContext *c, void *arg){
+    FFV1Context *fs= *(void**)arg;
+    FFV1Context *f= fs->avctx->priv_data;
+    int width = fs->slice_width;
+    int height= fs->slice_height;
+    int x= fs->slice_x;
+    int y= fs->slice_y;
+    AVFrame * const p= &f->picture;
+
+    if(f->colorspace==0){
+        const int ps= (c->bits_per_raw_sample>8)+1;
+        const int cx= x>>f->chroma_h_shift;
+        const int cy= y>>f->chroma_v_shift;
+        const int chroma_width = -((-(x+width ))>>f->chroma_h_shift) - cx;
+        const int chroma_height= -((-(y+height))>>f->chroma_v_shift) - cy;
+
+        encode_plane(fs, p->data[0] + ps*x + y*p->linesize[0], width, height, p->linesize[0], 0);
+
+        encode_plane(fs, p->data[1] + ps*cx + cy*p->linesize[1], chroma_width, chroma_height, p->linesize[1], 1);
+        encode_plane(fs, p->data[2] + ps*cx + cy*p->linesize[2], chroma_width, chroma_height, p->linesize[2], 1);
+    }else{
+        encode_rgb_frame(fs, (uint32_t*)(p->data[0]) + x + y*(p->linesize[0]/4), width, height, p->linesize[0]/4);
+    }
+    emms_c();
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size, void *data){
     FFV1Context *f = avctx->priv_data;
     RangeCoder * const c= &f->c;
     AVFrame *pict = data;
-    const int width= f->width;
-    const int height= f->height;
     AVFrame * const p= &f->picture;
     int used_count= 0;
     uint8_t keystate=128;
+    uint8_t *buf_p;
+    int64_t area, avail;
+    int margin= 0;
+    int i;
 
     ff_init_range_encoder(c, buf, buf_size);
     ff_build_rac_states(c, 0.05*(1LL<<32), 256-8);
@@ -774,8 +942,10 @@ static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size,
     if(avctx->gop_size==0 || f->picture_number % avctx->gop_size == 0){
         put_rac(c, &keystate, 1);
         p->key_frame= 1;
-        write_header(f);
-        clear_state(f);
+        if(f->version < 2)
+            write_header(f);
+        for(i=0; i<f->slice_count; i++)
+            clear_state(f->slice_context[i]);
     }else{
         put_rac(c, &keystate, 0);
         p->key_frame= 0;
@@ -784,55 +954,111 @@ static int encode_frame(AVCodecContext *avctx, unsigned char *buf, int buf_size,
     if(!f->ac){
         used_count += ff_rac_terminate(c);
 //printf("pos=%d\n", used_count);
-        init_put_bits(&f->pb, buf + used_count, buf_size - used_count);
     }else if (f->ac>1){
-        int i;
         for(i=1; i<256; i++){
             c->one_state[i]= f->state_transition[i];
             c->zero_state[256-i]= 256-c->one_state[i];
         }
     }
 
-    if(f->colorspace==0){
-        const int chroma_width = -((-width )>>f->chroma_h_shift);
-        const int chroma_height= -((-height)>>f->chroma_v_shift);
+    /* every slice gets a share of the buffer proportional to its area, on
+       top of a margin for the check in encode_line() and the 3 byte size
+       trailer of version 2; the first one continues the frame header coder */
+    for(i=0; i<f->slice_count; i++)
+        margin += SLICE_MARGIN(f->slice_context[i]);
+    if(buf_size - used_count < margin){
+        av_log(avctx, AV_LOG_ERROR, "output buffer too small for %d slices\n", f->slice_count);
+        return -1;
+    }
+    avail= buf_size - margin;
+    area = 0;
+    margin = 0;
+    for(i=0; i<f->slice_count; i++){
+        FFV1Context *fs= f->slice_context[i];
+        uint8_t *start= buf + margin + avail*area/(f->width*f->height);
+        uint8_t *end;
+
+        area  += fs->slice_width*fs->slice_height;
+        margin+= SLICE_MARGIN(fs);
+        end= buf + margin + avail*area/(f->width*f->height);
+
+        if(f->version>1)
+            end -= 3;
+        if(fs->ac){
+            if(i){
+                ff_init_range_encoder(&fs->c, start, end - start);
+                init_slice_rac(f, &fs->c);
+            }else{
+                fs->c= *c;
+                fs->c.bytestream_end= end;
+            }
+        }else{
+            if(!i)
+                start += used_count;
+            init_put_bits(&fs->pb, start, end - start);
+        }
+    }
 
-        encode_plane(f, p->data[0], width, height, p->linesize[0], 0);
+    avctx->execute(avctx, encode_slice, &f->slice_context[0], NULL, f->slice_count, sizeof(void*));
 
-        encode_plane(f, p->data[1], chroma_width, chroma_height, p->linesize[1], 1);
-        encode_plane(f, p->data[2], chroma_width, chroma_height, p->linesize[2], 1);
-    }else{
-        encode_rgb_frame(f, (uint32_t*)(p->data[0]), width, height, p->linesize[0]/4);
+    buf_p= buf;
+    for(i=0; i<f->slice_count; i++){
+        FFV1Context *fs= f->slice_context[i];
+        int bytes;
+
+        if(fs->ac){
+            bytes= ff_rac_terminate(&fs->c);
+        }else{
+            flush_put_bits(&fs->pb); //nicer padding FIXME
+            bytes= used_count + (put_bits_count(&fs->pb)+7)/8;
+            used_count= 0;
+        }
+        if(i)
+            memmove(buf_p, fs->ac ? fs->c.bytestream_start : fs->pb.buf, bytes);
+        if(f->version>1){
+            AV_WB24(buf_p+bytes, bytes);
+            bytes += 3;
+        }
+        buf_p += bytes;
     }
-    emms_c();
 
     f->picture_number++;
 
-    if(f->ac){
-        return ff_rac_terminate(c);
-    }else{
-        flush_put_bits(&f->pb); //nicer padding FIXME
-        return used_count + (put_bits_count(&f->pb)+7)/8;
-    }
+    return buf_p - buf;
 }
 #endif /* CONFIG_FFV1_ENCODER */
 
 static av_cold int common_end(AVCodecContext *avctx){
     FFV1Context *s = avctx->priv_data;
-    int i;
+    int i, j;
 
-    for(i=0; i<s->plane_count; i++){
-        PlaneContext *p= &s->plane[i];
+    for(j=0; j<s->slice_count; j++){
+        FFV1Context *fs= s->slice_context[j];
 
-        av_freep(&p->state);
-        av_freep(&p->vlc_state);
-    }
+        if(!fs)
+            continue;
+        for(i=0; i<fs->plane_count; i++){
+            PlaneContext *p= &fs->plane[i];
 
-    av_freep(&s->sample_buffer);
+            av_freep(&p->state);
+            av_freep(&p->vlc_state);
+        }
+        av_freep(&fs->sample_buffer);
+        av_freep(&s->slice_context[j]);
+    }
 
     return 0;
 }
 
+#if CONFIG_FFV1_ENCODER
+static av_cold int encode_end(AVCodecContext *avctx){
+    av_freep(&avctx->extradata);
+    avctx->extradata_size= 0;
+
+    return common_end(avctx);
+}
+#endif /* CONFIG_FFV1_ENCODER */
+
 static av_always_inline void decode_line(FFV1Context *s, int w, int_fast16_t *sample[2], int plane_index, int bits){
     PlaneContext * const p= &s->plane[plane_index];
     RangeCoder * const c= &s->c;
@@ -1063,16 +1289,36 @@ static int read_header(FFV1Context *f){
     }
     context_count= (context_count+1)/2;
 
-    for(i=0; i<f->plane_count; i++){
-        PlaneContext * const p= &f->plane[i];
+    for(i=0; i<f->plane_count; i++)
+        f->plane[i].context_count= context_count;
 
-        p->context_count= context_count;
+    return 0;
+}
 
-        if(f->ac){
-            if(!p->state) p->state= av_malloc(CONTEXT_SIZE*p->context_count*sizeof(uint8_t));
-        }else{
-            if(!p->vlc_state) p->vlc_state= av_malloc(p->context_count*sizeof(VlcState));
-        }
+static av_cold int read_extra_header(FFV1Context *f){
+    RangeCoder * const c= &f->c;
+    uint8_t state[CONTEXT_SIZE];
+
+    memset(state, 128, sizeof(state));
+
+    ff_init_range_decoder(c, f->avctx->extradata, f->avctx->extradata_size);
+    ff_build_rac_states(c, 0.05*(1LL<<32), 256-8);
+
+    if(read_header(f) < 0)
+        return -1;
+    if(f->version < 2){
+        av_log(f->avctx, AV_LOG_ERROR, "invalid version %d in extradata\n", f->version);
+        return -1;
+    }
+
+    f->num_h_slices= 1 + get_symbol(c, state, 0);
+    f->num_v_slices= 1 + get_symbol(c, state, 0);
+    if(f->num_h_slices < 1 || f->num_h_slices > FFMAX(f->width  >> f->chroma_h_shift, 1) ||
+       f->num_v_slices < 1 || f->num_v_slices > FFMAX(f->height >> f->chroma_v_shift, 1) ||
+       f->num_h_slices * f->num_v_slices > MAX_SLICES){
+        av_log(f->avctx, AV_LOG_ERROR, "invalid slice count %dx%d\n",
+               f->num_h_slices, f->num_v_slices);
+        return -1;
     }
 
     return 0;
@@ -1080,10 +1326,49 @@ static int read_header(FFV1Context *f){
 
 static av_cold int decode_init(AVCodecContext *avctx)
 {
-//    FFV1Context *s = avctx->priv_data;
+    FFV1Context *f = avctx->priv_data;
 
     common_init(avctx);
 
+    f->num_h_slices= 1;
+    f->num_v_slices= 1;
+    if(avctx->extradata_size > 0 && read_extra_header(f) < 0)
+        return -1;
+
+    if(init_slice_contexts(f) < 0)
+        return AVERROR(ENOMEM);
+    if(f->version > 1 && init_slice_state(f) < 0)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int decode_slice(AVCodecContext *c, void *arg){
+    FFV1Context *fs= *(void**)arg;
+    FFV1Context *f= fs->avctx->priv_data;
+    int width = fs->slice_width;
+    int height= fs->slice_height;
+    int x= fs->slice_x;
+    int y= fs->slice_y;
+    AVFrame * const p= &f->picture;
+
+    if(f->colorspace==0){
+        const int ps= (c->bits_per_raw_sample>8)+1;
+        const int cx= x>>f->chroma_h_shift;
+        const int cy= y>>f->chroma_v_shift;
+        const int chroma_width = -((-(x+width ))>>f->chroma_h_shift) - cx;
+        const int chroma_height= -((-(y+height))>>f->chroma_v_shift) - cy;
+
+        decode_plane(fs, p->data[0] + ps*x + y*p->linesize[0], width, height, p->linesize[0], 0);
+
+        decode_plane(fs, p->data[1] + ps*cx + cy*p->linesize[1], chroma_width, chroma_height, p->linesize[1], 1);
+        decode_plane(fs, p->data[2] + ps*cx + cy*p->linesize[2], chroma_width, chroma_height, p->linesize[2], 1);
+    }else{
+        decode_rgb_frame(fs, (uint32_t*)p->data[0] + x + y*(p->linesize[0]/4), width, height, p->linesize[0]/4);
+    }
+
+    emms_c();
+
     return 0;
 }
 
@@ -1092,11 +1377,11 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPac
     int buf_size = avpkt->size;
     FFV1Context *f = avctx->priv_data;
     RangeCoder * const c= &f->c;
-    const int width= f->width;
-    const int height= f->height;
+    FFV1Context *fs= f->slice_context[0];
     AVFrame * const p= &f->picture;
-    int bytes_read;
+    int bytes_read, i;
     uint8_t keystate= 128;
+    const uint8_t *buf_p;
 
     AVFrame *picture = data;
 
@@ -1107,23 +1392,57 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPac
     p->pict_type= FF_I_TYPE; //FIXME I vs. P
     if(get_rac(c, &keystate)){
         p->key_frame= 1;
-        if(read_header(f) < 0)
-            return -1;
-        clear_state(f);
+        if(f->version < 2){
+            if(read_header(f) < 0)
+                return -1;
+            if(f->version > 1){
+                av_log(avctx, AV_LOG_ERROR, "version %d needs the header in extradata\n", f->version);
+                f->version= 0;
+                return -1;
+            }
+            if(init_slice_state(f) < 0)
+                return -1;
+        }
+        for(i=0; i<f->slice_count; i++)
+            clear_state(f->slice_context[i]);
     }else{
         p->key_frame= 0;
     }
     if(f->ac>1){
-        int i;
         for(i=1; i<256; i++){
             c->one_state[i]= f->state_transition[i];
             c->zero_state[256-i]= 256-c->one_state[i];
         }
     }
 
-    if(!f->plane[0].state && !f->plane[0].vlc_state)
+    if(!fs->plane[0].state && !fs->plane[0].vlc_state)
         return -1;
 
+    /* version 2 slices are followed by their size, walk them back to front */
+    buf_p= buf + buf_size;
+    if(f->version > 1){
+        for(i=f->slice_count-1; i>0; i--){
+            FFV1Context *sc= f->slice_context[i];
+            int v;
+
+            if(buf_p - buf < 3 || (v= AV_RB24(buf_p - 3)) > buf_p - buf - 3){
+                av_log(avctx, AV_LOG_ERROR, "slice size chain broken\n");
+                return -1;
+            }
+            buf_p -= v + 3;
+            if(sc->ac){
+                ff_init_range_decoder(&sc->c, buf_p, v);
+                init_slice_rac(f, &sc->c);
+            }else
+                init_get_bits(&sc->gb, buf_p, v*8);
+        }
+        if(buf_p - buf < 3){
+            av_log(avctx, AV_LOG_ERROR, "slice size chain broken\n");
+            return -1;
+        }
+        buf_p -= 3;
+    }
+
     p->reference= 0;
     if(avctx->get_buffer(avctx, p) < 0){
         av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
@@ -1137,23 +1456,14 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPac
         bytes_read = c->bytestream - c->bytestream_start - 1;
         if(bytes_read ==0) av_log(avctx, AV_LOG_ERROR, "error at end of AC stream\n"); //FIXME
 //printf("pos=%d\n", bytes_read);
-        init_get_bits(&f->gb, buf + bytes_read, buf_size - bytes_read);
+        init_get_bits(&fs->gb, buf + bytes_read, (buf_p - buf - bytes_read)*8);
     } else {
         bytes_read = 0; /* avoid warning */
+        fs->c= *c;
+        fs->c.bytestream_end= fs->c.bytestream_start + (buf_p - buf);
     }
 
-    if(f->colorspace==0){
-        const int chroma_width = -((-width )>>f->chroma_h_shift);
-        const int chroma_height= -((-height)>>f->chroma_v_shift);
-        decode_plane(f, p->data[0], width, height, p->linesize[0], 0);
-
-        decode_plane(f, p->data[1], chroma_width, chroma_height, p->linesize[1], 1);
-        decode_plane(f, p->data[2], chroma_width, chroma_height, p->linesize[2], 1);
-    }else{
-        decode_rgb_frame(f, (uint32_t*)p->data[0], width, height, p->linesize[0]/4);
-    }
-
-    emms_c();
+    avctx->execute(avctx, decode_slice, &f->slice_context[0], NULL, f->slice_count, sizeof(void*));
 
     f->picture_number++;
 
@@ -1163,11 +1473,14 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPac
 
     *data_size = sizeof(AVFrame);
 
+    if(f->version > 1)
+        return buf_size;
+
     if(f->ac){
-        bytes_read= c->bytestream - c->bytestream_start - 1;
+        bytes_read= fs->c.bytestream - fs->c.bytestream_start - 1;
         if(bytes_read ==0) av_log(f->avctx, AV_LOG_ERROR, "error at end of frame\n");
     }else{
-        bytes_read+= (get_bits_count(&f->gb)+7)/8;
+        bytes_read+= (get_bits_count(&fs->gb)+7)/8;
     }
 
     return bytes_read;
@@ -1195,7 +1508,7 @@ AVCodec ffv1_encoder = {
     sizeof(FFV1Context),
     encode_init,
     encode_frame,
-    common_end,
+    encode_end,
     .pix_fmts= (const enum PixelFormat[]){PIX_FMT_YUV420P, PIX_FMT_YUV444P, PIX_FMT_YUV422P, PIX_FMT_YUV411P, PIX_FMT_YUV410P, PIX_FMT_RGB32, PIX_FMT_YUV420P16, PIX_FMT_YUV422P16, PIX_FMT_YUV444P16, PIX_FMT_NONE},
     .long_name= NULL_IF_CONFIG_SMALL("FFmpeg video codec #1"),
 };
@@ -69,8 +69,24 @@ typedef struct FlacSubframe {
     RiceContext rc;
     int32_t samples[FLAC_MAX_BLOCKSIZE];
     int32_t residual[FLAC_MAX_BLOCKSIZE+1];
+
+    /* prediction order search state */
+    int count;                                          ///< subframe size in bits, 0 until known
+    int32_t lpc_coefs[MAX_LPC_ORDER+1][MAX_LPC_ORDER];  ///< candidate coefficients per order-1
+    int lpc_shift[MAX_LPC_ORDER+1];
+    uint32_t order_bits[MAX_LPC_ORDER+1];               ///< estimated size of each candidate
 } FlacSubframe;
 
+/**
+ * One candidate prediction order of one channel, evaluated as a
+ * separate job so that all candidates of a frame can run in parallel.
+ */
+typedef struct FlacOrderJob {
+    int ch;
+    int idx;        ///< index into order_bits[] of the channel
+    int order;      ///< prediction order to evaluate
+} FlacOrderJob;
+
 typedef struct FlacFrame {
     FlacSubframe subframes[FLAC_MAX_CHANNELS];
     int blocksize;
@@ -97,6 +113,10 @@ typedef struct FlacEncodeContext {
     AVCodecContext *avctx;
     DSPContext dsp;
     struct AVMD5 *md5ctx;
+    FlacOrderJob order_jobs[FLAC_MAX_CHANNELS * (MAX_LPC_ORDER+1)];
+    int nb_order_jobs;
+    int32_t *residual_buf;      ///< per-thread scratch residual, max_blocksize+1 each
+    int nb_residual_bufs;
 } FlacEncodeContext;
 
 
@@ -126,6 +146,25 @@ static void write_streaminfo(FlacEncodeContext *s, uint8_t *header)
 }
 
 
+/**
+ * Make sure there is one scratch residual buffer per encoding thread.
+ */
+static int alloc_residual_buffers(FlacEncodeContext *s)
+{
+    int nb_bufs = FFMAX(s->avctx->thread_count, 1);
+
+    if (nb_bufs <= s->nb_residual_bufs)
+        return 0;
+    av_freep(&s->residual_buf);
+    s->nb_residual_bufs = 0;
+    s->residual_buf = av_malloc(nb_bufs * (s->max_blocksize + 1) * sizeof(int32_t));
+    if (!s->residual_buf)
+        return -1;
+    s->nb_residual_bufs = nb_bufs;
+    return 0;
+}
+
+
 /**
  * Set blocksize based on samplerate.
  * Choose the closest predefined blocksize >= BLOCK_TIME_MS milliseconds.
@@ -439,6 +478,9 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
     if (!avctx->coded_frame)
         return AVERROR(ENOMEM);
 
+    if (alloc_residual_buffers(s) < 0)
+        return AVERROR(ENOMEM);
+
     dprint_compression_options(s);
 
     return 0;
@@ -596,24 +638,11 @@ static uint32_t calc_optimal_rice_params(RiceContext *rc, int porder,
 }
 
 
-static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
-                      uint32_t sums[][MAX_PARTITIONS])
+static void calc_sums(int pmin, int pmax, uint32_t sums[][MAX_PARTITIONS])
 {
     int i, j;
     int parts;
-    uint32_t *res, *res_end;
 
-    /* sums for highest level */
-    parts   = (1 << pmax);
-    res     = &data[pred_order];
-    res_end = &data[n >> pmax];
-    for (i = 0; i < parts; i++) {
-        uint32_t sum = 0;
-        while (res < res_end)
-            sum += *(res++);
-        sums[pmax][i] = sum;
-        res_end += n >> pmax;
-    }
     /* sums for lower levels */
     for (i = pmax - 1; i >= pmin; i--) {
         parts = (1 << i);
@@ -623,25 +652,23 @@ static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
 }
 
 
-static uint32_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
-                                 int32_t *data, int n, int pred_order)
+static uint32_t calc_rice_params(FlacEncodeContext *s, RiceContext *rc,
+                                 int pmin, int pmax, const int32_t *data,
+                                 int n, int pred_order)
 {
     int i;
     uint32_t bits[MAX_PARTITION_ORDER+1];
     int opt_porder;
     RiceContext tmp_rc;
-    uint32_t *udata;
     uint32_t sums[MAX_PARTITION_ORDER+1][MAX_PARTITIONS];
 
     assert(pmin >= 0 && pmin <= MAX_PARTITION_ORDER);
     assert(pmax >= 0 && pmax <= MAX_PARTITION_ORDER);
     assert(pmin <= pmax);
 
-    udata = av_malloc(n * sizeof(uint32_t));
-    for (i = 0; i < n; i++)
-        udata[i] = (2*data[i]) ^ (data[i]>>31);
-
-    calc_sums(pmin, pmax, udata, n, pred_order, sums);
+    /* sums for highest level */
+    s->dsp.lpc_rice_partition_sums(sums[pmax], data, n, pmax, pred_order);
+    calc_sums(pmin, pmax, sums);
 
     opt_porder = pmin;
     bits[pmin] = UINT32_MAX;
@@ -653,7 +680,6 @@ static uint32_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
         }
     }
 
-    av_freep(&udata);
     return bits[opt_porder];
 }
 
@@ -668,7 +694,8 @@ static int get_max_p_order(int max_porder, int n, int order)
 
 
 static uint32_t find_subframe_rice_params(FlacEncodeContext *s,
-                                          FlacSubframe *sub, int pred_order)
+                                          FlacSubframe *sub, RiceContext *rc,
+                                          const int32_t *res, int pred_order)
 {
     int pmin = get_max_p_order(s->options.min_partition_order,
                                s->frame.blocksize, pred_order);
@@ -678,8 +705,8 @@ static uint32_t find_subframe_rice_params(FlacEncodeContext *s,
     uint32_t bits = 8 + pred_order * sub->obits + 2 + 4;
     if (sub->type == FLAC_SUBFRAME_LPC)
         bits += 4 + 5 + pred_order * s->options.lpc_coeff_precision;
-    bits += calc_rice_params(&sub->rc, pmin, pmax, sub->residual,
-                             s->frame.blocksize, pred_order);
+    bits += calc_rice_params(s, rc, pmin, pmax, res, s->frame.blocksize,
+                             pred_order);
     return bits;
 }
 
@@ -735,118 +762,18 @@ static void encode_residual_fixed(int32_t *res, const int32_t *smp, int n,
 }
 
 
-#define LPC1(x) {\
-    int c = coefs[(x)-1];\
-    p0   += c * s;\
-    s     = smp[i-(x)+1];\
-    p1   += c * s;\
-}
-
-static av_always_inline void encode_residual_lpc_unrolled(int32_t *res,
-                                    const int32_t *smp, int n, int order,
-                                    const int32_t *coefs, int shift, int big)
-{
-    int i;
-    for (i = order; i < n; i += 2) {
-        int s  = smp[i-order];
-        int p0 = 0, p1 = 0;
-        if (big) {
-            switch (order) {
-            case 32: LPC1(32)
-            case 31: LPC1(31)
-            case 30: LPC1(30)
-            case 29: LPC1(29)
-            case 28: LPC1(28)
-            case 27: LPC1(27)
-            case 26: LPC1(26)
-            case 25: LPC1(25)
-            case 24: LPC1(24)
-            case 23: LPC1(23)
-            case 22: LPC1(22)
-            case 21: LPC1(21)
-            case 20: LPC1(20)
-            case 19: LPC1(19)
-            case 18: LPC1(18)
-            case 17: LPC1(17)
-            case 16: LPC1(16)
-            case 15: LPC1(15)
-            case 14: LPC1(14)
-            case 13: LPC1(13)
-            case 12: LPC1(12)
-            case 11: LPC1(11)
-            case 10: LPC1(10)
-            case  9: LPC1( 9)
-                     LPC1( 8)
-                     LPC1( 7)
-                     LPC1( 6)
-                     LPC1( 5)
-                     LPC1( 4)
-                     LPC1( 3)
-                     LPC1( 2)
-                     LPC1( 1)
-            }
-        } else {
-            switch (order) {
-            case  8: LPC1( 8)
-            case  7: LPC1( 7)
-            case  6: LPC1( 6)
-            case  5: LPC1( 5)
-            case  4: LPC1( 4)
-            case  3: LPC1( 3)
-            case  2: LPC1( 2)
-            case  1: LPC1( 1)
-            }
-        }
-        res[i  ] = smp[i  ] - (p0 >> shift);
-        res[i+1] = smp[i+1] - (p1 >> shift);
-    }
-}
-
-
-static void encode_residual_lpc(int32_t *res, const int32_t *smp, int n,
-                                int order, const int32_t *coefs, int shift)
-{
-    int i;
-    for (i = 0; i < order; i++)
-        res[i] = smp[i];
-#if CONFIG_SMALL
-    for (i = order; i < n; i += 2) {
-        int j;
-        int s  = smp[i];
-        int p0 = 0, p1 = 0;
-        for (j = 0; j < order; j++) {
-            int c = coefs[j];
-            p1   += c * s;
-            s     = smp[i-j-1];
-            p0   += c * s;
-        }
-        res[i  ] = smp[i  ] - (p0 >> shift);
-        res[i+1] = smp[i+1] - (p1 >> shift);
-    }
-#else
-    switch (order) {
-    case  1: encode_residual_lpc_unrolled(res, smp, n, 1, coefs, shift, 0); break;
-    case  2: encode_residual_lpc_unrolled(res, smp, n, 2, coefs, shift, 0); break;
-    case  3: encode_residual_lpc_unrolled(res, smp, n, 3, coefs, shift, 0); break;
-    case  4: encode_residual_lpc_unrolled(res, smp, n, 4, coefs, shift, 0); break;
-    case  5: encode_residual_lpc_unrolled(res, smp, n, 5, coefs, shift, 0); break;
-    case  6: encode_residual_lpc_unrolled(res, smp, n, 6, coefs, shift, 0); break;
-    case  7: encode_residual_lpc_unrolled(res, smp, n, 7, coefs, shift, 0); break;
-    case  8: encode_residual_lpc_unrolled(res, smp, n, 8, coefs, shift, 0); break;
-    default: encode_residual_lpc_unrolled(res, smp, n, order, coefs, shift, 1); break;
-    }
-#endif
-}
-
-
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+/**
+ * First stage of the subframe search: handle the trivial subframe types and
+ * compute the LPC coefficients. The candidate prediction orders left for the
+ * second stage are evaluated by evaluate_order().
+ */
+static int analyze_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
+    FlacEncodeContext *s = avctx->priv_data;
     int i, n;
     int min_order, max_order, opt_order, omethod;
     FlacFrame *frame;
     FlacSubframe *sub;
-    int32_t coefs[MAX_LPC_ORDER][MAX_LPC_ORDER];
-    int shift[MAX_LPC_ORDER];
     int32_t *res, *smp;
 
     frame = &s->frame;
@@ -855,6 +782,9 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
     smp   = sub->samples;
     n     = frame->blocksize;
 
+    sub->count         = 0;
+    sub->order_bits[0] = UINT32_MAX;
+
     /* CONSTANT */
     for (i = 1; i < n; i++)
         if(smp[i] != smp[0])
@@ -862,14 +792,16 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
     if (i == n) {
         sub->type = sub->type_code = FLAC_SUBFRAME_CONSTANT;
         res[0] = smp[0];
-        return subframe_count_exact(s, sub, 0);
+        sub->count = subframe_count_exact(s, sub, 0);
+        return 0;
     }
 
     /* VERBATIM */
     if (frame->verbatim_only || n < 5) {
         sub->type = sub->type_code = FLAC_SUBFRAME_VERBATIM;
         memcpy(res, smp, n * sizeof(int32_t));
-        return subframe_count_exact(s, sub, 0);
+        sub->count = subframe_count_exact(s, sub, 0);
+        return 0;
     }
 
     min_order  = s->options.min_prediction_order;
@@ -879,68 +811,18 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
     /* FIXED */
     sub->type = FLAC_SUBFRAME_FIXED;
     if (s->options.lpc_type == AV_LPC_TYPE_NONE  ||
-        s->options.lpc_type == AV_LPC_TYPE_FIXED || n <= max_order) {
-        uint32_t bits[MAX_FIXED_ORDER+1];
-        if (max_order > MAX_FIXED_ORDER)
-            max_order = MAX_FIXED_ORDER;
-        opt_order = 0;
-        bits[0]   = UINT32_MAX;
-        for (i = min_order; i <= max_order; i++) {
-            encode_residual_fixed(res, smp, n, i);
-            bits[i] = find_subframe_rice_params(s, sub, i);
-            if (bits[i] < bits[opt_order])
-                opt_order = i;
-        }
-        sub->order     = opt_order;
-        sub->type_code = sub->type | sub->order;
-        if (sub->order != max_order) {
-            encode_residual_fixed(res, smp, n, sub->order);
-            find_subframe_rice_params(s, sub, sub->order);
-        }
-        return subframe_count_exact(s, sub, sub->order);
-    }
+        s->options.lpc_type == AV_LPC_TYPE_FIXED || n <= max_order)
+        return 0;
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
     opt_order = ff_lpc_calc_coefs(&s->dsp, smp, n, min_order, max_order,
-                                  s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
+                                  s->options.lpc_coeff_precision, sub->lpc_coefs,
+                                  sub->lpc_shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MAX_LPC_SHIFT, 0);
 
-    if (omethod == ORDER_METHOD_2LEVEL ||
-        omethod == ORDER_METHOD_4LEVEL ||
-        omethod == ORDER_METHOD_8LEVEL) {
-        int levels = 1 << omethod;
-        uint32_t bits[1 << ORDER_METHOD_8LEVEL];
-        int order;
-        int opt_index   = levels-1;
-        opt_order       = max_order-1;
-        bits[opt_index] = UINT32_MAX;
-        for (i = levels-1; i >= 0; i--) {
-            order = min_order + (((max_order-min_order+1) * (i+1)) / levels)-1;
-            if (order < 0)
-                order = 0;
-            encode_residual_lpc(res, smp, n, order+1, coefs[order], shift[order]);
-            bits[i] = find_subframe_rice_params(s, sub, order+1);
-            if (bits[i] < bits[opt_index]) {
-                opt_index = i;
-                opt_order = order;
-            }
-        }
-        opt_order++;
-    } else if (omethod == ORDER_METHOD_SEARCH) {
-        // brute-force optimal order search
-        uint32_t bits[MAX_LPC_ORDER];
-        opt_order = 0;
-        bits[0]   = UINT32_MAX;
-        for (i = min_order-1; i < max_order; i++) {
-            encode_residual_lpc(res, smp, n, i+1, coefs[i], shift[i]);
-            bits[i] = find_subframe_rice_params(s, sub, i+1);
-            if (bits[i] < bits[opt_order])
-                opt_order = i;
-        }
-        opt_order++;
-    } else if (omethod == ORDER_METHOD_LOG) {
+    if (omethod == ORDER_METHOD_LOG) {
         uint32_t bits[MAX_LPC_ORDER];
         int step;
 
@@ -952,24 +834,163 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
             for (i = last-step; i <= last+step; i += step) {
                 if (i < min_order-1 || i >= max_order || bits[i] < UINT32_MAX)
                     continue;
-                encode_residual_lpc(res, smp, n, i+1, coefs[i], shift[i]);
-                bits[i] = find_subframe_rice_params(s, sub, i+1);
+                s->dsp.lpc_compute_residual(res, smp, n, i+1, sub->lpc_coefs[i],
+                                            sub->lpc_shift[i]);
+                bits[i] = find_subframe_rice_params(s, sub, &sub->rc, res, i+1);
                 if (bits[i] < bits[opt_order])
                     opt_order = i;
             }
         }
         opt_order++;
     }
+    sub->order = opt_order;
+
+    return 0;
+}
+
+
+/**
+ * Queue the prediction orders of a channel which have to be tried.
+ */
+static void add_order_jobs(FlacEncodeContext *s, int ch)
+{
+    FlacSubframe *sub = &s->frame.subframes[ch];
+    int min_order = s->options.min_prediction_order;
+    int max_order = s->options.max_prediction_order;
+    int omethod   = s->options.prediction_order_method;
+    int i;
+
+#define ADD_JOB(i, o) {\
+    FlacOrderJob *job = &s->order_jobs[s->nb_order_jobs++];\
+    job->ch    = ch;\
+    job->idx   = i;\
+    job->order = o;\
+}
+    if (sub->count)
+        return;
+
+    if (sub->type == FLAC_SUBFRAME_FIXED) {
+        if (max_order > MAX_FIXED_ORDER)
+            max_order = MAX_FIXED_ORDER;
+        for (i = min_order; i <= max_order; i++)
+            ADD_JOB(i, i)
+    } else if (omethod == ORDER_METHOD_2LEVEL ||
+               omethod == ORDER_METHOD_4LEVEL ||
+               omethod == ORDER_METHOD_8LEVEL) {
+        int levels = 1 << omethod;
+        for (i = levels-1; i >= 0; i--) {
+            int order = min_order + (((max_order-min_order+1) * (i+1)) / levels)-1;
+            if (order < 0)
+                order = 0;
+            ADD_JOB(i, order+1)
+        }
+    } else if (omethod == ORDER_METHOD_SEARCH) {
+        for (i = min_order-1; i < max_order; i++)
+            ADD_JOB(i, i+1)
+    }
+#undef ADD_JOB
+}
+
+
+/**
+ * Second stage of the subframe search: estimate the size of a subframe
+ * using one candidate prediction order.
+ */
+static int evaluate_order(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacOrderJob *job    = &s->order_jobs[jobnr];
+    FlacSubframe *sub    = &s->frame.subframes[job->ch];
+    int32_t *res         = s->residual_buf + threadnr * (s->max_blocksize + 1);
+    int n                = s->frame.blocksize;
+    RiceContext rc;
+
+    if (sub->type == FLAC_SUBFRAME_FIXED)
+        encode_residual_fixed(res, sub->samples, n, job->order);
+    else
+        s->dsp.lpc_compute_residual(res, sub->samples, n, job->order,
+                                    sub->lpc_coefs[job->order-1],
+                                    sub->lpc_shift[job->order-1]);
+    sub->order_bits[job->idx] = find_subframe_rice_params(s, sub, &rc, res,
+                                                          job->order);
+    return 0;
+}
+
+
+/**
+ * Last stage of the subframe search: pick the best of the evaluated
+ * prediction orders and compute the final residual.
+ * @return size of the subframe in bits
+ */
+static int encode_residual_ch(AVCodecContext *avctx, void *arg, int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    int i, n;
+    int min_order, max_order, opt_order, omethod;
+    FlacSubframe *sub;
+    uint32_t *bits;
+    int32_t *res, *smp;
+
+    sub   = &s->frame.subframes[ch];
+    res   = sub->residual;
+    smp   = sub->samples;
+    n     = s->frame.blocksize;
+    bits  = sub->order_bits;
+
+    if (sub->count)
+        return sub->count;
+
+    min_order  = s->options.min_prediction_order;
+    max_order  = s->options.max_prediction_order;
+    omethod    = s->options.prediction_order_method;
+
+    /* FIXED */
+    if (sub->type == FLAC_SUBFRAME_FIXED) {
+        if (max_order > MAX_FIXED_ORDER)
+            max_order = MAX_FIXED_ORDER;
+        opt_order = 0;
+        for (i = min_order; i <= max_order; i++)
+            if (bits[i] < bits[opt_order])
+                opt_order = i;
+        sub->order     = opt_order;
+        sub->type_code = sub->type | sub->order;
+        encode_residual_fixed(res, smp, n, sub->order);
+        find_subframe_rice_params(s, sub, &sub->rc, res, sub->order);
+        return subframe_count_exact(s, sub, sub->order);
+    }
+
+    /* LPC */
+    if (omethod == ORDER_METHOD_2LEVEL ||
+        omethod == ORDER_METHOD_4LEVEL ||
+        omethod == ORDER_METHOD_8LEVEL) {
+        int levels    = 1 << omethod;
+        int opt_index = levels-1;
+        opt_order     = max_order-1;
+        for (i = levels-1; i >= 0; i--) {
+            if (bits[i] < bits[opt_index]) {
+                opt_index = i;
+                opt_order = min_order + (((max_order-min_order+1) * (i+1)) / levels)-1;
+                if (opt_order < 0)
+                    opt_order = 0;
+            }
+        }
+        sub->order = opt_order + 1;
+    } else if (omethod == ORDER_METHOD_SEARCH) {
+        opt_order = 0;
+        for (i = min_order-1; i < max_order; i++)
+            if (bits[i] < bits[opt_order])
+                opt_order = i;
+        sub->order = opt_order + 1;
+    }
 
-    sub->order     = opt_order;
     sub->type_code = sub->type | (sub->order-1);
-    sub->shift     = shift[sub->order-1];
+    sub->shift     = sub->lpc_shift[sub->order-1];
     for (i = 0; i < sub->order; i++)
-        sub->coefs[i] = coefs[sub->order-1][i];
+        sub->coefs[i] = sub->lpc_coefs[sub->order-1][i];
 
-    encode_residual_lpc(res, smp, n, sub->order, sub->coefs, sub->shift);
+    s->dsp.lpc_compute_residual(res, smp, n, sub->order, sub->coefs, sub->shift);
 
-    find_subframe_rice_params(s, sub, sub->order);
+    find_subframe_rice_params(s, sub, &sub->rc, res, sub->order);
 
     return subframe_count_exact(s, sub, sub->order);
 }
@@ -1013,12 +1034,23 @@ static int count_frame_header(FlacEncodeContext *s)
 
 static int encode_frame(FlacEncodeContext *s)
 {
+    AVCodecContext *avctx = s->avctx;
     int ch, count;
+    int counts[FLAC_MAX_CHANNELS];
 
     count = count_frame_header(s);
 
+    avctx->execute2(avctx, analyze_channel, NULL, NULL, s->channels);
+
+    s->nb_order_jobs = 0;
+    for (ch = 0; ch < s->channels; ch++)
+        add_order_jobs(s, ch);
+    if (s->nb_order_jobs)
+        avctx->execute2(avctx, evaluate_order, NULL, NULL, s->nb_order_jobs);
+
+    avctx->execute2(avctx, encode_residual_ch, NULL, counts, s->channels);
     for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+        count += counts[ch];
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1278,6 +1310,9 @@ static int flac_encode_frame(AVCodecContext *avctx, uint8_t *frame,
                                                       s->channels, 16);
     }
 
+    if (alloc_residual_buffers(s) < 0)
+        return AVERROR(ENOMEM);
+
     init_frame(s);
 
     copy_samples(s, samples);
@@ -1317,6 +1352,7 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
         av_freep(&s->md5ctx);
+        av_freep(&s->residual_buf);
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -354,10 +354,16 @@ int16_t *h263_pred_motion(MpegEncContext * s, int block, int dir,
                 *py = A[1];
             }
         }else{ /* block==2*/
+            int16_t zero[2];
             B = mot_val[ - wrap];
             C = mot_val[off[block] - wrap];
-            if(s->mb_x == s->resync_mb_x) //rare
+            if(s->mb_x == s->resync_mb_x){ //rare
+                /* the MB on the left may still be in use by another slice thread,
+                 * its vector is cleared once all threads are done */
+                if(s->start_mb_num && s->mb_x + s->mb_y*s->mb_width == s->start_mb_num)
+                    A= zero;
                 A[0]=A[1]=0;
+            }
 
             *px = mid_pred(A[0], B[0], C[0]);
             *py = mid_pred(A[1], B[1], C[1]);
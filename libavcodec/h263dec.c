@@ -203,6 +203,12 @@ static int decode_slice(MpegEncContext *s){
         for(; s->mb_x < s->mb_width; s->mb_x++) {
             int ret;
 
+            if(s->mb_x + s->mb_y*s->mb_width >= s->end_mb_num){
+                av_log(s->avctx, AV_LOG_ERROR, "Slice overlaps the next slice at MB: %d\n", s->mb_x + s->mb_y*s->mb_width);
+                ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y, s->mb_x-1, s->mb_y, (AC_ERROR|DC_ERROR|MV_ERROR)&part_mask);
+                return -1;
+            }
+
             ff_update_block_index(s);
 
             if(s->resync_mb_x == s->mb_x && s->resync_mb_y+1 == s->mb_y){
@@ -329,6 +335,112 @@ static int decode_slice(MpegEncContext *s){
     return -1;
 }
 
+/**
+ * Clear the AC prediction values of the MB rows start_mb_y..end_mb_y-1.
+ * Each slice thread has its own AC prediction values, but which of them are
+ * stale is tracked in the shared mbintra_table, so once slice threads have
+ * been used the values have to be cleared before they can be trusted again.
+ */
+static void clear_ac_val(MpegEncContext *s, int start_mb_y, int end_mb_y){
+    const int rows= end_mb_y - start_mb_y;
+
+    memset(s->ac_val[0][2*start_mb_y*s->b8_stride - 1], 0, 2*rows*s->b8_stride*sizeof(*s->ac_val[0]));
+    memset(s->ac_val[1][  start_mb_y*s->mb_stride - 1], 0,   rows*s->mb_stride*sizeof(*s->ac_val[1]));
+    memset(s->ac_val[2][  start_mb_y*s->mb_stride - 1], 0,   rows*s->mb_stride*sizeof(*s->ac_val[2]));
+}
+
+/**
+ * Decode the video packets of one slice thread, see mpeg4_split_slices().
+ */
+static int decode_slice_thread(AVCodecContext *avctx, void *arg){
+    MpegEncContext *s= *(void**)arg;
+
+    clear_ac_val(s, s->mb_y, (s->end_mb_num - 1)/s->mb_width + 1);
+    if(s->mb_x || s->mb_y)
+        ff_mpeg4_clean_buffers(s);
+
+    for(;;){
+        decode_slice(s);
+        if(s->mb_x + s->mb_y*s->mb_width >= s->end_mb_num)
+            break;
+
+        if(ff_h263_resync(s) < 0)
+            break;
+        if(s->mb_x + s->mb_y*s->mb_width >= s->end_mb_num)
+            break;
+
+        ff_mpeg4_clean_buffers(s);
+    }
+    emms_c();
+
+    return 0;
+}
+
+/**
+ * Find the video packets of the current MPEG-4 VOP by their resync markers
+ * and split them into up to thread_count groups of consecutive packets with
+ * about the same number of MBs.
+ * The thread contexts are set up to start decoding at the first packet of
+ * their group, the error counts and the padding bug score are split so that
+ * they can simply be merged once all threads are done.
+ * @return the number of groups
+ */
+static int mpeg4_split_slices(MpegEncContext *s){
+    const int thread_count= s->avctx->thread_count;
+    const int prefix_length= ff_mpeg4_get_video_packet_prefix_length(s);
+    const uint8_t *buf_end= s->gb.buffer_end;
+    const uint8_t *p= s->gb.buffer + (get_bits_count(&s->gb)>>3);
+    int last_mb_num= 0, packet_count= 0, count= 1, i;
+
+    for(i=1; i<thread_count; i++)
+        ff_update_duplicate_context(s->thread_context[i], s);
+
+    while(count < thread_count && buf_end - p > 3){
+        MpegEncContext *t= s->thread_context[count];
+        int mb_num;
+
+        p= ff_h263_find_resync_marker(p, buf_end);
+        if(buf_end - p <= 3 || p[2] == 1) /* end of the buffer or a start code */
+            break;
+
+        init_get_bits(&t->gb, s->gb.buffer, (buf_end - s->gb.buffer)*8);
+        skip_bits_long(&t->gb, (p - s->gb.buffer)*8);
+        p += 2;
+        if(show_bits_long(&t->gb, prefix_length+1) != 1)
+            continue;
+
+        /* a packet without its own qscale depends on the end of the previous one */
+        t->qscale= 0;
+        if(mpeg4_decode_video_packet_header(t) < 0 || !t->qscale)
+            continue;
+
+        mb_num= t->mb_x + t->mb_y*s->mb_width;
+        if(mb_num <= last_mb_num)
+            continue;
+        last_mb_num= mb_num;
+        packet_count++;
+
+        if(mb_num >= (s->mb_num*count + thread_count/2) / thread_count){
+            t->start_mb_num= mb_num;
+            s->thread_context[count-1]->end_mb_num= mb_num;
+            /* every packet before this one ends with a decremented score */
+            t->padding_bug_score= s->padding_bug_score - packet_count;
+            count++;
+        }
+    }
+
+    if(count > 1){
+        s->thread_context[count-1]->end_mb_num= s->mb_num;
+        for(i=0; i<count; i++){
+            MpegEncContext *t= s->thread_context[i];
+
+            t->error_count= 3*(t->end_mb_num - t->start_mb_num);
+        }
+    }
+
+    return count;
+}
+
 int ff_h263_decode_frame(AVCodecContext *avctx,
                              void *data, int *data_size,
                              AVPacket *avpkt)
@@ -336,7 +448,7 @@ int ff_h263_decode_frame(AVCodecContext *avctx,
     const uint8_t *buf = avpkt->data;
     int buf_size = avpkt->size;
     MpegEncContext *s = avctx->priv_data;
-    int ret;
+    int ret, slice_count, i;
     AVFrame *pict = data;
 
 #ifdef PRINT_FRAME_TIME
@@ -643,21 +755,69 @@ retry:
     /* decode each macroblock */
     s->mb_x=0;
     s->mb_y=0;
-
-    decode_slice(s);
-    while(s->mb_y<s->mb_height){
-        if(s->msmpeg4_version){
-            if(s->slice_height==0 || s->mb_x!=0 || (s->mb_y%s->slice_height)!=0 || get_bits_count(&s->gb) > s->gb.size_in_bits)
-                break;
-        }else{
-            if(ff_h263_resync(s)<0)
-                break;
+    s->start_mb_num= 0;
+    s->end_mb_num= s->mb_num;
+
+    slice_count= 1;
+    if(CONFIG_MPEG4_DECODER && s->codec_id==CODEC_ID_MPEG4 && avctx->thread_count > 1 && s->resync_marker){
+        /* without padding the packet ends are guessed sequentially, GMC
+         * packet headers and interlaced B-VOP field vectors carry state over
+         * from the previous packet */
+        if(   !(s->workaround_bugs&FF_BUG_NO_PADDING)
+           && !avctx->draw_horiz_band && !avctx->hwaccel
+           && !(s->pict_type==FF_S_TYPE && s->vol_sprite_usage==GMC_SPRITE)
+           && !(s->pict_type==FF_B_TYPE && !s->progressive_sequence))
+            slice_count= mpeg4_split_slices(s);
+        /* a previous frame may have been decoded with slice threads */
+        if(slice_count == 1)
+            clear_ac_val(s, 0, s->mb_height);
+    }
+
+    if(slice_count > 1){
+        MpegEncContext *last= s->thread_context[slice_count-1];
+        int64_t error_count= 0;
+
+        avctx->execute(avctx, decode_slice_thread, &s->thread_context[0], NULL, slice_count, sizeof(void*));
+        for(i=0; i<slice_count; i++)
+            error_count+= s->thread_context[i]->error_count;
+        s->error_count= FFMIN(error_count, INT_MAX);
+
+        /* h263_pred_motion() clears the last vector of the MB left of a
+         * slice starting with a 4MV MB, the threads left that to us */
+        for(i=1; i<slice_count; i++){
+            MpegEncContext *t= s->thread_context[i];
+            const int mb_x= t->start_mb_num % s->mb_width;
+            const int mb_y= t->start_mb_num / s->mb_width;
+
+            if(s->pict_type != FF_B_TYPE && mb_x && IS_8X8(s->current_picture.mb_type[mb_x + mb_y*s->mb_stride])){
+                int16_t *mv= s->current_picture.motion_val[0][2*mb_x - 1 + (2*mb_y + 1)*s->b8_stride];
+                mv[0]= mv[1]= 0;
+            }
         }
 
-        if(s->msmpeg4_version<4 && s->h263_pred)
-            ff_mpeg4_clean_buffers(s);
-
+        /* the last thread continued where the sequential code would stop */
+        s->gb               = last->gb;
+        s->mb_x             = last->mb_x;
+        s->mb_y             = last->mb_y;
+        s->padding_bug_score= last->padding_bug_score;
+        s->workaround_bugs  = last->workaround_bugs;
+        s->end_mb_num       = s->mb_num;
+    }else{
         decode_slice(s);
+        while(s->mb_y<s->mb_height){
+            if(s->msmpeg4_version){
+                if(s->slice_height==0 || s->mb_x!=0 || (s->mb_y%s->slice_height)!=0 || get_bits_count(&s->gb) > s->gb.size_in_bits)
+                    break;
+            }else{
+                if(ff_h263_resync(s)<0)
+                    break;
+            }
+
+            if(s->msmpeg4_version<4 && s->h263_pred)
+                ff_mpeg4_clean_buffers(s);
+
+            decode_slice(s);
+        }
     }
 
     if (s->h263_msmpeg4 && s->msmpeg4_version<4 && s->pict_type==FF_I_TYPE)
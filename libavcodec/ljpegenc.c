@@ -177,6 +177,7 @@ static int encode_picture_lossless(AVCodecContext *avctx, unsigned char *buf, in
 
     emms_c();
 
+    ff_mjpeg_encode_stuffing(s);
     ff_mjpeg_encode_picture_trailer(s);
     s->picture_number++;
 
@@ -49,6 +49,12 @@ int ff_lpc_calc_coefs(DSPContext *s,
 void ff_lpc_compute_autocorr(const int32_t *data, int len, int lag,
                              double *autoc);
 
+void ff_lpc_compute_residual(int32_t *res, const int32_t *smp, int n,
+                             int order, const int32_t *coefs, int shift);
+
+void ff_lpc_rice_partition_sums(uint32_t *sums, const int32_t *res, int n,
+                                int porder, int pred_order);
+
 #ifdef LPC_USE_DOUBLE
 #define LPC_TYPE double
 #else
@@ -767,10 +767,146 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor, int point
     return 0;
 }
 
-static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah, int Al){
-    int i, mb_x, mb_y;
-    uint8_t* data[MAX_COMPONENTS];
+static int decode_mcu(MJpegDecodeContext *s, int nb_components, uint8_t **data,
+                      const int *linesize, int mb_x, int mb_y, int Ah, int Al)
+{
+    int i;
+
+    for(i=0;i<nb_components;i++) {
+        uint8_t *ptr;
+        int n, h, v, x, y, c, j;
+        n = s->nb_blocks[i];
+        c = s->comp_index[i];
+        h = s->h_scount[i];
+        v = s->v_scount[i];
+        x = 0;
+        y = 0;
+        for(j=0;j<n;j++) {
+            ptr = data[c] +
+                (((linesize[c] * (v * mb_y + y) * 8) +
+                (h * mb_x + x) * 8) >> s->avctx->lowres);
+            if(s->interlaced && s->bottom_field)
+                ptr += linesize[c] >> 1;
+            if(!s->progressive) {
+                s->dsp.clear_block(s->block);
+                if(decode_block(s, s->block, i,
+                             s->dc_index[i], s->ac_index[i],
+                             s->quant_matrixes[ s->quant_index[c] ]) < 0) {
+                    av_log(s->avctx, AV_LOG_ERROR, "error y=%d x=%d\n", mb_y, mb_x);
+                    return -1;
+                }
+                s->dsp.idct_put(ptr, linesize[c], s->block);
+            } else {
+                int block_idx = s->block_stride[c] * (v * mb_y + y) + (h * mb_x + x);
+                DCTELEM *block = s->blocks[c][block_idx];
+                if(Ah)
+                    block[0] += get_bits1(&s->gb) * s->quant_matrixes[ s->quant_index[c] ][0] << Al;
+                else if(decode_dc_progressive(s, block, i, s->dc_index[i], s->quant_matrixes[ s->quant_index[c] ], Al) < 0) {
+                    av_log(s->avctx, AV_LOG_ERROR, "error y=%d x=%d\n", mb_y, mb_x);
+                    return -1;
+                }
+            }
+//            av_log(s->avctx, AV_LOG_DEBUG, "mb: %d %d processed\n", mb_y, mb_x);
+//av_log(NULL, AV_LOG_DEBUG, "%d %d %d %d %d %d %d %d \n", mb_x, mb_y, x, y, c, s->bottom_field, (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+    return 0;
+}
+
+typedef struct MJpegScanContext {
+    uint8_t *data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
+    int nb_components;
+    int nb_intervals;
+    int start, end;             ///< byte offsets of the entropy coded data in buffer
+    int end_bits;               ///< bit position in buffer after the last interval
+} MJpegScanContext;
+
+static int decode_restart_interval(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s0 = avctx->priv_data;
+    MJpegDecodeContext *s  = &s0->thread_ctx[threadnr];
+    MJpegScanContext *sc   = arg;
+    int start = jobnr ? s0->restart_offsets[jobnr - 1] : sc->start;
+    int end   = jobnr < sc->nb_intervals - 1 ? s0->restart_offsets[jobnr] : sc->end;
+    int mcu   = jobnr * s0->restart_interval;
+    int last  = FFMIN(mcu + s0->restart_interval, s0->mb_width * s0->mb_height);
+    int i;
+
+    init_get_bits(&s->gb, s0->buffer + start, (end - start) * 8);
+    for (i = 0; i < sc->nb_components; i++) /* reset dc */
+        s->last_dc[i] = 1024;
+
+    for (; mcu < last; mcu++)
+        if (decode_mcu(s, sc->nb_components, sc->data, sc->linesize,
+                       mcu % s->mb_width, mcu / s->mb_width, 0, 0) < 0)
+            return -1;
+
+    if (jobnr == sc->nb_intervals - 1)
+        sc->end_bits = start * 8 + get_bits_count(&s->gb);
+    return 0;
+}
+
+/**
+ * Decode the restart intervals of a sequential scan in parallel.
+ * The entropy coded segments between RSTn markers are independent,
+ * the marker positions have been recorded while unescaping the scan.
+ * @return 1 if the scan was decoded, 0 if the serial path has to be used,
+ *         <0 if an interval failed to decode
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s, MJpegScanContext *sc)
+{
+    AVCodecContext *avctx = s->avctx;
+    int nb_mcus = s->mb_width * s->mb_height;
+    int *ret;
+    int i;
+
+    if (avctx->thread_count <= 1 || s->progressive || !s->restart_interval ||
+        s->restart_count || avctx->codec_id == CODEC_ID_THP)
+        return 0;
+
+    sc->nb_intervals = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+    if (sc->nb_intervals < 2 || s->nb_restart_markers < sc->nb_intervals - 1)
+        return 0;
+    sc->start = get_bits_count(&s->gb) >> 3;
+    sc->end   = s->gb.size_in_bits >> 3;
+    if (sc->start > s->restart_offsets[0])
+        return 0;
+
+    if (!s->thread_ctx) {
+        s->thread_ctx = av_malloc(avctx->thread_count * sizeof(*s->thread_ctx));
+        if (!s->thread_ctx)
+            return 0;
+    }
+    ret = av_fast_realloc(s->interval_ret, &s->interval_ret_size,
+                          sc->nb_intervals * sizeof(*ret));
+    if (!ret)
+        return 0;
+    s->interval_ret = ret;
+    for (i = 0; i < avctx->thread_count; i++)
+        memcpy(&s->thread_ctx[i], s, sizeof(*s));
+
+    sc->end_bits = s->gb.size_in_bits;
+    avctx->execute2(avctx, decode_restart_interval, sc, ret, sc->nb_intervals);
+    for (i = 0; i < sc->nb_intervals; i++)
+        if (ret[i] < 0)
+            return ret[i];
+
+    skip_bits_long(&s->gb, sc->end_bits - get_bits_count(&s->gb));
+    s->restart_count = nb_mcus % s->restart_interval ?
+                       s->restart_interval - nb_mcus % s->restart_interval : 0;
+    return 1;
+}
+
+static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah, int Al){
+    int i, mb_x, mb_y, ret;
+    MJpegScanContext sc;
+    uint8_t **data = sc.data;
+    int *linesize  = sc.linesize;
 
     if(s->flipped && s->avctx->flags & CODEC_FLAG_EMU_EDGE) {
         av_log(s->avctx, AV_LOG_ERROR, "Can not flip image with CODEC_FLAG_EMU_EDGE set!\n");
@@ -787,54 +923,18 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah, i
             linesize[c] *= -1;
         }
     }
+    sc.nb_components = nb_components;
+
+    if ((ret = mjpeg_decode_scan_threaded(s, &sc)))
+        return ret < 0 ? ret : 0;
 
     for(mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for(mb_x = 0; mb_x < s->mb_width; mb_x++) {
             if (s->restart_interval && !s->restart_count)
                 s->restart_count = s->restart_interval;
 
-            for(i=0;i<nb_components;i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for(j=0;j<n;j++) {
-                    ptr = data[c] +
-                        (((linesize[c] * (v * mb_y + y) * 8) +
-                        (h * mb_x + x) * 8) >> s->avctx->lowres);
-                    if(s->interlaced && s->bottom_field)
-                        ptr += linesize[c] >> 1;
-                    if(!s->progressive) {
-                        s->dsp.clear_block(s->block);
-                        if(decode_block(s, s->block, i,
-                                     s->dc_index[i], s->ac_index[i],
-                                     s->quant_matrixes[ s->quant_index[c] ]) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR, "error y=%d x=%d\n", mb_y, mb_x);
-                            return -1;
-                        }
-                        s->dsp.idct_put(ptr, linesize[c], s->block);
-                    } else {
-                        int block_idx = s->block_stride[c] * (v * mb_y + y) + (h * mb_x + x);
-                        DCTELEM *block = s->blocks[c][block_idx];
-                        if(Ah)
-                            block[0] += get_bits1(&s->gb) * s->quant_matrixes[ s->quant_index[c] ][0] << Al;
-                        else if(decode_dc_progressive(s, block, i, s->dc_index[i], s->quant_matrixes[ s->quant_index[c] ], Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR, "error y=%d x=%d\n", mb_y, mb_x);
-                            return -1;
-                        }
-                    }
-//                    av_log(s->avctx, AV_LOG_DEBUG, "mb: %d %d processed\n", mb_y, mb_x);
-//av_log(NULL, AV_LOG_DEBUG, "%d %d %d %d %d %d %d %d \n", mb_x, mb_y, x, y, c, s->bottom_field, (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
+            if (decode_mcu(s, nb_components, data, linesize, mb_x, mb_y, Ah, Al) < 0)
+                return -1;
 
             if (s->restart_interval && !--s->restart_count) {
                 align_get_bits(&s->gb);
@@ -1226,6 +1326,22 @@ static int valid_marker_list[] =
 }
 #endif
 
+static void record_restart_marker(MJpegDecodeContext *s, int offset)
+{
+    int *offsets;
+
+    if (s->nb_restart_markers < 0)
+        return;
+    offsets = av_fast_realloc(s->restart_offsets, &s->restart_offsets_size,
+                              (s->nb_restart_markers + 1) * sizeof(*offsets));
+    if (!offsets) {
+        s->nb_restart_markers = -1; /* incomplete, use the serial path */
+        return;
+    }
+    s->restart_offsets = offsets;
+    s->restart_offsets[s->nb_restart_markers++] = offset;
+}
+
 /* return the 8 bit start code value and update the search
    state. Return -1 if no start code found */
 static int find_marker(const uint8_t **pbuf_ptr, const uint8_t *buf_end)
@@ -1295,6 +1411,7 @@ int ff_mjpeg_decode_frame(AVCodecContext *avctx,
                     const uint8_t *src = buf_ptr;
                     uint8_t *dst = s->buffer;
 
+                    s->nb_restart_markers = 0;
                     while (src<buf_end)
                     {
                         uint8_t x = *(src++);
@@ -1306,9 +1423,10 @@ int ff_mjpeg_decode_frame(AVCodecContext *avctx,
                                 while (src < buf_end && x == 0xff)
                                     x = *(src++);
 
-                                if (x >= 0xd0 && x <= 0xd7)
+                                if (x >= 0xd0 && x <= 0xd7) {
                                     *(dst++) = x;
-                                else if (x)
+                                    record_restart_marker(s, dst - s->buffer);
+                                } else if (x)
                                     break;
                             }
                         }
@@ -1520,6 +1638,9 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_free(s->qscale_table);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size=0;
+    av_freep(&s->restart_offsets);
+    av_freep(&s->thread_ctx);
+    av_freep(&s->interval_ret);
 
     for(i=0;i<2;i++) {
         for(j=0;j<4;j++)
@@ -93,6 +93,12 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_offsets;       ///< offsets in buffer of the segments following each RSTn marker
+    unsigned int restart_offsets_size;
+    int nb_restart_markers;
+    struct MJpegDecodeContext *thread_ctx; ///< per-thread copies for parallel restart interval decoding
+    int *interval_ret;          ///< return values of the parallel restart interval decoding
+    unsigned int interval_ret_size;
 
     int buggy_avid;
     int cs_itu601;
@@ -204,6 +204,13 @@ void ff_mjpeg_encode_picture_header(MpegEncContext *s)
 
     jpeg_table_header(s);
 
+    /* slices start with a restart marker at the beginning of a row */
+    if(s->rtp_mode && !lossless){
+        put_marker(&s->pb, DRI);
+        put_bits(&s->pb, 16, 4);
+        put_bits(&s->pb, 16, s->mb_width);
+    }
+
     switch(s->avctx->codec_id){
     case CODEC_ID_MJPEG:  put_marker(&s->pb, SOF0 ); break;
     case CODEC_ID_LJPEG:  put_marker(&s->pb, SOF3 ); break;
@@ -274,6 +281,8 @@ void ff_mjpeg_encode_picture_header(MpegEncContext *s)
     }
 
     put_bits(&s->pb, 8, 0); /* Ah/Al (not used) */
+
+    s->esc_pos= put_bits_count(&s->pb) >> 3;
 }
 
 static void escape_FF(MpegEncContext *s, int start)
@@ -329,22 +338,41 @@ static void escape_FF(MpegEncContext *s, int start)
     }
 }
 
-void ff_mjpeg_encode_stuffing(PutBitContext * pbc)
+/**
+ * Pad the coded data to a byte boundary and escape the 0xFF bytes coded
+ * since the last call, the header or the last restart marker.
+ */
+void ff_mjpeg_encode_stuffing(MpegEncContext *s)
 {
+    PutBitContext *pbc = &s->pb;
     int length;
     length= (-put_bits_count(pbc))&7;
     if(length) put_bits(pbc, length, (1<<length)-1);
+
+    flush_put_bits(pbc);
+    escape_FF(s, s->esc_pos);
+    s->esc_pos= put_bits_count(pbc) >> 3;
 }
 
-void ff_mjpeg_encode_picture_trailer(MpegEncContext *s)
+/**
+ * Write the n-th restart marker, after which the DC prediction restarts.
+ */
+void ff_mjpeg_encode_restart(MpegEncContext *s, int n)
 {
-    ff_mjpeg_encode_stuffing(&s->pb);
-    flush_put_bits(&s->pb);
-
-    assert((s->header_bits&7)==0);
+    int i;
 
-    escape_FF(s, s->header_bits>>3);
+    put_marker(&s->pb, RST0 + (n & 7));
+    s->esc_pos= put_bits_count(&s->pb) >> 3;
+    for(i=0; i<3; i++)
+        s->last_dc[i] = 128 << s->intra_dc_precision;
+}
 
+/**
+ * Finish the picture; the coded data must have been padded and escaped
+ * with ff_mjpeg_encode_stuffing().
+ */
+void ff_mjpeg_encode_picture_trailer(MpegEncContext *s)
+{
     put_marker(&s->pb, EOI);
 }
 
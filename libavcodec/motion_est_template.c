@@ -585,10 +585,53 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
         next_dir=-1;
 
 //printf("%d", dir);
-        if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
-        if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
-        if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
-        if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        if(size==0 && flags==0 && cmpf==s->dsp.sad[0]){
+            /* score all unvisited neighbours with one sad16_x4() call and
+             * then update best in the same order as the CHECK_MV_DIR path */
+            static const int8_t dia[4][2]= {{-1,0}, {0,-1}, {1,0}, {0,1}};
+            const int stride= c->stride;
+            uint8_t * const ref= c->ref[ref_index][0] + x + y*stride;
+            uint8_t *cand[4];
+            int scores[4];
+            int i, todo= 0;
+
+            for(i=0; i<4; i++){
+                const int nx= x + dia[i][0];
+                const int ny= y + dia[i][1];
+                const int key= (ny<<ME_MAP_MV_BITS) + nx + map_generation;
+                const int index= ((ny<<ME_MAP_SHIFT) + nx)&(ME_MAP_SIZE-1);
+
+                cand[i]= ref;
+                if(dir == (i^2) || nx<xmin || nx>xmax || ny<ymin || ny>ymax || map[index]==key)
+                    continue;
+                cand[i]= ref + dia[i][0] + dia[i][1]*stride;
+                todo |= 1<<i;
+            }
+            if(todo)
+                s->dsp.sad16_x4(c->src[src_index][0], cand, stride, h, scores);
+            for(i=0; i<4; i++){
+                if(todo & (1<<i)){
+                    const int nx= x + dia[i][0];
+                    const int ny= y + dia[i][1];
+                    const int index= ((ny<<ME_MAP_SHIFT) + nx)&(ME_MAP_SIZE-1);
+
+                    map[index]= (ny<<ME_MAP_MV_BITS) + nx + map_generation;
+                    score_map[index]= d= scores[i];
+                    d += (mv_penalty[(nx<<shift)-pred_x] + mv_penalty[(ny<<shift)-pred_y])*penalty_factor;
+                    if(d<dmin){
+                        best[0]=nx;
+                        best[1]=ny;
+                        dmin=d;
+                        next_dir= i;
+                    }
+                }
+            }
+        }else{
+            if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
+            if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
+            if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
+            if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        }
 
         if(next_dir==-1){
             return dmin;
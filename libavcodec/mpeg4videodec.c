@@ -543,6 +543,11 @@ static int mpeg4_decode_partition_a(MpegEncContext *s){
             int cbpc;
             int dir=0;
 
+            /* the following video packet belongs to another slice thread,
+             * the caller checks that it starts with the expected marker */
+            if(s->mb_x + s->mb_y*s->mb_width >= s->end_mb_num)
+                return mb_num;
+
             mb_num++;
             ff_update_block_index(s);
             if(s->mb_x == s->resync_mb_x && s->mb_y == s->resync_mb_y+1)
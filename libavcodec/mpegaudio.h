@@ -159,6 +159,22 @@ typedef struct MPADecodeContext {
     AVCodecContext* avctx;
 #if CONFIG_FLOAT
     DCTContext dct;
+    /**
+     * antialias butterflies between n pairs of long blocks
+     * @param ptr start of the second block
+     * @param csa cs[8] followed by ca[8], 16-byte aligned
+     */
+    void (*antialias_float)(float *ptr, const float *csa, int n);
+    /**
+     * imdct36, windowing and overlap of 4 consecutive long blocks,
+     * starting at an even subband. Optional, NULL if not available.
+     * @param out output samples, 16-byte aligned, stride SBLIMIT
+     * @param buf overlap buffer of the 4 blocks
+     * @param in  4 blocks of 18 coefficients
+     * @param win window, coefficient i of block k at win[4 * i + k]
+     */
+    void (*imdct36_4_float)(float *out, float *buf, const float *in,
+                            const float *win);
 #endif
     void (*apply_window_mp3)(MPA_INT *synth_buf, MPA_INT *window,
                              int *dither_state, OUT_INT *samples, int incr);
@@ -74,6 +74,9 @@
 #endif
 
 static void compute_antialias(MPADecodeContext *s, GranuleDef *g);
+#if CONFIG_FLOAT
+static void antialias_float_c(float *ptr, const float *csa, int n);
+#endif
 static void apply_window_mp3_c(MPA_INT *synth_buf, MPA_INT *window,
                                int *dither_state, OUT_INT *samples, int incr);
 
@@ -99,8 +102,12 @@ static uint16_t band_index_long[9][23];
 static INTFLOAT is_table[2][16];
 static INTFLOAT is_table_lsf[2][2][16];
 static int32_t csa_table[8][4];
-static float csa_table_float[8][4];
+DECLARE_ALIGNED(16, static float, csa_table_float)[2][8];
 static INTFLOAT mdct_win[8][36];
+#if CONFIG_FLOAT
+/* mdct_win of 4 consecutive long blocks, interleaved */
+DECLARE_ALIGNED(16, static float, mdct_win4)[4][36][4];
+#endif
 
 static int16_t division_tab3[1<<6 ];
 static int16_t division_tab5[1<<8 ];
@@ -321,6 +328,10 @@ static av_cold int decode_init(AVCodecContext * avctx)
 
     s->avctx = avctx;
     s->apply_window_mp3 = apply_window_mp3_c;
+#if CONFIG_FLOAT
+    s->antialias_float = antialias_float_c;
+    s->imdct36_4_float = NULL;
+#endif
 #if HAVE_MMX && CONFIG_FLOAT
     ff_mpegaudiodec_init_mmx(s);
 #endif
@@ -471,10 +482,8 @@ static av_cold int decode_init(AVCodecContext * avctx)
             csa_table[i][1] = FIXHR(ca/4);
             csa_table[i][2] = FIXHR(ca/4) + FIXHR(cs/4);
             csa_table[i][3] = FIXHR(ca/4) - FIXHR(cs/4);
-            csa_table_float[i][0] = cs;
-            csa_table_float[i][1] = ca;
-            csa_table_float[i][2] = ca + cs;
-            csa_table_float[i][3] = ca - cs;
+            csa_table_float[0][i] = cs;
+            csa_table_float[1][i] = ca;
         }
 
         /* compute mdct windows */
@@ -513,6 +522,14 @@ static av_cold int decode_init(AVCodecContext * avctx)
                 mdct_win[j + 4][i + 1] = -mdct_win[j][i + 1];
             }
         }
+#if CONFIG_FLOAT
+        for(j=0;j<4;j++) {
+            for(i=0;i<36;i++) {
+                for(k=0;k<4;k++)
+                    mdct_win4[j][i][k] = mdct_win[j + 4 * (k & 1)][i];
+            }
+        }
+#endif
 
         init = 1;
     }
@@ -1649,7 +1666,18 @@ static void compute_imdct(MPADecodeContext *s,
 
     buf = mdct_buf;
     ptr = g->sb_hybrid;
-    for(j=0;j<mdct_long_end;j++) {
+    j = 0;
+#if CONFIG_FLOAT
+    if (s->imdct36_4_float && !g->switch_point) {
+        for(; j + 4 <= mdct_long_end; j += 4) {
+            s->imdct36_4_float(sb_samples + j, buf, ptr,
+                               mdct_win4[g->block_type][0]);
+            ptr += 4 * 18;
+            buf += 4 * 18;
+        }
+    }
+#endif
+    for(;j<mdct_long_end;j++) {
         /* apply window & overlap with previous buffer */
         out_ptr = sb_samples + j;
         /* select window */
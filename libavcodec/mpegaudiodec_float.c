@@ -41,31 +41,17 @@ void ff_mpa_synth_filter_float(MPADecodeContext *s, float *synth_buf_ptr,
     *synth_buf_offset = offset;
 }
 
-static void compute_antialias_float(MPADecodeContext *s,
-                              GranuleDef *g)
+static void antialias_float_c(float *ptr, const float *csa, int n)
 {
-    float *ptr;
-    int n, i;
-
-    /* we antialias only "long" bands */
-    if (g->block_type == 2) {
-        if (!g->switch_point)
-            return;
-        /* XXX: check this for 8000Hz case */
-        n = 1;
-    } else {
-        n = SBLIMIT - 1;
-    }
+    int i;
 
-    ptr = g->sb_hybrid + 18;
     for(i = n;i > 0;i--) {
         float tmp0, tmp1;
-        float *csa = &csa_table_float[0][0];
 #define FLOAT_AA(j)\
         tmp0= ptr[-1-j];\
         tmp1= ptr[   j];\
-        ptr[-1-j] = tmp0 * csa[0+4*j] - tmp1 * csa[1+4*j];\
-        ptr[   j] = tmp0 * csa[1+4*j] + tmp1 * csa[0+4*j];
+        ptr[-1-j] = tmp0 * csa[j] - tmp1 * csa[8+j];\
+        ptr[   j] = tmp0 * csa[8+j] + tmp1 * csa[j];
 
         FLOAT_AA(0)
         FLOAT_AA(1)
@@ -80,6 +66,24 @@ static void compute_antialias_float(MPADecodeContext *s,
     }
 }
 
+static void compute_antialias_float(MPADecodeContext *s,
+                              GranuleDef *g)
+{
+    int n;
+
+    /* we antialias only "long" bands */
+    if (g->block_type == 2) {
+        if (!g->switch_point)
+            return;
+        /* XXX: check this for 8000Hz case */
+        n = 1;
+    } else {
+        n = SBLIMIT - 1;
+    }
+
+    s->antialias_float(g->sb_hybrid + 18, csa_table_float[0], n);
+}
+
 static av_cold int decode_end(AVCodecContext * avctx)
 {
     MPADecodeContext *s = avctx->priv_data;
@@ -249,6 +249,8 @@ typedef struct MpegEncContext {
 
     int start_mb_y;            ///< start mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
+    int start_mb_num;          ///< first MB index (mb_x + mb_y*mb_width) of the current slice thread
+    int end_mb_num;            ///< first MB index (mb_x + mb_y*mb_width) the current slice thread must not decode
     struct MpegEncContext *thread_context[MAX_THREADS];
 
     /**
@@ -577,6 +579,7 @@ typedef struct MpegEncContext {
     struct MJpegContext *mjpeg_ctx;
     int mjpeg_vsample[3];       ///< vertical sampling factors, default = {2, 1, 1}
     int mjpeg_hsample[3];       ///< horizontal sampling factors, default = {2, 1, 1}
+    int esc_pos;                ///< byte position in pb from which the coded data has not been escaped yet
 
     /* MSMPEG4 specific */
     int mv_table_index;
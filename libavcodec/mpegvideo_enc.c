@@ -462,6 +462,7 @@ av_cold int MPV_encode_init(AVCodecContext *avctx)
 
     if(s->avctx->thread_count > 1 && s->codec_id != CODEC_ID_MPEG4
        && s->codec_id != CODEC_ID_MPEG1VIDEO && s->codec_id != CODEC_ID_MPEG2VIDEO
+       && s->codec_id != CODEC_ID_MJPEG
        && (s->codec_id != CODEC_ID_H263P || !(s->flags & CODEC_FLAG_H263P_SLICE_STRUCT))){
         av_log(avctx, AV_LOG_ERROR, "multi threaded encoding not supported by codec\n");
         return -1;
@@ -2025,7 +2026,7 @@ static void write_slice_end(MpegEncContext *s){
 
         ff_mpeg4_stuffing(&s->pb);
     }else if(CONFIG_MJPEG_ENCODER && s->out_format == FMT_MJPEG){
-        ff_mjpeg_encode_stuffing(&s->pb);
+        ff_mjpeg_encode_stuffing(s);
     }
 
     align_put_bits(&s->pb);
@@ -2152,6 +2153,10 @@ static int encode_thread(AVCodecContext *c, void *arg){
                 case CODEC_ID_MPEG1VIDEO:
                     if(s->mb_skip_run) is_gob_start=0;
                     break;
+                case CODEC_ID_MJPEG:
+                    /* the restart interval is one row */
+                    is_gob_start= s->mb_x==0 && s->mb_y!=0;
+                    break;
                 }
 
                 if(is_gob_start){
@@ -2202,6 +2207,10 @@ static int encode_thread(AVCodecContext *c, void *arg){
                         if (CONFIG_H263_ENCODER)
                             h263_encode_gob_header(s, mb_y);
                     break;
+                    case CODEC_ID_MJPEG:
+                        if (CONFIG_MJPEG_ENCODER)
+                            ff_mjpeg_encode_restart(s, mb_y - 1);
+                    break;
                     }
 
                     if(s->flags&CODEC_FLAG_PASS1){
@@ -50,6 +50,10 @@ struct ReSampleContext {
     unsigned sample_size[2];         ///< size of one sample in sample_fmt
     short *buffer[2];                ///< buffers used for conversion to S16
     unsigned buffer_size[2];         ///< sizes of allocated buffers
+    AVAudioConvert *remix_ctx;       ///< downmix of more than 2 input channels
+    int remix_channels;              ///< input channels before the downmix
+    short *remix_buffer;
+    unsigned remix_buffer_size;
 };
 
 /* n1: number of samples */
@@ -149,19 +153,36 @@ ReSampleContext *av_audio_resample_init(int output_channels, int input_channels,
                                         int linear, double cutoff)
 {
     ReSampleContext *s;
-
-    if ( input_channels > 2)
-      {
-        av_log(NULL, AV_LOG_ERROR, "Resampling with input channels greater than 2 unsupported.\n");
-        return NULL;
-      }
+    AVAudioConvert *remix_ctx = NULL;
+    int remix_channels = 0;
+
+    if (input_channels > 2) {
+        float matrix[6*6];
+        if (output_channels > 2 ||
+            av_audio_convert_matrix(matrix,
+                                    avcodec_guess_channel_layout(output_channels, CODEC_ID_NONE, NULL),
+                                    avcodec_guess_channel_layout(input_channels,  CODEC_ID_NONE, NULL)) < 0 ||
+            !(remix_ctx = av_audio_convert_alloc(SAMPLE_FMT_S16, output_channels,
+                                                 SAMPLE_FMT_S16, input_channels,
+                                                 matrix, 0))) {
+            av_log(NULL, AV_LOG_ERROR, "Resampling from %d to %d channels unsupported.\n",
+                   input_channels, output_channels);
+            return NULL;
+        }
+        /* downmix first, the rest only sees output_channels */
+        remix_channels = input_channels;
+        input_channels = output_channels;
+    }
 
     s = av_mallocz(sizeof(ReSampleContext));
     if (!s)
       {
         av_log(NULL, AV_LOG_ERROR, "Can't allocate memory for resample context.\n");
+        av_audio_convert_free(remix_ctx);
         return NULL;
       }
+    s->remix_ctx      = remix_ctx;
+    s->remix_channels = remix_channels;
 
     s->ratio = (float)output_rate / (float)input_rate;
 
@@ -183,6 +204,7 @@ ReSampleContext *av_audio_resample_init(int output_channels, int input_channels,
             av_log(s, AV_LOG_ERROR,
                    "Cannot convert %s sample format to s16 sample format\n",
                    avcodec_get_sample_fmt_name(s->sample_fmt[0]));
+            av_audio_convert_free(s->remix_ctx);
             av_free(s);
             return NULL;
         }
@@ -195,6 +217,7 @@ ReSampleContext *av_audio_resample_init(int output_channels, int input_channels,
                    "Cannot convert s16 sample format to %s sample format\n",
                    avcodec_get_sample_fmt_name(s->sample_fmt[1]));
             av_audio_convert_free(s->convert_ctx[0]);
+            av_audio_convert_free(s->remix_ctx);
             av_free(s);
             return NULL;
         }
@@ -250,7 +273,8 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         int ostride[1] = { 2 };
         const void *ibuf[1] = { input };
         void       *obuf[1];
-        unsigned input_size = nb_samples*s->input_channels*2;
+        int channels = s->remix_ctx ? s->remix_channels : s->input_channels;
+        unsigned input_size = nb_samples*channels*2;
 
         if (!s->buffer_size[0] || s->buffer_size[0] < input_size) {
             av_free(s->buffer[0]);
@@ -265,7 +289,7 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         obuf[0] = s->buffer[0];
 
         if (av_audio_convert(s->convert_ctx[0], obuf, ostride,
-                             ibuf, istride, nb_samples*s->input_channels) < 0) {
+                             ibuf, istride, nb_samples*channels) < 0) {
             av_log(s->resample_context, AV_LOG_ERROR, "Audio sample format conversion failed\n");
             return 0;
         }
@@ -273,6 +297,38 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         input  = s->buffer[0];
     }
 
+    if (s->remix_ctx) {
+        const void *ibuf[6];
+        void       *obuf[6];
+        int istride[6], ostride[6];
+        unsigned remix_size = nb_samples*s->output_channels*2;
+
+        if (s->remix_buffer_size < remix_size) {
+            av_free(s->remix_buffer);
+            s->remix_buffer_size = remix_size;
+            s->remix_buffer = av_malloc(s->remix_buffer_size);
+            if (!s->remix_buffer) {
+                s->remix_buffer_size = 0;
+                av_log(s->resample_context, AV_LOG_ERROR, "Could not allocate buffer\n");
+                return 0;
+            }
+        }
+
+        for (i = 0; i < s->remix_channels; i++) {
+            ibuf[i]    = input + i;
+            istride[i] = 2*s->remix_channels;
+        }
+        for (i = 0; i < s->output_channels; i++) {
+            obuf[i]    = s->remix_buffer + i;
+            ostride[i] = 2*s->output_channels;
+        }
+        if (av_audio_convert(s->remix_ctx, obuf, ostride, ibuf, istride, nb_samples) < 0) {
+            av_log(s->resample_context, AV_LOG_ERROR, "Audio channel remixing failed\n");
+            return 0;
+        }
+        input = s->remix_buffer;
+    }
+
     lenout= 4*nb_samples * s->ratio + 16;
 
     if (s->sample_fmt[1] != SAMPLE_FMT_S16) {
@@ -291,53 +347,79 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         output = s->buffer[1];
     }
 
-    /* XXX: move those malloc to resample init code */
-    for(i=0; i<s->filter_channels; i++){
-        bufin[i]= av_malloc( (nb_samples + s->temp_len) * sizeof(short) );
-        memcpy(bufin[i], s->temp[i], s->temp_len * sizeof(short));
-        buftmp2[i] = bufin[i] + s->temp_len;
-    }
-
-    /* make some zoom to avoid round pb */
-    bufout[0]= av_malloc( lenout * sizeof(short) );
-    bufout[1]= av_malloc( lenout * sizeof(short) );
-
-    if (s->input_channels == 2 &&
-        s->output_channels == 1) {
-        buftmp3[0] = output;
-        stereo_to_mono(buftmp2[0], input, nb_samples);
-    } else if (s->output_channels >= 2 && s->input_channels == 1) {
-        buftmp3[0] = bufout[0];
-        memcpy(buftmp2[0], input, nb_samples*sizeof(short));
-    } else if (s->output_channels >= 2) {
-        buftmp3[0] = bufout[0];
-        buftmp3[1] = bufout[1];
-        stereo_split(buftmp2[0], buftmp2[1], input, nb_samples);
+    if (s->input_channels == 2 && s->output_channels == 2) {
+        /* both channels in one pass, temp[0] holds interleaved samples */
+        int consumed;
+        short *bufin2 = av_malloc((nb_samples + s->temp_len) * 2 * sizeof(short));
+        if (!bufin2) {
+            av_log(s->resample_context, AV_LOG_ERROR, "Could not allocate buffer\n");
+            return 0;
+        }
+        memcpy(bufin2, s->temp[0], s->temp_len * 2 * sizeof(short));
+        memcpy(bufin2 + 2*s->temp_len, input, nb_samples * 2 * sizeof(short));
+        nb_samples += s->temp_len;
+
+        nb_samples1 = av_resample_interleaved(s->resample_context, output, bufin2,
+                                              &consumed, nb_samples, lenout, 2, 1);
+        s->temp_len = nb_samples - consumed;
+        s->temp[0]  = av_realloc(s->temp[0], s->temp_len * 2 * sizeof(short));
+        memcpy(s->temp[0], bufin2 + 2*consumed, s->temp_len * 2 * sizeof(short));
+        av_free(bufin2);
     } else {
-        buftmp3[0] = output;
-        memcpy(buftmp2[0], input, nb_samples*sizeof(short));
-    }
+        /* XXX: move those malloc to resample init code */
+        for(i=0; i<s->filter_channels; i++){
+            bufin[i]= av_malloc( (nb_samples + s->temp_len) * sizeof(short) );
+            memcpy(bufin[i], s->temp[i], s->temp_len * sizeof(short));
+            buftmp2[i] = bufin[i] + s->temp_len;
+        }
 
-    nb_samples += s->temp_len;
+        /* make some zoom to avoid round pb */
+        bufout[0]= av_malloc( lenout * sizeof(short) );
+        bufout[1]= av_malloc( lenout * sizeof(short) );
+
+        if (s->input_channels == 2 &&
+            s->output_channels == 1) {
+            buftmp3[0] = output;
+            stereo_to_mono(buftmp2[0], input, nb_samples);
+        } else if (s->output_channels >= 2 && s->input_channels == 1) {
+            buftmp3[0] = bufout[0];
+            memcpy(buftmp2[0], input, nb_samples*sizeof(short));
+        } else if (s->output_channels >= 2) {
+            buftmp3[0] = bufout[0];
+            buftmp3[1] = bufout[1];
+            stereo_split(buftmp2[0], buftmp2[1], input, nb_samples);
+        } else {
+            buftmp3[0] = output;
+            memcpy(buftmp2[0], input, nb_samples*sizeof(short));
+        }
 
-    /* resample each channel */
-    nb_samples1 = 0; /* avoid warning */
-    for(i=0;i<s->filter_channels;i++) {
-        int consumed;
-        int is_last= i+1 == s->filter_channels;
+        nb_samples += s->temp_len;
 
-        nb_samples1 = av_resample(s->resample_context, buftmp3[i], bufin[i], &consumed, nb_samples, lenout, is_last);
-        s->temp_len= nb_samples - consumed;
-        s->temp[i]= av_realloc(s->temp[i], s->temp_len*sizeof(short));
-        memcpy(s->temp[i], bufin[i] + consumed, s->temp_len*sizeof(short));
-    }
+        /* resample each channel */
+        nb_samples1 = 0; /* avoid warning */
+        for(i=0;i<s->filter_channels;i++) {
+            int consumed;
+            int is_last= i+1 == s->filter_channels;
+
+            nb_samples1 = av_resample(s->resample_context, buftmp3[i], bufin[i], &consumed, nb_samples, lenout, is_last);
+            s->temp_len= nb_samples - consumed;
+            s->temp[i]= av_realloc(s->temp[i], s->temp_len*sizeof(short));
+            memcpy(s->temp[i], bufin[i] + consumed, s->temp_len*sizeof(short));
+        }
 
-    if (s->output_channels == 2 && s->input_channels == 1) {
-        mono_to_stereo(output, buftmp3[0], nb_samples1);
-    } else if (s->output_channels == 2) {
-        stereo_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
-    } else if (s->output_channels == 6) {
-        ac3_5p1_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
+        if (s->output_channels == 2 && s->input_channels == 1) {
+            mono_to_stereo(output, buftmp3[0], nb_samples1);
+        } else if (s->output_channels == 2) {
+            stereo_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
+        } else if (s->output_channels == 6) {
+            ac3_5p1_mux(output, buftmp3[0], buftmp3[1], nb_samples1);
+        }
+
+        for(i=0; i<s->filter_channels; i++)
+            av_free(bufin[i]);
+
+        av_free(bufout[0]);
+        av_free(bufout[1]);
     }
 
     if (s->sample_fmt[1] != SAMPLE_FMT_S16) {
@@ -353,11 +435,6 @@ int audio_resample(ReSampleContext *s, short *output, short *input, int nb_sampl
         }
     }
 
-    for(i=0; i<s->filter_channels; i++)
-        av_free(bufin[i]);
-
-    av_free(bufout[0]);
-    av_free(bufout[1]);
     return nb_samples1;
 }
 
@@ -368,7 +445,9 @@ void audio_resample_close(ReSampleContext *s)
     av_freep(&s->temp[1]);
     av_freep(&s->buffer[0]);
     av_freep(&s->buffer[1]);
+    av_freep(&s->remix_buffer);
     av_audio_convert_free(s->convert_ctx[0]);
     av_audio_convert_free(s->convert_ctx[1]);
+    av_audio_convert_free(s->remix_ctx);
     av_free(s);
 }
@@ -25,11 +25,14 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include "libavutil/cpu.h"
 #include "avcodec.h"
 #include "dsputil.h"
+#include "resample2.h"
 
 #ifndef CONFIG_RESAMPLE_HP
 #define FILTER_SHIFT 15
+#define RESAMPLE_DSP 1
 
 #define FELEM int16_t
 #define FELEM2 int32_t
@@ -55,6 +58,12 @@
 #define WINDOW_TYPE 24
 #endif
 
+#ifndef RESAMPLE_DSP
+#define RESAMPLE_DSP 0
+#endif
+
+#define MAX_CHANNELS 8
+
 
 typedef struct AVResampleContext{
     const AVClass *av_class;
@@ -69,6 +78,7 @@ typedef struct AVResampleContext{
     int phase_shift;
     int phase_mask;
     int linear;
+    ResampleDSPContext dsp;
 }AVResampleContext;
 
 /**
@@ -186,6 +196,42 @@ static int build_filter(FELEM *filter, double factor, int tap_count, int phase_c
     return 0;
 }
 
+static int32_t filter_c(const int16_t *src, const int16_t *filter, int len)
+{
+    int32_t val = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+        val += src[i] * filter[i];
+    return val;
+}
+
+static void filter_multi_c(int32_t *val, const int16_t *src,
+                           const int16_t *filter, int len, int channels)
+{
+    int i, ch;
+
+    for (ch = 0; ch < channels; ch++)
+        val[ch] = 0;
+    for (i = 0; i < len; i++)
+        for (ch = 0; ch < channels; ch++)
+            val[ch] += src[i*channels + ch] * filter[i];
+}
+
+static void filter_stereo_c(int32_t val[2], const int16_t *src,
+                            const int16_t *filter, int len)
+{
+    int32_t l = 0, r = 0;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        l += src[2*i    ] * filter[i];
+        r += src[2*i + 1] * filter[i];
+    }
+    val[0] = l;
+    val[1] = r;
+}
+
 AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter_size, int phase_shift, int linear, double cutoff){
     AVResampleContext *c= av_mallocz(sizeof(AVResampleContext));
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -199,7 +245,8 @@ AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter_size,
     c->linear= linear;
 
     c->filter_length= FFMAX((int)ceil(filter_size/factor), 1);
-    c->filter_bank= av_mallocz(c->filter_length*(phase_count+1)*sizeof(FELEM));
+    /* +1 for the SIMD filters, which may read one tap past the last phase */
+    c->filter_bank= av_mallocz((c->filter_length*(phase_count+1)+1)*sizeof(FELEM));
     if (!c->filter_bank)
         goto error;
     if (build_filter(c->filter_bank, factor, c->filter_length, phase_count, 1<<FILTER_SHIFT, WINDOW_TYPE))
@@ -211,6 +258,13 @@ AVResampleContext *av_resample_init(int out_rate, int in_rate, int filter_size,
     c->ideal_dst_incr= c->dst_incr= in_rate * phase_count;
     c->index= -phase_count*((c->filter_length-1)/2);
 
+    c->dsp.filter        = filter_c;
+    c->dsp.filter_stereo = filter_stereo_c;
+    c->dsp.filter_multi  = filter_multi_c;
+#if HAVE_MMX
+    ff_resample_dsp_init_mmx(&c->dsp, av_get_cpu_flags());
+#endif
+
     return c;
 error:
     av_free(c->filter_bank);
@@ -229,8 +283,57 @@ void av_resample_compensate(AVResampleContext *c, int sample_delta, int compensa
     c->dst_incr = c->ideal_dst_incr - c->ideal_dst_incr * (int64_t)sample_delta / compensation_distance;
 }
 
-int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx){
-    int dst_index, i;
+#ifdef CONFIG_RESAMPLE_AUDIOPHILE_KIDDY_MODE
+#define STORE(dst, val) dst = av_clip_int16(lrintf(val))
+#else
+#define STORE(dst, val) {                                                   \
+        val = (val + (1<<(FILTER_SHIFT-1)))>>FILTER_SHIFT;                  \
+        dst = (unsigned)(val + 32768) > 65535 ? (val>>31) ^ 32767 : val;    \
+    }
+#endif
+
+/**
+ * Apply one filter phase to all the interleaved channels of src.
+ * @param overread set if 2 frames past the filter window may be read
+ */
+static av_always_inline void filter_channels(AVResampleContext *c, FELEM2 *val,
+                                             const short *src, const FELEM *filter,
+                                             int channels, int overread)
+{
+    int i, ch;
+#if RESAMPLE_DSP
+    int32_t v[MAX_CHANNELS];
+
+    if (channels <= 2 || overread) {
+        if (channels == 1) {
+            val[0] = c->dsp.filter(src, filter, c->filter_length);
+            return;
+        }
+        if (channels == 2)
+            c->dsp.filter_stereo(v, src, filter, c->filter_length);
+        else
+            c->dsp.filter_multi(v, src, filter, c->filter_length, channels);
+        for (ch = 0; ch < channels; ch++)
+            val[ch] = v[ch];
+        return;
+    }
+#endif
+    for (ch = 0; ch < channels; ch++)
+        val[ch] = 0;
+    for (i = 0; i < c->filter_length; i++)
+        for (ch = 0; ch < channels; ch++)
+            val[ch] += src[i*channels + ch] * (FELEM2)filter[i];
+}
+
+/**
+ * Resample "channels" interleaved channels, all channels of one output
+ * sample share the filter phase computations.
+ */
+static av_always_inline int resample(AVResampleContext *c, short *dst, const short *src,
+                                     int *consumed, int src_size, int dst_size,
+                                     int update_ctx, int channels)
+{
+    int dst_index, i, ch;
     int index= c->index;
     int frac= c->frac;
     int dst_incr_frac= c->dst_incr % c->src_incr;
@@ -243,7 +346,8 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
         dst_size= FFMIN(dst_size, (src_size-1-index) * (int64_t)c->src_incr / c->dst_incr);
 
         for(dst_index=0; dst_index < dst_size; dst_index++){
-            dst[dst_index] = src[index2>>32];
+            for (ch = 0; ch < channels; ch++)
+                dst[dst_index*channels + ch] = src[(index2>>32)*channels + ch];
             index2 += incr;
         }
         frac += dst_index * dst_incr_frac;
@@ -254,33 +358,32 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
     for(dst_index=0; dst_index < dst_size; dst_index++){
         FELEM *filter= c->filter_bank + c->filter_length*(index & c->phase_mask);
         int sample_index= index >> c->phase_shift;
-        FELEM2 val=0;
 
         if(sample_index < 0){
-            for(i=0; i<c->filter_length; i++)
-                val += src[FFABS(sample_index + i) % src_size] * filter[i];
+            for (ch = 0; ch < channels; ch++) {
+                FELEM2 val=0;
+                for(i=0; i<c->filter_length; i++)
+                    val += src[(FFABS(sample_index + i) % src_size)*channels + ch] * filter[i];
+                STORE(dst[dst_index*channels + ch], val);
+            }
         }else if(sample_index + c->filter_length > src_size){
             break;
-        }else if(c->linear){
-            FELEM2 v2=0;
-            for(i=0; i<c->filter_length; i++){
-                val += src[sample_index + i] * (FELEM2)filter[i];
-                v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_length];
-            }
-            val+=(v2-val)*(FELEML)frac / c->src_incr;
         }else{
-            for(i=0; i<c->filter_length; i++){
-                val += src[sample_index + i] * (FELEM2)filter[i];
+            const short *s = src + sample_index*channels;
+            FELEM2 val[MAX_CHANNELS], v2[MAX_CHANNELS];
+
+            int overread = sample_index + c->filter_length + 2 <= src_size;
+
+            filter_channels(c, val, s, filter, channels, overread);
+            if (c->linear) {
+                filter_channels(c, v2, s, filter + c->filter_length, channels, overread);
+                for (ch = 0; ch < channels; ch++)
+                    val[ch] += (v2[ch] - val[ch])*(FELEML)frac / c->src_incr;
             }
+            for (ch = 0; ch < channels; ch++)
+                STORE(dst[dst_index*channels + ch], val[ch]);
         }
 
-#ifdef CONFIG_RESAMPLE_AUDIOPHILE_KIDDY_MODE
-        dst[dst_index] = av_clip_int16(lrintf(val));
-#else
-        val = (val + (1<<(FILTER_SHIFT-1)))>>FILTER_SHIFT;
-        dst[dst_index] = (unsigned)(val + 32768) > 65535 ? (val>>31) ^ 32767 : val;
-#endif
-
         frac += dst_incr_frac;
         index += dst_incr;
         if(frac >= c->src_incr){
@@ -318,3 +421,121 @@ av_log(NULL, AV_LOG_DEBUG, "%d %d %d\n", c->dst_incr, c->ideal_dst_incr, c->comp
 
     return dst_index;
 }
+
+int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int src_size, int dst_size, int update_ctx){
+    return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, 1);
+}
+
+int av_resample_interleaved(AVResampleContext *c, short *dst, const short *src,
+                            int *consumed, int src_size, int dst_size,
+                            int channels, int update_ctx)
+{
+    if (channels < 1 || channels > MAX_CHANNELS)
+        return -1;
+    switch (channels) {
+    case 1:  return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, 1);
+    case 2:  return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, 2);
+    default: return resample(c, dst, src, consumed, src_size, dst_size, update_ctx, channels);
+    }
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/crc.h"
+#include "libavutil/lfg.h"
+
+#undef printf
+#undef fprintf
+
+#define FRAME_SIZE 1000
+#define NB_FRAMES    20
+
+/**
+ * Resample random interleaved audio in frames, carrying the unconsumed
+ * input over like a player does, once with the filter loops picked for
+ * the CPU and once with the C ones, and compare.
+ */
+static int test_resample(int in_rate, int out_rate, int channels, int linear)
+{
+    const int max_out = 2 * FRAME_SIZE * out_rate / in_rate + 16;
+    short *src = av_malloc(FRAME_SIZE * NB_FRAMES * channels * sizeof(*src));
+    short *in  = av_malloc(2 * FRAME_SIZE * channels * sizeof(*in));
+    short *out[2];
+    AVResampleContext *c[2];
+    int in_len[2] = { 0 }, out_len[2] = { 0 };
+    uint32_t crc = 0;
+    AVLFG lfg;
+    int i, j, frame, consumed, ret = 0;
+
+    out[0] = av_malloc(max_out * NB_FRAMES * channels * sizeof(*out[0]));
+    out[1] = av_malloc(max_out * NB_FRAMES * channels * sizeof(*out[1]));
+    if (!src || !in || !out[0] || !out[1]) {
+        fprintf(stderr, "cannot allocate the buffers\n");
+        return 1;
+    }
+    /* small enough that the sums stay in 32 bits */
+    av_lfg_init(&lfg, channels);
+    for (i = 0; i < FRAME_SIZE * NB_FRAMES * channels; i++)
+        src[i] = (av_lfg_get(&lfg) & 0x1fff) - 0x1000;
+
+    for (j = 0; j < 2; j++) {
+        c[j] = av_resample_init(out_rate, in_rate, 16, 10, linear, 0.8);
+        if (!c[j]) {
+            fprintf(stderr, "cannot open the resampler\n");
+            return 1;
+        }
+        if (j) {
+            c[j]->dsp.filter        = filter_c;
+            c[j]->dsp.filter_stereo = filter_stereo_c;
+            c[j]->dsp.filter_multi  = filter_multi_c;
+        }
+        for (frame = 0; frame < NB_FRAMES; frame++) {
+            memcpy(in + in_len[j] * channels,
+                   src + frame * FRAME_SIZE * channels,
+                   FRAME_SIZE * channels * sizeof(*in));
+            in_len[j] += FRAME_SIZE;
+            out_len[j] += av_resample_interleaved(c[j], out[j] + out_len[j] * channels,
+                                                  in, &consumed, in_len[j],
+                                                  max_out, channels, 1);
+            in_len[j] -= consumed;
+            memmove(in, in + consumed * channels, in_len[j] * channels * sizeof(*in));
+        }
+        av_resample_close(c[j]);
+        in_len[j] = 0;
+    }
+
+    if (out_len[0] != out_len[1] ||
+        memcmp(out[0], out[1], out_len[0] * channels * sizeof(*out[0]))) {
+        printf("%d -> %d, %d channels, linear %d: differs from C\n",
+               in_rate, out_rate, channels, linear);
+        ret = 1;
+    }
+    crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), 0,
+                 (const uint8_t *)out[1], out_len[1] * channels * sizeof(*out[1]));
+    printf("%d -> %d, %d channels, linear %d: %d samples, CRC=%08x\n",
+           in_rate, out_rate, channels, linear, out_len[1], crc);
+
+    av_free(src);
+    av_free(in);
+    av_free(out[0]);
+    av_free(out[1]);
+    return ret;
+}
+
+int main(void)
+{
+    /* filter lengths of 19 and 28 taps, for the odd last tap */
+    static const int rates[][2] = { { 44100, 48000 }, { 44100, 32000 } };
+    static const int channels[] = { 1, 2, 3, 6, 8 };
+    int i, j, linear, ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(rates); i++)
+        for (j = 0; j < FF_ARRAY_ELEMS(channels); j++)
+            for (linear = 0; linear < 2; linear++)
+                ret |= test_resample(rates[i][0], rates[i][1], channels[j], linear);
+    return ret;
+}
+
+#endif /* TEST */
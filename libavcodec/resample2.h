@@ -0,0 +1,56 @@
+/*
+ * audio resampling
+ * Copyright (c) 2004 Michael Niedermayer <michaelni@gmx.at>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_RESAMPLE2_H
+#define AVCODEC_RESAMPLE2_H
+
+#include <stdint.h>
+
+/**
+ * FIR inner loops of the 16 bit polyphase resampler.
+ * The sums wrap around like 32 bit integer arithmetic does.
+ */
+typedef struct ResampleDSPContext {
+    /**
+     * @return the sum of src[i]*filter[i] for i in [0, len)
+     */
+    int32_t (*filter)(const int16_t *src, const int16_t *filter, int len);
+
+    /**
+     * Filter two interleaved channels with the same filter,
+     * val[ch] = sum of src[2*i+ch]*filter[i] for i in [0, len).
+     */
+    void (*filter_stereo)(int32_t val[2], const int16_t *src,
+                          const int16_t *filter, int len);
+
+    /**
+     * Filter 3 to 8 interleaved channels with the same filter,
+     * val[ch] = sum of src[channels*i+ch]*filter[i] for i in [0, len).
+     * May read up to 2 frames past the end of src and 1 tap past the end
+     * of filter.
+     */
+    void (*filter_multi)(int32_t *val, const int16_t *src,
+                         const int16_t *filter, int len, int channels);
+} ResampleDSPContext;
+
+void ff_resample_dsp_init_mmx(ResampleDSPContext *c, int flags);
+
+#endif /* AVCODEC_RESAMPLE2_H */
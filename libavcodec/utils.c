@@ -114,9 +114,31 @@ typedef struct InternalBuffer{
     int linesize[4];
     int width, height;
     enum PixelFormat pix_fmt;
+    int refcount;                   ///< references held by the codec and by users
+    int codec_ref;                  ///< the codec has not released the buffer yet
+    struct BufferPool *pool;
+    struct InternalBuffer *next;    ///< next unused buffer
 }InternalBuffer;
 
-#define INTERNAL_BUFFER_SIZE 32
+/**
+ * Pool of picture buffers behind avcodec_default_get_buffer().
+ * Unused buffers are kept on a stack so that the most recently released
+ * one is handed out first, acquiring and releasing are O(1).
+ * The pool outlives its codec context while users hold references.
+ */
+typedef struct BufferPool{
+    InternalBuffer **buffers;       ///< all buffers owned by the pool
+    unsigned int buffers_size;
+    int nb_buffers;
+    InternalBuffer *unused;         ///< stack of buffers with a zero refcount
+    int nb_used;                    ///< number of buffers with a nonzero refcount
+    int picture_number;
+    int detached;                   ///< the codec context no longer uses the pool
+    void *mutex;
+    int (*lockmgr)(void **mutex, enum AVLockOp op);
+}BufferPool;
+
+#define INTERNAL_BUFFER_SIZE 32 ///< maximum number of buffers held by the codec itself
 
 void avcodec_align_dimensions2(AVCodecContext *s, int *width, int *height, int linesize_align[4]){
     int w_align= 1;
@@ -219,12 +241,156 @@ int avcodec_check_dimensions(void *av_log_ctx, unsigned int w, unsigned int h){
 }
 #endif
 
+static BufferPool *buffer_pool_alloc(void)
+{
+    BufferPool *pool = av_mallocz(sizeof(BufferPool));
+
+    if (!pool)
+        return NULL;
+    if (ff_lockmgr_cb) {
+        if (ff_lockmgr_cb(&pool->mutex, AV_LOCK_CREATE)) {
+            av_free(pool);
+            return NULL;
+        }
+        pool->lockmgr = ff_lockmgr_cb;
+    }
+    return pool;
+}
+
+static void buffer_pool_lock(BufferPool *pool)
+{
+    if (pool->mutex)
+        pool->lockmgr(&pool->mutex, AV_LOCK_OBTAIN);
+}
+
+static void buffer_pool_unlock(BufferPool *pool)
+{
+    if (pool->mutex)
+        pool->lockmgr(&pool->mutex, AV_LOCK_RELEASE);
+}
+
+/**
+ * Free an unused buffer, it must not be on the unused stack.
+ */
+static void buffer_free(InternalBuffer *buf)
+{
+    BufferPool *pool = buf->pool;
+    int i;
+
+    for (i = 0; i < pool->nb_buffers; i++) {
+        if (pool->buffers[i] == buf) {
+            pool->buffers[i] = pool->buffers[--pool->nb_buffers];
+            break;
+        }
+    }
+    for (i = 0; i < 4; i++)
+        av_free(buf->base[i]);
+    av_free(buf);
+}
+
+static void buffer_pool_free(BufferPool *pool)
+{
+    while (pool->nb_buffers)
+        buffer_free(pool->buffers[0]);
+    av_free(pool->buffers);
+    if (pool->mutex)
+        pool->lockmgr(&pool->mutex, AV_LOCK_DESTROY);
+    av_free(pool);
+}
+
+static void buffer_unref(InternalBuffer *buf)
+{
+    BufferPool *pool = buf->pool;
+    int free_pool = 0;
+
+    buffer_pool_lock(pool);
+    assert(buf->refcount > 0);
+    if (!--buf->refcount) {
+        buf->next    = pool->unused;
+        pool->unused = buf;
+        pool->nb_used--;
+        free_pool = pool->detached && !pool->nb_used;
+    }
+    buffer_pool_unlock(pool);
+
+    if (free_pool)
+        buffer_pool_free(pool);
+}
+
+static int buffer_alloc_planes(AVCodecContext *s, InternalBuffer *buf)
+{
+    int w= s->width;
+    int h= s->height;
+    int i;
+    int h_chroma_shift, v_chroma_shift;
+    int size[4] = {0};
+    int tmpsize;
+    int unaligned;
+    AVPicture picture;
+    int stride_align[4];
+
+    avcodec_get_chroma_sub_sample(s->pix_fmt, &h_chroma_shift, &v_chroma_shift);
+
+    avcodec_align_dimensions2(s, &w, &h, stride_align);
+
+    if(!(s->flags&CODEC_FLAG_EMU_EDGE)){
+        w+= EDGE_WIDTH*2;
+        h+= EDGE_WIDTH*2;
+    }
+
+    do {
+        // NOTE: do not align linesizes individually, this breaks e.g. assumptions
+        // that linesize[0] == 2*linesize[1] in the MPEG-encoder for 4:2:2
+        av_image_fill_linesizes(picture.linesize, s->pix_fmt, w);
+        // increase alignment of w for next try (rhs gives the lowest bit set in w)
+        w += w & ~(w-1);
+
+        unaligned = 0;
+        for (i=0; i<4; i++){
+            unaligned |= picture.linesize[i] % stride_align[i];
+        }
+    } while (unaligned);
+
+    tmpsize = av_image_fill_pointers(picture.data, s->pix_fmt, h, NULL, picture.linesize);
+    if (tmpsize < 0)
+        return -1;
+
+    for (i=0; i<3 && picture.data[i+1]; i++)
+        size[i] = picture.data[i+1] - picture.data[i];
+    size[i] = tmpsize - (picture.data[i] - picture.data[0]);
+
+    buf->last_pic_num= -256*256*256*64;
+
+    for(i=0; i<4 && size[i]; i++){
+        const int h_shift= i==0 ? 0 : h_chroma_shift;
+        const int v_shift= i==0 ? 0 : v_chroma_shift;
+
+        buf->linesize[i]= picture.linesize[i];
+
+        buf->base[i]= av_malloc(size[i]+16); //FIXME 16
+        if(buf->base[i]==NULL) return -1;
+        memset(buf->base[i], 128, size[i]);
+
+        // no edge if EDGE EMU or not planar YUV
+        if((s->flags&CODEC_FLAG_EMU_EDGE) || !size[2])
+            buf->data[i] = buf->base[i];
+        else
+            buf->data[i] = buf->base[i] + FFALIGN((buf->linesize[i]*EDGE_WIDTH>>v_shift) + (EDGE_WIDTH>>h_shift), stride_align[i]);
+    }
+    if(size[1] && !size[2])
+        ff_set_systematic_pal((uint32_t*)buf->data[1], s->pix_fmt);
+    buf->width  = s->width;
+    buf->height = s->height;
+    buf->pix_fmt= s->pix_fmt;
+    return 0;
+}
+
 int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
     int i;
     int w= s->width;
     int h= s->height;
     InternalBuffer *buf;
-    int *picture_number;
+    BufferPool *pool;
 
     if(pic->data[0]!=NULL) {
         av_log(s, AV_LOG_ERROR, "pic->data[0]!=NULL in avcodec_default_get_buffer\n");
@@ -239,96 +405,50 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
         return -1;
 
     if(s->internal_buffer==NULL){
-        s->internal_buffer= av_mallocz((INTERNAL_BUFFER_SIZE+1)*sizeof(InternalBuffer));
+        s->internal_buffer= buffer_pool_alloc();
+        if(s->internal_buffer==NULL)
+            return AVERROR(ENOMEM);
     }
-#if 0
-    s->internal_buffer= av_fast_realloc(
-        s->internal_buffer,
-        &s->internal_buffer_size,
-        sizeof(InternalBuffer)*FFMAX(99,  s->internal_buffer_count+1)/*FIXME*/
-        );
-#endif
+    pool= s->internal_buffer;
 
-    buf= &((InternalBuffer*)s->internal_buffer)[s->internal_buffer_count];
-    picture_number= &(((InternalBuffer*)s->internal_buffer)[INTERNAL_BUFFER_SIZE]).last_pic_num; //FIXME ugly hack
-    (*picture_number)++;
+    buffer_pool_lock(pool);
+    pool->picture_number++;
 
-    if(buf->base[0] && (buf->width != w || buf->height != h || buf->pix_fmt != s->pix_fmt)){
-        for(i=0; i<4; i++){
-            av_freep(&buf->base[i]);
-            buf->data[i]= NULL;
-        }
+    /* buffers of a different size are stale, drop them as they come up */
+    while((buf= pool->unused)){
+        pool->unused= buf->next;
+        if(buf->width == w && buf->height == h && buf->pix_fmt == s->pix_fmt)
+            break;
+        buffer_free(buf);
     }
 
-    if(buf->base[0]){
-        pic->age= *picture_number - buf->last_pic_num;
-        buf->last_pic_num= *picture_number;
+    if(buf){
+        pic->age= pool->picture_number - buf->last_pic_num;
+        buf->last_pic_num= pool->picture_number;
     }else{
-        int h_chroma_shift, v_chroma_shift;
-        int size[4] = {0};
-        int tmpsize;
-        int unaligned;
-        AVPicture picture;
-        int stride_align[4];
-
-        avcodec_get_chroma_sub_sample(s->pix_fmt, &h_chroma_shift, &v_chroma_shift);
-
-        avcodec_align_dimensions2(s, &w, &h, stride_align);
-
-        if(!(s->flags&CODEC_FLAG_EMU_EDGE)){
-            w+= EDGE_WIDTH*2;
-            h+= EDGE_WIDTH*2;
+        InternalBuffer **buffers= av_fast_realloc(pool->buffers, &pool->buffers_size,
+                                                  (pool->nb_buffers+1)*sizeof(*buffers));
+        if(buffers==NULL || !(buf= av_mallocz(sizeof(InternalBuffer)))){
+            buffer_pool_unlock(pool);
+            return AVERROR(ENOMEM);
         }
-
-        do {
-            // NOTE: do not align linesizes individually, this breaks e.g. assumptions
-            // that linesize[0] == 2*linesize[1] in the MPEG-encoder for 4:2:2
-            av_image_fill_linesizes(picture.linesize, s->pix_fmt, w);
-            // increase alignment of w for next try (rhs gives the lowest bit set in w)
-            w += w & ~(w-1);
-
-            unaligned = 0;
-            for (i=0; i<4; i++){
-                unaligned |= picture.linesize[i] % stride_align[i];
-            }
-        } while (unaligned);
-
-        tmpsize = av_image_fill_pointers(picture.data, s->pix_fmt, h, NULL, picture.linesize);
-        if (tmpsize < 0)
+        pool->buffers= buffers;
+        pool->buffers[pool->nb_buffers++]= buf;
+        buf->pool= pool;
+        if(buffer_alloc_planes(s, buf) < 0){
+            buffer_free(buf);
+            buffer_pool_unlock(pool);
             return -1;
-
-        for (i=0; i<3 && picture.data[i+1]; i++)
-            size[i] = picture.data[i+1] - picture.data[i];
-        size[i] = tmpsize - (picture.data[i] - picture.data[0]);
-
-        buf->last_pic_num= -256*256*256*64;
-        memset(buf->base, 0, sizeof(buf->base));
-        memset(buf->data, 0, sizeof(buf->data));
-
-        for(i=0; i<4 && size[i]; i++){
-            const int h_shift= i==0 ? 0 : h_chroma_shift;
-            const int v_shift= i==0 ? 0 : v_chroma_shift;
-
-            buf->linesize[i]= picture.linesize[i];
-
-            buf->base[i]= av_malloc(size[i]+16); //FIXME 16
-            if(buf->base[i]==NULL) return -1;
-            memset(buf->base[i], 128, size[i]);
-
-            // no edge if EDGE EMU or not planar YUV
-            if((s->flags&CODEC_FLAG_EMU_EDGE) || !size[2])
-                buf->data[i] = buf->base[i];
-            else
-                buf->data[i] = buf->base[i] + FFALIGN((buf->linesize[i]*EDGE_WIDTH>>v_shift) + (EDGE_WIDTH>>h_shift), stride_align[i]);
         }
-        if(size[1] && !size[2])
-            ff_set_systematic_pal((uint32_t*)buf->data[1], s->pix_fmt);
-        buf->width  = s->width;
-        buf->height = s->height;
-        buf->pix_fmt= s->pix_fmt;
         pic->age= 256*256*256*64;
     }
+    buf->refcount = 1;
+    buf->codec_ref= 1;
+    pool->nb_used++;
+    buffer_pool_unlock(pool);
+
     pic->type= FF_BUFFER_TYPE_INTERNAL;
+    pic->internal_buffer= buf;
 
     for(i=0; i<4; i++){
         pic->base[i]= buf->base[i];
@@ -346,34 +466,52 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
 }
 
 void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
+    InternalBuffer *buf= pic->internal_buffer;
     int i;
-    InternalBuffer *buf, *last;
 
     assert(pic->type==FF_BUFFER_TYPE_INTERNAL);
     assert(s->internal_buffer_count);
+    assert(buf && buf->data[0] == pic->data[0] && buf->codec_ref);
 
-    buf = NULL; /* avoids warning */
-    for(i=0; i<s->internal_buffer_count; i++){ //just 3-5 checks so is not worth to optimize
-        buf= &((InternalBuffer*)s->internal_buffer)[i];
-        if(buf->data[0] == pic->data[0])
-            break;
-    }
-    assert(i < s->internal_buffer_count);
     s->internal_buffer_count--;
-    last = &((InternalBuffer*)s->internal_buffer)[s->internal_buffer_count];
-
-    FFSWAP(InternalBuffer, *buf, *last);
+    buf->codec_ref= 0;
+    buffer_unref(buf);
 
     for(i=0; i<4; i++){
         pic->data[i]=NULL;
 //        pic->base[i]=NULL;
     }
+    pic->internal_buffer= NULL;
 //printf("R%X\n", pic->opaque);
 
     if(s->debug&FF_DEBUG_BUFFERS)
         av_log(s, AV_LOG_DEBUG, "default_release_buffer called on pic %p, %d buffers used\n", pic, s->internal_buffer_count);
 }
 
+int avcodec_default_ref_buffer(AVFrame *pic){
+    InternalBuffer *buf= pic->internal_buffer;
+
+    if(pic->type != FF_BUFFER_TYPE_INTERNAL || !buf || buf->data[0] != pic->data[0])
+        return -1;
+
+    buffer_pool_lock(buf->pool);
+    buf->refcount++;
+    buffer_pool_unlock(buf->pool);
+    return 0;
+}
+
+void avcodec_default_unref_buffer(AVFrame *pic){
+    int i;
+
+    if(!pic->internal_buffer)
+        return;
+    buffer_unref(pic->internal_buffer);
+
+    for(i=0; i<4; i++)
+        pic->data[i]= NULL;
+    pic->internal_buffer= NULL;
+}
+
 int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic){
     AVFrame temp_pic;
     int i;
@@ -982,20 +1120,40 @@ void avcodec_flush_buffers(AVCodecContext *avctx)
 }
 
 void avcodec_default_free_buffers(AVCodecContext *s){
-    int i, j;
+    BufferPool *pool= s->internal_buffer;
+    InternalBuffer *buf;
+    int i, free_pool;
 
-    if(s->internal_buffer==NULL) return;
+    if(pool==NULL) return;
 
     if (s->internal_buffer_count)
         av_log(s, AV_LOG_WARNING, "Found %i unreleased buffers!\n", s->internal_buffer_count);
-    for(i=0; i<INTERNAL_BUFFER_SIZE; i++){
-        InternalBuffer *buf= &((InternalBuffer*)s->internal_buffer)[i];
-        for(j=0; j<4; j++){
-            av_freep(&buf->base[j]);
-            buf->data[j]= NULL;
+
+    buffer_pool_lock(pool);
+    /* drop the references the codec forgot to release */
+    for(i=0; i<pool->nb_buffers; i++){
+        buf= pool->buffers[i];
+        if(buf->codec_ref){
+            buf->codec_ref= 0;
+            if(!--buf->refcount){
+                buf->next= pool->unused;
+                pool->unused= buf;
+                pool->nb_used--;
+            }
         }
     }
-    av_freep(&s->internal_buffer);
+    while((buf= pool->unused)){
+        pool->unused= buf->next;
+        buffer_free(buf);
+    }
+    /* buffers still referenced by users keep the pool alive */
+    pool->detached= 1;
+    free_pool= !pool->nb_used;
+    buffer_pool_unlock(pool);
+
+    if(free_pool)
+        buffer_pool_free(pool);
+    s->internal_buffer= NULL;
 
     s->internal_buffer_count=0;
 }
@@ -1187,3 +1345,90 @@ unsigned int ff_toupper4(unsigned int x)
             + (toupper((x>>16)&0xFF)<<16)
             + (toupper((x>>24)&0xFF)<<24);
 }
+
+#ifdef TEST
+
+#include <stdio.h>
+
+#undef printf
+
+static void fill_picture(AVCodecContext *avctx, AVFrame *pic, int v)
+{
+    int y;
+    for (y = 0; y < avctx->height; y++)
+        memset(pic->data[0] + y * pic->linesize[0], v, avctx->width);
+}
+
+static const char *check_picture(AVCodecContext *avctx, AVFrame *pic, int v)
+{
+    int x, y;
+    for (y = 0; y < avctx->height; y++)
+        for (x = 0; x < avctx->width; x++)
+            if (pic->data[0][y * pic->linesize[0] + x] != v)
+                return "overwritten";
+    return "intact";
+}
+
+int main(void)
+{
+    AVCodecContext *avctx = avcodec_alloc_context();
+    AVFrame a, b, c, kept, user;
+    uint8_t *kept_data;
+
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&c, 0, sizeof(c));
+    memset(&user, 0, sizeof(user));
+    avctx->codec_type = AVMEDIA_TYPE_VIDEO;
+    avctx->width      = 64;
+    avctx->height     = 48;
+    avctx->pix_fmt    = PIX_FMT_YUV420P;
+
+    /* a picture kept by a user is not handed out again when the codec
+     * releases it */
+    avcodec_default_get_buffer(avctx, &a);
+    fill_picture(avctx, &a, 1);
+    kept = a;
+    printf("ref: %d\n", avcodec_default_ref_buffer(&kept));
+    printf("second ref: %d\n", avcodec_default_ref_buffer(&kept));
+    avcodec_default_release_buffer(avctx, &a);
+    avcodec_default_get_buffer(avctx, &b);
+    fill_picture(avctx, &b, 2);
+    printf("referenced buffer reused: %s\n", b.data[0] == kept.data[0] ? "yes" : "no");
+    printf("referenced picture: %s\n", check_picture(avctx, &kept, 1));
+
+    /* it is once the last reference has been dropped, before older ones */
+    kept_data = kept.data[0];
+    avcodec_default_release_buffer(avctx, &b);
+    c = kept;
+    avcodec_default_unref_buffer(&c);
+    avcodec_default_get_buffer(avctx, &c);
+    printf("buffer reused after one unref: %s\n", c.data[0] == kept_data ? "yes" : "no");
+    avcodec_default_release_buffer(avctx, &c);
+    avcodec_default_unref_buffer(&kept);
+    printf("unref clears the picture: %s\n", kept.data[0] ? "no" : "yes");
+    avcodec_default_get_buffer(avctx, &c);
+    printf("buffer reused after the last unref: %s\n", c.data[0] == kept_data ? "yes" : "no");
+    avcodec_default_release_buffer(avctx, &c);
+
+    /* a reference outlives the buffers of the codec context */
+    avcodec_default_get_buffer(avctx, &a);
+    fill_picture(avctx, &a, 3);
+    kept = a;
+    avcodec_default_ref_buffer(&kept);
+    avcodec_default_release_buffer(avctx, &a);
+    avcodec_default_free_buffers(avctx);
+    printf("picture after freeing the buffers: %s\n", check_picture(avctx, &kept, 3));
+    fill_picture(avctx, &kept, 4);
+    avcodec_default_unref_buffer(&kept);
+
+    /* only pictures from avcodec_default_get_buffer() can be referenced */
+    user.type    = FF_BUFFER_TYPE_USER;
+    user.data[0] = kept_data;
+    printf("ref of a user buffer: %s\n", avcodec_default_ref_buffer(&user) < 0 ? "refused" : "accepted");
+
+    av_free(avctx);
+    return 0;
+}
+
+#endif /* TEST */
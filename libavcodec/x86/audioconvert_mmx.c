@@ -0,0 +1,517 @@
+/*
+ * SSE2 optimized audio sample format conversion and remixing
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * SSE2 audio sample format conversion and remixing.
+ * The output matches the C code in audioconvert.c except for out of range
+ * input to the float to integer conversions (NaN, or beyond 2^16 for s16
+ * and 2^32 for s32), which saturates here but wraps in C. The loops handle
+ * multiples of 8 samples and leave the rest to the same C expressions.
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavutil/libm.h"
+#include "libavcodec/audioconvert.h"
+
+#if HAVE_SSE
+
+DECLARE_ALIGNED(16, static const float, s16_scale)[4] = { 1.0/(1<<15), 1.0/(1<<15), 1.0/(1<<15), 1.0/(1<<15) };
+DECLARE_ALIGNED(16, static const float, s32_scale)[4] = { 1.0/(1U<<31), 1.0/(1U<<31), 1.0/(1U<<31), 1.0/(1U<<31) };
+DECLARE_ALIGNED(16, static const float, s16_mul  )[4] = { 1<<15, 1<<15, 1<<15, 1<<15 };
+DECLARE_ALIGNED(16, static const float, s16_max  )[4] = { 32767, 32767, 32767, 32767 };
+DECLARE_ALIGNED(16, static const float, s32_mul  )[4] = { 1U<<31, 1U<<31, 1U<<31, 1U<<31 };
+
+static void conv_s16_to_flt_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t*)src;
+    float *po = (float*)dst;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    if (n)
+    __asm__ volatile(
+        "movaps        %3, %%xmm7           \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%2,%0), %%xmm0            \n\t"
+        "movdqa   %%xmm0, %%xmm1            \n\t"
+        "punpcklwd %%xmm0, %%xmm0           \n\t"
+        "punpckhwd %%xmm1, %%xmm1           \n\t"
+        "psrad       $16, %%xmm0            \n\t"
+        "psrad       $16, %%xmm1            \n\t"
+        "cvtdq2ps %%xmm0, %%xmm0            \n\t"
+        "cvtdq2ps %%xmm1, %%xmm1            \n\t"
+        "mulps    %%xmm7, %%xmm0            \n\t"
+        "mulps    %%xmm7, %%xmm1            \n\t"
+        "movups   %%xmm0,   (%1,%0,2)       \n\t"
+        "movups   %%xmm1, 16(%1,%0,2)       \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n), "m"(*s16_scale)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm7")
+    );
+    for (; n < len; n++)
+        po[n] = pi[n]*(1.0 / (1<<15));
+}
+
+static void conv_flt_to_s16_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const float *pi = (const float*)src;
+    int16_t *po = (int16_t*)dst;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    /* the clamp only matters for input at or beyond 2^16, packssdw
+     * saturates everything below */
+    if (n)
+    __asm__ volatile(
+        "movaps        %3, %%xmm6           \n\t"
+        "movaps        %4, %%xmm7           \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movups    (%2,%0,2), %%xmm0        \n\t"
+        "movups  16(%2,%0,2), %%xmm1        \n\t"
+        "mulps    %%xmm6, %%xmm0            \n\t"
+        "mulps    %%xmm6, %%xmm1            \n\t"
+        "movaps   %%xmm7, %%xmm2            \n\t"
+        "movaps   %%xmm7, %%xmm3            \n\t"
+        "minps    %%xmm0, %%xmm2            \n\t"
+        "minps    %%xmm1, %%xmm3            \n\t"
+        "cvtps2dq %%xmm2, %%xmm2            \n\t"
+        "cvtps2dq %%xmm3, %%xmm3            \n\t"
+        "packssdw %%xmm3, %%xmm2            \n\t"
+        "movdqu   %%xmm2, (%1,%0)           \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n), "m"(*s16_mul), "m"(*s16_max)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm6", "%xmm7")
+    );
+    for (; n < len; n++)
+        po[n] = av_clip_int16(lrintf(pi[n] * (1<<15)));
+}
+
+static void conv_s16_to_s32_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t*)src;
+    int32_t *po = (int32_t*)dst;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%2,%0), %%xmm0            \n\t"
+        "pxor     %%xmm1, %%xmm1            \n\t"
+        "pxor     %%xmm2, %%xmm2            \n\t"
+        "punpcklwd %%xmm0, %%xmm1           \n\t"
+        "punpckhwd %%xmm0, %%xmm2           \n\t"
+        "movdqu   %%xmm1,   (%1,%0,2)       \n\t"
+        "movdqu   %%xmm2, 16(%1,%0,2)       \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2")
+    );
+    for (; n < len; n++)
+        po[n] = pi[n] << 16;
+}
+
+static void conv_s32_to_s16_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int32_t *pi = (const int32_t*)src;
+    int16_t *po = (int16_t*)dst;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu    (%2,%0,2), %%xmm0        \n\t"
+        "movdqu  16(%2,%0,2), %%xmm1        \n\t"
+        "psrad       $16, %%xmm0            \n\t"
+        "psrad       $16, %%xmm1            \n\t"
+        "packssdw %%xmm1, %%xmm0            \n\t"
+        "movdqu   %%xmm0, (%1,%0)           \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1")
+    );
+    for (; n < len; n++)
+        po[n] = pi[n] >> 16;
+}
+
+static void conv_s32_to_flt_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int32_t *pi = (const int32_t*)src;
+    float *po = (float*)dst;
+    int n = len & ~7;
+    x86_reg i = -4*n;
+
+    if (n)
+    __asm__ volatile(
+        "movaps        %3, %%xmm7           \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu    (%2,%0), %%xmm0          \n\t"
+        "movdqu  16(%2,%0), %%xmm1          \n\t"
+        "cvtdq2ps %%xmm0, %%xmm0            \n\t"
+        "cvtdq2ps %%xmm1, %%xmm1            \n\t"
+        "mulps    %%xmm7, %%xmm0            \n\t"
+        "mulps    %%xmm7, %%xmm1            \n\t"
+        "movups   %%xmm0,   (%1,%0)         \n\t"
+        "movups   %%xmm1, 16(%1,%0)         \n\t"
+        "add         $32, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n), "m"(*s32_scale)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm7")
+    );
+    for (; n < len; n++)
+        po[n] = pi[n]*(1.0 / (1U<<31));
+}
+
+static void conv_flt_to_s32_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const float *pi = (const float*)src;
+    int32_t *po = (int32_t*)dst;
+    int n = len & ~7;
+    x86_reg i = -4*n;
+
+    /* cvtps2dq gives INT_MIN for everything >= 2^31, flip those to
+     * INT_MAX; the compare is false for NaN, which stays INT_MIN like in C */
+    if (n)
+    __asm__ volatile(
+        "movaps        %3, %%xmm7           \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movups    (%2,%0), %%xmm0          \n\t"
+        "movups  16(%2,%0), %%xmm1          \n\t"
+        "mulps    %%xmm7, %%xmm0            \n\t"
+        "mulps    %%xmm7, %%xmm1            \n\t"
+        "movaps   %%xmm7, %%xmm2            \n\t"
+        "movaps   %%xmm7, %%xmm3            \n\t"
+        "cmpleps  %%xmm0, %%xmm2            \n\t"
+        "cmpleps  %%xmm1, %%xmm3            \n\t"
+        "cvtps2dq %%xmm0, %%xmm0            \n\t"
+        "cvtps2dq %%xmm1, %%xmm1            \n\t"
+        "pxor     %%xmm2, %%xmm0            \n\t"
+        "pxor     %%xmm3, %%xmm1            \n\t"
+        "movdqu   %%xmm0,   (%1,%0)         \n\t"
+        "movdqu   %%xmm1, 16(%1,%0)         \n\t"
+        "add         $32, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+n), "r"(pi+n), "m"(*s32_mul)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7")
+    );
+    for (; n < len; n++)
+        po[n] = av_clipl_int32(llrintf(pi[n] * (1U<<31)));
+}
+
+static void interleave2_s16_sse2(uint8_t *dst, const uint8_t *src0,
+                                 const uint8_t *src1, int len)
+{
+    const int16_t *p0 = (const int16_t*)src0, *p1 = (const int16_t*)src1;
+    int16_t *po = (int16_t*)dst;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%2,%0), %%xmm0            \n\t"
+        "movdqu  (%3,%0), %%xmm1            \n\t"
+        "movdqa   %%xmm0, %%xmm2            \n\t"
+        "punpcklwd %%xmm1, %%xmm0           \n\t"
+        "punpckhwd %%xmm1, %%xmm2           \n\t"
+        "movdqu   %%xmm0,   (%1,%0,2)       \n\t"
+        "movdqu   %%xmm2, 16(%1,%0,2)       \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+2*n), "r"(p0+n), "r"(p1+n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2")
+    );
+    for (; n < len; n++) {
+        po[2*n  ] = p0[n];
+        po[2*n+1] = p1[n];
+    }
+}
+
+static void deinterleave2_s16_sse2(uint8_t *dst0, uint8_t *dst1,
+                                   const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t*)src;
+    int16_t *p0 = (int16_t*)dst0, *p1 = (int16_t*)dst1;
+    int n = len & ~7;
+    x86_reg i = -2*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu    (%3,%0,2), %%xmm0        \n\t"
+        "movdqu  16(%3,%0,2), %%xmm1        \n\t"
+        "movdqa   %%xmm0, %%xmm2            \n\t"
+        "movdqa   %%xmm1, %%xmm3            \n\t"
+        "pslld       $16, %%xmm0            \n\t"
+        "pslld       $16, %%xmm1            \n\t"
+        "psrad       $16, %%xmm0            \n\t"
+        "psrad       $16, %%xmm1            \n\t"
+        "psrad       $16, %%xmm2            \n\t"
+        "psrad       $16, %%xmm3            \n\t"
+        "packssdw %%xmm1, %%xmm0            \n\t"
+        "packssdw %%xmm3, %%xmm2            \n\t"
+        "movdqu   %%xmm0, (%1,%0)           \n\t"
+        "movdqu   %%xmm2, (%2,%0)           \n\t"
+        "add         $16, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(p0+n), "r"(p1+n), "r"(pi+2*n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3")
+    );
+    for (; n < len; n++) {
+        p0[n] = pi[2*n  ];
+        p1[n] = pi[2*n+1];
+    }
+}
+
+static void interleave2_flt_sse2(uint8_t *dst, const uint8_t *src0,
+                                 const uint8_t *src1, int len)
+{
+    const float *p0 = (const float*)src0, *p1 = (const float*)src1;
+    float *po = (float*)dst;
+    int n = len & ~7;
+    x86_reg i = -4*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movups    (%2,%0), %%xmm0          \n\t"
+        "movups  16(%2,%0), %%xmm3          \n\t"
+        "movups    (%3,%0), %%xmm1          \n\t"
+        "movups  16(%3,%0), %%xmm4          \n\t"
+        "movaps   %%xmm0, %%xmm2            \n\t"
+        "movaps   %%xmm3, %%xmm5            \n\t"
+        "unpcklps %%xmm1, %%xmm0            \n\t"
+        "unpckhps %%xmm1, %%xmm2            \n\t"
+        "unpcklps %%xmm4, %%xmm3            \n\t"
+        "unpckhps %%xmm4, %%xmm5            \n\t"
+        "movups   %%xmm0,   (%1,%0,2)       \n\t"
+        "movups   %%xmm2, 16(%1,%0,2)       \n\t"
+        "movups   %%xmm3, 32(%1,%0,2)       \n\t"
+        "movups   %%xmm5, 48(%1,%0,2)       \n\t"
+        "add         $32, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(po+2*n), "r"(p0+n), "r"(p1+n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5")
+    );
+    for (; n < len; n++) {
+        po[2*n  ] = p0[n];
+        po[2*n+1] = p1[n];
+    }
+}
+
+static void deinterleave2_flt_sse2(uint8_t *dst0, uint8_t *dst1,
+                                   const uint8_t *src, int len)
+{
+    const float *pi = (const float*)src;
+    float *p0 = (float*)dst0, *p1 = (float*)dst1;
+    int n = len & ~7;
+    x86_reg i = -4*n;
+
+    if (n)
+    __asm__ volatile(
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movups    (%3,%0,2), %%xmm0        \n\t"
+        "movups  16(%3,%0,2), %%xmm1        \n\t"
+        "movups  32(%3,%0,2), %%xmm3        \n\t"
+        "movups  48(%3,%0,2), %%xmm4        \n\t"
+        "movaps   %%xmm0, %%xmm2            \n\t"
+        "movaps   %%xmm3, %%xmm5            \n\t"
+        "shufps $0x88, %%xmm1, %%xmm0       \n\t"
+        "shufps $0xDD, %%xmm1, %%xmm2       \n\t"
+        "shufps $0x88, %%xmm4, %%xmm3       \n\t"
+        "shufps $0xDD, %%xmm4, %%xmm5       \n\t"
+        "movups   %%xmm0,   (%1,%0)         \n\t"
+        "movups   %%xmm3, 16(%1,%0)         \n\t"
+        "movups   %%xmm2,   (%2,%0)         \n\t"
+        "movups   %%xmm5, 16(%2,%0)         \n\t"
+        "add         $32, %0                \n\t"
+        " js 1b                             \n\t"
+        :"+r"(i)
+        :"r"(p0+n), "r"(p1+n), "r"(pi+2*n)
+        :"memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5")
+    );
+    for (; n < len; n++) {
+        p0[n] = pi[2*n  ];
+        p1[n] = pi[2*n+1];
+    }
+}
+
+/* dst = acc + c0*src0 [+ c1*src1], 8 samples per iteration; acc is 0 on
+ * the first pass of a matrix row and dst otherwise, the products are added
+ * one after the other to keep the summation order of mix_c() */
+#define MIX_LOAD_ACC_FIRST                                              \
+        "xorps    %%xmm0, %%xmm0            \n\t"                       \
+        "xorps    %%xmm1, %%xmm1            \n\t"
+#define MIX_LOAD_ACC_NEXT                                               \
+        "movaps    (%1,%0), %%xmm0          \n\t"                       \
+        "movaps  16(%1,%0), %%xmm1          \n\t"
+#define MIX_ADD(reg, coeff)                                             \
+        "movups    (" reg ",%0), %%xmm2     \n\t"                       \
+        "movups  16(" reg ",%0), %%xmm3     \n\t"                       \
+        "mulps  " coeff ", %%xmm2           \n\t"                       \
+        "mulps  " coeff ", %%xmm3           \n\t"                       \
+        "addps    %%xmm2, %%xmm0            \n\t"                       \
+        "addps    %%xmm3, %%xmm1            \n\t"
+
+#define MIX_PASS(name, load_acc, second)                                \
+static void name(float *dst, const float *src0, const float *src1,      \
+                 float c0, float c1, int n)                             \
+{                                                                       \
+    x86_reg i = -4*n;                                                   \
+    __asm__ volatile(                                                   \
+        "movss  %4, %%xmm6                  \n\t"                       \
+        "movss  %5, %%xmm7                  \n\t"                       \
+        "shufps $0, %%xmm6, %%xmm6          \n\t"                       \
+        "shufps $0, %%xmm7, %%xmm7          \n\t"                       \
+        ASMALIGN(4)                                                     \
+        "1:                                 \n\t"                       \
+        load_acc                                                        \
+        MIX_ADD("%2", "%%xmm6")                                         \
+        second                                                          \
+        "movaps   %%xmm0,   (%1,%0)         \n\t"                       \
+        "movaps   %%xmm1, 16(%1,%0)         \n\t"                       \
+        "add         $32, %0                \n\t"                       \
+        " js 1b                             \n\t"                       \
+        :"+r"(i)                                                        \
+        :"r"(dst+n), "r"(src0+n), "r"(src1+n), "m"(c0), "m"(c1)         \
+        :"memory"                                                       \
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3",            \
+                         "%xmm6", "%xmm7")                              \
+    );                                                                  \
+}
+
+MIX_PASS(mix_first1, MIX_LOAD_ACC_FIRST, )
+MIX_PASS(mix_first2, MIX_LOAD_ACC_FIRST, MIX_ADD("%3", "%%xmm7"))
+MIX_PASS(mix_next1,  MIX_LOAD_ACC_NEXT,  )
+MIX_PASS(mix_next2,  MIX_LOAD_ACC_NEXT,  MIX_ADD("%3", "%%xmm7"))
+
+/**
+ * Remix planar float samples, the mix buffers and direct output pointers
+ * are only guaranteed to be float aligned, but dst is loaded with movaps
+ * so unaligned outputs fall back to C.
+ * For 5.1->stereo this is 2 passes per output channel over the 3 nonzero
+ * coefficients of each row (front, center, surround).
+ */
+static void mix_sse(AVAudioConvert *ctx, float * const *out,
+                    const float * const *in, int len)
+{
+    int o, k, i;
+    int n = len & ~7;
+
+    for (o = 0; o < ctx->out_channels; o++) {
+        const int   *idx   = ctx->coeff_idx[o];
+        const float *coeff = ctx->coeff[o];
+        const int    nb    = ctx->nb_coeffs[o];
+        float *dst = out[o];
+
+        if (!dst)
+            continue;
+        i = 0;
+        if (n && !((intptr_t)dst & 15)) {
+            if (!nb)
+                memset(dst, 0, n*sizeof(*dst));
+            for (k = 0; k < nb; k += 2) {
+                const float *src1 = k+1 < nb ? in[idx[k+1]] : in[idx[k]];
+                float c1 = k+1 < nb ? coeff[k+1] : 0;
+                if (k+1 < nb)
+                    (k ? mix_next2 : mix_first2)(dst, in[idx[k]], src1, coeff[k], c1, n);
+                else
+                    (k ? mix_next1 : mix_first1)(dst, in[idx[k]], src1, coeff[k], c1, n);
+            }
+            i = n;
+        }
+        for (; i < len; i++) {
+            float sum = 0;
+            for (k = 0; k < nb; k++)
+                sum += coeff[k] * in[idx[k]][i];
+            dst[i] = sum;
+        }
+    }
+}
+
+#endif /* HAVE_SSE */
+
+void ff_audio_convert_init_mmx(AVAudioConvert *ctx, int flags)
+{
+#if HAVE_SSE
+    if (!(flags & AV_CPU_FLAG_SSE2))
+        return;
+
+    if (ctx->remix) {
+        ctx->mix = mix_sse;
+        return;
+    }
+
+#define PAIR(out, in) (SAMPLE_FMT_ ## out + SAMPLE_FMT_NB*SAMPLE_FMT_ ## in)
+    switch (ctx->fmt_pair) {
+    case PAIR(FLT, S16): ctx->conv_contig = conv_s16_to_flt_sse2; break;
+    case PAIR(S16, FLT): ctx->conv_contig = conv_flt_to_s16_sse2; break;
+    case PAIR(S32, S16): ctx->conv_contig = conv_s16_to_s32_sse2; break;
+    case PAIR(S16, S32): ctx->conv_contig = conv_s32_to_s16_sse2; break;
+    case PAIR(FLT, S32): ctx->conv_contig = conv_s32_to_flt_sse2; break;
+    case PAIR(S32, FLT): ctx->conv_contig = conv_flt_to_s32_sse2; break;
+    case PAIR(S16, S16):
+        ctx->interleave2   = interleave2_s16_sse2;
+        ctx->deinterleave2 = deinterleave2_s16_sse2;
+        break;
+    case PAIR(S32, S32):
+    case PAIR(FLT, FLT):
+        ctx->interleave2   = interleave2_flt_sse2;
+        ctx->deinterleave2 = deinterleave2_flt_sse2;
+        break;
+    }
+#endif
+}
@@ -2034,6 +2034,73 @@ static void vorbis_inverse_coupling_sse(float *mag, float *ang, int blocksize)
         :"memory"\
     );
 
+static void aac_abs_pow34_sse(float *out, const float *in, int size)
+{
+    x86_reg i = -4*size;
+    __asm__ volatile(
+        "movaps  %3,     %%xmm7         \n\t"
+        "1:                             \n\t"
+        "movups  (%2,%0), %%xmm0        \n\t"
+        "movaps  %%xmm7, %%xmm1         \n\t"
+        "andnps  %%xmm0, %%xmm1         \n\t" // a = fabsf(in)
+        "sqrtps  %%xmm1, %%xmm0         \n\t"
+        "mulps   %%xmm1, %%xmm0         \n\t"
+        "sqrtps  %%xmm0, %%xmm0         \n\t" // sqrtf(a * sqrtf(a))
+        "movups  %%xmm0, (%1,%0)        \n\t"
+        "add     $16,    %0             \n\t"
+        "jl 1b                          \n\t"
+        :"+r"(i)
+        :"r"(out+size), "r"(in+size), "m"(ff_pdw_80000000[0])
+        :"memory"
+    );
+}
+
+static void aac_quantize_bands_sse2(int *out, const float *in, const float *scaled,
+                                    int size, float Q34, int is_signed, int maxval)
+{
+    static const double bias = 0.4054;
+    double dmaxval = maxval;
+    int sign_mask = -is_signed;
+    x86_reg i = -4*size;
+
+    __asm__ volatile(
+        "movss     %4,     %%xmm7       \n\t"
+        "shufps    $0, %%xmm7, %%xmm7   \n\t"
+        "movsd     %5,     %%xmm6       \n\t"
+        "unpcklpd  %%xmm6, %%xmm6       \n\t"
+        "movsd     %6,     %%xmm5       \n\t"
+        "unpcklpd  %%xmm5, %%xmm5       \n\t"
+        "movd      %7,     %%xmm4       \n\t"
+        "pshufd    $0, %%xmm4, %%xmm4   \n\t"
+        "1:                             \n\t"
+        "movups    (%3,%0), %%xmm0      \n\t"
+        "mulps     %%xmm7, %%xmm0       \n\t" // scaled * Q34, in float
+        "cvtps2pd  %%xmm0, %%xmm1       \n\t"
+        "movhlps   %%xmm0, %%xmm0       \n\t"
+        "cvtps2pd  %%xmm0, %%xmm0       \n\t"
+        "addpd     %%xmm6, %%xmm1       \n\t"
+        "addpd     %%xmm6, %%xmm0       \n\t"
+        "minpd     %%xmm5, %%xmm1       \n\t"
+        "minpd     %%xmm5, %%xmm0       \n\t"
+        "cvttpd2dq %%xmm1, %%xmm1       \n\t"
+        "cvttpd2dq %%xmm0, %%xmm0       \n\t"
+        "punpcklqdq %%xmm0, %%xmm1      \n\t"
+        "movups    (%2,%0), %%xmm2      \n\t"
+        "xorps     %%xmm0, %%xmm0       \n\t"
+        "cmpltps   %%xmm0, %%xmm2       \n\t" // in < 0.0
+        "andps     %%xmm4, %%xmm2       \n\t"
+        "pxor      %%xmm2, %%xmm1       \n\t"
+        "psubd     %%xmm2, %%xmm1       \n\t"
+        "movdqu    %%xmm1, (%1,%0)      \n\t"
+        "add       $16,    %0           \n\t"
+        "jl 1b                          \n\t"
+        :"+r"(i)
+        :"r"(out+size), "r"(in+size), "r"(scaled+size),
+         "m"(Q34), "m"(bias), "m"(dmaxval), "m"(sign_mask)
+        :"memory"
+    );
+}
+
 static void ac3_downmix_sse(float (*samples)[256], float (*matrix)[2], int out_ch, int in_ch, int len)
 {
     int (*matrix_cmp)[2] = (int(*)[2])matrix;
@@ -2890,6 +2957,7 @@ void dsputil_init_mmx(DSPContext* c, AVCodecContext *avctx)
         if(mm_flags & AV_CPU_FLAG_SSE){
             c->vorbis_inverse_coupling = vorbis_inverse_coupling_sse;
             c->ac3_downmix = ac3_downmix_sse;
+            c->aac_abs_pow34 = aac_abs_pow34_sse;
             c->vector_fmul = vector_fmul_sse;
             c->vector_fmul_reverse = vector_fmul_reverse_sse;
             c->vector_fmul_add = vector_fmul_add_sse;
@@ -2905,6 +2973,7 @@ void dsputil_init_mmx(DSPContext* c, AVCodecContext *avctx)
         if(mm_flags & AV_CPU_FLAG_3DNOW)
             c->vector_fmul_add = vector_fmul_add_3dnow; // faster than sse
         if(mm_flags & AV_CPU_FLAG_SSE2){
+            c->aac_quantize_bands = aac_quantize_bands_sse2;
             c->int32_to_float_fmul_scalar = int32_to_float_fmul_scalar_sse2;
             c->float_to_int16 = float_to_int16_sse2;
             c->float_to_int16_interleave = float_to_int16_interleave_sse2;
@@ -202,6 +202,10 @@ void ff_avg_vc1_mspel_mc00_mmx2(uint8_t *dst, const uint8_t *src, int stride, in
 
 void ff_lpc_compute_autocorr_sse2(const int32_t *data, int len, int lag,
                                    double *autoc);
+void ff_lpc_compute_residual_sse2(int32_t *res, const int32_t *smp, int n,
+                                  int order, const int32_t *coefs, int shift);
+void ff_lpc_rice_partition_sums_sse2(uint32_t *sums, const int32_t *res, int n,
+                                     int porder, int pred_order);
 
 void ff_mmx_idct(DCTELEM *block);
 void ff_mmxext_idct(DCTELEM *block);
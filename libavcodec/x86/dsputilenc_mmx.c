@@ -1417,6 +1417,10 @@ void dsputilenc_init_mmx(DSPContext* c, AVCodecContext *avctx)
         if (CONFIG_LPC && mm_flags & (AV_CPU_FLAG_SSE2|AV_CPU_FLAG_SSE2SLOW)) {
             c->lpc_compute_autocorr = ff_lpc_compute_autocorr_sse2;
         }
+        if (CONFIG_LPC && mm_flags & AV_CPU_FLAG_SSE2) {
+            c->lpc_compute_residual    = ff_lpc_compute_residual_sse2;
+            c->lpc_rice_partition_sums = ff_lpc_rice_partition_sums_sse2;
+        }
 
 #if HAVE_SSSE3
         if(mm_flags & AV_CPU_FLAG_SSSE3){
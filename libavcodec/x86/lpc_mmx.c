@@ -21,6 +21,7 @@
 
 #include "libavutil/x86_cpu.h"
 #include "dsputil_mmx.h"
+#include "libavcodec/lpc.h"
 
 static void apply_welch_window_sse2(const int32_t *data, int len, double *w_data)
 {
@@ -138,3 +139,100 @@ void ff_lpc_compute_autocorr_sse2(const int32_t *data, int len, int lag,
         }
     }
 }
+
+/* There is no packed 32x32->32 multiply before SSE4, so the even and odd
+ * output samples are accumulated separately with pmuludq, whose low dwords
+ * wrap exactly like the C code. */
+void ff_lpc_compute_residual_sse2(int32_t *res, const int32_t *smp, int n,
+                                  int order, const int32_t *coefs, int shift)
+{
+    DECLARE_ALIGNED(16, int32_t, coefs4)[MAX_LPC_ORDER][4];
+    int i, j;
+
+    if (order > MAX_LPC_ORDER || n - order < 4) {
+        ff_lpc_compute_residual(res, smp, n, order, coefs, shift);
+        return;
+    }
+
+    for (j = 0; j < order; j++)
+        coefs4[j][0] = coefs4[j][1] = coefs4[j][2] = coefs4[j][3] = coefs[j];
+    for (i = 0; i < order; i++)
+        res[i] = smp[i];
+
+    __asm__ volatile("movd %0, %%xmm7 \n\t" :: "r"(shift));
+    for (i = order; i <= n - 4; i += 4) {
+        x86_reg k = -order * 16;
+        const int32_t *p = smp + i - 1;
+        __asm__ volatile(
+            "pxor      %%xmm0, %%xmm0           \n\t"
+            "pxor      %%xmm1, %%xmm1           \n\t"
+            ASMALIGN(4)
+            "1:                                 \n\t"
+            "movdqu     (%1),  %%xmm2           \n\t"
+            "movdqu    4(%1),  %%xmm3           \n\t"
+            "pmuludq  (%2,%0), %%xmm2           \n\t"
+            "pmuludq  (%2,%0), %%xmm3           \n\t"
+            "paddd     %%xmm2, %%xmm0           \n\t"
+            "paddd     %%xmm3, %%xmm1           \n\t"
+            "sub          $4,  %1               \n\t"
+            "add         $16,  %0               \n\t"
+            "jl 1b                              \n\t"
+            "pshufd    $0x08,  %%xmm0, %%xmm0   \n\t"
+            "pshufd    $0x08,  %%xmm1, %%xmm1   \n\t"
+            "punpckldq %%xmm1, %%xmm0           \n\t"
+            "psrad     %%xmm7, %%xmm0           \n\t"
+            "movdqu     (%3),  %%xmm2           \n\t"
+            "psubd     %%xmm0, %%xmm2           \n\t"
+            "movdqu    %%xmm2, (%4)             \n\t"
+            :"+&r"(k), "+&r"(p)
+            :"r"(coefs4 + order), "r"(smp + i), "r"(res + i)
+            :"memory"
+        );
+    }
+    for (; i < n; i++) {
+        int p = 0;
+        for (j = 0; j < order; j++)
+            p += coefs[j] * smp[i-j-1];
+        res[i] = smp[i] - (p >> shift);
+    }
+}
+
+void ff_lpc_rice_partition_sums_sse2(uint32_t *sums, const int32_t *res, int n,
+                                     int porder, int pred_order)
+{
+    int i, parts = 1 << porder;
+    const int32_t *p   = res + pred_order;
+    const int32_t *end = res + (n >> porder);
+
+    for (i = 0; i < parts; i++) {
+        uint32_t sum = 0;
+        x86_reg k = -((end - p) & ~3) * 4;
+        if (k) {
+            p -= k / 4;
+            __asm__ volatile(
+                "pxor      %%xmm0, %%xmm0           \n\t"
+                ASMALIGN(4)
+                "1:                                 \n\t"
+                "movdqu   (%2,%1), %%xmm1           \n\t"
+                "movdqa    %%xmm1, %%xmm2           \n\t"
+                "psrad        $31, %%xmm2           \n\t"
+                "paddd     %%xmm1, %%xmm1           \n\t"
+                "pxor      %%xmm2, %%xmm1           \n\t"
+                "paddd     %%xmm1, %%xmm0           \n\t"
+                "add          $16, %1               \n\t"
+                "jl 1b                              \n\t"
+                "pshufd    $0x4e,  %%xmm0, %%xmm1   \n\t"
+                "paddd     %%xmm1, %%xmm0           \n\t"
+                "pshufd    $0x01,  %%xmm0, %%xmm1   \n\t"
+                "paddd     %%xmm1, %%xmm0           \n\t"
+                "movd      %%xmm0, %0               \n\t"
+                :"=r"(sum), "+&r"(k)
+                :"r"(p)
+            );
+        }
+        for (; p < end; p++)
+            sum += (2 * *p) ^ (*p >> 31);
+        sums[i] = sum;
+        end += n >> porder;
+    }
+}
@@ -119,6 +119,55 @@ static int sad16_sse2(void *v, uint8_t *blk2, uint8_t *blk1, int stride, int h)
     return ret;
 }
 
+#if HAVE_6REGS
+static void sad16_x4_sse2(uint8_t *blk, uint8_t *ref[4], int stride, int h, int *scores)
+{
+    x86_reg off= 0;
+    __asm__ volatile(
+        "pxor %%xmm4, %%xmm4            \n\t"
+        "pxor %%xmm5, %%xmm5            \n\t"
+        "pxor %%xmm6, %%xmm6            \n\t"
+        "pxor %%xmm7, %%xmm7            \n\t"
+        ASMALIGN(4)
+        "1:                             \n\t"
+        "movdqu (%2, %0), %%xmm0        \n\t"
+        "movdqu (%3, %0), %%xmm1        \n\t"
+        "movdqu (%4, %0), %%xmm2        \n\t"
+        "movdqu (%5, %0), %%xmm3        \n\t"
+        "psadbw %%xmm0, %%xmm1          \n\t"
+        "psadbw %%xmm0, %%xmm2          \n\t"
+        "psadbw %%xmm0, %%xmm3          \n\t"
+        "paddd  %%xmm1, %%xmm4          \n\t"
+        "paddd  %%xmm2, %%xmm5          \n\t"
+        "paddd  %%xmm3, %%xmm6          \n\t"
+        "movdqu (%6, %0), %%xmm1        \n\t"
+        "psadbw %%xmm0, %%xmm1          \n\t"
+        "paddd  %%xmm1, %%xmm7          \n\t"
+        "add %7, %0                     \n\t"
+        "decl %1                        \n\t"
+        " jg 1b                         \n\t"
+        : "+r" (off), "+rm" (h)
+        : "r" (blk), "r" (ref[0]), "r" (ref[1]), "r" (ref[2]), "r" (ref[3]),
+          "g" ((x86_reg)stride)
+    );
+    __asm__ volatile(
+        "movhlps %%xmm4, %%xmm0         \n\t"
+        "movhlps %%xmm5, %%xmm1         \n\t"
+        "movhlps %%xmm6, %%xmm2         \n\t"
+        "movhlps %%xmm7, %%xmm3         \n\t"
+        "paddd   %%xmm0, %%xmm4         \n\t"
+        "paddd   %%xmm1, %%xmm5         \n\t"
+        "paddd   %%xmm2, %%xmm6         \n\t"
+        "paddd   %%xmm3, %%xmm7         \n\t"
+        "movd    %%xmm4, %0             \n\t"
+        "movd    %%xmm5, %1             \n\t"
+        "movd    %%xmm6, %2             \n\t"
+        "movd    %%xmm7, %3             \n\t"
+        : "=m"(scores[0]), "=m"(scores[1]), "=m"(scores[2]), "=m"(scores[3])
+    );
+}
+#endif
+
 static inline void sad8_x2a_mmx2(uint8_t *blk1, uint8_t *blk2, int stride, int h)
 {
     __asm__ volatile(
@@ -461,4 +510,9 @@ void dsputil_init_pix_mmx(DSPContext* c, AVCodecContext *avctx)
     if ((mm_flags & AV_CPU_FLAG_SSE2) && !(mm_flags & AV_CPU_FLAG_3DNOW) && avctx->codec_id != CODEC_ID_SNOW) {
         c->sad[0]= sad16_sse2;
     }
+#if HAVE_6REGS
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        c->sad16_x4 = sad16_x4_sse2;
+    }
+#endif
 }
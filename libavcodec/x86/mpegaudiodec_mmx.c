@@ -148,10 +148,305 @@ static void apply_window_mp3(float *in, float *win, int *unused, float *out,
     *out = sum;
 }
 
+static void antialias_sse(float *ptr, const float *csa, int n)
+{
+    x86_reg count = n;
+
+/* butterflies between ptr[-1-j] and ptr[j] for 4 consecutive j */
+#define AA(lo, hi, cs)                                    \
+    "movups  " #lo "(%0),     %%xmm0            \n\t"     \
+    "shufps         $0x1b,    %%xmm0, %%xmm0    \n\t"     \
+    "movups  " #hi "(%0),     %%xmm1            \n\t"     \
+    "movaps  " #cs "(%2),     %%xmm2            \n\t"     \
+    "movaps  32+" #cs "(%2),  %%xmm3            \n\t"     \
+    "movaps         %%xmm0,   %%xmm4            \n\t"     \
+    "mulps          %%xmm2,   %%xmm4            \n\t"     \
+    "movaps         %%xmm1,   %%xmm5            \n\t"     \
+    "mulps          %%xmm3,   %%xmm5            \n\t"     \
+    "subps          %%xmm5,   %%xmm4            \n\t"     \
+    "mulps          %%xmm3,   %%xmm0            \n\t"     \
+    "mulps          %%xmm2,   %%xmm1            \n\t"     \
+    "addps          %%xmm1,   %%xmm0            \n\t"     \
+    "shufps         $0x1b,    %%xmm4, %%xmm4    \n\t"     \
+    "movups         %%xmm4, " #lo "(%0)         \n\t"     \
+    "movups         %%xmm0, " #hi "(%0)         \n\t"
+
+    __asm__ volatile(
+        "1:                                     \n\t"
+        AA(-16,  0,  0)
+        AA(-32, 16, 16)
+        "add           $72, %0                  \n\t"
+        "dec            %1                      \n\t"
+        "jnz            1b                      \n\t"
+        :"+&r"(ptr), "+&r"(count)
+        :"r"(csa)
+        :"memory"
+    );
+#undef AA
+}
+
+/* the constant factors of imdct36(), see mpegaudiodec.c */
+DECLARE_ALIGNED(16, static const float, imdct36_consts)[18][4] = {
+#define C(x) { x, x, x, x }
+    C( 0.93969262078590838405f), /*  0:  2 * C2 */
+    C(-0.17364817766693034885f), /*  1: -2 * C8 */
+    C(-0.76604444311897803520f), /*  2: -2 * C4 */
+    C(-0.86602540378443864676f), /*  3: -2 * C3 */
+    C( 0.98480775301220805936f), /*  4:  2 * C1 */
+    C(-0.34202014332566873304f), /*  5: -2 * C7 */
+    C( 0.86602540378443864676f), /*  6:  2 * C3 */
+    C(-0.64278760968653932632f), /*  7: -2 * C5 */
+    C( 0.5f),                    /*  8 */
+    C( 0.50190991877167369479f), /*  9: 2 * icos36h[0] */
+    C( 0.51763809020504152469f),
+    C( 0.55168895948124587824f),
+    C( 0.61038729438072803416f),
+    C( 0.70710678118654752439f), /* 13: 2 * icos36h[4] */
+    C( 5.73685662283492756461f), /* 14: icos36[8] */
+    C( 1.93185165257813657349f),
+    C( 1.18310079157624925896f),
+    C( 0.87172339781054900991f), /* 17: icos36[5] */
+#undef C
+};
+
+/* transpose 4 rows of 4 floats, 72 bytes apart at %0, to 4 vectors at %1 */
+#define TRANSPOSE4(src, dst)                             \
+    "movups    " #src "(%0),       %%xmm0   \n\t"        \
+    "movups  72+" #src "(%0),      %%xmm1   \n\t"        \
+    "movups 144+" #src "(%0),      %%xmm2   \n\t"        \
+    "movups 216+" #src "(%0),      %%xmm3   \n\t"        \
+    TRANSPOSE_REGS                                       \
+    "movaps          %%xmm0,    " #dst "(%1)\n\t"        \
+    "movaps          %%xmm2, 16+" #dst "(%1)\n\t"        \
+    "movaps          %%xmm4, 32+" #dst "(%1)\n\t"        \
+    "movaps          %%xmm5, 48+" #dst "(%1)\n\t"
+
+/* the inverse, 4 vectors at %1 to 4 rows 72 bytes apart at %0 */
+#define UNTRANSPOSE4(dst, src)                           \
+    "movaps    " #src "(%1),       %%xmm0   \n\t"        \
+    "movaps  16+" #src "(%1),      %%xmm1   \n\t"        \
+    "movaps  32+" #src "(%1),      %%xmm2   \n\t"        \
+    "movaps  48+" #src "(%1),      %%xmm3   \n\t"        \
+    TRANSPOSE_REGS                                       \
+    "movups          %%xmm0,     " #dst "(%0)\n\t"       \
+    "movups          %%xmm2,  72+" #dst "(%0)\n\t"       \
+    "movups          %%xmm4, 144+" #dst "(%0)\n\t"       \
+    "movups          %%xmm5, 216+" #dst "(%0)\n\t"
+
+/* xmm0-3 to xmm0, xmm2, xmm4, xmm5 */
+#define TRANSPOSE_REGS                                   \
+    "movaps          %%xmm0,       %%xmm4   \n\t"        \
+    "unpcklps        %%xmm1,       %%xmm0   \n\t"        \
+    "unpckhps        %%xmm1,       %%xmm4   \n\t"        \
+    "movaps          %%xmm2,       %%xmm5   \n\t"        \
+    "unpcklps        %%xmm3,       %%xmm2   \n\t"        \
+    "unpckhps        %%xmm3,       %%xmm5   \n\t"        \
+    "movaps          %%xmm0,       %%xmm1   \n\t"        \
+    "movlhps         %%xmm2,       %%xmm0   \n\t"        \
+    "movhlps         %%xmm1,       %%xmm2   \n\t"        \
+    "movaps          %%xmm4,       %%xmm3   \n\t"        \
+    "movlhps         %%xmm5,       %%xmm4   \n\t"        \
+    "movhlps         %%xmm3,       %%xmm5   \n\t"
+
+/* 18 coefficients of 4 blocks, the last 2 transposes overlap */
+#define TRANSPOSE18(OP, rows, vecs)                      \
+    OP(rows +  0, vecs +   0)                            \
+    OP(rows + 16, vecs +  64)                            \
+    OP(rows + 32, vecs + 128)                            \
+    OP(rows + 48, vecs + 192)                            \
+    OP(rows + 56, vecs + 224)
+
+/* layout of the scratch buffer: input, dct output, overlap buffer */
+#define A(m, j) #m "*32+" #j "*16(%0)"
+#define T(i, j) #i "*16+" #j "*16+288(%0)"
+#define TS(i, j) #i "*16+" #j "*64+288(%0)"
+#define B(i)    #i "*16+576(%0)"
+#define K(i, j) #i "*16+" #j "*16(%2)"
+
+/* in[i] += in[i - d] */
+#define ADD_PREV(i, d)                                   \
+    "movaps  " #i "*16-" #d "*16(%0), %%xmm0  \n\t"      \
+    "addps   " #i "*16(%0),           %%xmm0  \n\t"      \
+    "movaps           %%xmm0, " #i "*16(%0)   \n\t"
+
+/*
+ * The 9 point DCT of imdct36() on the even (j = 0) or odd (j = 1) input
+ * coefficients. The operations are done in the same order as in C so that
+ * the output is identical.
+ */
+#define DCT9(j)                                                            \
+    "movaps " A(4, j) ", %%xmm0       \n\t"                                \
+    "addps  " A(8, j) ", %%xmm0       \n\t"                                \
+    "subps  " A(2, j) ", %%xmm0       \n\t" /* t2 */                       \
+    "movaps " A(6, j) ", %%xmm1       \n\t"                                \
+    "mulps  " K(8, 0) ", %%xmm1       \n\t"                                \
+    "addps  " A(0, j) ", %%xmm1       \n\t" /* t3 */                       \
+    "movaps " A(0, j) ", %%xmm2       \n\t"                                \
+    "subps  " A(6, j) ", %%xmm2       \n\t" /* t1 */                       \
+    "movaps      %%xmm0, %%xmm3       \n\t"                                \
+    "mulps  " K(8, 0) ", %%xmm3       \n\t"                                \
+    "movaps      %%xmm2, %%xmm4       \n\t"                                \
+    "subps       %%xmm3, %%xmm4       \n\t"                                \
+    "movaps      %%xmm4, " T(6, j)  "  \n\t"                                \
+    "addps       %%xmm0, %%xmm2       \n\t"                                \
+    "movaps      %%xmm2, " T(16, j) "  \n\t"                                \
+    "movaps " A(2, j) ", %%xmm0       \n\t"                                \
+    "addps  " A(4, j) ", %%xmm0       \n\t"                                \
+    "mulps  " K(0, 0) ", %%xmm0       \n\t" /* t0 */                       \
+    "movaps " A(4, j) ", %%xmm2       \n\t"                                \
+    "subps  " A(8, j) ", %%xmm2       \n\t"                                \
+    "mulps  " K(1, 0) ", %%xmm2       \n\t" /* t1 */                       \
+    "movaps " A(2, j) ", %%xmm3       \n\t"                                \
+    "addps  " A(8, j) ", %%xmm3       \n\t"                                \
+    "mulps  " K(2, 0) ", %%xmm3       \n\t" /* t2 */                       \
+    "movaps      %%xmm1, %%xmm4       \n\t"                                \
+    "subps       %%xmm0, %%xmm4       \n\t"                                \
+    "subps       %%xmm3, %%xmm4       \n\t"                                \
+    "movaps      %%xmm4, " T(10, j) "  \n\t"                                \
+    "movaps      %%xmm1, %%xmm4       \n\t"                                \
+    "addps       %%xmm0, %%xmm4       \n\t"                                \
+    "addps       %%xmm2, %%xmm4       \n\t"                                \
+    "movaps      %%xmm4, " T(2, j)  "  \n\t"                                \
+    "addps       %%xmm3, %%xmm1       \n\t"                                \
+    "subps       %%xmm2, %%xmm1       \n\t"                                \
+    "movaps      %%xmm1, " T(14, j) "  \n\t"                                \
+                                                                           \
+    "movaps " A(5, j) ", %%xmm0       \n\t"                                \
+    "addps  " A(7, j) ", %%xmm0       \n\t"                                \
+    "subps  " A(1, j) ", %%xmm0       \n\t"                                \
+    "mulps  " K(3, 0) ", %%xmm0       \n\t"                                \
+    "movaps      %%xmm0, " T(4, j)  "  \n\t"                                \
+    "movaps " A(1, j) ", %%xmm1       \n\t"                                \
+    "addps  " A(5, j) ", %%xmm1       \n\t"                                \
+    "mulps  " K(4, 0) ", %%xmm1       \n\t" /* t2 */                       \
+    "movaps " A(5, j) ", %%xmm2       \n\t"                                \
+    "subps  " A(7, j) ", %%xmm2       \n\t"                                \
+    "mulps  " K(5, 0) ", %%xmm2       \n\t" /* t3 */                       \
+    "movaps " A(3, j) ", %%xmm3       \n\t"                                \
+    "mulps  " K(6, 0) ", %%xmm3       \n\t" /* t0 */                       \
+    "movaps " A(1, j) ", %%xmm4       \n\t"                                \
+    "addps  " A(7, j) ", %%xmm4       \n\t"                                \
+    "mulps  " K(7, 0) ", %%xmm4       \n\t" /* t1 */                       \
+    "movaps      %%xmm1, %%xmm5       \n\t"                                \
+    "addps       %%xmm2, %%xmm5       \n\t"                                \
+    "addps       %%xmm3, %%xmm5       \n\t"                                \
+    "movaps      %%xmm5, " T(0, j)  "  \n\t"                                \
+    "addps       %%xmm4, %%xmm1       \n\t"                                \
+    "subps       %%xmm3, %%xmm1       \n\t"                                \
+    "movaps      %%xmm1, " T(12, j) "  \n\t"                                \
+    "subps       %%xmm4, %%xmm2       \n\t"                                \
+    "subps       %%xmm3, %%xmm2       \n\t"                                \
+    "movaps      %%xmm2, " T(8, j)  "  \n\t"
+
+/*
+ * window and overlap out[a] and out[b] from the vector in xmm<t1>
+ * and buf[a] and buf[b] from xmm<t0>, window in %1, out in %3
+ */
+#define W(i)   #i "*16(%1)"
+#define W2(i)  #i "*16+288(%1)"
+#define O(i)   #i "*128(%3)"
+#define OUT2(a, b, t0, t1)                               \
+    "movaps  " W(a) ",          %%xmm5      \n\t"        \
+    "mulps      %%xmm" #t1 ",   %%xmm5      \n\t"        \
+    "addps   " B(a) ",          %%xmm5      \n\t"        \
+    "movaps     %%xmm5,       " O(a) "      \n\t"        \
+    "movaps  " W(b) ",          %%xmm5      \n\t"        \
+    "mulps      %%xmm" #t1 ",   %%xmm5      \n\t"        \
+    "addps   " B(b) ",          %%xmm5      \n\t"        \
+    "movaps     %%xmm5,       " O(b) "      \n\t"        \
+    "movaps  " W2(a) ",         %%xmm5      \n\t"        \
+    "mulps      %%xmm" #t0 ",   %%xmm5      \n\t"        \
+    "movaps     %%xmm5,       " B(a) "      \n\t"        \
+    "movaps  " W2(b) ",         %%xmm5      \n\t"        \
+    "mulps      %%xmm" #t0 ",   %%xmm5      \n\t"        \
+    "movaps     %%xmm5,       " B(b) "      \n\t"
+
+/* the last stage of imdct36() for outputs j, 8 - j, 9 + j and 17 - j */
+#define STAGE2(j, j9, j8, j17)                                     \
+    "movaps  " TS(0, j) ",        %%xmm0      \n\t"                 \
+    "movaps  " TS(2, j) ",        %%xmm1      \n\t"                 \
+    "movaps         %%xmm1,      %%xmm2      \n\t"                 \
+    "addps          %%xmm0,      %%xmm2      \n\t" /* s0 */        \
+    "subps          %%xmm0,      %%xmm1      \n\t" /* s2 */        \
+    "movaps  " TS(3, j) ",        %%xmm3      \n\t"                 \
+    "movaps         %%xmm3,      %%xmm4      \n\t"                 \
+    "addps   " TS(1, j) ",        %%xmm3      \n\t"                 \
+    "mulps   " K(9, j) ",        %%xmm3      \n\t" /* s1 */        \
+    "subps   " TS(1, j) ",        %%xmm4      \n\t"                 \
+    "mulps   " K(14, j) ",       %%xmm4      \n\t" /* s3 */        \
+    "movaps         %%xmm2,      %%xmm0      \n\t"                 \
+    "addps          %%xmm3,      %%xmm0      \n\t"                 \
+    "subps          %%xmm3,      %%xmm2      \n\t"                 \
+    OUT2(j9, j8, 0, 2)                                             \
+    "movaps         %%xmm1,      %%xmm0      \n\t"                 \
+    "addps          %%xmm4,      %%xmm0      \n\t"                 \
+    "subps          %%xmm4,      %%xmm1      \n\t"                 \
+    OUT2(j17, j, 0, 1)
+
+static void imdct36_4_sse(float *out, float *buf, const float *in,
+                          const float *win)
+{
+    LOCAL_ALIGNED_16(float, tmp, [3 * 18 * 4]);
+
+    __asm__ volatile(
+        TRANSPOSE18(TRANSPOSE4, 0, 0)
+        :
+        :"r"(in), "r"(tmp)
+        :"memory"
+    );
+    __asm__ volatile(
+        TRANSPOSE18(TRANSPOSE4, 0, 576)
+        :
+        :"r"(buf), "r"(tmp)
+        :"memory"
+    );
+
+    __asm__ volatile(
+        ADD_PREV(17, 1) ADD_PREV(16, 1) ADD_PREV(15, 1) ADD_PREV(14, 1)
+        ADD_PREV(13, 1) ADD_PREV(12, 1) ADD_PREV(11, 1) ADD_PREV(10, 1)
+        ADD_PREV( 9, 1) ADD_PREV( 8, 1) ADD_PREV( 7, 1) ADD_PREV( 6, 1)
+        ADD_PREV( 5, 1) ADD_PREV( 4, 1) ADD_PREV( 3, 1) ADD_PREV( 2, 1)
+        ADD_PREV( 1, 1)
+        ADD_PREV(17, 2) ADD_PREV(15, 2) ADD_PREV(13, 2) ADD_PREV(11, 2)
+        ADD_PREV( 9, 2) ADD_PREV( 7, 2) ADD_PREV( 5, 2) ADD_PREV( 3, 2)
+
+        DCT9(0)
+        DCT9(1)
+
+        STAGE2(0,  9, 8, 17)
+        STAGE2(1, 10, 7, 16)
+        STAGE2(2, 11, 6, 15)
+        STAGE2(3, 12, 5, 14)
+
+        /* the middle outputs 4 and 13 */
+        "movaps  " T(16, 0) ",     %%xmm2      \n\t"
+        "movaps  " T(17, 0) ",     %%xmm3      \n\t"
+        "mulps   " K(13, 0) ",     %%xmm3      \n\t"
+        "movaps         %%xmm2, %%xmm0      \n\t"
+        "addps          %%xmm3, %%xmm0      \n\t"
+        "subps          %%xmm3, %%xmm2      \n\t"
+        OUT2(13, 4, 0, 2)
+        :
+        :"r"(tmp), "r"(win), "r"(imdct36_consts), "r"(out)
+        :"memory"
+    );
+
+    __asm__ volatile(
+        TRANSPOSE18(UNTRANSPOSE4, 0, 576)
+        :
+        :"r"(buf), "r"(tmp)
+        :"memory"
+    );
+}
+
 void ff_mpegaudiodec_init_mmx(MPADecodeContext *s)
 {
     int mm_flags = av_get_cpu_flags();
 
+    if (mm_flags & AV_CPU_FLAG_SSE) {
+        s->antialias_float = antialias_sse;
+        s->imdct36_4_float = imdct36_4_sse;
+    }
     if (mm_flags & AV_CPU_FLAG_SSE2) {
         s->apply_window_mp3 = apply_window_mp3;
     }
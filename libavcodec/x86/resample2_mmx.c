@@ -0,0 +1,182 @@
+/*
+ * SSE2 optimized polyphase resampler inner loops
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/resample2.h"
+
+#if HAVE_SSE
+
+/* pmaddwd sums are exact modulo 2^32 so the results match the C loops */
+
+static int32_t filter_sse2(const int16_t *src, const int16_t *filter, int len)
+{
+    int n = len & ~7;
+    x86_reg i = -2*n;
+    int32_t val;
+
+    __asm__ volatile(
+        "pxor     %%xmm0, %%xmm0            \n\t"
+        "test        %1, %1                 \n\t"
+        " jz 2f                             \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%2,%1), %%xmm1            \n\t"
+        "movdqu  (%3,%1), %%xmm2            \n\t"
+        "pmaddwd  %%xmm2, %%xmm1            \n\t"
+        "paddd    %%xmm1, %%xmm0            \n\t"
+        "add         $16, %1                \n\t"
+        " js 1b                             \n\t"
+        "2:                                 \n\t"
+        "pshufd $0x4E, %%xmm0, %%xmm1       \n\t"
+        "paddd    %%xmm1, %%xmm0            \n\t"
+        "pshufd $0xB1, %%xmm0, %%xmm1       \n\t"
+        "paddd    %%xmm1, %%xmm0            \n\t"
+        "movd     %%xmm0, %0                \n\t"
+        :"=r"(val), "+r"(i)
+        :"r"(src+n), "r"(filter+n)
+        :"memory"
+    );
+    for (; n < len; n++)
+        val += src[n] * filter[n];
+    return val;
+}
+
+/**
+ * 4 frames per iteration: the words of each channel are paired with
+ * pshuflw/pshufhw so that pmaddwd against the filter taps duplicated per
+ * dword gives L and R partial sums in alternate dwords.
+ */
+static void filter_stereo_sse2(int32_t val[2], const int16_t *src,
+                               const int16_t *filter, int len)
+{
+    int n = len & ~3;
+    x86_reg i = -2*n;
+    int32_t l, r;
+
+    __asm__ volatile(
+        "pxor     %%xmm0, %%xmm0            \n\t"
+        "test        %2, %2                 \n\t"
+        " jz 2f                             \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%3,%2,2), %%xmm1          \n\t"
+        "movq    (%4,%2), %%xmm2            \n\t"
+        "pshuflw $0xD8, %%xmm1, %%xmm1      \n\t"
+        "pshufhw $0xD8, %%xmm1, %%xmm1      \n\t"
+        "punpckldq %%xmm2, %%xmm2           \n\t"
+        "pmaddwd  %%xmm2, %%xmm1            \n\t"
+        "paddd    %%xmm1, %%xmm0            \n\t"
+        "add          $8, %2                \n\t"
+        " js 1b                             \n\t"
+        "2:                                 \n\t"
+        "pshufd $0x4E, %%xmm0, %%xmm1       \n\t"
+        "paddd    %%xmm1, %%xmm0            \n\t"
+        "movd     %%xmm0, %0                \n\t"
+        "pshufd $0x55, %%xmm0, %%xmm0       \n\t"
+        "movd     %%xmm0, %1                \n\t"
+        :"=r"(l), "=r"(r), "+r"(i)
+        :"r"(src+2*n), "r"(filter+n)
+        :"memory"
+    );
+    for (; n < len; n++) {
+        l += src[2*n    ] * filter[n];
+        r += src[2*n + 1] * filter[n];
+    }
+    val[0] = l;
+    val[1] = r;
+}
+
+/**
+ * 2 taps per iteration: the samples of the two frames are interleaved per
+ * channel so that pmaddwd against the tap pair gives one partial sum per
+ * channel, channels 0-3 in xmm0 and 4-7 in xmm1. An odd last tap is paired
+ * with zeros.
+ * Each load reads 8 samples, past the end of the frame for less than 8
+ * channels.
+ */
+static void filter_multi_sse2(int32_t *val, const int16_t *src,
+                              const int16_t *filter, int len, int channels)
+{
+    DECLARE_ALIGNED(16, int32_t, v)[8];
+    int n = len & ~1;
+    x86_reg i = -2*n;
+    const int16_t *s = src;
+    int ch;
+
+    __asm__ volatile(
+        "pxor     %%xmm0, %%xmm0            \n\t"
+        "pxor     %%xmm1, %%xmm1            \n\t"
+        "test        %0, %0                 \n\t"
+        " jz 2f                             \n\t"
+        ASMALIGN(4)
+        "1:                                 \n\t"
+        "movdqu  (%1), %%xmm2               \n\t"
+        "movdqu  (%1,%2), %%xmm3            \n\t"
+        "movd    (%3,%0), %%xmm5            \n\t"
+        "movdqa   %%xmm2, %%xmm4            \n\t"
+        "pshufd $0, %%xmm5, %%xmm5          \n\t"
+        "punpcklwd %%xmm3, %%xmm2           \n\t"
+        "punpckhwd %%xmm3, %%xmm4           \n\t"
+        "pmaddwd  %%xmm5, %%xmm2            \n\t"
+        "pmaddwd  %%xmm5, %%xmm4            \n\t"
+        "paddd    %%xmm2, %%xmm0            \n\t"
+        "paddd    %%xmm4, %%xmm1            \n\t"
+        "lea     (%1,%2,2), %1              \n\t"
+        "add          $4, %0                \n\t"
+        " js 1b                             \n\t"
+        "2:                                 \n\t"
+        "test         $1, %5                \n\t"
+        " jz 3f                             \n\t"
+        "movdqu  (%1), %%xmm2               \n\t"
+        "pxor     %%xmm3, %%xmm3            \n\t"
+        "movd    (%3), %%xmm5               \n\t"
+        "movdqa   %%xmm2, %%xmm4            \n\t"
+        "pshufd $0, %%xmm5, %%xmm5          \n\t"
+        "punpcklwd %%xmm3, %%xmm2           \n\t"
+        "punpckhwd %%xmm3, %%xmm4           \n\t"
+        "pmaddwd  %%xmm5, %%xmm2            \n\t"
+        "pmaddwd  %%xmm5, %%xmm4            \n\t"
+        "paddd    %%xmm2, %%xmm0            \n\t"
+        "paddd    %%xmm4, %%xmm1            \n\t"
+        "3:                                 \n\t"
+        "movdqa   %%xmm0,   (%4)            \n\t"
+        "movdqa   %%xmm1, 16(%4)            \n\t"
+        :"+r"(i), "+r"(s)
+        :"r"((x86_reg)(2*channels)), "r"(filter+n), "r"(v), "r"(len)
+        :"memory"
+    );
+    for (ch = 0; ch < channels; ch++)
+        val[ch] = v[ch];
+}
+
+#endif /* HAVE_SSE */
+
+void ff_resample_dsp_init_mmx(ResampleDSPContext *c, int flags)
+{
+#if HAVE_SSE
+    if (flags & AV_CPU_FLAG_SSE2) {
+        c->filter        = filter_sse2;
+        c->filter_stereo = filter_stereo_sse2;
+        c->filter_multi  = filter_multi_sse2;
+    }
+#endif
+}
@@ -30,6 +30,9 @@
 #include "avformat.h"
 #include "internal.h"
 #include <unistd.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -41,8 +44,18 @@
  *
  * If the main playlist doesn't point at any variants, we still create
  * one anonymous toplevel variant for this, to maintain the structure.
+ *
+ * When threads are available, a few prefetch threads download the segments
+ * following the current one into memory while the current one is demuxed,
+ * and reload the playlists of live streams in the background.
  */
 
+#define PREFETCH_SEGMENTS   3   ///< number of segments downloaded ahead
+#define PREFETCH_THREADS    3
+#define MAX_CACHED_SEGMENTS 32
+#define MAX_CACHE_SIZE      (16 << 20)
+#define CHUNK_SIZE          32768
+
 struct segment {
     int duration;
     char url[MAX_URL_SIZE];
@@ -65,6 +78,25 @@ struct variant {
     int n_segments;
     struct segment **segments;
     int needed;
+    struct cached_segment *cached;  ///< cache entry pb reads from, if any
+};
+
+/*
+ * A segment downloaded by a prefetch thread. The data is appended as it
+ * arrives, so that the demuxer can start reading a segment that is still
+ * being downloaded.
+ */
+struct cached_segment {
+    struct AppleHTTPContext *c;
+    struct variant *var;
+    int seq_no;
+    char url[MAX_URL_SIZE];
+    uint8_t *data;
+    int size, allocated;
+    int read_pos;
+    int fetching;   ///< a prefetch thread is downloading it
+    int done;       ///< 1 once completely downloaded, or an AVERROR code
+    int abandoned;  ///< dropped from the cache while being downloaded
 };
 
 typedef struct AppleHTTPContext {
@@ -76,8 +108,99 @@ typedef struct AppleHTTPContext {
     int64_t last_load_time;
     int64_t last_packet_dts;
     int max_start_seq, min_end_seq;
+    int nb_threads;
+#if HAVE_PTHREADS
+    /* The lock protects the segment lists and the fields above, the cache,
+     * and the playlist state; the threads are woken up through the cond
+     * whenever any of those change. */
+    pthread_t threads[PREFETCH_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int abort;
+    int reloading;
+    int reload_error;
+    struct cached_segment *cache[MAX_CACHED_SEGMENTS];
+    int cache_size;     ///< bytes allocated for the cached segments
+#endif
 } AppleHTTPContext;
 
+static void lock_context(AppleHTTPContext *c)
+{
+#if HAVE_PTHREADS
+    if (c->nb_threads)
+        pthread_mutex_lock(&c->lock);
+#endif
+}
+
+static void unlock_context(AppleHTTPContext *c)
+{
+#if HAVE_PTHREADS
+    if (c->nb_threads)
+        pthread_mutex_unlock(&c->lock);
+#endif
+}
+
+#if HAVE_PTHREADS
+/* Interrupt callbacks of the downloads done by the prefetch threads, so
+ * that closing the demuxer or seeking away doesn't wait for them. */
+static int abort_requested(void *opaque)
+{
+    AppleHTTPContext *c = opaque;
+    int ret;
+    pthread_mutex_lock(&c->lock);
+    ret = c->abort;
+    pthread_mutex_unlock(&c->lock);
+    return ret;
+}
+
+static int segment_abandoned(void *opaque)
+{
+    struct cached_segment *seg = opaque;
+    AppleHTTPContext *c = seg->c;
+    int ret;
+    pthread_mutex_lock(&c->lock);
+    ret = c->abort || seg->abandoned;
+    pthread_mutex_unlock(&c->lock);
+    return ret;
+}
+
+static int open_interruptible(URLContext **puc, const char *url,
+                              int (*interrupt_cb)(void *opaque), void *opaque)
+{
+    int ret = url_alloc(puc, url, URL_RDONLY);
+    if (ret < 0)
+        return ret;
+    (*puc)->interrupt_cb     = interrupt_cb;
+    (*puc)->interrupt_opaque = opaque;
+    if ((ret = url_connect(*puc)) < 0) {
+        url_close(*puc);
+        *puc = NULL;
+    }
+    return ret;
+}
+#endif
+
+/**
+ * Open a playlist, interruptibly once the prefetch threads, which reload
+ * the playlists, are running.
+ */
+static int open_playlist(AppleHTTPContext *c, ByteIOContext **pb,
+                         const char *url)
+{
+#if HAVE_PTHREADS
+    if (c->nb_threads) {
+        URLContext *h;
+        int ret;
+        if ((ret = open_interruptible(&h, url, abort_requested, c)) < 0)
+            return ret;
+        if ((ret = url_fdopen(pb, h)) < 0)
+            url_close(h);
+        return ret;
+    }
+#endif
+    return url_fopen(pb, url, URL_RDONLY);
+}
+
 static int read_chomp_line(ByteIOContext *s, char *buf, int maxlen)
 {
     int len = ff_get_line(s, buf, maxlen);
@@ -99,6 +222,8 @@ static void make_absolute_url(char *buf, int size, const char *base,
     sep = strrchr(buf, '/');
     if (sep)
         sep[1] = '\0';
+    else
+        buf[0] = '\0';
     while (av_strstart(rel, "../", NULL)) {
         if (sep) {
             sep[0] = '\0';
@@ -120,6 +245,110 @@ static void free_segment_list(struct variant *var)
     var->n_segments = 0;
 }
 
+#if HAVE_PTHREADS
+static void free_cached(AppleHTTPContext *c, struct cached_segment *seg)
+{
+    c->cache_size -= seg->allocated;
+    av_free(seg->data);
+    av_free(seg);
+}
+
+/**
+ * Remove a segment from the cache. A segment that is still being
+ * downloaded is freed by its prefetch thread once it notices.
+ * Must be called with the lock held.
+ */
+static void release_cached(AppleHTTPContext *c, struct cached_segment *seg)
+{
+    int i;
+    for (i = 0; i < MAX_CACHED_SEGMENTS; i++)
+        if (c->cache[i] == seg)
+            c->cache[i] = NULL;
+    if (seg->fetching)
+        seg->abandoned = 1;
+    else
+        free_cached(c, seg);
+    pthread_cond_broadcast(&c->cond);
+}
+
+static struct cached_segment *find_cached(AppleHTTPContext *c,
+                                          struct variant *var, int seq_no)
+{
+    int i;
+    for (i = 0; i < MAX_CACHED_SEGMENTS; i++)
+        if (c->cache[i] && c->cache[i]->var == var &&
+            c->cache[i]->seq_no == seq_no)
+            return c->cache[i];
+    return NULL;
+}
+
+/**
+ * Drop the segments that are outside of the prefetch window, i.e. the ones
+ * that were skipped by a seek or belong to variants that are not needed
+ * anymore. Must be called with the lock held.
+ */
+static void prune_cache(AppleHTTPContext *c)
+{
+    int i;
+    for (i = 0; i < MAX_CACHED_SEGMENTS; i++) {
+        struct cached_segment *seg = c->cache[i];
+        if (seg && seg->var->cached != seg &&
+            (!seg->var->needed || seg->seq_no < c->cur_seq_no ||
+             seg->seq_no > c->cur_seq_no + PREFETCH_SEGMENTS))
+            release_cached(c, seg);
+    }
+    pthread_cond_broadcast(&c->cond);
+}
+
+static void wait_timeout(AppleHTTPContext *c, int64_t timeout)
+{
+    int64_t t = av_gettime() + timeout;
+    struct timespec ts = { t / 1000000, t % 1000000 * 1000 };
+    pthread_cond_timedwait(&c->cond, &c->lock, &ts);
+}
+
+static int read_cached(void *opaque, uint8_t *buf, int buf_size)
+{
+    struct cached_segment *seg = opaque;
+    AppleHTTPContext *c = seg->c;
+    int len;
+
+    pthread_mutex_lock(&c->lock);
+    while (seg->read_pos >= seg->size && !seg->done) {
+        if (url_interrupt_cb()) {
+            pthread_mutex_unlock(&c->lock);
+            return AVERROR(EINTR);
+        }
+        wait_timeout(c, 100000);
+    }
+    len = FFMIN(buf_size, seg->size - seg->read_pos);
+    if (len > 0) {
+        memcpy(buf, seg->data + seg->read_pos, len);
+        seg->read_pos += len;
+    } else {
+        len = seg->done < 0 ? seg->done : 0;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return len;
+}
+#endif
+
+static void close_variant(AppleHTTPContext *c, struct variant *var)
+{
+#if HAVE_PTHREADS
+    if (var->cached) {
+        av_free(var->pb->buffer);
+        av_free(var->pb);
+        lock_context(c);
+        release_cached(c, var->cached);
+        var->cached = NULL;
+        unlock_context(c);
+    } else
+#endif
+    url_fclose(var->pb);
+    var->pb = NULL;
+}
+
 static void free_variant_list(AppleHTTPContext *c)
 {
     int i;
@@ -128,7 +357,7 @@ static void free_variant_list(AppleHTTPContext *c)
         free_segment_list(var);
         av_free_packet(&var->pkt);
         if (var->pb)
-            url_fclose(var->pb);
+            close_variant(c, var);
         if (var->ctx) {
             var->ctx->pb = NULL;
             av_close_input_file(var->ctx);
@@ -262,6 +491,240 @@ fail:
     return ret;
 }
 
+/* Must be called with the lock held. */
+static void update_seq_range(AppleHTTPContext *c)
+{
+    int i;
+    c->max_start_seq = 0;
+    c->min_end_seq   = INT_MAX;
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *var = c->variants[i];
+        if (var->needed) {
+            c->max_start_seq = FFMAX(c->max_start_seq, var->start_seq_no);
+            c->min_end_seq   = FFMIN(c->min_end_seq,
+                                     var->start_seq_no + var->n_segments);
+        }
+    }
+}
+
+/**
+ * Reload the playlist of a variant. The playlist is downloaded and parsed
+ * without holding the lock, so that the demuxer and the prefetch threads
+ * keep going meanwhile, and the new segment list is swapped in afterwards.
+ */
+static int reload_variant(AppleHTTPContext *c, struct variant *var)
+{
+    AppleHTTPContext tmp = { 0 };
+    struct variant playlist = { 0 };
+    ByteIOContext *in;
+    int ret;
+
+    lock_context(c);
+    playlist.start_seq_no = var->start_seq_no;
+    unlock_context(c);
+    if ((ret = open_playlist(c, &in, var->url)) < 0)
+        return ret;
+    ret = parse_playlist(&tmp, var->url, &playlist, in);
+    url_fclose(in);
+    free_variant_list(&tmp);
+    if (ret >= 0) {
+        lock_context(c);
+        FFSWAP(struct segment **, var->segments,   playlist.segments);
+        FFSWAP(int,               var->n_segments, playlist.n_segments);
+        var->start_seq_no = playlist.start_seq_no;
+        c->finished       = tmp.finished;
+        c->last_load_time = tmp.last_load_time;
+        if (tmp.target_duration)
+            c->target_duration = tmp.target_duration;
+        update_seq_range(c);
+        unlock_context(c);
+    }
+    free_segment_list(&playlist);
+    return ret;
+}
+
+static int reload_playlists(AppleHTTPContext *c)
+{
+    int i, ret, needed;
+    for (i = 0; i < c->n_variants; i++) {
+        lock_context(c);
+        needed = c->variants[i]->needed;
+        unlock_context(c);
+        if (needed && (ret = reload_variant(c, c->variants[i])) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+#if HAVE_PTHREADS
+/**
+ * Pick the next segment to download: the segments following the current
+ * one are fetched in order, for all the needed variants, as long as the
+ * cache isn't full. Must be called with the lock held.
+ */
+static struct cached_segment *next_prefetch(AppleHTTPContext *c)
+{
+    int seq, i, j;
+
+    for (seq = c->cur_seq_no + 1; seq <= c->cur_seq_no + PREFETCH_SEGMENTS; seq++) {
+        for (i = 0; i < c->n_variants; i++) {
+            struct variant *var = c->variants[i];
+            struct cached_segment *seg;
+            if (!var->needed || seq < var->start_seq_no ||
+                seq - var->start_seq_no >= var->n_segments ||
+                find_cached(c, var, seq))
+                continue;
+            if (c->cache_size >= MAX_CACHE_SIZE)
+                return NULL;
+            for (j = 0; j < MAX_CACHED_SEGMENTS && c->cache[j]; j++)
+                ;
+            if (j == MAX_CACHED_SEGMENTS || !(seg = av_mallocz(sizeof(*seg))))
+                return NULL;
+            seg->c        = c;
+            seg->var      = var;
+            seg->seq_no   = seq;
+            seg->fetching = 1;
+            av_strlcpy(seg->url, var->segments[seq - var->start_seq_no]->url,
+                       sizeof(seg->url));
+            c->cache[j] = seg;
+            return seg;
+        }
+    }
+    return NULL;
+}
+
+static int fetch_segment(AppleHTTPContext *c, struct cached_segment *seg)
+{
+    URLContext *h;
+    uint8_t *dst;
+    int ret;
+
+    if ((ret = open_interruptible(&h, seg->url, segment_abandoned, seg)) < 0)
+        return ret;
+    do {
+        pthread_mutex_lock(&c->lock);
+        /* Once the cache is full, only the segment the demuxer is at
+         * may grow, the others wait for it to catch up. */
+        while (!c->abort && !seg->abandoned && seg->seq_no > c->cur_seq_no &&
+               c->cache_size > MAX_CACHE_SIZE)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (c->abort || seg->abandoned) {
+            pthread_mutex_unlock(&c->lock);
+            ret = AVERROR(EINTR);
+            break;
+        }
+        if (seg->allocated - seg->size < CHUNK_SIZE) {
+            int size = FFMAX(2 * seg->allocated, seg->size + CHUNK_SIZE);
+            uint8_t *data = av_realloc(seg->data, size);
+            if (!data) {
+                pthread_mutex_unlock(&c->lock);
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            c->cache_size += size - seg->allocated;
+            seg->data      = data;
+            seg->allocated = size;
+        }
+        /* Only this thread reallocates the data, and the demuxer does not
+         * look past size, so the download itself needs no locking. */
+        dst = seg->data + seg->size;
+        pthread_mutex_unlock(&c->lock);
+
+        ret = url_read(h, dst, CHUNK_SIZE);
+        if (ret > 0) {
+            pthread_mutex_lock(&c->lock);
+            seg->size += ret;
+            pthread_cond_broadcast(&c->cond);
+            pthread_mutex_unlock(&c->lock);
+        }
+    } while (ret > 0);
+    url_close(h);
+    return ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    AppleHTTPContext *c = arg;
+    struct cached_segment *seg;
+    int ret;
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->abort) {
+        if (!c->finished && !c->reloading &&
+            av_gettime() - c->last_load_time >=
+            FFMAX(c->target_duration, 1) * 1000000LL) {
+            c->reloading = 1;
+            pthread_mutex_unlock(&c->lock);
+            ret = reload_playlists(c);
+            pthread_mutex_lock(&c->lock);
+            if (ret < 0) {
+                c->reload_error = ret;
+                /* retry after target_duration rather than right away */
+                c->last_load_time = av_gettime();
+            }
+            c->reloading = 0;
+            pthread_cond_broadcast(&c->cond);
+        } else if ((seg = next_prefetch(c))) {
+            pthread_mutex_unlock(&c->lock);
+            ret = fetch_segment(c, seg);
+            pthread_mutex_lock(&c->lock);
+            seg->fetching = 0;
+            seg->done     = ret < 0 ? ret : 1;
+            if (seg->abandoned)
+                free_cached(c, seg);
+            pthread_cond_broadcast(&c->cond);
+        } else {
+            wait_timeout(c, 100000);
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static void start_prefetch(AppleHTTPContext *c)
+{
+    int i;
+
+    if (pthread_mutex_init(&c->lock, NULL))
+        return;
+    if (pthread_cond_init(&c->cond, NULL)) {
+        pthread_mutex_destroy(&c->lock);
+        return;
+    }
+    for (i = 0; i < PREFETCH_THREADS; i++)
+        if (pthread_create(&c->threads[c->nb_threads], NULL,
+                           prefetch_thread, c) == 0)
+            c->nb_threads++;
+    if (!c->nb_threads) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+    }
+}
+
+static void stop_prefetch(AppleHTTPContext *c)
+{
+    int i;
+
+    if (!c->nb_threads)
+        return;
+    pthread_mutex_lock(&c->lock);
+    c->abort = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    for (i = 0; i < c->nb_threads; i++)
+        pthread_join(c->threads[i], NULL);
+    for (i = 0; i < c->n_variants; i++)
+        if (c->variants[i]->pb)
+            close_variant(c, c->variants[i]);
+    for (i = 0; i < MAX_CACHED_SEGMENTS; i++)
+        if (c->cache[i])
+            release_cached(c, c->cache[i]);
+    c->nb_threads = 0;
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+}
+#endif
+
 static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
 {
     AppleHTTPContext *c = s->priv_data;
@@ -334,6 +797,9 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
     if (!c->finished && c->min_end_seq - c->max_start_seq > 3)
         c->cur_seq_no = c->min_end_seq - 2;
 
+#if HAVE_PTHREADS
+    start_prefetch(c);
+#endif
     return 0;
 fail:
     free_variant_list(c);
@@ -342,20 +808,51 @@ fail:
 
 static int open_variant(AppleHTTPContext *c, struct variant *var, int skip)
 {
+    char url[MAX_URL_SIZE];
     int ret;
 
+    lock_context(c);
     if (c->cur_seq_no < var->start_seq_no) {
         av_log(NULL, AV_LOG_WARNING,
                "seq %d not available in variant %s, skipping\n",
                var->start_seq_no, var->url);
+        unlock_context(c);
         return 0;
     }
-    if (c->cur_seq_no - var->start_seq_no >= var->n_segments)
-        return c->finished ? AVERROR_EOF : 0;
-    ret = url_fopen(&var->pb,
-                    var->segments[c->cur_seq_no - var->start_seq_no]->url,
-                    URL_RDONLY);
-    if (ret < 0)
+    if (c->cur_seq_no - var->start_seq_no >= var->n_segments) {
+        ret = c->finished ? AVERROR_EOF : 0;
+        unlock_context(c);
+        return ret;
+    }
+    av_strlcpy(url, var->segments[c->cur_seq_no - var->start_seq_no]->url,
+               sizeof(url));
+#if HAVE_PTHREADS
+    /* Read the segment from the cache if it has been prefetched, falling
+     * back to a direct download if prefetching it failed. */
+    if (c->nb_threads && (var->cached = find_cached(c, var, c->cur_seq_no)) &&
+        var->cached->done < 0) {
+        release_cached(c, var->cached);
+        var->cached = NULL;
+    }
+#endif
+    unlock_context(c);
+#if HAVE_PTHREADS
+    if (var->cached) {
+        uint8_t *buf = av_malloc(CHUNK_SIZE);
+        if (!buf || !(var->pb = av_alloc_put_byte(buf, CHUNK_SIZE, 0,
+                                                  var->cached, read_cached,
+                                                  NULL, NULL))) {
+            av_free(buf);
+            lock_context(c);
+            release_cached(c, var->cached);
+            var->cached = NULL;
+            unlock_context(c);
+            return AVERROR(ENOMEM);
+        }
+        var->pb->is_streamed = 1;
+    } else
+#endif
+    if ((ret = url_fopen(&var->pb, url, URL_RDONLY)) < 0)
         return ret;
     var->ctx->pb = var->pb;
     /* If this is a new segment in parallel with another one already opened,
@@ -382,9 +879,10 @@ static int applehttp_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     AppleHTTPContext *c = s->priv_data;
     int ret, i, minvariant = -1, first = 1, needed = 0, changed = 0,
-        variants = 0;
+        variants = 0, live;
 
     /* Recheck the discard flags - which streams are desired at the moment */
+    lock_context(c);
     for (i = 0; i < c->n_variants; i++)
         c->variants[i]->needed = 0;
     for (i = 0; i < s->nb_streams; i++) {
@@ -398,6 +896,12 @@ static int applehttp_read_packet(AVFormatContext *s, AVPacket *pkt)
          * streams are desired. */
         var->ctx->streams[i - var->stream_offset]->discard = st->discard;
     }
+#if HAVE_PTHREADS
+    if (c->nb_threads)
+        prune_cache(c);
+#endif
+    live = !c->finished;
+    unlock_context(c);
     if (!needed)
         return AVERROR_EOF;
 start:
@@ -409,14 +913,13 @@ start:
                    "Closing variant stream %d, no longer needed\n", i);
             av_free_packet(&var->pkt);
             reset_packet(&var->pkt);
-            url_fclose(var->pb);
-            var->pb = NULL;
+            close_variant(c, var);
             changed = 1;
         } else if (!var->pb && var->needed) {
             if (first)
                 av_log(s, AV_LOG_DEBUG, "Opening variant stream %d\n", i);
-            if (first && !c->finished)
-                if ((ret = parse_playlist(c, var->url, var, NULL)) < 0)
+            if (first && live)
+                if ((ret = reload_variant(c, var)) < 0)
                     return ret;
             ret = open_variant(c, var, first);
             if (ret < 0)
@@ -457,35 +960,23 @@ start:
      * current segments. */
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
-        if (var->pb) {
-            url_fclose(var->pb);
-            var->pb = NULL;
-        }
+        if (var->pb)
+            close_variant(c, var);
     }
     /* Indicate that we're opening the next segment, not opening a new
      * variant stream in parallel, so we shouldn't try to skip ahead. */
     first = 0;
+    lock_context(c);
     c->cur_seq_no++;
 reload:
-    if (!c->finished) {
+    if (!c->finished && !c->nb_threads) {
         /* If this is a live stream and target_duration has elapsed since
-         * the last playlist reload, reload the variant playlists now. */
+         * the last playlist reload, reload the variant playlists now.
+         * With prefetch threads, this is done in the background. */
         int64_t now = av_gettime();
-        if (now - c->last_load_time >= c->target_duration*1000000) {
-            c->max_start_seq = 0;
-            c->min_end_seq   = INT_MAX;
-            for (i = 0; i < c->n_variants; i++) {
-                struct variant *var = c->variants[i];
-                if (var->needed) {
-                    if ((ret = parse_playlist(c, var->url, var, NULL)) < 0)
-                        return ret;
-                    c->max_start_seq = FFMAX(c->max_start_seq,
-                                             var->start_seq_no);
-                    c->min_end_seq   = FFMIN(c->min_end_seq,
-                                             var->start_seq_no + var->n_segments);
-                }
-            }
-        }
+        if (now - c->last_load_time >= c->target_duration*1000000)
+            if ((ret = reload_playlists(c)) < 0)
+                return ret;
     }
     if (c->cur_seq_no < c->max_start_seq) {
         av_log(NULL, AV_LOG_WARNING,
@@ -493,13 +984,35 @@ reload:
                c->max_start_seq - c->cur_seq_no);
         c->cur_seq_no = c->max_start_seq;
     }
+#if HAVE_PTHREADS
+    if (c->nb_threads)
+        prune_cache(c);
+#endif
     /* If more segments exit, open the next one */
-    if (c->cur_seq_no < c->min_end_seq)
+    if (c->cur_seq_no < c->min_end_seq) {
+        unlock_context(c);
         goto start;
+    }
     /* We've reached the end of the playlists - return eof if this is a
      * non-live stream, wait until the next playlist reload if it is live. */
-    if (c->finished)
+    if (c->finished) {
+        unlock_context(c);
         return AVERROR_EOF;
+    }
+#if HAVE_PTHREADS
+    if (c->nb_threads) {
+        while (!c->finished && c->cur_seq_no >= c->min_end_seq) {
+            if (c->reload_error || url_interrupt_cb()) {
+                ret = c->reload_error ? c->reload_error : AVERROR(EINTR);
+                c->reload_error = 0;
+                pthread_mutex_unlock(&c->lock);
+                return ret;
+            }
+            wait_timeout(c, 100000);
+        }
+        goto reload;
+    }
+#endif
     while (av_gettime() - c->last_load_time < c->target_duration*1000000) {
         if (url_interrupt_cb())
             return AVERROR(EINTR);
@@ -513,6 +1026,9 @@ static int applehttp_close(AVFormatContext *s)
 {
     AppleHTTPContext *c = s->priv_data;
 
+#if HAVE_PTHREADS
+    stop_prefetch(c);
+#endif
     free_variant_list(c);
     return 0;
 }
@@ -521,7 +1037,7 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
                                int64_t timestamp, int flags)
 {
     AppleHTTPContext *c = s->priv_data;
-    int pos = 0, i;
+    int pos = 0, i, ret = AVERROR(EIO);
     struct variant *var = c->variants[0];
 
     if ((flags & AVSEEK_FLAG_BYTE) || !c->finished)
@@ -531,10 +1047,8 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
     c->last_packet_dts = AV_NOPTS_VALUE;
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
-        if (var->pb) {
-            url_fclose(var->pb);
-            var->pb = NULL;
-        }
+        if (var->pb)
+            close_variant(c, var);
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
     }
@@ -544,14 +1058,22 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
                                AV_TIME_BASE, flags & AVSEEK_FLAG_BACKWARD ?
                                AV_ROUND_DOWN : AV_ROUND_UP);
     /* Locate the segment that contains the target timestamp */
+    lock_context(c);
     for (i = 0; i < var->n_segments; i++) {
         if (timestamp >= pos && timestamp < pos + var->segments[i]->duration) {
             c->cur_seq_no = var->start_seq_no + i;
-            return 0;
+            ret = 0;
+            break;
         }
         pos += var->segments[i]->duration;
     }
-    return AVERROR(EIO);
+#if HAVE_PTHREADS
+    /* Drop the prefetched segments that are not needed anymore */
+    if (c->nb_threads)
+        prune_cache(c);
+#endif
+    unlock_context(c);
+    return ret;
 }
 
 static int applehttp_probe(AVProbeData *p)
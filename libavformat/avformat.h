@@ -22,8 +22,8 @@
 #define AVFORMAT_AVFORMAT_H
 
 #define LIBAVFORMAT_VERSION_MAJOR 52
-#define LIBAVFORMAT_VERSION_MINOR 78
-#define LIBAVFORMAT_VERSION_MICRO  5
+#define LIBAVFORMAT_VERSION_MINOR 83
+#define LIBAVFORMAT_VERSION_MICRO  0
 
 #define LIBAVFORMAT_VERSION_INT AV_VERSION_INT(LIBAVFORMAT_VERSION_MAJOR, \
                                                LIBAVFORMAT_VERSION_MINOR, \
@@ -737,6 +737,11 @@ typedef struct AVFormatContext {
     int mux_rate;
     unsigned int packet_size;
     int preload;
+    /**
+     * Maximum delay in microseconds, of the packets behind their dts when
+     * muxing, or to wait for missing RTP packets when demuxing, where 0
+     * means 100 ms.
+     */
     int max_delay;
 
 #define AVFMT_NOOUTPUTLOOP -1
@@ -754,6 +759,8 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_NOFILLIN     0x0010 ///< Do not infer any values from other values, just return what is stored in the container
 #define AVFMT_FLAG_NOPARSE      0x0020 ///< Do not use AVParsers, you also must set AVFMT_FLAG_NOFILLIN as the fillin code works on frames and no parsing -> no frames. Also seeking to frames can not work if parsing to find frame boundaries has been disabled
 #define AVFMT_FLAG_RTP_HINT     0x0040 ///< Add RTP hinting to the output file
+#define AVFMT_FLAG_MOV_FRAGMENT 0x0080 ///< Write a fragmented MOV/MP4 file (moof/mdat pairs) instead of a single moov
+#define AVFMT_FLAG_MOV_FASTSTART 0x0100 ///< Place the moov of MOV/MP4 files before the mdat, shifting the data if it does not fit in moov_size
 
     int loop_input;
 
@@ -847,6 +854,34 @@ typedef struct AVFormatContext {
      * - decoding: Unused.
      */
     int64_t start_time_realtime;
+
+    /**
+     * Minimum duration of a fragment in AV_TIME_BASE units for muxers
+     * writing fragmented output, a new fragment is started at the next
+     * key frame after it. 0 starts a fragment at every key frame.
+     * - encoding: Set by user.
+     * - decoding: Unused.
+     */
+    int fragment_duration;
+
+    /**
+     * Space in bytes to reserve at the start of the file for the index
+     * of muxers that write it at the end, such as the moov of MOV/MP4.
+     * If it fits, the index is written there instead of the end.
+     * - encoding: Set by user.
+     * - decoding: Unused.
+     */
+    int moov_size;
+
+    /**
+     * Number of RTP packets to keep when some are missing, so that they can
+     * be put back in order. The missing packets are given up on when the
+     * queue is full or max_delay after the first queued packet arrived.
+     * 0 or 1 returns the packets in the order they arrive.
+     * - encoding: Unused.
+     * - decoding: Set by user.
+     */
+    int reorder_queue_size;
 } AVFormatContext;
 
 typedef struct AVPacketList {
@@ -26,6 +26,7 @@
 #include "libavcodec/opt.h"
 #include "os_support.h"
 #include "avformat.h"
+#include "internal.h"
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
@@ -323,6 +324,28 @@ static int default_interrupt_cb(void)
     return 0;
 }
 
+int ff_url_interrupted(URLContext *h)
+{
+    return url_interrupt_cb() ||
+           (h->interrupt_cb && h->interrupt_cb(h->interrupt_opaque));
+}
+
+int ff_url_open_nested(URLContext **puc, const char *filename, int flags,
+                       URLContext *parent)
+{
+    int ret = url_alloc(puc, filename, flags);
+    if (ret)
+        return ret;
+    (*puc)->interrupt_cb     = parent->interrupt_cb;
+    (*puc)->interrupt_opaque = parent->interrupt_opaque;
+    ret = url_connect(*puc);
+    if (!ret)
+        return 0;
+    url_close(*puc);
+    *puc = NULL;
+    return ret;
+}
+
 void url_set_interrupt_cb(URLInterruptCB *interrupt_cb)
 {
     if (!interrupt_cb)
@@ -53,6 +53,14 @@ typedef struct URLContext {
     void *priv_data;
     char *filename; /**< specified URL */
     int is_connected;
+    /**
+     * Checked along with the global interrupt callback by the protocols
+     * that block, to abort only this context. To be set between
+     * url_alloc() and url_connect(), the protocols pass it on to the
+     * contexts they open themselves.
+     */
+    int (*interrupt_cb)(void *opaque);
+    void *interrupt_opaque;
 } URLContext;
 
 typedef struct URLPollEntry {
@@ -36,6 +36,27 @@
 /* used for protocol handling */
 #define BUFFER_SIZE 1024
 #define MAX_REDIRECTS 8
+#define MAX_CONNECTIONS 8
+/* forward seeks shorter than this read through the data instead of
+ * issuing a new request */
+#define SHORT_SEEK_SIZE 32768
+
+/**
+ * A connection which is not the one being read from, either left
+ * somewhere in a response after a seek or waiting for the response to
+ * a range request sent ahead of time. Connections belong to one context
+ * and are never shared with others.
+ */
+typedef struct {
+    URLContext *hd;
+    unsigned char buffer[BUFFER_SIZE];
+    int buf_pos, buf_len;
+    int64_t chunksize;
+    int64_t off, end_off;
+    int willclose;
+    int pending;            /**< Set if the response header has not been read yet. */
+    unsigned last_use;
+} HTTPConnection;
 
 typedef struct {
     const AVClass *class;
@@ -45,23 +66,33 @@ typedef struct {
     int http_code;
     int64_t chunksize;      /**< Used if "Transfer-Encoding: chunked" otherwise -1. */
     int64_t off, filesize;
+    int64_t end_off;        /**< End of the response body, -1 if it only ends with the connection. */
     char location[MAX_URL_SIZE];
     HTTPAuthState auth_state;
     unsigned char headers[BUFFER_SIZE];
     int willclose;          /**< Set if the server correctly handles Connection: close and will close the connection after feeding us the content. */
+    int keepalive;
+    int64_t range_size;     /**< Maximum size of a requested range, 0 for no limit. */
+    int parallel;           /**< Number of range requests kept in flight. */
+    /* where the location currently resolves to, to issue new requests */
+    char tcp_url[1024], path[MAX_URL_SIZE], hoststr[1024], auth[1024];
+    HTTPConnection conns[MAX_CONNECTIONS];
+    unsigned use_count;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
 static const AVOption options[] = {
 {"chunksize", "use chunked transfer-encoding for posts, -1 disables it, 0 enables it", OFFSET(chunksize), FF_OPT_TYPE_INT64, 0, -1, 0 }, /* Default to 0, for chunked POSTs */
+{"keepalive", "keep the connections open to reuse them for the next requests", OFFSET(keepalive), FF_OPT_TYPE_INT, 1, 0, 1 },
+{"range_size", "maximum size of the ranges requested, 0 for no limit", OFFSET(range_size), FF_OPT_TYPE_INT64, 0, 0, INT64_MAX },
+{"parallel", "number of range requests kept in flight on separate connections", OFFSET(parallel), FF_OPT_TYPE_INT, 1, 1, MAX_CONNECTIONS / 2 },
 {NULL}
 };
 static const AVClass httpcontext_class = {
     "HTTP", av_default_item_name, options, LIBAVUTIL_VERSION_INT
 };
 
-static int http_connect(URLContext *h, const char *path, const char *hoststr,
-                        const char *auth, int *new_location);
+static int http_request(URLContext *h, int64_t off, int read_header);
 
 void ff_http_set_headers(URLContext *h, const char *headers)
 {
@@ -85,32 +116,27 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            &((HTTPContext*)src->priv_data)->auth_state, sizeof(HTTPAuthState));
 }
 
-/* return non zero if error */
-static int http_open_cnx(URLContext *h)
+/**
+ * Work out where to send the requests for the current location.
+ */
+static void http_resolve_location(HTTPContext *s)
 {
     const char *path, *proxy_path;
-    char hostname[1024], hoststr[1024];
-    char auth[1024];
+    char hostname[1024];
     char path1[1024];
-    char buf[1024];
-    int port, use_proxy, err, location_changed = 0, redirects = 0;
-    HTTPAuthType cur_auth_type;
-    HTTPContext *s = h->priv_data;
-    URLContext *hd = NULL;
+    int port, use_proxy;
 
     proxy_path = getenv("http_proxy");
     use_proxy = (proxy_path != NULL) && !getenv("no_proxy") &&
         av_strstart(proxy_path, "http://", NULL);
 
-    /* fill the dest addr */
- redo:
     /* needed in any case to build the host string */
-    av_url_split(NULL, 0, auth, sizeof(auth), hostname, sizeof(hostname), &port,
+    av_url_split(NULL, 0, s->auth, sizeof(s->auth), hostname, sizeof(hostname), &port,
                  path1, sizeof(path1), s->location);
-    ff_url_join(hoststr, sizeof(hoststr), NULL, NULL, hostname, port, NULL);
+    ff_url_join(s->hoststr, sizeof(s->hoststr), NULL, NULL, hostname, port, NULL);
 
     if (use_proxy) {
-        av_url_split(NULL, 0, auth, sizeof(auth), hostname, sizeof(hostname), &port,
+        av_url_split(NULL, 0, s->auth, sizeof(s->auth), hostname, sizeof(hostname), &port,
                      NULL, 0, proxy_path);
         path = s->location;
     } else {
@@ -122,36 +148,23 @@ static int http_open_cnx(URLContext *h)
     if (port < 0)
         port = 80;
 
-    ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port, NULL);
-    err = url_open(&hd, buf, URL_RDWR);
-    if (err < 0)
-        goto fail;
+    ff_url_join(s->tcp_url, sizeof(s->tcp_url), "tcp", NULL, hostname, port, NULL);
+    av_strlcpy(s->path, path, sizeof(s->path));
+}
 
-    s->hd = hd;
-    cur_auth_type = s->auth_state.auth_type;
-    if (http_connect(h, path, hoststr, auth, &location_changed) < 0)
-        goto fail;
-    if (s->http_code == 401) {
-        if (cur_auth_type == HTTP_AUTH_NONE && s->auth_state.auth_type != HTTP_AUTH_NONE) {
-            url_close(hd);
-            goto redo;
-        } else
-            goto fail;
-    }
-    if ((s->http_code == 302 || s->http_code == 303) && location_changed == 1) {
-        /* url moved, get next */
-        url_close(hd);
-        if (redirects++ >= MAX_REDIRECTS)
-            return AVERROR(EIO);
-        location_changed = 0;
-        goto redo;
+/* return non zero if error */
+static int http_open_cnx(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    http_resolve_location(s);
+    if (http_request(h, 0, 1) < 0) {
+        if (s->hd)
+            url_close(s->hd);
+        s->hd = NULL;
+        return AVERROR(EIO);
     }
     return 0;
- fail:
-    if (hd)
-        url_close(hd);
-    s->hd = NULL;
-    return AVERROR(EIO);
 }
 
 static int http_open(URLContext *h, const char *uri, int flags)
@@ -161,7 +174,10 @@ static int http_open(URLContext *h, const char *uri, int flags)
     h->is_streamed = 1;
 
     s->filesize = -1;
+    s->end_off  = -1;
     av_strlcpy(s->location, uri, sizeof(s->location));
+    if (s->parallel > 1 && !s->range_size)
+        s->range_size = 1 << 20;
 
     return http_open_cnx(h);
 }
@@ -223,6 +239,9 @@ static int process_line(URLContext *h, char *line, int line_count,
         while (isspace(*p))
             p++;
         s->http_code = strtol(p, &end, 10);
+        /* HTTP/1.0 servers close the connection unless told otherwise */
+        if (!strncmp(line, "HTTP/1.0", 8))
+            s->willclose = 1;
 
         dprintf(NULL, "http_code=%d\n", s->http_code);
 
@@ -248,14 +267,19 @@ static int process_line(URLContext *h, char *line, int line_count,
         if (!strcmp(tag, "Location")) {
             strcpy(s->location, p);
             *new_location = 1;
-        } else if (!strcmp (tag, "Content-Length") && s->filesize == -1) {
-            s->filesize = atoll(p);
+        } else if (!strcmp (tag, "Content-Length")) {
+            if (s->filesize == -1)
+                s->filesize = atoll(p);
+            if (s->end_off == -1)
+                s->end_off = s->off + atoll(p);
         } else if (!strcmp (tag, "Content-Range")) {
             /* "bytes $from-$to/$document_size" */
-            const char *slash;
+            const char *slash, *dash;
             if (!strncmp (p, "bytes ", 6)) {
                 p += 6;
                 s->off = atoll(p);
+                if ((dash = strchr(p, '-')))
+                    s->end_off = atoll(dash+1) + 1;
                 if ((slash = strchr(p, '/')) && strlen(slash) > 0)
                     s->filesize = atoll(slash+1);
             }
@@ -268,8 +292,10 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!strcmp (tag, "Authentication-Info")) {
             ff_http_auth_handle_header(&s->auth_state, tag, p);
         } else if (!strcmp (tag, "Connection")) {
-            if (!strcmp(p, "close"))
+            if (!strcasecmp(p, "close"))
                 s->willclose = 1;
+            else if (!strcasecmp(p, "keep-alive"))
+                s->willclose = 0;
         }
     }
     return 1;
@@ -281,15 +307,13 @@ static inline int has_header(const char *str, const char *header)
     return av_stristart(str, header + 2, NULL) || av_stristr(str, header);
 }
 
-static int http_connect(URLContext *h, const char *path, const char *hoststr,
-                        const char *auth, int *new_location)
+static int http_send_request(URLContext *h, const char *path,
+                             const char *hoststr, const char *auth)
 {
     HTTPContext *s = h->priv_data;
-    int post, err;
-    char line[1024];
+    int post;
     char headers[1024] = "";
     char *authstr = NULL;
-    int64_t off = s->off;
     int len = 0;
 
 
@@ -305,12 +329,19 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     if (!has_header(s->headers, "\r\nAccept: "))
         len += av_strlcpy(headers + len, "Accept: */*\r\n",
                           sizeof(headers) - len);
-    if (!has_header(s->headers, "\r\nRange: "))
-        len += av_strlcatf(headers + len, sizeof(headers) - len,
-                           "Range: bytes=%"PRId64"-\r\n", s->off);
+    if (!has_header(s->headers, "\r\nRange: ")) {
+        if (s->range_size > 0 && !post)
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-%"PRId64"\r\n",
+                               s->off, s->off + s->range_size - 1);
+        else
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-\r\n", s->off);
+    }
     if (!has_header(s->headers, "\r\nConnection: "))
-        len += av_strlcpy(headers + len, "Connection: close\r\n",
-                          sizeof(headers)-len);
+        len += av_strlcatf(headers + len, sizeof(headers) - len,
+                           "Connection: %s\r\n",
+                           s->keepalive && !post ? "keep-alive" : "close");
     if (!has_header(s->headers, "\r\nHost: "))
         len += av_strlcatf(headers + len, sizeof(headers) - len,
                            "Host: %s\r\n", hoststr);
@@ -337,17 +368,22 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     /* init input buffer */
     s->buf_ptr = s->buffer;
     s->buf_end = s->buffer;
+    return 0;
+}
+
+/**
+ * Read the header of the response to the request for the data at off.
+ */
+static int http_read_header(URLContext *h, int64_t off, int *new_location)
+{
+    HTTPContext *s = h->priv_data;
+    char line[1024];
+    int err;
+
     s->line_count = 0;
     s->off = 0;
-    s->filesize = -1;
+    s->end_off = -1;
     s->willclose = 0;
-    if (post) {
-        /* Pretend that it did work. We didn't read any header yet, since
-         * we've still to send the POST data, but the code calling this
-         * function will check http_code after we return. */
-        s->http_code = 200;
-        return 0;
-    }
     s->chunksize = -1;
 
     /* wait for header */
@@ -365,14 +401,262 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
         s->line_count++;
     }
 
-    return (off == s->off) ? 0 : -1;
+    /* redirects and authentication requests do not carry the data */
+    return (off == s->off || s->http_code >= 300) ? 0 : -1;
 }
 
+/**
+ * Check if the response on the current connection has been read entirely
+ * and the connection can carry another request.
+ */
+static int http_reusable(HTTPContext *s)
+{
+    return s->hd && s->keepalive && !s->willclose && s->chunksize < 0 &&
+           s->end_off >= 0 && s->off >= s->end_off &&
+           s->buf_ptr >= s->buf_end;
+}
+
+/**
+ * Read the header of the response to the request for the data at off,
+ * following redirects and authentication requests.
+ * @param redirects number of redirects followed so far
+ * @return 0 on success, 1 if the request has to be sent again, <0 on error
+ */
+static int http_handle_response(URLContext *h, int64_t off, int *redirects)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPAuthType cur_auth_type = s->auth_state.auth_type;
+    int new_location = 0, err;
+
+    if ((err = http_read_header(h, off, &new_location)) < 0)
+        return err;
+    if (s->http_code == 401) {
+        if (cur_auth_type != HTTP_AUTH_NONE ||
+            s->auth_state.auth_type == HTTP_AUTH_NONE)
+            return AVERROR(EIO);
+    } else if ((s->http_code == 302 || s->http_code == 303) && new_location) {
+        /* url moved, get next */
+        if ((*redirects)++ >= MAX_REDIRECTS)
+            return AVERROR(EIO);
+        http_resolve_location(s);
+    } else if (s->http_code >= 300) {
+        return AVERROR(EIO);
+    } else {
+        return 0;
+    }
+    /* the body of this response is not read, so the connection cannot
+     * carry the next request */
+    url_close(s->hd);
+    s->hd = NULL;
+    return 1;
+}
+
+/**
+ * Request the data at off on the current connection if it can be reused,
+ * on a new connection otherwise.
+ * @param read_header 0 to return without waiting for the response
+ */
+static int http_request(URLContext *h, int64_t off, int read_header)
+{
+    HTTPContext *s = h->priv_data;
+    int redirects = 0, err;
+
+    do {
+        if (!http_reusable(s)) {
+            if (s->hd)
+                url_close(s->hd);
+            s->hd = NULL;
+            if (ff_url_open_nested(&s->hd, s->tcp_url, URL_RDWR, h) < 0)
+                return AVERROR(EIO);
+        }
+        s->off = off;
+        if ((err = http_send_request(h, s->path, s->hoststr, s->auth)) < 0)
+            return err;
+        if (h->flags & URL_WRONLY) {
+            /* Pretend that it did work. We didn't read any header yet, since
+             * we've still to send the POST data, but the code calling this
+             * function will check http_code after we return. */
+            s->off = 0;
+            s->filesize = -1;
+            s->willclose = 0;
+            s->http_code = 200;
+            return 0;
+        }
+        /* until the header tells, this is where the response should end */
+        s->end_off = s->range_size > 0 ? off + s->range_size : -1;
+        if (!read_header)
+            return 0;
+        s->filesize = -1;
+    } while ((err = http_handle_response(h, off, &redirects)) > 0);
+    return err;
+}
+
+/**
+ * Exchange the current connection with an idle one.
+ */
+static void http_swap_connection(HTTPContext *s, HTTPConnection *c,
+                                 int pending)
+{
+    HTTPConnection tmp = *c;
+    int len = s->buf_end - s->buf_ptr;
+
+    c->hd         = s->hd;
+    memcpy(c->buffer, s->buf_ptr, len);
+    c->buf_pos    = 0;
+    c->buf_len    = len;
+    c->chunksize  = s->chunksize;
+    c->off        = s->off;
+    c->end_off    = s->end_off;
+    c->willclose  = s->willclose;
+    c->pending    = pending;
+    c->last_use   = s->use_count++;
+
+    s->hd         = tmp.hd;
+    memcpy(s->buffer, tmp.buffer + tmp.buf_pos, tmp.buf_len);
+    s->buf_ptr    = s->buffer;
+    s->buf_end    = s->buffer + tmp.buf_len;
+    s->chunksize  = tmp.chunksize;
+    s->off        = tmp.off;
+    s->end_off    = tmp.end_off;
+    s->willclose  = tmp.willclose;
+}
+
+/**
+ * Find where to put a connection aside, closing the least recently used
+ * one if needed.
+ */
+static HTTPConnection *http_free_connection(HTTPContext *s)
+{
+    HTTPConnection *c = &s->conns[0];
+    int i;
+
+    for (i = 0; i < MAX_CONNECTIONS; i++) {
+        if (!s->conns[i].hd)
+            return &s->conns[i];
+        if (s->conns[i].last_use < c->last_use)
+            c = &s->conns[i];
+    }
+    url_close(c->hd);
+    c->hd = NULL;
+    return c;
+}
+
+/**
+ * Find an idle connection from which the data at off can be read, either
+ * because it is waiting for the response to a request for it or because
+ * it was left shortly before it.
+ */
+static HTTPConnection *http_find_connection(HTTPContext *s, int64_t off)
+{
+    int i;
+
+    for (i = 0; i < MAX_CONNECTIONS; i++) {
+        HTTPConnection *c = &s->conns[i];
+        if (!c->hd)
+            continue;
+        if (c->pending ? c->off == off :
+            c->off <= off && off - c->off <= SHORT_SEEK_SIZE &&
+            (c->end_off < 0 || off < c->end_off))
+            return c;
+    }
+    return NULL;
+}
+
+/**
+ * Make the connection at off the current one, reading the response header
+ * if it was pending.
+ */
+static int http_activate_connection(URLContext *h, HTTPConnection *c)
+{
+    HTTPContext *s = h->priv_data;
+    int64_t off = c->off;
+    int pending = c->pending, redirects = 0, err;
+
+    http_swap_connection(s, c, 0);
+    if (!pending)
+        return 0;
+    if ((err = http_handle_response(h, off, &redirects)) > 0)
+        err = http_request(h, off, 1);
+    return err;
+}
+
+/**
+ * Keep parallel - 1 requests in flight for the ranges following the one
+ * being read.
+ */
+static void http_fill_pipeline(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    int64_t off = s->end_off;
+    int i, j;
+
+    for (i = 1; i < s->parallel && off >= 0 && off < s->filesize;
+         i++, off += s->range_size) {
+        HTTPConnection *c = NULL;
+
+        for (j = 0; j < MAX_CONNECTIONS; j++)
+            if (s->conns[j].hd && s->conns[j].pending &&
+                s->conns[j].off == off)
+                break;
+        if (j < MAX_CONNECTIONS)
+            continue;
+
+        /* prefer a connection whose response has been read entirely */
+        for (j = 0; j < MAX_CONNECTIONS; j++)
+            if (s->conns[j].hd && !s->conns[j].pending &&
+                s->conns[j].end_off >= 0 &&
+                s->conns[j].off >= s->conns[j].end_off &&
+                !s->conns[j].buf_len && !s->conns[j].willclose &&
+                s->conns[j].chunksize < 0)
+                c = &s->conns[j];
+        if (!c)
+            c = http_free_connection(s);
+
+        http_swap_connection(s, c, 0);
+        if (http_request(h, off, 0) < 0) {
+            if (s->hd)
+                url_close(s->hd);
+            s->hd = NULL;
+            http_swap_connection(s, c, 0);
+            c->hd = NULL;
+            return;
+        }
+        http_swap_connection(s, c, 1);
+    }
+}
+
+/**
+ * Continue with the range following the one just read.
+ */
+static int http_next_range(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPConnection *c;
+    int err;
+
+    if ((c = http_find_connection(s, s->off)) && c->pending) {
+        err = http_activate_connection(h, c);
+    } else {
+        err = http_request(h, s->off, 1);
+    }
+    if (err < 0)
+        return err;
+    http_fill_pipeline(h);
+    return 0;
+}
 
 static int http_read(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
-    int len;
+    int len, err;
+
+    if (s->end_off >= 0 && s->off >= s->end_off && s->chunksize < 0 &&
+        !h->is_streamed && s->off < s->filesize) {
+        if ((err = http_next_range(h)) < 0)
+            return err;
+    }
+    if (!s->hd)
+        return AVERROR(EIO);
 
     if (s->chunksize >= 0) {
         if (!s->chunksize) {
@@ -405,6 +689,12 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
     } else {
         if (!s->willclose && s->filesize >= 0 && s->off >= s->filesize)
             return AVERROR_EOF;
+        if (s->end_off >= 0) {
+            /* do not read into whatever follows the response */
+            if (s->off >= s->end_off)
+                return AVERROR_EOF;
+            size = FFMIN(size, s->end_off - s->off);
+        }
         len = url_read(s->hd, buf, size);
     }
     if (len > 0) {
@@ -444,7 +734,7 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
 
 static int http_close(URLContext *h)
 {
-    int ret = 0;
+    int i, ret = 0;
     char footer[] = "0\r\n\r\n";
     HTTPContext *s = h->priv_data;
 
@@ -456,42 +746,89 @@ static int http_close(URLContext *h)
 
     if (s->hd)
         url_close(s->hd);
+    for (i = 0; i < MAX_CONNECTIONS; i++)
+        if (s->conns[i].hd)
+            url_close(s->conns[i].hd);
     return ret;
 }
 
+/**
+ * Read and discard the data up to off if it is close enough after the
+ * current position, in the same response.
+ */
+static int http_skip(URLContext *h, int64_t off)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[BUFFER_SIZE];
+    int len;
+
+    if (!s->hd || off < s->off || off - s->off > SHORT_SEEK_SIZE ||
+        (s->end_off >= 0 && off > s->end_off))
+        return -1;
+    while (s->off < off) {
+        len = http_read(h, buf, FFMIN(off - s->off, sizeof(buf)));
+        if (len <= 0)
+            return -1;
+    }
+    return 0;
+}
+
 static int64_t http_seek(URLContext *h, int64_t off, int whence)
 {
     HTTPContext *s = h->priv_data;
-    URLContext *old_hd = s->hd;
-    int64_t old_off = s->off;
-    uint8_t old_buf[BUFFER_SIZE];
-    int old_buf_size;
+    HTTPConnection *c;
+    int64_t old_off;
 
     if (whence == AVSEEK_SIZE)
         return s->filesize;
     else if ((s->filesize == -1 && whence == SEEK_END) || h->is_streamed)
         return -1;
 
-    /* we save the old context in case the seek fails */
-    old_buf_size = s->buf_end - s->buf_ptr;
-    memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
     if (whence == SEEK_CUR)
         off += s->off;
     else if (whence == SEEK_END)
         off += s->filesize;
-    s->off = off;
+
+    if (off == s->off || !http_skip(h, off))
+        return off;
+
+    /* another connection may already be there, otherwise the current one
+     * is put aside in case the reads come back to it */
+    old_off = s->off;
+    if ((c = http_find_connection(s, off))) {
+        if (http_activate_connection(h, c) >= 0 && !http_skip(h, off)) {
+            http_fill_pipeline(h);
+            return off;
+        }
+        if (s->hd)
+            url_close(s->hd);
+        s->hd = NULL;
+    } else {
+        /* reading the end of a response is cheaper than a new connection */
+        if (s->keepalive && !s->willclose && s->end_off >= 0)
+            http_skip(h, s->end_off);
+        if (!http_reusable(s)) {
+            c = http_free_connection(s);
+            http_swap_connection(s, c, 0);
+        }
+    }
 
     /* if it fails, continue on old connection */
-    if (http_open_cnx(h) < 0) {
-        memcpy(s->buffer, old_buf, old_buf_size);
-        s->buf_ptr = s->buffer;
-        s->buf_end = s->buffer + old_buf_size;
-        s->hd = old_hd;
-        s->off = old_off;
+    if (http_request(h, off, 1) < 0) {
+        if (s->hd)
+            url_close(s->hd);
+        s->hd = NULL;
+        if (c && c->hd) {
+            http_swap_connection(s, c, 0);
+        } else {
+            /* the next read will request the data again */
+            s->off     = old_off;
+            s->end_off = old_off;
+            s->buf_ptr = s->buf_end = s->buffer;
+        }
         return -1;
     }
-    url_close(old_hd);
+    http_fill_pipeline(h);
     return off;
 }
 
@@ -76,6 +76,19 @@ void ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
 
 void ff_read_frame_flush(AVFormatContext *s);
 
+/**
+ * Check the global interrupt callback and the one of the context.
+ * @return non-zero if a blocking operation on h has to be aborted
+ */
+int ff_url_interrupted(URLContext *h);
+
+/**
+ * Open a context for a protocol to use underneath parent, interrupted
+ * along with it.
+ */
+int ff_url_open_nested(URLContext **puc, const char *filename, int flags,
+                       URLContext *parent);
+
 #define NTP_OFFSET 2208988800ULL
 #define NTP_OFFSET_US (NTP_OFFSET * 1000000ULL)
 
@@ -87,6 +87,21 @@ typedef struct {
     unsigned flags;
 } MOVTrackExt;
 
+/**
+ * Position in the sample tables of a track, used instead of a full
+ * AVIndexEntry array when the tables are well formed.
+ */
+typedef struct {
+    unsigned sample;       ///< sample number in the track
+    unsigned chunk;        ///< chunk containing it
+    unsigned chunk_sample; ///< index of the sample in its chunk
+    unsigned stsc_index;
+    unsigned stts_index;
+    unsigned stts_sample;  ///< index of the sample in its stts entry
+    int64_t pos;
+    int64_t dts;
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     ByteIOContext *pb;
     int ffindex;          ///< AVStream index
@@ -107,7 +122,7 @@ typedef struct MOVStreamContext {
     unsigned int sample_count;
     int *sample_sizes;
     unsigned int keyframe_count;
-    int *keyframes;
+    unsigned *keyframes;
     int time_scale;
     int time_offset;      ///< time offset of the first edit list entry
     int current_sample;
@@ -123,6 +138,9 @@ typedef struct MOVStreamContext {
     int width;            ///< tkhd width
     int height;           ///< tkhd height
     int dts_shift;        ///< dts shift when ctts is negative
+    int lazy_index;       ///< samples are read through cursor, st->index_entries is not used
+    MOVSampleCursor cursor;
+    int64_t start_dts;    ///< dts of the first sample
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -229,6 +229,12 @@ typedef struct {
 
     /* byte position of the segment inside the stream */
     int64_t segment_start;
+    /* byte position of the first cluster */
+    int64_t clusters_start;
+    /* position and timestamp of the last cue point, the index is only
+     * complete up to there */
+    int64_t cues_end_pos;
+    int64_t cues_end_time;
 
     /* the packet queue */
     AVPacket **packets;
@@ -240,6 +246,8 @@ typedef struct {
     /* What to skip before effectively reading a packet. */
     int skip_to_keyframe;
     uint64_t skip_to_timecode;
+    /* a possible key frame was met while reading the current cluster */
+    int cluster_has_keyframe;
 } MatroskaDemuxContext;
 
 typedef struct {
@@ -722,6 +730,8 @@ static int matroska_ebmlnum_sint(MatroskaDemuxContext *matroska,
 
 static int ebml_parse_elem(MatroskaDemuxContext *matroska,
                            EbmlSyntax *syntax, void *data);
+static int matroska_block_is_dropped(MatroskaDemuxContext *matroska,
+                                     uint32_t id, uint64_t length);
 
 static int ebml_parse_id(MatroskaDemuxContext *matroska, EbmlSyntax *syntax,
                          uint32_t id, void *data)
@@ -805,7 +815,10 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
     case EBML_FLOAT: res = ebml_read_float (pb, length, data);  break;
     case EBML_STR:
     case EBML_UTF8:  res = ebml_read_ascii (pb, length, data);  break;
-    case EBML_BIN:   res = ebml_read_binary(pb, length, data);  break;
+    case EBML_BIN:   if ((id == MATROSKA_ID_SIMPLEBLOCK || id == MATROSKA_ID_BLOCK)
+                         && matroska_block_is_dropped(matroska, id, length))
+                         return url_fseek(pb,length,SEEK_CUR)<0 ? AVERROR(EIO) : 0;
+                     res = ebml_read_binary(pb, length, data);  break;
     case EBML_NEST:  if ((res=ebml_read_master(matroska, length)) < 0)
                          return res;
                      if (id == MATROSKA_ID_SEGMENT)
@@ -903,6 +916,49 @@ static MatroskaTrack *matroska_find_track_by_num(MatroskaDemuxContext *matroska,
     return NULL;
 }
 
+/*
+ * Peek at the header of the block at the current position to know if
+ * matroska_parse_block() would drop it anyway, so that its data does
+ * not need to be read at all.
+ */
+static int matroska_block_is_dropped(MatroskaDemuxContext *matroska,
+                                     uint32_t id, uint64_t length)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    MatroskaTrack *tracks = matroska->tracks.elem;
+    int64_t pos = url_ftell(pb);
+    uint64_t num;
+    int i, flags = 0, res;
+
+    /* track number, timecode and flags, left to matroska_parse_block() to
+     * complain about if they do not fit */
+    if (length < 4)
+        return 0;
+    res = ebml_read_num(matroska, pb, 8, &num);
+    if (res >= 0 && url_ftell(pb) - pos + 3 <= length) {
+        get_be16(pb);
+        flags = get_byte(pb);
+    } else
+        res = AVERROR_INVALIDDATA;
+    url_fseek(pb, pos, SEEK_SET);
+    if (res < 0)
+        return 0;
+
+    for (i=0; i < matroska->tracks.nb_elem; i++)
+        if (tracks[i].num == num && tracks[i].stream) {
+            if (tracks[i].stream->discard >= AVDISCARD_ALL)
+                return 1;
+            if (!matroska->skip_to_keyframe
+                || tracks[i].type == MATROSKA_TRACK_TYPE_SUBTITLE)
+                return 0;
+            /* whether a Block is a key frame is only known after it */
+            if (id == MATROSKA_ID_BLOCK || flags & 0x80)
+                matroska->cluster_has_keyframe = 1;
+            return !matroska->cluster_has_keyframe;
+        }
+    return 0;
+}
+
 static int matroska_decode_buffer(uint8_t** buf, int* buf_size,
                                   MatroskaTrack *track)
 {
@@ -1201,6 +1257,9 @@ static int matroska_read_header(AVFormatContext *s, AVFormatParameters *ap)
     /* The next thing is a segment. */
     if ((res = ebml_parse(matroska, matroska_segments, matroska)) < 0)
         return res;
+    matroska->clusters_start = url_ftell(s->pb);
+    if (matroska->current_id)
+        matroska->clusters_start -= 4;  /* sizeof the ID which was already read */
     matroska_execute_seekhead(matroska);
 
     if (!matroska->time_scale)
@@ -1505,17 +1564,24 @@ static int matroska_read_header(AVFormatContext *s, AVFormatParameters *ap)
         av_log(matroska->ctx, AV_LOG_WARNING, "Working around broken index.\n");
         index_scale = matroska->time_scale;
     }
+    matroska->cues_end_pos  = matroska->clusters_start;
+    matroska->cues_end_time = INT64_MIN;
     for (i=0; i<index_list->nb_elem; i++) {
         EbmlList *pos_list = &index[i].pos;
         MatroskaIndexPos *pos = pos_list->elem;
         for (j=0; j<pos_list->nb_elem; j++) {
             MatroskaTrack *track = matroska_find_track_by_num(matroska,
                                                               pos[j].track);
-            if (track && track->stream)
+            if (track && track->stream) {
                 av_add_index_entry(track->stream,
                                    pos[j].pos + matroska->segment_start,
                                    index[i].time/index_scale, 0, 0,
                                    AVINDEX_KEYFRAME);
+                if (index[i].time/index_scale > matroska->cues_end_time) {
+                    matroska->cues_end_time = index[i].time/index_scale;
+                    matroska->cues_end_pos  = pos[j].pos + matroska->segment_start;
+                }
+            }
         }
     }
 
@@ -1820,6 +1886,7 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     int i, res;
     int64_t pos = url_ftell(matroska->ctx->pb);
     matroska->prev_pkt = NULL;
+    matroska->cluster_has_keyframe = 0;
     if (matroska->current_id)
         pos -= 4;  /* sizeof the ID which was already read */
     res = ebml_parse(matroska, matroska_clusters, &cluster);
@@ -1852,6 +1919,233 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/*
+ * Read the header of the block at the current position and add an index
+ * entry for it if it is a key frame, the block data itself is not read.
+ */
+static void matroska_skim_block(MatroskaDemuxContext *matroska,
+                                uint64_t cluster_time, int64_t cluster_pos,
+                                int is_keyframe)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    MatroskaTrack *track;
+    int16_t block_time;
+    uint64_t num;
+    int flags;
+
+    if (ebml_read_num(matroska, pb, 8, &num) < 0)
+        return;
+    block_time = get_be16(pb);
+    flags = get_byte(pb);
+    if (is_keyframe == -1)
+        is_keyframe = flags & 0x80;
+
+    /* subtitles are indexed by matroska_parse_block() which knows when
+     * they overlap */
+    track = matroska_find_track_by_num(matroska, num);
+    if (!track || !track->stream || track->stream->discard >= AVDISCARD_ALL
+        || track->type == MATROSKA_TRACK_TYPE_SUBTITLE)
+        return;
+    if (is_keyframe && cluster_time != (uint64_t)-1
+        && (block_time >= 0 || cluster_time >= -block_time))
+        av_add_index_entry(track->stream, cluster_pos, cluster_time + block_time,
+                           0, 0, AVINDEX_KEYFRAME);
+}
+
+/*
+ * Walk the cluster at the current position like matroska_parse_cluster()
+ * but without reading the blocks, only their headers, to index the key
+ * frames it contains. Other top level elements are skipped.
+ * Returns: 0 on success, < 0 at the end of the file or on error
+ */
+static int matroska_skim_cluster(MatroskaDemuxContext *matroska,
+                                 uint64_t *timecode)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    int64_t cluster_pos, end;
+    uint64_t id, length;
+    int res;
+
+    do {
+        cluster_pos = url_ftell(pb);
+        if ((res = ebml_read_num(matroska, pb, 4, &id)) < 0)
+            return res;
+        id |= 1 << 7*res;
+        if ((res = ebml_read_length(matroska, pb, &length)) < 0)
+            return res;
+        if (id != MATROSKA_ID_CLUSTER) {
+            if (length == 0xffffffffffffffULL)
+                return AVERROR_INVALIDDATA;
+            url_fseek(pb, length, SEEK_CUR);
+        }
+    } while (id != MATROSKA_ID_CLUSTER);
+
+    *timecode = -1;
+    end = length == 0xffffffffffffffULL ? INT64_MAX : url_ftell(pb) + length;
+    while (url_ftell(pb) < end && !url_feof(pb)) {
+        int64_t elem_pos = url_ftell(pb), next;
+
+        if ((res = ebml_read_num(matroska, pb, 4, &id)) < 0)
+            break;
+        id |= 1 << 7*res;
+        if (end == INT64_MAX
+            && id != MATROSKA_ID_CLUSTERTIMECODE && id != MATROSKA_ID_BLOCKGROUP
+            && id != MATROSKA_ID_SIMPLEBLOCK && id != MATROSKA_ID_CLUSTERPOSITION
+            && id != MATROSKA_ID_CLUSTERPREVSIZE && id != EBML_ID_VOID
+            && id != EBML_ID_CRC32) {
+            /* end of a cluster of unknown size */
+            url_fseek(pb, elem_pos, SEEK_SET);
+            break;
+        }
+        if ((res = ebml_read_length(matroska, pb, &length)) < 0)
+            return res;
+        next = url_ftell(pb) + length;
+
+        switch (id) {
+        case MATROSKA_ID_CLUSTERTIMECODE:
+            ebml_read_uint(pb, length, timecode);
+            break;
+        case MATROSKA_ID_SIMPLEBLOCK:
+            matroska_skim_block(matroska, *timecode, cluster_pos, -1);
+            break;
+        case MATROSKA_ID_BLOCKGROUP: {
+            int64_t block_pos = -1;
+            int reference = 0;
+
+            while (url_ftell(pb) < next && !url_feof(pb)) {
+                uint64_t sub_id, sub_length;
+
+                if ((res = ebml_read_num(matroska, pb, 4, &sub_id)) < 0)
+                    return res;
+                sub_id |= 1 << 7*res;
+                if ((res = ebml_read_length(matroska, pb, &sub_length)) < 0)
+                    return res;
+                if (sub_id == MATROSKA_ID_BLOCK)
+                    block_pos = url_ftell(pb);
+                else if (sub_id == MATROSKA_ID_BLOCKREFERENCE)
+                    reference = 1;
+                url_fseek(pb, sub_length, SEEK_CUR);
+            }
+            if (block_pos >= 0) {
+                url_fseek(pb, block_pos, SEEK_SET);
+                matroska_skim_block(matroska, *timecode, cluster_pos, !reference);
+            }
+            break;
+        }
+        }
+        url_fseek(pb, next, SEEK_SET);
+    }
+    return 0;
+}
+
+/*
+ * Look for the first cluster starting in [pos, end) and read its timecode,
+ * which is expected to be its first element.
+ * Returns: the position of the cluster, < 0 if none was found
+ */
+static int64_t matroska_find_cluster(MatroskaDemuxContext *matroska,
+                                     int64_t pos, int64_t end,
+                                     uint64_t *timecode)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    uint32_t state = 0;
+    uint64_t length;
+    int64_t cluster_pos;
+    int id;
+
+    url_fseek(pb, pos, SEEK_SET);
+    while (url_ftell(pb) < end + 3 && !url_feof(pb)) {
+        state = (state << 8) | get_byte(pb);
+        if (state != MATROSKA_ID_CLUSTER)
+            continue;
+        cluster_pos = url_ftell(pb) - 4;
+        if (ebml_read_length(matroska, pb, &length) > 0) {
+            id = get_byte(pb);
+            if (id == EBML_ID_CRC32 && get_byte(pb) == 0x84) {
+                url_fseek(pb, 4, SEEK_CUR);
+                id = get_byte(pb);
+            }
+            if (id == MATROSKA_ID_CLUSTERTIMECODE &&
+                ebml_read_num(matroska, pb, 8, &length) > 0 &&
+                !ebml_read_uint(pb, length, timecode) && !url_feof(pb))
+                return cluster_pos;
+        }
+        url_fseek(pb, cluster_pos + 4, SEEK_SET);
+        state = 0;
+    }
+    return -1;
+}
+
+/* below this, scanning the clusters is cheaper than bisecting further */
+#define MATROSKA_BISECT_MIN (64 * 1024)
+
+/*
+ * Bisect [start, end) on the cluster timecodes.
+ * Returns: the position of the last cluster found to start at or before
+ * timestamp, start if there is none
+ */
+static int64_t matroska_bisect_clusters(MatroskaDemuxContext *matroska,
+                                        int64_t start, int64_t end,
+                                        int64_t timestamp)
+{
+    while (end - start > MATROSKA_BISECT_MIN) {
+        int64_t mid = start + (end - start) / 2, pos;
+        uint64_t timecode;
+
+        pos = matroska_find_cluster(matroska, mid, end, &timecode);
+        if (pos < 0 || timecode > timestamp)
+            end = mid;
+        else
+            start = pos;
+    }
+    return start;
+}
+
+/*
+ * Add the key frames around timestamp to the index when the cues are
+ * missing or do not go that far, without reading the whole file.
+ * The clusters skipped by the bisection are not indexed, so this is done
+ * again for every seek past the cues rather than trusting the index.
+ */
+static void matroska_index_clusters(MatroskaDemuxContext *matroska,
+                                    AVStream *st, int64_t timestamp, int flags)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    int64_t start = matroska->cues_end_pos, end = url_fsize(pb);
+    int64_t limit = INT64_MAX, pos;
+    uint64_t timecode;
+    int index;
+
+    if (end <= 0)
+        return;
+
+    for (;;) {
+        pos = matroska_bisect_clusters(matroska, start, end, timestamp);
+        url_fseek(pb, pos, SEEK_SET);
+        while (url_ftell(pb) < limit &&
+               matroska_skim_cluster(matroska, &timecode) >= 0) {
+            if (timecode == (uint64_t)-1 || timecode <= timestamp)
+                continue;
+            if (flags & AVSEEK_FLAG_BACKWARD)
+                break;
+            /* an entry found by an earlier seek further on may skip the
+             * key frames of the clusters in between */
+            index = av_index_search_timestamp(st, timestamp, flags);
+            if (index >= 0 && st->index_entries[index].pos < url_ftell(pb))
+                break;
+        }
+        if (!(flags & AVSEEK_FLAG_BACKWARD) || pos <= start)
+            break;
+        index = av_index_search_timestamp(st, timestamp, flags);
+        if (index >= 0 && st->index_entries[index].pos >= pos)
+            break;
+        /* no key frame of this stream between pos and timestamp,
+         * the one we are looking for is in an earlier cluster */
+        end = limit = pos;
+    }
+    matroska->current_id = 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -1860,21 +2154,14 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     AVStream *st = s->streams[stream_index];
     int i, index, index_sub, index_min;
 
+    if (!url_is_streamed(s->pb) && timestamp > matroska->cues_end_time)
+        matroska_index_clusters(matroska, st, timestamp, flags);
+
+    matroska_clear_queue(matroska);
     if (!st->nb_index_entries)
         return 0;
     timestamp = FFMAX(timestamp, st->index_entries[0].timestamp);
-
-    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
-        url_fseek(s->pb, st->index_entries[st->nb_index_entries-1].pos, SEEK_SET);
-        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
-            matroska_clear_queue(matroska);
-            if (matroska_parse_cluster(matroska) < 0)
-                break;
-        }
-    }
-
-    matroska_clear_queue(matroska);
-    if (index < 0)
+    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0)
         return 0;
 
     index_min = index;
@@ -1891,6 +2178,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     url_fseek(s->pb, st->index_entries[index_min].pos, SEEK_SET);
+    matroska->current_id = 0;
     matroska->skip_to_keyframe = !(flags & AVSEEK_FLAG_ANY);
     matroska->skip_to_timecode = st->index_entries[index].timestamp;
     matroska->done = 0;
@@ -1546,17 +1546,10 @@ static int mov_read_ctts(MOVContext *c, ByteIOContext *pb, MOVAtom atom)
     return 0;
 }
 
-static void mov_build_index(MOVContext *mov, AVStream *st)
+static int64_t mov_get_start_dts(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
-    int64_t current_offset;
     int64_t current_dts = 0;
-    unsigned int stts_index = 0;
-    unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
-    uint64_t stream_size = 0;
 
     /* adjust first dts according to edit list */
     if (sc->time_offset) {
@@ -1569,10 +1562,30 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             st->codec->has_b_frames = 1;
         }
     }
+    return current_dts;
+}
 
-    /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
-          sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
+/* only use old uncompressed audio chunk demuxing when stts specifies it */
+static int mov_use_chunk_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
+           sc->stts_count == 1 && sc->stts_data[0].duration == 1;
+}
+
+static void mov_build_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t current_offset;
+    int64_t current_dts = mov_get_start_dts(mov, st);
+    unsigned int stts_index = 0;
+    unsigned int stsc_index = 0;
+    unsigned int stss_index = 0;
+    unsigned int stps_index = 0;
+    unsigned int i, j;
+    uint64_t stream_size = 0;
+
+    if (!mov_use_chunk_index(st)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
         unsigned int sample_size;
@@ -1724,6 +1737,239 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 }
 
+static int mov_sorted(const unsigned *tab, unsigned count)
+{
+    unsigned i;
+    for (i = 1; i < count; i++)
+        if (tab[i] <= tab[i-1])
+            return 0;
+    return 1;
+}
+
+/** @return index of the first entry of the sorted table not below n */
+static unsigned mov_lower_bound(const unsigned *tab, unsigned count, unsigned n)
+{
+    unsigned a = 0, b = count;
+    while (a < b) {
+        unsigned m = (a + b) >> 1;
+        if (tab[m] < n) a = m + 1;
+        else            b = m;
+    }
+    return a;
+}
+
+/* stss and stps entries are 1-based, but some files start at 0 */
+static unsigned mov_key_offset(MOVStreamContext *sc)
+{
+    return sc->keyframes && sc->keyframes[0] == 1;
+}
+
+static int mov_sample_is_keyframe(MOVStreamContext *sc, unsigned sample)
+{
+    unsigned n = sample + mov_key_offset(sc), i;
+
+    if (!sc->keyframe_count)
+        return 1;
+    i = mov_lower_bound(sc->keyframes, sc->keyframe_count, n);
+    if (i < sc->keyframe_count && sc->keyframes[i] == n)
+        return 1;
+    i = mov_lower_bound(sc->stps_data, sc->stps_count, n);
+    return i < sc->stps_count && sc->stps_data[i] == n;
+}
+
+/**
+ * Find the closest key frame before (dir < 0) or after (dir > 0) a sample.
+ * @return sample number, -1 if there is none
+ */
+static int64_t mov_find_keyframe(MOVStreamContext *sc, unsigned sample, int dir)
+{
+    const unsigned *tab[2] = { sc->keyframes, sc->stps_data };
+    unsigned count[2] = { sc->keyframe_count, sc->stps_count };
+    unsigned n = sample + mov_key_offset(sc);
+    int64_t best = -1;
+    int t;
+
+    if (!sc->keyframe_count)
+        return sample;
+    for (t = 0; t < 2; t++) {
+        unsigned i = mov_lower_bound(tab[t], count[t], n + (dir < 0));
+        int64_t key;
+        if (dir < 0) {
+            if (!i)
+                continue;
+            key = (int64_t)tab[t][i-1] - mov_key_offset(sc);
+            if (key >= 0 && key > best)
+                best = key;
+        } else {
+            if (i == count[t])
+                continue;
+            key = (int64_t)tab[t][i] - mov_key_offset(sc);
+            if (key < sc->sample_count && (best < 0 || key < best))
+                best = key;
+        }
+    }
+    return best;
+}
+
+/**
+ * Place the cursor on a sample, walking the run-length coded tables.
+ */
+static void mov_cursor_seek(MOVStreamContext *sc, unsigned sample)
+{
+    MOVSampleCursor *c = &sc->cursor;
+    uint64_t first = 0;
+    int64_t dts = sc->start_dts;
+    unsigned i, j;
+
+    if (sample > sc->sample_count)
+        sample = sc->sample_count;
+    c->sample = sample;
+
+    c->stts_index = c->stts_sample = 0;
+    for (i = 0; i < sc->stts_count; i++) {
+        c->stts_index  = i;
+        c->stts_sample = sample - first;
+        /* the last entry applies to all the remaining samples */
+        if (i + 1 == sc->stts_count || sample < first + sc->stts_data[i].count)
+            break;
+        dts   += (int64_t)sc->stts_data[i].count * sc->stts_data[i].duration;
+        first += sc->stts_data[i].count;
+    }
+    c->dts = dts + (int64_t)c->stts_sample * sc->stts_data[c->stts_index].duration;
+
+    first = 0;
+    for (i = 0; i < sc->stsc_count; i++) {
+        unsigned last = i + 1 < sc->stsc_count ? sc->stsc_data[i+1].first - 1 : sc->chunk_count;
+        uint64_t samples = (uint64_t)(last - sc->stsc_data[i].first + 1) * sc->stsc_data[i].count;
+        if (i + 1 == sc->stsc_count || sample < first + samples) {
+            c->stsc_index   = i;
+            c->chunk        = sc->stsc_data[i].first - 1 + (sample - first) / sc->stsc_data[i].count;
+            c->chunk_sample = (sample - first) % sc->stsc_data[i].count;
+            break;
+        }
+        first += samples;
+    }
+
+    if (c->chunk >= sc->chunk_count)
+        return;
+    c->pos = sc->chunk_offsets[c->chunk];
+    if (sc->sample_size > 0)
+        c->pos += (int64_t)c->chunk_sample * sc->sample_size;
+    else
+        for (j = sample - c->chunk_sample; j < sample; j++)
+            c->pos += sc->sample_sizes[j];
+}
+
+static void mov_cursor_next(MOVStreamContext *sc)
+{
+    MOVSampleCursor *c = &sc->cursor;
+
+    c->pos += sc->sample_size > 0 ? sc->sample_size : sc->sample_sizes[c->sample];
+    c->dts += sc->stts_data[c->stts_index].duration;
+    if (c->stts_index + 1 < sc->stts_count &&
+        ++c->stts_sample == sc->stts_data[c->stts_index].count) {
+        c->stts_index++;
+        c->stts_sample = 0;
+    }
+    c->sample++;
+    if (++c->chunk_sample == sc->stsc_data[c->stsc_index].count) {
+        c->chunk_sample = 0;
+        c->chunk++;
+        if (c->stsc_index + 1 < sc->stsc_count &&
+            c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+            c->stsc_index++;
+        if (c->chunk < sc->chunk_count)
+            c->pos = sc->chunk_offsets[c->chunk];
+    }
+}
+
+/**
+ * Get the sample at the current position of a stream.
+ * @return 0 if there is none left
+ */
+static int mov_get_current_sample(AVStream *st, AVIndexEntry *e)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVSampleCursor *c = &sc->cursor;
+
+    if (!sc->lazy_index) {
+        if (sc->current_sample >= st->nb_index_entries)
+            return 0;
+        *e = st->index_entries[sc->current_sample];
+        return 1;
+    }
+    if (c->sample >= sc->sample_count || c->chunk >= sc->chunk_count)
+        return 0;
+    e->pos          = c->pos;
+    e->timestamp    = c->dts;
+    e->size         = sc->sample_size > 0 ? sc->sample_size : sc->sample_sizes[c->sample];
+    e->flags        = mov_sample_is_keyframe(sc, c->sample) ? AVINDEX_KEYFRAME : 0;
+    e->min_distance = 0;
+    return 1;
+}
+
+/**
+ * Use the sample tables directly instead of building an AVIndexEntry per
+ * sample, which takes time and memory proportional to the duration.
+ * Only done for tables whose entries are well formed, the others go
+ * through mov_build_index() which copes with more broken files.
+ * @return <0 if the index has to be built
+ */
+static int mov_init_lazy_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t samples = 0, stream_size = 0;
+    unsigned i;
+
+    if (mov_use_chunk_index(st) || !sc->chunk_count || !sc->sample_count ||
+        (!sc->sample_size && !sc->sample_sizes) ||
+        !mov_sorted(sc->keyframes, sc->keyframe_count) ||
+        !mov_sorted(sc->stps_data, sc->stps_count) ||
+        sc->stsc_data[0].first != 1)
+        return -1;
+    for (i = 0; i < sc->stts_count; i++)
+        /* av_add_index_entry() merges samples with the same dts */
+        if (!sc->stts_data[i].count || sc->stts_data[i].duration <= 0)
+            return -1;
+    for (i = 0; i < sc->stsc_count; i++) {
+        unsigned last = i + 1 < sc->stsc_count ? sc->stsc_data[i+1].first - 1 : sc->chunk_count;
+        if (!sc->stsc_data[i].count || last < sc->stsc_data[i].first ||
+            last > sc->chunk_count ||
+            (sc->pseudo_stream_id != -1 &&
+             sc->stsc_data[i].id - 1 != sc->pseudo_stream_id))
+            return -1;
+        samples += (uint64_t)(last - sc->stsc_data[i].first + 1) * sc->stsc_data[i].count;
+    }
+    if (samples < sc->sample_count)
+        sc->sample_count = samples;
+
+    if (sc->sample_size > 0)
+        stream_size = (uint64_t)sc->sample_size * sc->sample_count;
+    else
+        for (i = 0; i < sc->sample_count; i++)
+            stream_size += sc->sample_sizes[i];
+    if (st->duration > 0)
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    sc->start_dts  = mov_get_start_dts(mov, st) - sc->dts_shift;
+    sc->lazy_index = 1;
+    mov_cursor_seek(sc, 0);
+    return 0;
+}
+
+/* Fill st->index_entries for code that needs all samples at once, the
+ * next sample to read stays the same. */
+static void mov_build_lazy_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->lazy_index)
+        return;
+    sc->lazy_index = 0;
+    mov_build_index(mov, st);
+    sc->current_sample = sc->cursor.sample;
+}
+
 static int mov_open_dref(ByteIOContext **pb, char *src, MOVDref *ref)
 {
     /* try relative path, we do not try the absolute because it can leak information about our
@@ -1809,7 +2055,8 @@ static int mov_read_trak(MOVContext *c, ByteIOContext *pb, MOVAtom atom)
         dprintf(c->fc, "frame size %d\n", st->codec->frame_size);
     }
 
-    mov_build_index(c, st);
+    if (mov_init_lazy_index(c, st) < 0)
+        mov_build_index(c, st);
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -1852,12 +2099,14 @@ static int mov_read_trak(MOVContext *c, ByteIOContext *pb, MOVAtom atom)
     }
 
     /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+    }
 
     return 0;
 }
@@ -2054,6 +2303,8 @@ static int mov_read_trun(MOVContext *c, ByteIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id)
         return 0;
+    /* the fragment samples are appended to the index entries */
+    mov_build_lazy_index(c, st);
     get_byte(pb); /* version */
     flags = get_be24(pb);
     entries = get_be32(pb);
@@ -2338,6 +2589,7 @@ static void mov_read_chapters(AVFormatContext *s)
     st->discard = AVDISCARD_ALL;
     sc = st->priv_data;
     cur_pos = url_ftell(sc->pb);
+    mov_build_lazy_index(mov, st);
 
     for (i = 0; i < st->nb_index_entries; i++) {
         AVIndexEntry *sample = &st->index_entries[i];
@@ -2413,7 +2665,8 @@ static int mov_read_header(AVFormatContext *s, AVFormatParameters *ap)
     return 0;
 }
 
-static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
+static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st,
+                                          AVIndexEntry *buf)
 {
     AVIndexEntry *sample = NULL;
     int64_t best_dts = INT64_MAX;
@@ -2421,8 +2674,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample = sample == &buf[0] ? &buf[1] : &buf[0];
+        if (msc->pb && mov_get_current_sample(avst, current_sample)) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             dprintf(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (url_is_streamed(s->pb) && current_sample->pos < sample->pos) ||
@@ -2443,11 +2696,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, buf[2];
     AVStream *st = NULL;
     int ret;
  retry:
-    sample = mov_find_next_sample(s, &st);
+    sample = mov_find_next_sample(s, &st, buf);
     if (!sample) {
         mov->found_mdat = 0;
         if (!url_is_streamed(s->pb) ||
@@ -2459,7 +2712,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     }
     sc = st->priv_data;
     /* must be done just before reading, to avoid infinite loop on sample */
-    sc->current_sample++;
+    if (sc->lazy_index) {
+        mov_cursor_next(sc);
+        sc->current_sample = sc->cursor.sample;
+    } else
+        sc->current_sample++;
 
     if (st->discard != AVDISCARD_ALL) {
         if (url_fseek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
@@ -2496,8 +2753,9 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        AVIndexEntry next;
+        int64_t next_dts = mov_get_current_sample(st, &next) ?
+            next.timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -2510,19 +2768,71 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Search the sample tables of a lazily indexed stream like
+ * av_index_search_timestamp() does with the index entries.
+ */
+static int64_t mov_search_sample(MOVStreamContext *sc, int64_t timestamp, int flags)
+{
+    int64_t dts = sc->start_dts, sample = 0;
+    uint64_t first = 0;
+    unsigned i;
+
+    if (timestamp < dts) {
+        if (flags & AVSEEK_FLAG_BACKWARD)
+            return -1;
+        sample = 0;
+    } else {
+        /* last sample with a dts not above timestamp */
+        for (i = 0; i < sc->stts_count; i++) {
+            int64_t end = dts + (int64_t)sc->stts_data[i].count * sc->stts_data[i].duration;
+            if (i + 1 == sc->stts_count || timestamp < end) {
+                int64_t n = sc->stts_data[i].duration ?
+                            (timestamp - dts) / sc->stts_data[i].duration : 0;
+                if (i + 1 < sc->stts_count)
+                    n = FFMIN(n, sc->stts_data[i].count - 1);
+                sample = first + n;
+                dts   += n * sc->stts_data[i].duration;
+                break;
+            }
+            dts    = end;
+            first += sc->stts_data[i].count;
+        }
+        if (sample >= sc->sample_count) {
+            if (!(flags & AVSEEK_FLAG_BACKWARD))
+                return -1;
+            sample = sc->sample_count - 1;
+        } else if (dts < timestamp && !(flags & AVSEEK_FLAG_BACKWARD))
+            sample++;
+        if (sample >= sc->sample_count)
+            return -1;
+    }
+    if (flags & AVSEEK_FLAG_ANY)
+        return sample;
+    return mov_find_keyframe(sc, sample, flags & AVSEEK_FLAG_BACKWARD ? -1 : 1);
+}
+
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy_index) {
+        sample = mov_search_sample(sc, timestamp, flags);
+        if (sample < 0 && sc->sample_count && timestamp < sc->start_dts)
+            sample = 0;
+    } else {
+        sample = av_index_search_timestamp(st, timestamp, flags);
+        if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+            sample = 0;
+    }
     dprintf(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
-        sample = 0;
     if (sample < 0) /* not sure what to do */
         return -1;
     sc->current_sample = sample;
+    if (sc->lazy_index)
+        mov_cursor_seek(sc, sample);
     dprintf(s, "stream %d, found sample %d\n", st->index, sc->current_sample);
     /* adjust ctts index */
     if (sc->ctts_data) {
@@ -2558,7 +2868,10 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return -1;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    if (((MOVStreamContext *)st->priv_data)->lazy_index)
+        seek_timestamp = ((MOVStreamContext *)st->priv_data)->cursor.dts;
+    else
+        seek_timestamp = st->index_entries[sample].timestamp;
 
     for (i = 0; i < s->nb_streams; i++) {
         st = s->streams[i];
@@ -2581,6 +2894,12 @@ static int mov_read_close(AVFormatContext *s)
         MOVStreamContext *sc = st->priv_data;
 
         av_freep(&sc->ctts_data);
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
         for (j = 0; j < sc->drefs_count; j++) {
             av_freep(&sc->drefs[j].path);
             av_freep(&sc->drefs[j].dir);
@@ -53,7 +53,8 @@ static int mov_write_stco_tag(ByteIOContext *pb, MOVTrack *track)
     int mode64 = 0; //   use 32 bit size variant if possible
     int64_t pos = url_ftell(pb);
     put_be32(pb, 0); /* size */
-    if (pos > UINT32_MAX) {
+    /* the moov is not necessarily after the samples, look at the last one */
+    if (track->entry && track->cluster[track->entry-1].pos > UINT32_MAX) {
         mode64 = 1;
         put_tag(pb, "co64");
     } else
@@ -88,7 +89,7 @@ static int mov_write_stsz_tag(ByteIOContext *pb, MOVTrack *track)
         oldtst = tst;
         entries += track->cluster[i].entries;
     }
-    if (equalChunks) {
+    if (equalChunks && track->entry) {
         int sSize = track->cluster[0].size/track->cluster[0].entries;
         put_be32(pb, sSize); // sample size
         put_be32(pb, entries); // sample count
@@ -901,6 +902,22 @@ static int mov_write_ctts_tag(ByteIOContext *pb, MOVTrack *track)
     return atom_size;
 }
 
+static int64_t mov_get_sample_duration(MOVTrack *track, int i)
+{
+    int64_t duration;
+
+    if (i + 1 < track->entry)
+        return track->cluster[i+1].dts - track->cluster[i].dts;
+    /* readjusting */
+    duration = track->trackDuration - track->cluster[i].dts + track->start_dts;
+    /* the packet duration was unknown, and the next sample is not there yet
+     * in a fragment which is not cut on this track */
+    if (duration <= 0)
+        duration = i ? track->cluster[i].dts - track->cluster[i-1].dts
+                     : track->frag_last_duration;
+    return FFMAX(duration, 0);
+}
+
 /* Time to sample atom */
 static int mov_write_stts_tag(ByteIOContext *pb, MOVTrack *track)
 {
@@ -909,7 +926,7 @@ static int mov_write_stts_tag(ByteIOContext *pb, MOVTrack *track)
     uint32_t atom_size;
     int i;
 
-    if (track->enc->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
+    if (track->enc->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr && track->entry) {
         stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
         stts_entries[0].count = track->sampleCount;
         stts_entries[0].duration = 1;
@@ -917,9 +934,7 @@ static int mov_write_stts_tag(ByteIOContext *pb, MOVTrack *track)
     } else {
         stts_entries = av_malloc(track->entry * sizeof(*stts_entries)); /* worst case */
         for (i=0; i<track->entry; i++) {
-            int64_t duration = i + 1 == track->entry ?
-                track->trackDuration - track->cluster[i].dts + track->cluster[0].dts : /* readjusting */
-                track->cluster[i+1].dts - track->cluster[i].dts;
+            int64_t duration = mov_get_sample_duration(track, i);
             if (i && duration == stts_entries[entries].duration) {
                 stts_entries[entries].count++; /* compress */
             } else {
@@ -1318,7 +1333,7 @@ static int mov_write_mvhd_tag(ByteIOContext *pb, MOVMuxContext *mov)
     int version;
 
     for (i=0; i<mov->nb_streams; i++) {
-        if(mov->tracks[i].entry > 0) {
+        if(mov->tracks[i].entry > 0 || mov->fragmented) {
             maxTrackLenTemp = av_rescale_rnd(mov->tracks[i].trackDuration,
                                              MOV_TIMESCALE,
                                              mov->tracks[i].timescale,
@@ -1687,6 +1702,30 @@ static int mov_write_uuidusmt_tag(ByteIOContext *pb, AVFormatContext *s)
     return 0;
 }
 
+static int mov_write_trex_tag(ByteIOContext *pb, MOVTrack *track)
+{
+    put_be32(pb, 0x20); /* size */
+    put_tag(pb, "trex");
+    put_be32(pb, 0); /* version & flags */
+    put_be32(pb, track->trackID);
+    put_be32(pb, 1); /* default sample description index */
+    put_be32(pb, 0); /* default sample duration */
+    put_be32(pb, 0); /* default sample size */
+    put_be32(pb, 0); /* default sample flags */
+    return 0x20;
+}
+
+static int mov_write_mvex_tag(ByteIOContext *pb, MOVMuxContext *mov)
+{
+    int i;
+    int64_t pos = url_ftell(pb);
+    put_be32(pb, 0); /* size */
+    put_tag(pb, "mvex");
+    for (i = 0; i < mov->nb_streams; i++)
+        mov_write_trex_tag(pb, &mov->tracks[i]);
+    return updateSize(pb, pos);
+}
+
 static int mov_write_moov_tag(ByteIOContext *pb, MOVMuxContext *mov,
                               AVFormatContext *s)
 {
@@ -1696,7 +1735,7 @@ static int mov_write_moov_tag(ByteIOContext *pb, MOVMuxContext *mov,
     put_tag(pb, "moov");
 
     for (i=0; i<mov->nb_streams; i++) {
-        if(mov->tracks[i].entry <= 0) continue;
+        if(mov->tracks[i].entry <= 0 && !mov->fragmented) continue;
 
         mov->tracks[i].time = mov->time;
         mov->tracks[i].trackID = i+1;
@@ -1718,10 +1757,14 @@ static int mov_write_moov_tag(ByteIOContext *pb, MOVMuxContext *mov,
     mov_write_mvhd_tag(pb, mov);
     //mov_write_iods_tag(pb, mov);
     for (i=0; i<mov->nb_streams; i++) {
-        if(mov->tracks[i].entry > 0) {
+        /* fragmented files have every track, with the samples of the first
+         * fragment if any */
+        if(mov->tracks[i].entry > 0 || mov->fragmented) {
             mov_write_trak_tag(pb, &(mov->tracks[i]), i < s->nb_streams ? s->streams[i] : NULL);
         }
     }
+    if (mov->fragmented)
+        mov_write_mvex_tag(pb, mov);
 
     if (mov->mode == MODE_PSP)
         mov_write_uuidusmt_tag(pb, s);
@@ -1860,6 +1903,280 @@ static void mov_write_uuidprof_tag(ByteIOContext *pb, AVFormatContext *s)
     put_be32(pb, 0x010001); /* ? */
 }
 
+#define MOV_FRAG_SAMPLE_FLAG_DEPENDS_NO  0x02000000
+#define MOV_FRAG_SAMPLE_FLAG_DEPENDS_YES 0x01000000
+#define MOV_FRAG_SAMPLE_FLAG_NON_SYNC    0x00010000
+
+static uint32_t mov_get_sample_flags(MOVIentry *entry)
+{
+    return entry->flags & MOV_SYNC_SAMPLE ? MOV_FRAG_SAMPLE_FLAG_DEPENDS_NO :
+           MOV_FRAG_SAMPLE_FLAG_DEPENDS_YES | MOV_FRAG_SAMPLE_FLAG_NON_SYNC;
+}
+
+static int mov_write_tfhd_tag(ByteIOContext *pb, MOVTrack *track, int64_t offset)
+{
+    put_be32(pb, 28); /* size */
+    put_tag(pb, "tfhd");
+    put_byte(pb, 0); /* version */
+    put_be24(pb, 0x21); /* flags: base data offset, default sample flags */
+    put_be32(pb, track->trackID);
+    put_be64(pb, offset); /* base data offset */
+    put_be32(pb, mov_get_sample_flags(&track->cluster[track->entry > 1]));
+    return 28;
+}
+
+static int mov_write_tfdt_tag(ByteIOContext *pb, MOVTrack *track)
+{
+    put_be32(pb, 20); /* size */
+    put_tag(pb, "tfdt");
+    put_byte(pb, 1); /* version */
+    put_be24(pb, 0); /* flags */
+    put_be64(pb, track->cluster[0].dts - track->start_dts); /* base media decode time */
+    return 20;
+}
+
+static int mov_write_trun_tag(ByteIOContext *pb, MOVTrack *track)
+{
+    int64_t pos = url_ftell(pb);
+    uint32_t flags = 0x300; /* sample duration and size present */
+    int i;
+
+    /* the default sample flags of the tfhd are those of the second sample,
+     * per sample flags are only needed if the others do not all match */
+    for (i = 2; i < track->entry; i++)
+        if (mov_get_sample_flags(&track->cluster[i]) !=
+            mov_get_sample_flags(&track->cluster[1]))
+            break;
+    if (i < track->entry)
+        flags |= 0x400; /* sample flags present */
+    else
+        flags |= 0x004; /* first sample flags present */
+    if (track->flags & MOV_TRACK_CTTS)
+        flags |= 0x800;
+
+    put_be32(pb, 0); /* size */
+    put_tag(pb, "trun");
+    put_byte(pb, 0); /* version */
+    put_be24(pb, flags);
+    put_be32(pb, track->entry); /* sample count */
+    if (flags & 0x004)
+        put_be32(pb, mov_get_sample_flags(&track->cluster[0]));
+    for (i = 0; i < track->entry; i++) {
+        put_be32(pb, mov_get_sample_duration(track, i));
+        put_be32(pb, track->cluster[i].size);
+        if (flags & 0x400)
+            put_be32(pb, mov_get_sample_flags(&track->cluster[i]));
+        if (flags & 0x800)
+            put_be32(pb, track->cluster[i].cts);
+    }
+    return updateSize(pb, pos);
+}
+
+static int mov_write_traf_tag(ByteIOContext *pb, MOVTrack *track, int64_t offset)
+{
+    int64_t pos = url_ftell(pb);
+    put_be32(pb, 0); /* size */
+    put_tag(pb, "traf");
+    mov_write_tfhd_tag(pb, track, offset);
+    mov_write_tfdt_tag(pb, track);
+    mov_write_trun_tag(pb, track);
+    return updateSize(pb, pos);
+}
+
+/**
+ * Write the moof describing the buffered samples, the data of each track
+ * follows the one of the previous track in the mdat starting at offset.
+ */
+static int mov_write_moof_tag(ByteIOContext *pb, MOVMuxContext *mov, int64_t offset)
+{
+    int64_t pos = url_ftell(pb);
+    int i;
+
+    put_be32(pb, 0); /* size */
+    put_tag(pb, "moof");
+    put_be32(pb, 16); /* size */
+    put_tag(pb, "mfhd");
+    put_be32(pb, 0); /* version & flags */
+    put_be32(pb, mov->fragments + 1); /* sequence number */
+
+    for (i = 0; i < mov->nb_streams; i++) {
+        MOVTrack *track = &mov->tracks[i];
+        if (!track->entry)
+            continue;
+        mov_write_traf_tag(pb, track, offset);
+        offset += url_ftell(track->mdat_buf);
+    }
+    return updateSize(pb, pos);
+}
+
+static int mov_write_tfra_tag(ByteIOContext *pb, MOVTrack *track)
+{
+    int size = 24 + 19 * track->frag_info_count;
+    int i;
+
+    put_be32(pb, size);
+    put_tag(pb, "tfra");
+    put_byte(pb, 1); /* version */
+    put_be24(pb, 0); /* flags */
+    put_be32(pb, track->trackID);
+    put_be32(pb, 0); /* traf, trun and sample numbers are coded on one byte */
+    put_be32(pb, track->frag_info_count);
+    for (i = 0; i < track->frag_info_count; i++) {
+        put_be64(pb, track->frag_info[i].time);
+        put_be64(pb, track->frag_info[i].offset);
+        put_byte(pb, track->frag_info[i].traf);
+        put_byte(pb, 1); /* trun number */
+        put_byte(pb, 1); /* sample number */
+    }
+    return size;
+}
+
+/* written without seeking back, the output may be streamed */
+static int mov_write_mfra_tag(ByteIOContext *pb, MOVMuxContext *mov)
+{
+    int size = 8 + 16, i;
+
+    for (i = 0; i < mov->nb_streams; i++)
+        if (mov->tracks[i].frag_info_count)
+            size += 24 + 19 * mov->tracks[i].frag_info_count;
+
+    put_be32(pb, size);
+    put_tag(pb, "mfra");
+    for (i = 0; i < mov->nb_streams; i++)
+        if (mov->tracks[i].frag_info_count)
+            mov_write_tfra_tag(pb, &mov->tracks[i]);
+
+    put_be32(pb, 16); /* size */
+    put_tag(pb, "mfro");
+    put_be32(pb, 0); /* version & flags */
+    put_be32(pb, size);
+    return size;
+}
+
+/**
+ * Write the buffered samples of all tracks after the moov for the first
+ * fragment, like in unfragmented files, and as one moof and mdat for the
+ * next ones. The atoms are assembled in dynamic buffers since their sizes
+ * are rewritten by seeking back, which is not possible on streamed output.
+ */
+static int mov_flush_fragment(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    ByteIOContext *pb = s->pb, *moof_buf;
+    int64_t moof_pos, mdat_size = 0;
+    int i, j, size, traf = 0;
+    uint8_t *buf;
+
+    for (i = 0; i < mov->nb_streams; i++)
+        if (mov->tracks[i].entry)
+            mdat_size += url_ftell(mov->tracks[i].mdat_buf);
+
+    if (!mov->moov_written) {
+        int64_t offset;
+
+        /* the chunk offsets point after the moov, measure it first */
+        if (url_open_dyn_buf(&moof_buf) < 0)
+            return AVERROR(ENOMEM);
+        mov_write_moov_tag(moof_buf, mov, s);
+        size = url_close_dyn_buf(moof_buf, &buf);
+        av_free(buf);
+
+        offset = url_ftell(pb) + size + 8;
+        for (i = 0; i < mov->nb_streams; i++) {
+            MOVTrack *track = &mov->tracks[i];
+            if (!track->entry)
+                continue;
+            for (j = 0; j < track->entry; j++)
+                track->cluster[j].pos += offset;
+            offset += url_ftell(track->mdat_buf);
+        }
+
+        if (url_open_dyn_buf(&moof_buf) < 0)
+            return AVERROR(ENOMEM);
+        mov_write_moov_tag(moof_buf, mov, s);
+        size = url_close_dyn_buf(moof_buf, &buf);
+        put_buffer(pb, buf, size);
+        av_free(buf);
+        mov->moov_written = 1;
+
+        if (mdat_size) {
+            put_be32(pb, mdat_size + 8);
+            put_tag(pb, "mdat");
+        }
+        for (i = 0; i < mov->nb_streams; i++) {
+            MOVTrack *track = &mov->tracks[i];
+            if (!track->entry)
+                continue;
+            size = url_close_dyn_buf(track->mdat_buf, &buf);
+            track->mdat_buf = NULL;
+            put_buffer(pb, buf, size);
+            av_free(buf);
+            track->frag_last_duration = mov_get_sample_duration(track, track->entry - 1);
+            track->entry = 0;
+        }
+        put_flush_packet(pb);
+        return 0;
+    }
+
+    if (!mdat_size) {
+        put_flush_packet(pb);
+        return 0;
+    }
+
+    /* the data offsets depend on the size of the moof, measure it first */
+    if (url_open_dyn_buf(&moof_buf) < 0)
+        return AVERROR(ENOMEM);
+    mov_write_moof_tag(moof_buf, mov, 0);
+    size = url_close_dyn_buf(moof_buf, &buf);
+    av_free(buf);
+
+    moof_pos = url_ftell(pb);
+    if (url_open_dyn_buf(&moof_buf) < 0)
+        return AVERROR(ENOMEM);
+    mov_write_moof_tag(moof_buf, mov, moof_pos + size +
+                       (mdat_size + 8 <= UINT32_MAX ? 8 : 16));
+    size = url_close_dyn_buf(moof_buf, &buf);
+    put_buffer(pb, buf, size);
+    av_free(buf);
+
+    if (mdat_size + 8 <= UINT32_MAX) {
+        put_be32(pb, mdat_size + 8);
+        put_tag(pb, "mdat");
+    } else {
+        put_be32(pb, 1); /* special value: real atom size will be 64 bit value after tag field */
+        put_tag(pb, "mdat");
+        put_be64(pb, mdat_size + 16);
+    }
+
+    for (i = 0; i < mov->nb_streams; i++) {
+        MOVTrack *track = &mov->tracks[i];
+        if (!track->entry)
+            continue;
+        traf++;
+        if (track->cluster[0].flags & MOV_SYNC_SAMPLE) {
+            MOVFragmentInfo *info = av_realloc(track->frag_info,
+                                               (track->frag_info_count + 1) * sizeof(*info));
+            if (!info)
+                return AVERROR(ENOMEM);
+            track->frag_info = info;
+            info += track->frag_info_count++;
+            info->time   = track->cluster[0].dts - track->start_dts;
+            info->offset = moof_pos;
+            info->traf   = traf;
+        }
+        size = url_close_dyn_buf(track->mdat_buf, &buf);
+        track->mdat_buf = NULL;
+        put_buffer(pb, buf, size);
+        av_free(buf);
+        track->frag_last_duration = mov_get_sample_duration(track, track->entry - 1);
+        track->entry = 0;
+    }
+    mov->fragments++;
+
+    put_flush_packet(pb);
+    return 0;
+}
+
 static int mov_parse_mpeg2_frame(AVPacket *pkt, uint32_t *flags)
 {
     uint32_t c = -1;
@@ -1888,11 +2205,27 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     MOVTrack *trk = &mov->tracks[pkt->stream_index];
     AVCodecContext *enc = trk->enc;
     unsigned int samplesInChunk = 0;
-    int size= pkt->size;
+    int size= pkt->size, ret;
 
-    if (url_is_streamed(s->pb)) return 0; /* Can't handle that */
+    if (url_is_streamed(s->pb) && !mov->fragmented) return 0; /* Can't handle that */
     if (!size) return 0; /* Discard 0 sized packets */
 
+    if (mov->fragmented) {
+        /* start a new fragment at a key frame of the reference track once
+         * enough is buffered, or when the sample index of a track is full */
+        if ((pkt->stream_index == mov->frag_track && pkt->flags & AV_PKT_FLAG_KEY && trk->entry &&
+             av_rescale(pkt->dts - trk->cluster[0].dts, AV_TIME_BASE, trk->timescale) >= s->fragment_duration) ||
+            trk->entry >= MOV_INDEX_CLUSTER_SIZE) {
+            /* the duration of the last sample is known exactly here */
+            trk->trackDuration = pkt->dts - trk->start_dts;
+            if ((ret = mov_flush_fragment(s)) < 0)
+                return ret;
+        }
+        if (!trk->mdat_buf && url_open_dyn_buf(&trk->mdat_buf) < 0)
+            return AVERROR(ENOMEM);
+        pb = trk->mdat_buf;
+    }
+
     if (enc->codec_id == CODEC_ID_AMR_NB) {
         /* We must find out how many AMR blocks there are in one packet */
         static uint16_t packed_size[16] =
@@ -1948,7 +2281,9 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     trk->cluster[trk->entry].size = size;
     trk->cluster[trk->entry].entries = samplesInChunk;
     trk->cluster[trk->entry].dts = pkt->dts;
-    trk->trackDuration = pkt->dts - trk->cluster[0].dts + pkt->duration;
+    if (trk->start_dts == AV_NOPTS_VALUE)
+        trk->start_dts = pkt->dts;
+    trk->trackDuration = pkt->dts - trk->start_dts + pkt->duration;
 
     if (pkt->pts == AV_NOPTS_VALUE) {
         av_log(s, AV_LOG_WARNING, "pts has no value\n");
@@ -2021,8 +2356,14 @@ static int mov_write_header(AVFormatContext *s)
     MOVMuxContext *mov = s->priv_data;
     int i, hint_track = 0;
 
-    if (url_is_streamed(s->pb)) {
-        av_log(s, AV_LOG_ERROR, "muxer does not support non seekable output\n");
+    mov->fragmented = !!(s->flags & AVFMT_FLAG_MOV_FRAGMENT);
+    if (url_is_streamed(s->pb) && !mov->fragmented) {
+        av_log(s, AV_LOG_ERROR, "muxer does not support non seekable output, "
+               "use fragmented output\n");
+        return -1;
+    }
+    if (mov->fragmented && s->flags & AVFMT_FLAG_RTP_HINT) {
+        av_log(s, AV_LOG_ERROR, "rtp hinting is not supported with fragmented output\n");
         return -1;
     }
 
@@ -2065,6 +2406,8 @@ static int mov_write_header(AVFormatContext *s)
     mov->tracks = av_mallocz(mov->nb_streams*sizeof(*mov->tracks));
     if (!mov->tracks)
         return AVERROR(ENOMEM);
+    for (i = 0; i < mov->nb_streams; i++)
+        mov->tracks[i].start_dts = AV_NOPTS_VALUE;
 
     for(i=0; i<s->nb_streams; i++){
         AVStream *st= s->streams[i];
@@ -2131,9 +2474,23 @@ static int mov_write_header(AVFormatContext *s)
             track->height = st->codec->height;
 
         av_set_pts_info(st, 64, 1, track->timescale);
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+            s->streams[mov->frag_track]->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+            mov->frag_track = i;
     }
 
-    mov_write_mdat_tag(pb, mov);
+    if (s->moov_size && !mov->fragmented) {
+        /* reserve space for the moov with a free atom */
+        mov->reserved_moov_pos  = url_ftell(pb);
+        mov->reserved_moov_size = FFMAX(s->moov_size, 8);
+        put_be32(pb, mov->reserved_moov_size);
+        put_tag(pb, "free");
+        for (i = 8; i < mov->reserved_moov_size; i++)
+            put_byte(pb, 0);
+    }
+
+    if (!mov->fragmented)
+        mov_write_mdat_tag(pb, mov);
     mov->time = s->timestamp + 0x7C25B080; //1970 based -> 1904 based
 
     if (mov->chapter_track)
@@ -2159,6 +2516,156 @@ static int mov_write_header(AVFormatContext *s)
     return -1;
 }
 
+static void mov_shift_chunk_offsets(MOVMuxContext *mov, int64_t shift)
+{
+    int i, j;
+
+    for (i = 0; i < mov->nb_streams; i++)
+        for (j = 0; j < mov->tracks[i].entry; j++)
+            mov->tracks[i].cluster[j].pos += shift;
+}
+
+static int mov_get_moov_size(AVFormatContext *s)
+{
+    ByteIOContext *moov_buf;
+    uint8_t *buf;
+    int size;
+
+    if (url_open_dyn_buf(&moov_buf) < 0)
+        return AVERROR(ENOMEM);
+    mov_write_moov_tag(moov_buf, s->priv_data, s);
+    size = url_close_dyn_buf(moov_buf, &buf);
+    av_free(buf);
+    return size;
+}
+
+/**
+ * Find how far the data after the reserved space has to be shifted for
+ * the moov to fit before it, the rest of the space is filled with a free
+ * atom which needs at least 8 bytes.
+ * The chunk offsets are left shifted by the returned value.
+ */
+static int64_t mov_get_moov_shift(AVFormatContext *s, int avail)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t shift = 0, needed;
+    int size, i;
+
+    /* the moov can grow with the shift when chunk offsets need 64 bits */
+    for (i = 0; i < 3; i++) {
+        if ((size = mov_get_moov_size(s)) < 0)
+            break;
+        if (size > avail)
+            needed = size - avail;
+        else if (size < avail && size + 8 > avail)
+            needed = size + 8 - avail;
+        else
+            needed = 0;
+        if (needed == shift)
+            return shift;
+        mov_shift_chunk_offsets(mov, needed - shift);
+        shift = needed;
+    }
+    mov_shift_chunk_offsets(mov, -shift);
+    return -1;
+}
+
+#define MOV_SHIFT_BLOCK_SIZE (1 << 20)
+
+/**
+ * Move the data from pos to end shift bytes forward in the output file.
+ * It is read through a second context one block ahead of the writes,
+ * blocks are at least shift bytes so that nothing is overwritten before
+ * it has been read.
+ */
+static int mov_shift_data(AVFormatContext *s, int64_t pos, int64_t end, int64_t shift)
+{
+    ByteIOContext *read_pb;
+    uint8_t *buf[2];
+    int block = FFMAX(shift, MOV_SHIFT_BLOCK_SIZE);
+    int size[2], cur = 0, ret = 0;
+
+    if (shift > INT_MAX / 2)
+        return -1;
+    put_flush_packet(s->pb);
+    if (url_fopen(&read_pb, s->filename, URL_RDONLY) < 0) {
+        av_log(s, AV_LOG_WARNING, "could not reopen %s for reading, "
+               "the moov stays at the end\n", s->filename);
+        return -1;
+    }
+    buf[0] = av_malloc(block);
+    buf[1] = av_malloc(block);
+    if (!buf[0] || !buf[1]) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    url_fseek(read_pb, pos, SEEK_SET);
+    url_fseek(s->pb, pos + shift, SEEK_SET);
+    size[cur] = FFMIN(block, end - pos);
+    if (get_buffer(read_pb, buf[cur], size[cur]) != size[cur])
+        goto read_error;
+    while (pos < end) {
+        int64_t next = pos + size[cur];
+        size[!cur] = FFMIN(block, end - next);
+        if (size[!cur] > 0 &&
+            get_buffer(read_pb, buf[!cur], size[!cur]) != size[!cur])
+            goto read_error;
+        put_buffer(s->pb, buf[cur], size[cur]);
+        pos = next;
+        cur = !cur;
+    }
+    goto end;
+read_error:
+    av_log(s, AV_LOG_ERROR, "error reading back the mdat, the file is corrupted\n");
+    ret = AVERROR(EIO);
+end:
+    av_free(buf[0]);
+    av_free(buf[1]);
+    url_fclose(read_pb);
+    return ret;
+}
+
+/**
+ * Write the moov before the mdat, in the reserved space if it fits or
+ * else by shifting the mdat with faststart.
+ * @return 0 on success, <0 if the moov has to be written at the end
+ */
+static int mov_write_moov_first(AVFormatContext *s, int64_t end)
+{
+    MOVMuxContext *mov = s->priv_data;
+    ByteIOContext *pb = s->pb;
+    int64_t pos   = mov->reserved_moov_size ? mov->reserved_moov_pos : mov->mdat_pos - 8;
+    int64_t shift = mov_get_moov_shift(s, mov->reserved_moov_size);
+    int64_t free_size;
+
+    if (shift < 0)
+        return -1;
+    if (shift && !(s->flags & AVFMT_FLAG_MOV_FASTSTART)) {
+        av_log(s, AV_LOG_WARNING, "moov does not fit in the reserved space (%d bytes), "
+               "it is written at the end\n", mov->reserved_moov_size);
+        mov_shift_chunk_offsets(mov, -shift);
+        return -1;
+    }
+    if (shift && mov_shift_data(s, pos + mov->reserved_moov_size, end, shift) < 0) {
+        mov_shift_chunk_offsets(mov, -shift);
+        url_fseek(pb, end, SEEK_SET);
+        return -1;
+    }
+
+    url_fseek(pb, pos, SEEK_SET);
+    mov_write_moov_tag(pb, mov, s);
+    free_size = pos + mov->reserved_moov_size + shift - url_ftell(pb);
+    if (free_size) {
+        put_be32(pb, free_size);
+        put_tag(pb, "free");
+        for (; free_size > 8; free_size--)
+            put_byte(pb, 0);
+    }
+    url_fseek(pb, end + shift, SEEK_SET);
+    return 0;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -2168,20 +2675,28 @@ static int mov_write_trailer(AVFormatContext *s)
 
     int64_t moov_pos = url_ftell(pb);
 
-    /* Write size of mdat tag */
-    if (mov->mdat_size+8 <= UINT32_MAX) {
-        url_fseek(pb, mov->mdat_pos, SEEK_SET);
-        put_be32(pb, mov->mdat_size+8);
+    if (mov->fragmented) {
+        res = mov_flush_fragment(s);
+        if (res >= 0)
+            mov_write_mfra_tag(pb, mov);
     } else {
-        /* overwrite 'wide' placeholder atom */
-        url_fseek(pb, mov->mdat_pos - 8, SEEK_SET);
-        put_be32(pb, 1); /* special value: real atom size will be 64 bit value after tag field */
-        put_tag(pb, "mdat");
-        put_be64(pb, mov->mdat_size+16);
-    }
-    url_fseek(pb, moov_pos, SEEK_SET);
+        /* Write size of mdat tag */
+        if (mov->mdat_size+8 <= UINT32_MAX) {
+            url_fseek(pb, mov->mdat_pos, SEEK_SET);
+            put_be32(pb, mov->mdat_size+8);
+        } else {
+            /* overwrite 'wide' placeholder atom */
+            url_fseek(pb, mov->mdat_pos - 8, SEEK_SET);
+            put_be32(pb, 1); /* special value: real atom size will be 64 bit value after tag field */
+            put_tag(pb, "mdat");
+            put_be64(pb, mov->mdat_size+16);
+        }
+        url_fseek(pb, moov_pos, SEEK_SET);
 
-    mov_write_moov_tag(pb, mov, s);
+        if (!(mov->reserved_moov_size || s->flags & AVFMT_FLAG_MOV_FASTSTART) ||
+            mov_write_moov_first(s, moov_pos) < 0)
+            mov_write_moov_tag(pb, mov, s);
+    }
 
     if (mov->chapter_track)
         av_freep(&mov->tracks[mov->chapter_track].enc);
@@ -2190,6 +2705,12 @@ static int mov_write_trailer(AVFormatContext *s)
         if (mov->tracks[i].tag == MKTAG('r','t','p',' '))
             ff_mov_close_hinting(&mov->tracks[i]);
         av_freep(&mov->tracks[i].cluster);
+        av_freep(&mov->tracks[i].frag_info);
+        if (mov->tracks[i].mdat_buf) {
+            uint8_t *buf;
+            url_close_dyn_buf(mov->tracks[i].mdat_buf, &buf);
+            av_free(buf);
+        }
 
         if(mov->tracks[i].vosLen) av_free(mov->tracks[i].vosData);
 
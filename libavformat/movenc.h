@@ -51,6 +51,12 @@ typedef struct MOVIentry {
     uint32_t     flags;
 } MOVIentry;
 
+typedef struct MOVFragmentInfo {
+    int64_t time;   ///< decode time of the first sample of the fragment
+    int64_t offset; ///< position of the moof
+    int     traf;   ///< number of the traf of the track in the moof, starting at 1
+} MOVFragmentInfo;
+
 typedef struct HintSample {
     uint8_t *data;
     int size;
@@ -98,6 +104,12 @@ typedef struct MOVIndex {
     uint32_t    max_packet_size;
 
     HintSampleQueue sample_queue;
+
+    int64_t     start_dts;    ///< dts of the first sample of the track
+    ByteIOContext *mdat_buf;  ///< sample data of the current fragment
+    MOVFragmentInfo *frag_info; ///< fragments starting with a sync sample, for the tfra
+    int         frag_info_count;
+    int64_t     frag_last_duration; ///< duration of the last sample of the previous fragment
 } MOVTrack;
 
 typedef struct MOVMuxContext {
@@ -108,6 +120,14 @@ typedef struct MOVMuxContext {
     int64_t mdat_pos;
     uint64_t mdat_size;
     MOVTrack *tracks;
+
+    int     fragmented;    ///< write moof/mdat fragments instead of a single mdat
+    int     moov_written;
+    int     fragments;     ///< number of fragments written
+    int     frag_track;    ///< track whose key frames start the fragments
+
+    int64_t reserved_moov_pos;  ///< position of the space reserved for the moov
+    int     reserved_moov_size; ///< size of the free atom reserving it, 0 if none
 } MOVMuxContext;
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
@@ -40,6 +40,10 @@
 
 #define MAX_PES_PAYLOAD 200*1024
 
+/* number of packets read from the input at once by the demuxer, enough
+   for the reads to bypass the ByteIOContext buffer */
+#define TS_BATCH_PACKETS 256
+
 enum MpegTSFilterType {
     MPEGTS_PES,
     MPEGTS_SECTION,
@@ -120,6 +124,21 @@ struct MpegTSContext {
 
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+
+    /** packets read ahead from the input, they are parsed in place */
+    uint8_t *batch;
+    int batch_size;
+    int batch_len;          ///< number of bytes read into batch
+    int batch_pos;          ///< offset of the next packet in batch
+    int64_t batch_start;    ///< position of batch[0] in the input
+
+    /** pids that are only part of discarded programs, see discard_pid() */
+    uint8_t discard_map[NB_PID_MAX];
+    /** discard_map must be rebuilt, the programs or their discard flags changed */
+    int discard_dirty;
+    /** discard flags of the AVPrograms discard_map was built for */
+    int *prg_discard;
+    int nb_prg_discard;
 };
 
 /* TS stream handling */
@@ -166,12 +185,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_dirty = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    ts->discard_dirty = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -185,6 +206,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    ts->discard_dirty = 1;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
@@ -203,6 +225,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_dirty = 1;
 }
 
 /**
@@ -238,6 +261,53 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Notice changes of the programs selected by the caller since the last
+ * call, so that the discard map is rebuilt.
+ */
+static void check_program_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i;
+
+    if (s->nb_programs != ts->nb_prg_discard) {
+        int *tmp = av_realloc(ts->prg_discard,
+                              (s->nb_programs + 1) * sizeof(*ts->prg_discard));
+        if (!tmp)
+            return;
+        ts->prg_discard    = tmp;
+        ts->nb_prg_discard = s->nb_programs;
+        ts->discard_dirty  = 1;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        if (ts->discard_dirty || ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i] = s->programs[i]->discard;
+            ts->discard_dirty  = 1;
+        }
+    }
+}
+
+/**
+ * Cached version of discard_pid(), the map is only rebuilt when the
+ * programs or their discard flags change instead of for every packet.
+ */
+static inline int pid_discarded(MpegTSContext *ts, unsigned int pid)
+{
+    if (ts->discard_dirty) {
+        int i, j;
+        memset(ts->discard_map, 0, sizeof(ts->discard_map));
+        for (i = 0; i < ts->nb_prg; i++) {
+            for (j = 0; j < ts->prg[i].nb_pids; j++) {
+                unsigned int p = ts->prg[i].pids[j];
+                if (p && p < NB_PID_MAX)
+                    ts->discard_map[p] = discard_pid(ts, p);
+            }
+        }
+        ts->discard_dirty = 0;
+    }
+    return ts->discard_map[pid];
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -1147,16 +1217,18 @@ static void sdt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 }
 
 /* handle one TS packet */
-static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
+/**
+ * @param pos position of the packet in the input, or -1 if unknown
+ */
+static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 {
     AVFormatContext *s = ts->stream;
     MpegTSFilter *tss;
     int len, pid, cc, cc_ok, afc, is_start;
     const uint8_t *p, *p_end;
-    int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if(pid && discard_pid(ts, pid))
+    if(pid && pid_discarded(ts, pid))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -1188,9 +1260,6 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     if (p >= p_end)
         return 0;
 
-    pos = url_ftell(ts->stream->pb);
-    ts->pos47= pos % ts->raw_packet_size;
-
     if (tss->type == MPEGTS_SECTION) {
         if (is_start) {
             /* pointer field present */
@@ -1218,9 +1287,8 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
         }
     } else {
         int ret;
-        // Note: The position here points actually behind the current packet.
         if ((ret = tss->u.pes_filter.pes_cb(tss, p, p_end - p, is_start,
-                                            pos - ts->raw_packet_size)) < 0)
+                                            pos)) < 0)
             return ret;
     }
 
@@ -1276,12 +1344,86 @@ static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
     return 0;
 }
 
+/**
+ * Drop the packets read ahead, the next ones are read from the current
+ * position of the input.
+ */
+static void flush_batch(MpegTSContext *ts)
+{
+    ts->batch_len   = 0;
+    ts->batch_pos   = 0;
+    ts->batch_start = url_ftell(ts->stream->pb);
+}
+
+/**
+ * Get the next packet from the batch of packets read ahead, reading a new
+ * batch when it is exhausted. The packets of the pids that are discarded
+ * are skipped here, before any other parsing.
+ * @param packet set to the packet, which is valid until the next call
+ * @param pos set to the position of the packet in the input
+ * @param skipped incremented by the number of packets skipped
+ * @return 0 if OK, AVERROR(EIO) on EOF, AVERROR(EAGAIN) if sync was lost
+ */
+static int read_batch_packet(MpegTSContext *ts, const uint8_t **packet,
+                             int64_t *pos, int *skipped)
+{
+    ByteIOContext *pb = ts->stream->pb;
+    int resync = 0, pid, len;
+    const uint8_t *p;
+
+    for(;;) {
+        if (ts->batch_len - ts->batch_pos < TS_PACKET_SIZE) {
+            int left = FFMAX(ts->batch_len - ts->batch_pos, 0);
+            /* the packet trailer may not have been read yet */
+            if (ts->batch_pos > ts->batch_len)
+                url_fskip(pb, ts->batch_pos - ts->batch_len);
+            memmove(ts->batch, ts->batch + ts->batch_pos, left);
+            ts->batch_start += ts->batch_pos;
+            ts->batch_pos    = 0;
+            ts->batch_len    = left;
+            /* parse what has arrived rather than waiting for a full batch */
+            do {
+                len = get_partial_buffer(pb, ts->batch + ts->batch_len,
+                                         ts->batch_size - ts->batch_len);
+                if (len <= 0)
+                    return AVERROR(EIO);
+                ts->batch_len += len;
+            } while (ts->batch_len < TS_PACKET_SIZE);
+        }
+        p = ts->batch + ts->batch_pos;
+        /* check packet sync byte, find a new packet start if lost */
+        if (p[0] != 0x47) {
+            const uint8_t *end = ts->batch + ts->batch_len;
+            const uint8_t *sync = memchr(p, 0x47, end - p);
+            int n = sync ? sync - p : end - p;
+            resync += n;
+            ts->batch_pos += n;
+            if (resync >= MAX_RESYNC_SIZE) {
+                av_log(ts->stream, AV_LOG_ERROR,
+                       "max resync size reached, could not find sync byte\n");
+                return AVERROR(EAGAIN);
+            }
+            continue;
+        }
+        ts->batch_pos += ts->raw_packet_size;
+        pid = AV_RB16(p + 1) & 0x1fff;
+        if (pid && pid_discarded(ts, pid)) {
+            (*skipped)++;
+            continue;
+        }
+        *packet = p;
+        *pos    = ts->batch_start + (p - ts->batch);
+        return 0;
+    }
+}
+
 static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
-    AVFormatContext *s = ts->stream;
-    uint8_t packet[TS_PACKET_SIZE];
+    const uint8_t *packet;
     int packet_num, ret;
+    int64_t pos;
 
+    check_program_discard(ts);
     ts->stop_parse = 0;
     packet_num = 0;
     for(;;) {
@@ -1290,10 +1432,11 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets)
             break;
-        ret = read_packet(s, packet, ts->raw_packet_size);
+        ret = read_batch_packet(ts, &packet, &pos, &packet_num);
         if (ret != 0)
             return ret;
-        ret = handle_packet(ts, packet);
+        ts->pos47 = pos % ts->raw_packet_size;
+        ret = handle_packet(ts, packet, pos);
         if (ret != 0)
             return ret;
     }
@@ -1389,10 +1532,15 @@ static int mpegts_read_header(AVFormatContext *s,
 
     if (s->iformat == &mpegts_demuxer) {
         /* normal demux */
+        ts->batch_size = TS_BATCH_PACKETS * ts->raw_packet_size;
+        ts->batch = av_malloc(ts->batch_size);
+        if (!ts->batch)
+            return AVERROR(ENOMEM);
 
         /* first do a scaning to get all the services */
         if (url_fseek(pb, pos, SEEK_SET) < 0)
             av_log(s, AV_LOG_ERROR, "Unable to seek back to the start\n");
+        flush_batch(ts);
 
         mpegts_open_section_filter(ts, SDT_PID, sdt_cb, ts, 1);
 
@@ -1456,7 +1604,12 @@ static int mpegts_read_header(AVFormatContext *s,
 #endif
     }
 
-    url_fseek(pb, pos, SEEK_SET);
+    /* make mpegts_read_packet() drop the packets read ahead, unless the
+       input could not be rewound and they are the ones that follow */
+    if (url_fseek(pb, pos, SEEK_SET) < 0)
+        ts->last_pos = url_ftell(pb);
+    else
+        ts->last_pos = -1;
     return 0;
  fail:
     return -1;
@@ -1515,7 +1668,8 @@ static int mpegts_read_packet(AVFormatContext *s,
     int ret, i;
 
     if (url_ftell(s->pb) != ts->last_pos) {
-        /* seek detected, flush pes buffer */
+        /* seek detected, flush pes buffer and the packets read ahead */
+        flush_batch(ts);
         for (i = 0; i < NB_PID_MAX; i++) {
             if (ts->pids[i] && ts->pids[i]->type == MPEGTS_PES) {
                 PESContext *pes = ts->pids[i]->u.pes_filter.opaque;
@@ -1554,6 +1708,8 @@ static int mpegts_read_close(AVFormatContext *s)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->batch);
+    av_freep(&ts->prg_discard);
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
@@ -1569,6 +1725,8 @@ static int64_t mpegts_get_pcr(AVFormatContext *s, int stream_index,
     uint8_t buf[TS_PACKET_SIZE];
     int pcr_l, pcr_pid = ((PESContext*)s->streams[stream_index]->priv_data)->pcr_pid;
     const int find_next= 1;
+    /* the input is moved around, drop the packets read ahead */
+    ts->last_pos = -1;
     pos = ((*ppos  + ts->raw_packet_size - 1 - ts->pos47) / ts->raw_packet_size) * ts->raw_packet_size + ts->pos47;
     if (find_next) {
         for(;;) {
@@ -1691,6 +1849,7 @@ static int read_seek(AVFormatContext *s, int stream_index, int64_t target_ts, in
     uint8_t buf[TS_PACKET_SIZE];
     int64_t pos;
 
+    ts->last_pos = -1;
     if(av_seek_frame_binary(s, stream_index, target_ts, flags) < 0)
         return -1;
 
@@ -1738,6 +1897,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
     len1 = len;
     ts->pkt = pkt;
     ts->stop_parse = 0;
+    check_program_discard(ts);
     for(;;) {
         if (ts->stop_parse>0)
             break;
@@ -1747,7 +1907,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
             buf++;
             len--;
         } else {
-            handle_packet(ts, buf);
+            handle_packet(ts, buf, -1);
             buf += TS_PACKET_SIZE;
             len -= TS_PACKET_SIZE;
         }
@@ -1761,6 +1921,7 @@ void ff_mpegts_parse_close(MpegTSContext *ts)
 
     for(i=0;i<NB_PID_MAX;i++)
         av_free(ts->pids[i]);
+    av_free(ts->prg_discard);
     av_free(ts);
 }
 
@@ -45,8 +45,10 @@ typedef struct MpegTSService {
     char *name;
     char *provider_name;
     int pcr_pid;
+    AVStream *pcr_st;  /* stream carrying the PCR */
     int pcr_packet_count;
     int pcr_packet_period;
+    int64_t last_pcr_packet; /* index of the packet with the last PCR, CBR only */
 } MpegTSService;
 
 typedef struct MpegTSWrite {
@@ -60,10 +62,23 @@ typedef struct MpegTSWrite {
     int nb_services;
     int onid;
     int tsid;
-    uint64_t cur_pcr;
+    int64_t first_pcr;  ///< PCR of the first packet, in 27MHz units
+    int64_t nb_packets; ///< number of packets written so far
     int mux_rate; ///< set to 1 when VBR
 } MpegTSWrite;
 
+/**
+ * Get the time at which the given byte of the next packet leaves the
+ * multiplexer at the mux rate, in 27MHz units. Only meaningful for CBR.
+ * The PCR is derived from the packet count rather than accumulated, so
+ * that it does not drift from the actual rate.
+ */
+static int64_t get_pcr(const MpegTSWrite *ts, int byte)
+{
+    return ts->first_pcr + av_rescale(ts->nb_packets * TS_PACKET_SIZE + byte,
+                                      8 * 27000000LL, ts->mux_rate);
+}
+
 /* NOTE: 4 bytes must be left at the end for the crc32 */
 static void mpegts_write_section(MpegTSSection *s, uint8_t *buf, int len)
 {
@@ -110,7 +125,7 @@ static void mpegts_write_section(MpegTSSection *s, uint8_t *buf, int len)
         buf_ptr += len1;
         len -= len1;
 
-        ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
+        ts->nb_packets++;
     }
 }
 
@@ -221,6 +236,8 @@ static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
         AVStream *st = s->streams[i];
         MpegTSWriteStream *ts_st = st->priv_data;
         AVMetadataTag *lang = av_metadata_get(st->metadata, "language", NULL,0);
+        if (ts_st->service != service)
+            continue;
         switch(st->codec->codec_id) {
         case CODEC_ID_MPEG1VIDEO:
         case CODEC_ID_MPEG2VIDEO:
@@ -385,22 +402,54 @@ static int mpegts_write_header(AVFormatContext *s)
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st;
     MpegTSService *service;
-    AVStream *st, *pcr_st = NULL;
-    AVMetadataTag *title;
-    int i, j;
-    const char *service_name;
+    AVStream *st;
+    AVMetadataTag *title, *tag;
+    int i, j, k;
+    const char *service_name, *provider_name;
     int *pids;
 
     ts->tsid = DEFAULT_TSID;
     ts->onid = DEFAULT_ONID;
-    /* allocate a single DVB service */
     title = av_metadata_get(s->metadata, "title", NULL, 0);
-    service_name = title ? title->value : DEFAULT_SERVICE_NAME;
-    service = mpegts_add_service(ts, DEFAULT_SID,
-                                 DEFAULT_PROVIDER_NAME, service_name);
-    service->pmt.write_packet = section_write_packet;
-    service->pmt.opaque = s;
-    service->pmt.cc = 15;
+    if (s->nb_programs) {
+        /* one DVB service per program */
+        for (i = 0; i < s->nb_programs; i++) {
+            AVProgram *program = s->programs[i];
+            tag = av_metadata_get(program->metadata, "name", NULL, 0);
+            service_name = tag ? tag->value :
+                           title ? title->value : DEFAULT_SERVICE_NAME;
+            tag = av_metadata_get(program->metadata, "provider_name", NULL, 0);
+            provider_name = tag ? tag->value : DEFAULT_PROVIDER_NAME;
+            /* program number 0 is reserved for the network PID in the PAT */
+            if (program->id <= 0 || program->id > 0xffff) {
+                av_log(s, AV_LOG_ERROR,
+                       "Invalid program id %d, must be between 1 and 65535\n",
+                       program->id);
+                return -1;
+            }
+            for (j = 0; j < ts->nb_services; j++)
+                if (ts->services[j]->sid == program->id) {
+                    av_log(s, AV_LOG_ERROR, "Duplicate program id %d\n",
+                           program->id);
+                    return -1;
+                }
+            if (!mpegts_add_service(ts, program->id, provider_name,
+                                    service_name))
+                return AVERROR(ENOMEM);
+        }
+    } else {
+        /* allocate a single DVB service */
+        service_name = title ? title->value : DEFAULT_SERVICE_NAME;
+        if (!mpegts_add_service(ts, DEFAULT_SID, DEFAULT_PROVIDER_NAME,
+                                service_name))
+            return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < ts->nb_services; i++) {
+        service = ts->services[i];
+        service->pmt.write_packet = section_write_packet;
+        service->pmt.opaque = s;
+        service->pmt.cc = 15;
+    }
 
     ts->pat.pid = PAT_PID;
     ts->pat.cc = 15; // Initialize at 15 so that it wraps and be equal to 0 for the first packet we write
@@ -423,7 +472,13 @@ static int mpegts_write_header(AVFormatContext *s)
         if (!ts_st)
             goto fail;
         st->priv_data = ts_st;
-        ts_st->service = service;
+        /* a stream which is not part of any program goes in the first one */
+        ts_st->service = ts->services[0];
+        for (j = s->nb_programs - 1; j >= 0; j--)
+            for (k = 0; k < s->programs[j]->nb_stream_indexes; k++)
+                if (s->programs[j]->stream_index[k] == i)
+                    ts_st->service = ts->services[j];
+        service = ts_st->service;
         /* MPEG pid values < 16 are reserved. Applications which set st->id in
          * this range are assigned a calculated pid. */
         if (st->id < 16) {
@@ -434,10 +489,11 @@ static int mpegts_write_header(AVFormatContext *s)
             av_log(s, AV_LOG_ERROR, "Invalid stream id %d, must be less than 8191\n", st->id);
             goto fail;
         }
-        if (ts_st->pid == service->pmt.pid) {
-            av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
-            goto fail;
-        }
+        for (j = 0; j < ts->nb_services; j++)
+            if (ts_st->pid == ts->services[j]->pmt.pid) {
+                av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
+                goto fail;
+            }
         for (j = 0; j < i; j++)
             if (pids[j] == ts_st->pid) {
                 av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
@@ -452,7 +508,7 @@ static int mpegts_write_header(AVFormatContext *s)
         if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
             service->pcr_pid == 0x1fff) {
             service->pcr_pid = ts_st->pid;
-            pcr_st = st;
+            service->pcr_st  = st;
         }
         if (st->codec->codec_id == CODEC_ID_AAC &&
             st->codec->extradata_size > 0) {
@@ -467,29 +523,40 @@ static int mpegts_write_header(AVFormatContext *s)
 
     av_free(pids);
 
-    /* if no video stream, use the first stream as PCR */
-    if (service->pcr_pid == 0x1fff && s->nb_streams > 0) {
-        pcr_st = s->streams[0];
-        ts_st = pcr_st->priv_data;
-        service->pcr_pid = ts_st->pid;
+    /* if no video stream, use the first stream of the service as PCR */
+    for (i = 0; i < s->nb_streams; i++) {
+        ts_st = s->streams[i]->priv_data;
+        service = ts_st->service;
+        if (service->pcr_pid == 0x1fff) {
+            service->pcr_pid = ts_st->pid;
+            service->pcr_st  = s->streams[i];
+        }
     }
 
     ts->mux_rate = s->mux_rate ? s->mux_rate : 1;
 
     if (ts->mux_rate > 1) {
-        service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
-            (TS_PACKET_SIZE * 8 * 1000);
         ts->sdt_packet_period      = (ts->mux_rate * SDT_RETRANS_TIME) /
             (TS_PACKET_SIZE * 8 * 1000);
         ts->pat_packet_period      = (ts->mux_rate * PAT_RETRANS_TIME) /
             (TS_PACKET_SIZE * 8 * 1000);
 
-        ts->cur_pcr = av_rescale(s->max_delay, 90000, AV_TIME_BASE);
+        ts->first_pcr = av_rescale(s->max_delay, 27000000, AV_TIME_BASE);
     } else {
         /* Arbitrary values, PAT/PMT could be written on key frames */
         ts->sdt_packet_period = 200;
         ts->pat_packet_period = 40;
-        if (pcr_st->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
+    }
+    for (i = 0; i < ts->nb_services; i++) {
+        AVStream *pcr_st = ts->services[i]->pcr_st;
+        service = ts->services[i];
+        if (ts->mux_rate > 1) {
+            /* counted in packets of the whole multiplex */
+            service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
+                (TS_PACKET_SIZE * 8 * 1000);
+        } else if (!pcr_st) {
+            continue;
+        } else if (pcr_st->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
             if (!pcr_st->codec->frame_size) {
                 av_log(s, AV_LOG_WARNING, "frame size not set\n");
                 service->pcr_packet_period =
@@ -503,10 +570,11 @@ static int mpegts_write_header(AVFormatContext *s)
             service->pcr_packet_period =
                 pcr_st->codec->time_base.den/(10*pcr_st->codec->time_base.num);
         }
+        // output a PCR as soon as possible
+        service->pcr_packet_count = service->pcr_packet_period;
+        service->last_pcr_packet  = -service->pcr_packet_period;
     }
 
-    // output a PCR as soon as possible
-    service->pcr_packet_count = service->pcr_packet_period;
     ts->pat_packet_count = ts->pat_packet_period-1;
     ts->sdt_packet_count = ts->sdt_packet_period-1;
 
@@ -516,8 +584,10 @@ static int mpegts_write_header(AVFormatContext *s)
         av_log(s, AV_LOG_INFO, "muxrate %d, ", ts->mux_rate);
     av_log(s, AV_LOG_INFO, "pcr every %d pkts, "
            "sdt every %d, pat/pmt every %d pkts\n",
-           service->pcr_packet_period,
+           ts->services[0]->pcr_packet_period,
            ts->sdt_packet_period, ts->pat_packet_period);
+    if (ts->nb_services > 1)
+        av_log(s, AV_LOG_INFO, "%d services\n", ts->nb_services);
 
     put_flush_packet(s->pb);
 
@@ -565,7 +635,25 @@ static void mpegts_insert_null_packet(AVFormatContext *s)
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
     put_buffer(s->pb, buf, TS_PACKET_SIZE);
-    ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
+    ts->nb_packets++;
+}
+
+/* the PCR refers to the arrival of the last byte of its base */
+#define PCR_BYTE_OFFSET 11
+
+/* Write a PCR in 27MHz units, as 33 bits of base and 9 bits of extension */
+static int write_pcr_bits(uint8_t *buf, int64_t pcr)
+{
+    int64_t pcr_low = pcr % 300, pcr_high = pcr / 300;
+
+    *buf++ = pcr_high >> 25;
+    *buf++ = pcr_high >> 17;
+    *buf++ = pcr_high >> 9;
+    *buf++ = pcr_high >> 1;
+    *buf++ = pcr_high << 7 | pcr_low >> 8 | 0x7e;
+    *buf++ = pcr_low;
+
+    return 6;
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
@@ -574,7 +662,6 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
     uint8_t *q;
-    uint64_t pcr = ts->cur_pcr;
     uint8_t buf[TS_PACKET_SIZE];
 
     q = buf;
@@ -587,17 +674,13 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     *q++ = 0x10;               /* Adaptation flags: PCR present */
 
     /* PCR coded into 6 bytes */
-    *q++ = pcr >> 25;
-    *q++ = pcr >> 17;
-    *q++ = pcr >> 9;
-    *q++ = pcr >> 1;
-    *q++ = (pcr & 1) << 7;
-    *q++ = 0;
+    q += write_pcr_bits(q, get_pcr(ts, PCR_BYTE_OFFSET));
+    ts_st->service->last_pcr_packet = ts->nb_packets;
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
     put_buffer(s->pb, buf, TS_PACKET_SIZE);
-    ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
+    ts->nb_packets++;
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -628,7 +711,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
     uint8_t buf[TS_PACKET_SIZE];
     uint8_t *q;
     int val, is_start, len, header_len, write_pcr, private_code, flags;
-    int afc_len, stuffing_len;
+    int afc_len, stuffing_len, i;
     int64_t pcr = -1; /* avoid warning */
     int64_t delay = av_rescale(s->max_delay, 90000, AV_TIME_BASE);
 
@@ -637,8 +720,27 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         retransmit_si_info(s);
 
         write_pcr = 0;
-        if (ts_st->pid == ts_st->service->pcr_pid) {
-            if (ts->mux_rate > 1 || is_start) // VBR pcr period is based on frames
+        if (ts->mux_rate > 1) {
+            /* The PCRs of all services are due at regular intervals of the
+             * multiplex, whatever stream is being written. They are sent
+             * in the packet being written if it is from the PCR stream,
+             * in packets of their own otherwise. */
+            MpegTSService *service = NULL;
+            for (i = 0; i < ts->nb_services; i++) {
+                if (ts->services[i]->pcr_st &&
+                    ts->nb_packets - ts->services[i]->last_pcr_packet >=
+                    ts->services[i]->pcr_packet_period) {
+                    service = ts->services[i];
+                    break;
+                }
+            }
+            if (service && service->pcr_st != st) {
+                mpegts_insert_pcr_only(s, service->pcr_st);
+                continue;
+            }
+            write_pcr = !!service;
+        } else if (ts_st->pid == ts_st->service->pcr_pid) {
+            if (is_start) // VBR pcr period is based on frames
                 ts_st->service->pcr_packet_count++;
             if (ts_st->service->pcr_packet_count >=
                 ts_st->service->pcr_packet_period) {
@@ -648,7 +750,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         }
 
         if (ts->mux_rate > 1 && dts != AV_NOPTS_VALUE &&
-            (dts - (int64_t)ts->cur_pcr) > delay) {
+            (dts - get_pcr(ts, 0) / 300) > delay) {
             /* pcr insert gets priority over null packet insert */
             if (write_pcr)
                 mpegts_insert_pcr_only(s, st);
@@ -668,21 +770,17 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         ts_st->cc = (ts_st->cc + 1) & 0xf;
         *q++ = 0x10 | ts_st->cc | (write_pcr ? 0x20 : 0);
         if (write_pcr) {
-            // add 11, pcr references the last byte of program clock reference base
-            if (ts->mux_rate > 1)
-                pcr = ts->cur_pcr + (4+7)*8*90000LL / ts->mux_rate;
-            else
-                pcr = dts - delay;
-            if (dts != AV_NOPTS_VALUE && dts < pcr)
+            if (ts->mux_rate > 1) {
+                pcr = get_pcr(ts, PCR_BYTE_OFFSET);
+                ts_st->service->last_pcr_packet = ts->nb_packets;
+            } else {
+                pcr = (dts - delay) * 300;
+            }
+            if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
                 av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
             *q++ = 7; /* AFC length */
             *q++ = 0x10; /* flags: PCR present */
-            *q++ = pcr >> 25;
-            *q++ = pcr >> 17;
-            *q++ = pcr >> 9;
-            *q++ = pcr >> 1;
-            *q++ = (pcr & 1) << 7;
-            *q++ = 0;
+            q += write_pcr_bits(q, pcr);
         }
         if (is_start) {
             int pes_extension = 0;
@@ -797,7 +895,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         payload += len;
         payload_size -= len;
         put_buffer(s->pb, buf, TS_PACKET_SIZE);
-        ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
+        ts->nb_packets++;
     }
     put_flush_packet(s->pb);
 }
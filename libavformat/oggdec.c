@@ -37,6 +37,9 @@
 
 #define MAX_PAGE_SIZE 65307
 #define DECODER_BUFFER_SIZE MAX_PAGE_SIZE
+#define MAX_CACHED_PAGES 4096
+/* below this, the pages left are read in a row rather than bisected */
+#define SEEK_LINEAR_SIZE MAX_PAGE_SIZE
 
 static const struct ogg_codec * const ogg_codecs[] = {
     &ff_skeleton_codec,
@@ -191,21 +194,85 @@ ogg_new_buf(struct ogg *ogg, int idx)
     return 0;
 }
 
+/**
+ * Remember the position and timestamp of a page of a stream.
+ * Only data pages with a granule are cached, so that reading from a
+ * cached page never goes back to the headers.
+ * @return the timestamp of the page, AV_NOPTS_VALUE if it is not cached
+ */
+static int64_t
+ogg_cache_page (AVFormatContext * s, int idx, int64_t pos, uint64_t gp)
+{
+    struct ogg *ogg = s->priv_data;
+    struct ogg_stream *os = ogg->streams + idx;
+    struct ogg_page_cache *pc;
+    struct ogg_cached_page *pages;
+    int64_t ts;
+    int a, b, i;
+
+    if (!os->codec || os->header || !ogg->headers || gp == -1 ||
+        pos < s->data_offset)
+        return AV_NOPTS_VALUE;
+    ts = ogg_gptopts (s, idx, gp, NULL);
+    if (ts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+
+    if (idx >= ogg->nb_page_cache){
+        pc = av_realloc (ogg->page_cache, (idx + 1) * sizeof (*pc));
+        if (!pc)
+            return ts;
+        memset (pc + ogg->nb_page_cache, 0,
+                (idx + 1 - ogg->nb_page_cache) * sizeof (*pc));
+        ogg->page_cache = pc;
+        ogg->nb_page_cache = idx + 1;
+    }
+    pc = ogg->page_cache + idx;
+
+    // keep every other page when full, the cache stays spread over the file
+    if (pc->nb_pages >= MAX_CACHED_PAGES){
+        for (i = 0; i < pc->nb_pages / 2; i++)
+            pc->pages[i] = pc->pages[2 * i];
+        pc->nb_pages /= 2;
+    }
+
+    // pages are mostly read in order, so check the end first
+    a = 0;
+    b = pc->nb_pages;
+    if (b && pc->pages[b - 1].pos < pos)
+        a = b;
+    while (a < b){
+        int m = (a + b) >> 1;
+        if (pc->pages[m].pos < pos)
+            a = m + 1;
+        else
+            b = m;
+    }
+    if (a < pc->nb_pages && pc->pages[a].pos == pos)
+        return ts;
+
+    pages = av_fast_realloc (pc->pages, &pc->allocated,
+                             (pc->nb_pages + 1) * sizeof (*pc->pages));
+    if (!pages)
+        return ts;
+    pc->pages = pages;
+    memmove (pages + a + 1, pages + a, (pc->nb_pages - a) * sizeof (*pages));
+    pages[a].pos = pos;
+    pages[a].ts = ts;
+    pc->nb_pages++;
+    return ts;
+}
+
+/**
+ * Read up to the sync word of the next page.
+ * @return 0 if found, -1 otherwise
+ */
 static int
-ogg_read_page (AVFormatContext * s, int *str)
+ogg_find_sync (AVFormatContext * s)
 {
     ByteIOContext *bc = s->pb;
-    struct ogg *ogg = s->priv_data;
-    struct ogg_stream *os;
-    int i = 0;
-    int flags, nsegs;
-    uint64_t gp;
-    uint32_t serial;
-    uint32_t seq;
-    uint32_t crc;
-    int size, idx;
     uint8_t sync[4];
     int sp = 0;
+    int i = 0;
 
     if (get_buffer (bc, sync, 4) < 4)
         return -1;
@@ -229,6 +296,26 @@ ogg_read_page (AVFormatContext * s, int *str)
         return -1;
     }
 
+    return 0;
+}
+
+static int
+ogg_read_page (AVFormatContext * s, int *str)
+{
+    ByteIOContext *bc = s->pb;
+    struct ogg *ogg = s->priv_data;
+    struct ogg_stream *os;
+    int i;
+    int flags, nsegs;
+    uint64_t gp;
+    uint32_t serial;
+    uint32_t seq;
+    uint32_t crc;
+    int size, idx;
+
+    if (ogg_find_sync (s) < 0)
+        return -1;
+
     if (url_fgetc (bc) != 0)      /* version */
         return -1;
 
@@ -291,6 +378,8 @@ ogg_read_page (AVFormatContext * s, int *str)
     os->granule = gp;
     os->flags = flags;
 
+    ogg_cache_page (s, idx, os->page_pos, gp);
+
     if (str)
         *str = idx;
 
@@ -573,6 +662,9 @@ ogg_read_close (AVFormatContext * s)
         av_free (ogg->streams[i].private);
     }
     av_free (ogg->streams);
+    for (i = 0; i < ogg->nb_page_cache; i++)
+        av_free (ogg->page_cache[i].pages);
+    av_free (ogg->page_cache);
     return 0;
 }
 
@@ -602,6 +694,161 @@ ogg_read_timestamp (AVFormatContext * s, int stream_index, int64_t * pos_arg,
     return pts;
 }
 
+/**
+ * Skim the pages from the current position up to the first cacheable
+ * page of stream idx which starts before end. Only the page headers are
+ * read, the stream state is left alone.
+ * @return the position of the page, -1 if there is none
+ */
+static int64_t
+ogg_next_page (AVFormatContext * s, int idx, int64_t end, int64_t *ts)
+{
+    struct ogg *ogg = s->priv_data;
+    ByteIOContext *bc = s->pb;
+    uint8_t segments[255];
+    int64_t pos;
+    uint64_t gp;
+    int i, nsegs, size;
+
+    while (!ogg_find_sync (s)){
+        pos = url_ftell (bc) - 4;
+        if (pos >= end || url_fgetc (bc) != 0)      /* version */
+            break;
+        url_fgetc (bc);                             /* flags */
+        gp = get_le64 (bc);
+        i = ogg_find_stream (ogg, get_le32 (bc));
+        url_fskip (bc, 8);                          /* sequence number, crc */
+        nsegs = url_fgetc (bc);
+        if (nsegs < 0 || get_buffer (bc, segments, nsegs) < nsegs)
+            break;
+        for (size = 0; nsegs > 0; nsegs--)
+            size += segments[nsegs - 1];
+        url_fskip (bc, size);
+        if (i >= 0 && (*ts = ogg_cache_page (s, i, pos, gp)) != AV_NOPTS_VALUE
+            && i == idx)
+            return pos;
+    }
+    return -1;
+}
+
+static inline int
+ogg_page_before (int64_t ts, int64_t timestamp, int flags)
+{
+    return ts < timestamp || (ts == timestamp && flags & AVSEEK_FLAG_BACKWARD);
+}
+
+/**
+ * Seek to the page of stream idx nearest to timestamp, by bisecting the
+ * file on the granules of its pages. The search starts between the
+ * cached pages around timestamp, and the pages read on the way are
+ * cached in turn, so that seeks near places already visited only need a
+ * couple of reads.
+ * A backward seek lands on the last page whose granule is not after
+ * timestamp, other seeks on the first page whose granule is not before.
+ * The granule of a page is the time its last complete packet ends, so
+ * the packets completed on the page are skipped and the next one gets
+ * the granule as timestamp. The codecs whose granule is the start of that
+ * packet tell nothing about the next one, and no packet follows the last
+ * page of a stream; the seek then only lands on the page.
+ */
+static int
+ogg_seek_bisect (AVFormatContext * s, int idx, int64_t timestamp, int flags)
+{
+    struct ogg *ogg = s->priv_data;
+    struct ogg_stream *os = ogg->streams + idx;
+    AVStream *st = s->streams[idx];
+    int64_t lo_pos = s->data_offset, lo_ts = AV_NOPTS_VALUE;
+    int64_t hi_pos = -1, hi_ts = AV_NOPTS_VALUE;
+    int64_t end = url_fsize (s->pb), pos, page, ts;
+    int step = 0, i;
+
+    if (end <= 0)
+        return -1;
+
+    if (idx < ogg->nb_page_cache){
+        struct ogg_page_cache *pc = ogg->page_cache + idx;
+        int a = 0, b = pc->nb_pages;
+        while (a < b){
+            int m = (a + b) >> 1;
+            if (ogg_page_before (pc->pages[m].ts, timestamp, flags))
+                a = m + 1;
+            else
+                b = m;
+        }
+        if (a > 0){
+            lo_pos = pc->pages[a - 1].pos;
+            lo_ts = pc->pages[a - 1].ts;
+        }
+        if (a < pc->nb_pages){
+            hi_pos = end = pc->pages[a].pos;
+            hi_ts = pc->pages[a].ts;
+        }
+    }
+
+    while (end - lo_pos > SEEK_LINEAR_SIZE){
+        // interpolate on the granules every other step, bisect otherwise
+        if (lo_ts != AV_NOPTS_VALUE && hi_ts > lo_ts && !(step++ & 1))
+            pos = lo_pos + av_rescale (timestamp - lo_ts, hi_pos - lo_pos,
+                                       hi_ts - lo_ts);
+        else
+            pos = lo_pos + (end - lo_pos) / 2;
+        pos = FFMIN (FFMAX (pos, lo_pos + 1), end - 1);
+
+        url_fseek (s->pb, pos, SEEK_SET);
+        page = ogg_next_page (s, idx, end, &ts);
+        if (page < 0){
+            end = pos;
+        }else if (ogg_page_before (ts, timestamp, flags)){
+            lo_pos = page;
+            lo_ts = ts;
+        }else{
+            hi_pos = end = page;
+            hi_ts = ts;
+        }
+    }
+
+    url_fseek (s->pb, lo_pos, SEEK_SET);
+    while ((page = ogg_next_page (s, idx, end, &ts)) >= 0){
+        if (ogg_page_before (ts, timestamp, flags)){
+            lo_pos = page;
+            lo_ts = ts;
+        }else{
+            hi_pos = page;
+            hi_ts = ts;
+            break;
+        }
+    }
+
+    if (flags & AVSEEK_FLAG_BACKWARD){
+        pos = lo_pos;
+        ts = lo_ts;
+    }else{
+        pos = hi_pos;
+        ts = hi_ts;
+    }
+    ogg_reset (ogg);
+    if (pos < 0 || url_fseek (s->pb, pos, SEEK_SET) < 0)
+        return -1;
+
+    if (ts == AV_NOPTS_VALUE){
+        ts = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    }else if (!os->codec->granule_is_start){
+        if (ogg_read_page (s, &i) < 0 || i != idx)
+            return -1;
+        for (i = os->nsegs; i > os->segp && os->segments[i - 1] == 255; i--);
+        // no packet follows the last page of a stream, it is read whole
+        if (i < os->nsegs || !(os->flags & OGG_FLAG_EOS)){
+            while (os->segp < i)
+                os->pstart += os->segments[os->segp++];
+            os->granule = -1;
+            os->lastpts = os->lastdts = ts;
+        }
+        ogg->curidx = os->segp < os->nsegs ? idx : -1;
+    }
+    av_update_cur_dts (s, st, ts);
+    return 0;
+}
+
 static int ogg_read_seek(AVFormatContext *s, int stream_index, int64_t timestamp, int flags)
 {
     struct ogg *ogg = s->priv_data;
@@ -614,7 +861,11 @@ static int ogg_read_seek(AVFormatContext *s, int stream_index, int64_t timestamp
         && !(flags & AVSEEK_FLAG_ANY))
         os->keyframe_seek = 1;
 
-    ret = av_seek_frame_binary(s, stream_index, timestamp, flags);
+    // the granule of a page does not tell where the keyframes are
+    if (!os->keyframe_seek && !url_is_streamed (s->pb))
+        ret = ogg_seek_bisect(s, stream_index, timestamp, flags);
+    else
+        ret = av_seek_frame_binary(s, stream_index, timestamp, flags);
     if (ret < 0)
         os->keyframe_seek = 0;
     return ret;
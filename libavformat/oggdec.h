@@ -78,6 +78,19 @@ struct ogg_stream {
     void *private;
 };
 
+/**
+ * Position and timestamp of the data pages of a stream which have a
+ * granule, sorted by position, remembered to narrow down later seeks.
+ */
+struct ogg_page_cache {
+    struct ogg_cached_page {
+        int64_t pos;
+        int64_t ts;
+    } *pages;
+    int nb_pages;
+    unsigned int allocated;
+};
+
 struct ogg_state {
     uint64_t pos;
     int curidx;
@@ -92,6 +105,8 @@ struct ogg {
     int headers;
     int curidx;
     struct ogg_state *state;
+    struct ogg_page_cache *page_cache; ///< one per stream, not part of the saved state
+    int nb_page_cache;
 };
 
 #define OGG_FLAG_CONT 1
@@ -50,6 +50,8 @@ static const AVOption options[]={
 {"noparse", "disable AVParsers, this needs nofillin too", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_NOPARSE, INT_MIN, INT_MAX, D, "fflags"},
 {"igndts", "ignore dts", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_IGNDTS, INT_MIN, INT_MAX, D, "fflags"},
 {"rtphint", "add rtp hinting", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_RTP_HINT, INT_MIN, INT_MAX, E, "fflags"},
+{"frag", "write fragmented mov/mp4", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_MOV_FRAGMENT, INT_MIN, INT_MAX, E, "fflags"},
+{"faststart", "place the mov/mp4 moov before the mdat", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_MOV_FASTSTART, INT_MIN, INT_MAX, E, "fflags"},
 #if FF_API_OLD_METADATA
 {"track", " set the track number", OFFSET(track), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
 {"year", "set the year", OFFSET(year), FF_OPT_TYPE_INT, DEFAULT, INT_MIN, INT_MAX, E},
@@ -58,6 +60,10 @@ static const AVOption options[]={
 {"cryptokey", "decryption key", OFFSET(key), FF_OPT_TYPE_BINARY, 0, 0, 0, D},
 {"indexmem", "max memory used for timestamp index (per stream)", OFFSET(max_index_size), FF_OPT_TYPE_INT, 1<<20, 0, INT_MAX, D},
 {"rtbufsize", "max memory used for buffering real-time frames", OFFSET(max_picture_buffer), FF_OPT_TYPE_INT, 3041280, 0, INT_MAX, D}, /* defaults to 1s of 15fps 352x288 YUYV422 video */
+{"fragdur", "minimum duration of a fragment in microseconds", OFFSET(fragment_duration), FF_OPT_TYPE_INT, 1000000, 0, INT_MAX, E},
+{"moov_size", "space to reserve for the mov/mp4 moov at the start of the file", OFFSET(moov_size), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
+{"max_delay", "maximum muxing or demuxing delay in microseconds", OFFSET(max_delay), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E|D},
+{"reorder_queue_size", "number of RTP packets kept to reorder them", OFFSET(reorder_queue_size), FF_OPT_TYPE_INT, 10, 0, INT_MAX, D},
 {"fdebug", "print specific debug info", OFFSET(debug), FF_OPT_TYPE_FLAGS, DEFAULT, 0, INT_MAX, E|D, "fdebug"},
 {"ts", NULL, 0, FF_OPT_TYPE_CONST, FF_FDEBUG_TS, INT_MIN, INT_MAX, E|D, "fdebug"},
 {NULL},
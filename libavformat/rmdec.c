@@ -509,7 +509,40 @@ static int get_num(ByteIOContext *pb, int *len)
 /* multiple of 20 bytes for ra144 (ugly) */
 #define RAW_PACKET_SIZE 1000
 
-static int sync(AVFormatContext *s, int64_t *timestamp, int *flags, int *stream_index, int64_t *pos){
+/**
+ * Check that a packet header, the index or the end of the data starts at
+ * next, so that a header found when resyncing can be told from the same
+ * bytes in a payload.
+ */
+static int next_header_ok(AVFormatContext *s, int64_t next)
+{
+    ByteIOContext *pb = s->pb;
+    int64_t pos = url_ftell(pb);
+    uint32_t state;
+    int i, num, ret = 0;
+
+    url_fseek(pb, next, SEEK_SET);
+    state = get_be32(pb);
+    num   = get_be16(pb);
+    if (url_feof(pb) || !state || state == MKBETAG('I', 'N', 'D', 'X') ||
+        state == MKBETAG('D', 'A', 'T', 'A')) {
+        ret = 1;
+    } else if (state > 12 && state <= 0xFFFF) {
+        for (i = 0; i < s->nb_streams; i++)
+            if (num == s->streams[i]->id)
+                ret = 1;
+    }
+    url_fseek(pb, pos, SEEK_SET);
+    return ret;
+}
+
+/**
+ * Find the next packet header.
+ * @param check check that each header found by scanning is followed by
+ *              another one, for the scans from arbitrary positions when
+ *              seeking
+ */
+static int sync(AVFormatContext *s, int64_t *timestamp, int *flags, int *stream_index, int64_t *pos, int check){
     RMDemuxContext *rm = s->priv_data;
     ByteIOContext *pb = s->pb;
     AVStream *st;
@@ -557,6 +590,11 @@ static int sync(AVFormatContext *s, int64_t *timestamp, int *flags, int *stream_
             *timestamp = get_be32(pb);
             get_byte(pb); /* reserved */
             *flags = get_byte(pb); /* flags */
+
+            if (check && !next_header_ok(s, *pos + 12 + len)) {
+                url_fseek(pb, *pos + 1, SEEK_SET);
+                continue;
+            }
         }
         for(i=0;i<s->nb_streams;i++) {
             st = s->streams[i];
@@ -843,7 +881,7 @@ static int rm_read_packet(AVFormatContext *s, AVPacket *pkt)
                 flags = (seq++ == 1) ? 2 : 0;
                 pos = url_ftell(s->pb);
             } else {
-                len=sync(s, &timestamp, &flags, &i, &pos);
+                len=sync(s, &timestamp, &flags, &i, &pos, 0);
                 if (len > 0)
                     st = s->streams[i];
             }
@@ -910,7 +948,7 @@ static int64_t rm_read_dts(AVFormatContext *s, int stream_index,
         int seq=1;
         AVStream *st;
 
-        len=sync(s, &dts, &flags, &stream_index2, &pos);
+        len=sync(s, &dts, &flags, &stream_index2, &pos, 1);
         if(len<0)
             return AV_NOPTS_VALUE;
 
@@ -332,9 +332,11 @@ void rtp_send_punch_packets(URLContext* rtp_handle)
 /**
  * open a new RTP parse context for stream 'st'. 'st' can be NULL for
  * MPEG2TS streams to indicate that they should be demuxed inside the
- * rtp demux (otherwise CODEC_ID_MPEG2TS packets are returned)
+ * rtp demux (otherwise CODEC_ID_MPEG2TS packets are returned).
+ * Up to queue_size packets are kept to put them back in order.
  */
-RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *rtpc, int payload_type)
+RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *rtpc,
+                                int payload_type, int queue_size)
 {
     RTPDemuxContext *s;
 
@@ -342,6 +344,7 @@ RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *r
     if (!s)
         return NULL;
     s->payload_type = payload_type;
+    s->queue_size = queue_size;
     s->last_rtcp_ntp_time = AV_NOPTS_VALUE;
     s->first_rtcp_ntp_time = AV_NOPTS_VALUE;
     s->ic = s1;
@@ -411,16 +414,39 @@ static void finalize_packet(RTPDemuxContext *s, AVPacket *pkt, uint32_t timestam
 }
 
 /**
- * Parse an RTP or RTCP packet directly sent as a buffer.
- * @param s RTP parse context.
- * @param pkt returned packet
- * @param buf input buffer or NULL to read the next packets
- * @param len buffer len
- * @return 0 if a packet is returned, 1 if a packet is returned and more can follow
- * (use buf as NULL to read the next). -1 if no packet (error or no more packet).
+ * Return the next packets of the last parsed RTP packet, if any.
  */
-int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
-                     const uint8_t *buf, int len)
+static int rtp_parse_packet_remaining(RTPDemuxContext *s, AVPacket *pkt)
+{
+    uint32_t timestamp;
+    int ret, rv;
+
+    if(s->st && s->parse_packet) {
+        /* timestamp should be overwritten by parse_packet, if not,
+         * the packet is left with pts == AV_NOPTS_VALUE */
+        timestamp = RTP_NOTS_VALUE;
+        rv= s->parse_packet(s->ic, s->dynamic_protocol_context,
+                            s->st, pkt, &timestamp, NULL, 0, 0);
+        finalize_packet(s, pkt, timestamp);
+        return rv;
+    } else {
+        // TODO: Move to a dynamic packet handler (like above)
+        if (s->read_buf_index >= s->read_buf_size)
+            return -1;
+        ret = ff_mpegts_parse_packet(s->ts, pkt, s->buf + s->read_buf_index,
+                                  s->read_buf_size - s->read_buf_index);
+        if (ret < 0)
+            return -1;
+        s->read_buf_index += ret;
+        if (s->read_buf_index < s->read_buf_size)
+            return 1;
+        else
+            return 0;
+    }
+}
+
+static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
+                                     const uint8_t *buf, int len)
 {
     unsigned int ssrc, h;
     int payload_type, seq, ret, flags = 0;
@@ -428,40 +454,6 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
     uint32_t timestamp;
     int rv= 0;
 
-    if (!buf) {
-        /* return the next packets, if any */
-        if(s->st && s->parse_packet) {
-            /* timestamp should be overwritten by parse_packet, if not,
-             * the packet is left with pts == AV_NOPTS_VALUE */
-            timestamp = RTP_NOTS_VALUE;
-            rv= s->parse_packet(s->ic, s->dynamic_protocol_context,
-                                s->st, pkt, &timestamp, NULL, 0, flags);
-            finalize_packet(s, pkt, timestamp);
-            return rv;
-        } else {
-            // TODO: Move to a dynamic packet handler (like above)
-            if (s->read_buf_index >= s->read_buf_size)
-                return -1;
-            ret = ff_mpegts_parse_packet(s->ts, pkt, s->buf + s->read_buf_index,
-                                      s->read_buf_size - s->read_buf_index);
-            if (ret < 0)
-                return -1;
-            s->read_buf_index += ret;
-            if (s->read_buf_index < s->read_buf_size)
-                return 1;
-            else
-                return 0;
-        }
-    }
-
-    if (len < 12)
-        return -1;
-
-    if ((buf[0] & 0xc0) != (RTP_VERSION << 6))
-        return -1;
-    if (buf[1] >= RTCP_SR && buf[1] <= RTCP_APP) {
-        return rtcp_parse_packet(s, buf, len);
-    }
     payload_type = buf[1] & 0x7f;
     if (buf[1] & 0x80)
         flags |= RTP_FLAG_MARKER;
@@ -471,10 +463,6 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
     /* store the ssrc in the RTPDemuxContext */
     s->ssrc = ssrc;
 
-    /* NOTE: we can handle only one payload type */
-    if (s->payload_type != payload_type)
-        return -1;
-
     st = s->st;
     // only do something with this if all the rtp checks pass...
     if(!rtp_valid_packet_in_sequence(&s->statistics, seq))
@@ -550,8 +538,200 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
     return rv;
 }
 
+static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+{
+    uint16_t seq = AV_RB16(buf + 2);
+    RTPPacket **cur = &s->queue, *packet;
+
+    /* find the first queued packet with a later sequence number */
+    while (*cur) {
+        int16_t diff = seq - (*cur)->seq;
+        if (diff < 0)
+            break;
+        if (!diff) {
+            /* already queued */
+            s->statistics.late++;
+            av_free(buf);
+            return;
+        }
+        cur = &(*cur)->next;
+    }
+
+    packet = av_mallocz(sizeof(*packet));
+    if (!packet) {
+        av_free(buf);
+        return;
+    }
+    packet->recvtime = av_gettime();
+    packet->seq      = seq;
+    packet->len      = len;
+    packet->buf      = buf;
+    packet->next     = *cur;
+    *cur = packet;
+    s->queue_len++;
+}
+
+static int has_next_packet(RTPDemuxContext *s)
+{
+    return s->queue && s->queue->seq == (uint16_t)(s->seq + 1);
+}
+
+int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
+{
+    return s->queue ? s->queue->recvtime : 0;
+}
+
+void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
+{
+    while (s->queue) {
+        RTPPacket *next = s->queue->next;
+        av_free(s->queue->buf);
+        av_free(s->queue);
+        s->queue = next;
+    }
+    s->queue_len = 0;
+    s->prev_ret  = 0;
+    s->seq_valid = 0;
+}
+
+/**
+ * Parse the first packet of the queue, giving up on the packets missing
+ * before it.
+ */
+static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
+{
+    RTPPacket *next;
+    int rv;
+
+    /* drop the packets returned or given up on in the meantime */
+    while ((next = s->queue) && (int16_t)(next->seq - s->seq) <= 0) {
+        s->queue = next->next;
+        av_free(next->buf);
+        av_free(next);
+        s->queue_len--;
+    }
+    if (!next)
+        return -1;
+
+    if (next->seq != (uint16_t)(s->seq + 1)) {
+        int missed = (uint16_t)(next->seq - s->seq - 1);
+        s->statistics.lost += missed;
+        av_log(s->ic, AV_LOG_WARNING,
+               "RTP: missed %d packets\n", missed);
+    }
+    rv = rtp_parse_packet_internal(s, pkt, next->buf, next->len);
+    av_free(next->buf);
+    s->queue = next->next;
+    av_free(next);
+    s->queue_len--;
+    return rv;
+}
+
+static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
+                                const uint8_t *buf, int len)
+{
+    const int MAX_DROPOUT = 3000;
+    const int MAX_MISORDER = 100;
+    uint16_t seq;
+    int16_t diff;
+    uint8_t *copy;
+
+    if (!buf) {
+        /* finish the previous packet, then go on with the queue */
+        if (s->prev_ret > 0)
+            return rtp_parse_packet_remaining(s, pkt);
+        return rtp_parse_queued_packet(s, pkt);
+    }
+
+    /* an RTCP BYE without reason is only 8 bytes */
+    if (len < 8)
+        return -1;
+
+    if ((buf[0] & 0xc0) != (RTP_VERSION << 6))
+        return -1;
+    if (buf[1] >= RTCP_SR && buf[1] <= RTCP_APP) {
+        return rtcp_parse_packet(s, buf, len);
+    }
+    if (len < 12)
+        return -1;
+
+    /* NOTE: we can handle only one payload type */
+    if (s->payload_type != (buf[1] & 0x7f))
+        return -1;
+
+    seq = AV_RB16(buf + 2);
+    if (!s->seq_valid || s->queue_size <= 1) {
+        s->seq_valid = 1;
+        return rtp_parse_packet_internal(s, pkt, buf, len);
+    }
+
+    diff = seq - s->seq;
+    if (diff <= 0 && diff > -MAX_MISORDER) {
+        /* the packet was given up on or already returned */
+        s->statistics.late++;
+        av_log(s->ic, AV_LOG_DEBUG,
+               "RTP: dropping late packet %d, expected %d\n",
+               seq, (uint16_t)(s->seq + 1));
+        return -1;
+    } else if (diff == 1) {
+        if (s->queue)
+            s->statistics.reordered++;
+        return rtp_parse_packet_internal(s, pkt, buf, len);
+    } else if (diff <= -MAX_MISORDER || diff >= MAX_DROPOUT) {
+        /* the sender restarted, the queued packets belong to the old run */
+        ff_rtp_reset_packet_queue(s);
+        s->seq_valid = 1;
+        return rtp_parse_packet_internal(s, pkt, buf, len);
+    }
+
+    /* some packets are missing, keep this one until they arrive */
+    copy = av_malloc(len);
+    if (!copy)
+        return -1;
+    memcpy(copy, buf, len);
+    enqueue_packet(s, copy, len);
+
+    /* give up on the missing packets if the queue is full */
+    if (s->queue_len >= s->queue_size)
+        return rtp_parse_queued_packet(s, pkt);
+    return -1;
+}
+
+/**
+ * Parse an RTP or RTCP packet directly sent as a buffer.
+ *
+ * RTP packets arriving ahead of a missing one are kept in a queue of up to
+ * queue_size packets, until the missing packet arrives, the queue is full or
+ * the caller gives up waiting and calls this function with buf NULL.
+ *
+ * @param s RTP parse context.
+ * @param pkt returned packet
+ * @param buf input buffer or NULL to read the next packets
+ * @param len buffer len
+ * @return 0 if a packet is returned, 1 if a packet is returned and more can follow
+ * (use buf as NULL to read the next). -1 if no packet (error or no more packet).
+ */
+int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
+                     const uint8_t *buf, int len)
+{
+    int rv = rtp_parse_one_packet(s, pkt, buf, len);
+    s->prev_ret = rv;
+    while (rv == -1 && has_next_packet(s)) {
+        rv = rtp_parse_queued_packet(s, pkt);
+        s->prev_ret = rv;
+    }
+    return rv ? rv : has_next_packet(s);
+}
+
 void rtp_parse_close(RTPDemuxContext *s)
 {
+    RTPStatistics *stats = &s->statistics;
+
+    if (stats->late || stats->lost || stats->reordered)
+        av_log(s->ic, AV_LOG_VERBOSE,
+               "RTP: %d packets reordered, %d lost, %d late\n",
+               stats->reordered, stats->lost, stats->late);
+    ff_rtp_reset_packet_queue(s);
     if (!strcmp(ff_rtp_enc_name(s->payload_type), "MP2T")) {
         ff_mpegts_parse_close(s->ts);
     }
@@ -35,12 +35,24 @@ typedef struct RTPDynamicProtocolHandler_s RTPDynamicProtocolHandler;
 #define RTP_NOTS_VALUE ((uint32_t)-1)
 
 typedef struct RTPDemuxContext RTPDemuxContext;
-RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *rtpc, int payload_type);
+RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *rtpc,
+                                int payload_type, int queue_size);
 void rtp_parse_set_dynamic_protocol(RTPDemuxContext *s, PayloadContext *ctx,
                                     RTPDynamicProtocolHandler *handler);
 int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
                      const uint8_t *buf, int len);
 void rtp_parse_close(RTPDemuxContext *s);
+/**
+ * Return the time at which the first packet waiting in the reordering
+ * queue was received, or 0 if the queue is empty. Calling rtp_parse_packet()
+ * with buf NULL returns the queued packets, giving up on the missing ones.
+ */
+int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s);
+/**
+ * Drop the packets of the reordering queue and accept the next packet
+ * whatever its sequence number, e.g. after a seek.
+ */
+void ff_rtp_reset_packet_queue(RTPDemuxContext *s);
 #if (LIBAVFORMAT_VERSION_MAJOR <= 53)
 int rtp_get_local_port(URLContext *h);
 #endif
@@ -89,8 +101,20 @@ typedef struct {
     int received_prior;         ///< packets received in last interval
     uint32_t transit;           ///< relative transit time for previous packet
     uint32_t jitter;            ///< estimated jitter.
+    int reordered;              ///< packets put back in order in the reordering queue
+    int lost;                   ///< packets given up on when releasing the queue
+    int late;                   ///< packets dropped for arriving after they were given up on or returned
 } RTPStatistics;
 
+/** packet received ahead of a missing one */
+typedef struct RTPPacket {
+    uint16_t seq;
+    uint8_t *buf;
+    int len;
+    int64_t recvtime;           ///< av_gettime() when the packet was received
+    struct RTPPacket *next;
+} RTPPacket;
+
 #define RTP_FLAG_KEY    0x1 ///< RTP packet contains a keyframe
 #define RTP_FLAG_MARKER 0x2 ///< RTP marker bit was set for this packet
 /**
@@ -152,6 +176,13 @@ struct RTPDemuxContext {
 
     RTPStatistics statistics; ///< Statistics for this stream (used by RTCP receiver reports)
 
+    /* reordering queue */
+    int seq_valid;                 ///< seq holds the last returned sequence number
+    int queue_size;                ///< maximum number of queued packets, 0 or 1 disables reordering
+    int queue_len;
+    RTPPacket *queue;              ///< packets received ahead of a missing one, sorted by seq
+    int prev_ret;                  ///< return value of the last parsed packet
+
     /* rtcp sender statistics receive */
     int64_t last_rtcp_ntp_time;    // TODO: move into statistics
     int64_t first_rtcp_ntp_time;   // TODO: move into statistics
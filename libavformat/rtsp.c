@@ -53,6 +53,8 @@ int rtsp_default_protocols = (1 << RTSP_LOWER_TRANSPORT_UDP);
 #define READ_PACKET_TIMEOUT_S 10
 #define MAX_TIMEOUTS READ_PACKET_TIMEOUT_S * 1000 / SELECT_TIMEOUT_MS
 #define SDP_MAX_SIZE 16384
+/* time to wait for a missing RTP packet if max_delay is not set, in us */
+#define DEFAULT_REORDERING_DELAY 100000
 
 static void get_word_until_chars(char *buf, int buf_size,
                                  const char *sep, const char **pp)
@@ -563,6 +565,9 @@ static int rtsp_open_transport_ctx(AVFormatContext *s, RTSPStream *rtsp_st)
 {
     RTSPState *rt = s->priv_data;
     AVStream *st = NULL;
+    /* packets cannot be reordered over TCP */
+    int queue_size = rt->lower_transport == RTSP_LOWER_TRANSPORT_TCP ?
+                     0 : s->reorder_queue_size;
 
     /* open the RTP context */
     if (rtsp_st->stream_index >= 0)
@@ -580,7 +585,7 @@ static int rtsp_open_transport_ctx(AVFormatContext *s, RTSPStream *rtsp_st)
                                             rtsp_st->dynamic_handler);
     else
         rtsp_st->transport_priv = rtp_parse_open(s, st, rtsp_st->rtp_handle,
-                                         rtsp_st->sdp_payload_type);
+                                         rtsp_st->sdp_payload_type, queue_size);
 
     if (!rtsp_st->transport_priv) {
          return AVERROR(ENOMEM);
@@ -1271,6 +1276,7 @@ static int rtsp_read_play(AVFormatContext *s)
                     st = s->streams[rtsp_st->stream_index];
                 rtpctx->last_rtcp_ntp_time  = AV_NOPTS_VALUE;
                 rtpctx->first_rtcp_ntp_time = AV_NOPTS_VALUE;
+                ff_rtp_reset_packet_queue(rtpctx);
                 if (st)
                     rtpctx->range_start_offset = av_rescale_q(reply->range_start,
                                                               AV_TIME_BASE_Q,
@@ -1667,8 +1673,14 @@ static int rtsp_read_header(AVFormatContext *s,
     return 0;
 }
 
+/**
+ * Read a packet from any of the RTP and RTCP sockets.
+ * @param wait_end time, as given by av_gettime(), after which to give up
+ *                 with AVERROR(EAGAIN) once no more data is pending,
+ *                 0 to wait until the read timeout
+ */
 static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
-                           uint8_t *buf, int buf_size)
+                           uint8_t *buf, int buf_size, int64_t wait_end)
 {
     RTSPState *rt = s->priv_data;
     RTSPStream *rtsp_st;
@@ -1700,6 +1712,8 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
         }
         tv.tv_sec = 0;
         tv.tv_usec = SELECT_TIMEOUT_MS * 1000;
+        if (wait_end)
+            tv.tv_usec = av_clip(wait_end - av_gettime(), 0, tv.tv_usec);
         n = select(fd_max + 1, &rfds, NULL, NULL, &tv);
         if (n > 0) {
             timeout_cnt = 0;
@@ -1729,6 +1743,8 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
                     return 0;
             }
 #endif
+        } else if (n == 0 && wait_end && av_gettime() >= wait_end) {
+            return AVERROR(EAGAIN);
         } else if (n == 0 && ++timeout_cnt >= MAX_TIMEOUTS) {
             return FF_NETERROR(ETIMEDOUT);
         } else if (n < 0 && errno != EINTR)
@@ -1795,10 +1811,8 @@ static int rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
     RTSPState *rt = s->priv_data;
     int ret, len;
     uint8_t buf[10 * RTP_MAX_PACKET_LENGTH];
-    RTSPStream *rtsp_st;
-
-    if (rt->nb_byes == rt->nb_rtsp_streams)
-        return AVERROR_EOF;
+    RTSPStream *rtsp_st, *first_queue_st;
+    int64_t wait_end;
 
     /* get next frames from the same RTP packet */
     if (rt->cur_transport_priv) {
@@ -1817,6 +1831,38 @@ static int rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 
     /* read next RTP packet */
  redo:
+    /* wait for the packets missing in the reordering queues no longer than
+     * max_delay after the first queued packet arrived */
+    first_queue_st = NULL;
+    wait_end = 0;
+    if (rt->transport == RTSP_TRANSPORT_RTP) {
+        int64_t first_queue_time = 0;
+        int i;
+        for (i = 0; i < rt->nb_rtsp_streams; i++) {
+            RTPDemuxContext *rtpctx = rt->rtsp_streams[i]->transport_priv;
+            int64_t queue_time;
+            if (!rtpctx)
+                continue;
+            queue_time = ff_rtp_queued_packet_time(rtpctx);
+            if (queue_time && (!first_queue_time || queue_time < first_queue_time)) {
+                first_queue_time = queue_time;
+                first_queue_st   = rt->rtsp_streams[i];
+            }
+        }
+        if (first_queue_time)
+            wait_end = first_queue_time + (s->max_delay > 0 ? s->max_delay :
+                                           DEFAULT_REORDERING_DELAY);
+    }
+
+    if (rt->nb_byes == rt->nb_rtsp_streams) {
+        if (!first_queue_st)
+            return AVERROR_EOF;
+        /* nothing else will arrive, flush the queues */
+        rtsp_st = first_queue_st;
+        ret = rtp_parse_packet(rtsp_st->transport_priv, pkt, NULL, 0);
+        goto end;
+    }
+
     switch(rt->lower_transport) {
     default:
 #if CONFIG_RTSP_DEMUXER
@@ -1826,7 +1872,13 @@ static int rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 #endif
     case RTSP_LOWER_TRANSPORT_UDP:
     case RTSP_LOWER_TRANSPORT_UDP_MULTICAST:
-        len = udp_read_packet(s, &rtsp_st, buf, sizeof(buf));
+        len = udp_read_packet(s, &rtsp_st, buf, sizeof(buf), wait_end);
+        if (len == AVERROR(EAGAIN) && first_queue_st) {
+            /* the missing packets did not arrive in time, give up on them */
+            rtsp_st = first_queue_st;
+            ret = rtp_parse_packet(rtsp_st->transport_priv, pkt, NULL, 0);
+            goto end;
+        }
         if (len >=0 && rtsp_st->transport_priv && rt->transport == RTSP_TRANSPORT_RTP)
             rtp_check_and_send_back_rr(rtsp_st->transport_priv, len);
         break;
@@ -1861,12 +1913,10 @@ static int rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 
                 av_log(s, AV_LOG_DEBUG, "Received BYE for stream %d (%d/%d)\n",
                        rtsp_st->stream_index, rt->nb_byes, rt->nb_rtsp_streams);
-
-                if (rt->nb_byes == rt->nb_rtsp_streams)
-                    return AVERROR_EOF;
             }
         }
     }
+end:
     if (ret < 0)
         goto redo;
     if (ret == 1)
@@ -81,7 +81,7 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
 
         /* wait until we are connected or until abort */
         for(;;) {
-            if (url_interrupt_cb()) {
+            if (ff_url_interrupted(h)) {
                 ret = AVERROR(EINTR);
                 goto fail1;
             }
@@ -140,7 +140,7 @@ static int tcp_read(URLContext *h, uint8_t *buf, int size)
     struct timeval tv;
 
     for (;;) {
-        if (url_interrupt_cb())
+        if (ff_url_interrupted(h))
             return AVERROR(EINTR);
         fd_max = s->fd;
         FD_ZERO(&rfds);
@@ -172,7 +172,7 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
 
     size1 = size;
     while (size > 0) {
-        if (url_interrupt_cb())
+        if (ff_url_interrupted(h))
             return AVERROR(EINTR);
         fd_max = s->fd;
         FD_ZERO(&wfds);
@@ -73,4 +73,14 @@ typedef int x86_reg;
 #    define BROKEN_RELOCATIONS 1
 #endif
 
+/* The xmm registers used by inline asm, for the compilers that know them;
+ * XMM_CLOBBERS() goes after other clobbers, XMM_CLOBBERS_ONLY() alone. */
+#if HAVE_XMM_CLOBBERS
+#    define XMM_CLOBBERS(...)        __VA_ARGS__
+#    define XMM_CLOBBERS_ONLY(...) : __VA_ARGS__
+#else
+#    define XMM_CLOBBERS(...)
+#    define XMM_CLOBBERS_ONLY(...)
+#endif
+
 #endif /* AVUTIL_X86_CPU_H */
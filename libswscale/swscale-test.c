@@ -23,6 +23,7 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdarg.h>
+#include <sys/time.h>
 
 #undef HAVE_AV_CONFIG_H
 #include "libavcore/imgutils.h"
@@ -339,6 +340,101 @@ static int fileTest(uint8_t *ref[4], int refStride[4], int w, int h, FILE *fp,
     return 0;
 }
 
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* frame sized conversions for -bench */
+static const struct {
+    enum PixelFormat srcFormat;
+    int srcW, srcH;
+    enum PixelFormat dstFormat;
+    int dstW, dstH;
+    int flags;
+} benchCases[] = {
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_RGB32,   1280, 720, SWS_BICUBIC },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_BGR32,   1280, 720, SWS_BICUBIC },
+    { PIX_FMT_YUV420P,  352, 288, PIX_FMT_YUV420P, 1280, 720, SWS_BICUBIC },
+    { PIX_FMT_YUV420P,  352, 288, PIX_FMT_YUV420P, 1280, 720, SWS_BICUBIC | SWS_ACCURATE_RND },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_YUV420P,  640, 360, SWS_LANCZOS },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_YUV420P,  640, 360, SWS_AREA },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_YUV420P,  320, 180, SWS_AREA },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_YUV420P,  160,  90, SWS_AREA },
+    { PIX_FMT_YUV420P, 1280, 720, PIX_FMT_YUV420P,  640, 360, SWS_BICUBIC },
+};
+
+/**
+ * Print the average time sws_scale() takes for each of benchCases.
+ */
+static int benchTest(uint8_t *ref[4], int refStride[4], int w, int h,
+                     int iterations,
+                     enum PixelFormat srcFormat_in,
+                     enum PixelFormat dstFormat_in)
+{
+    int n, res = 0;
+
+    for (n = 0; n < FF_ARRAY_ELEMS(benchCases) && !res; n++) {
+        const enum PixelFormat srcFormat = benchCases[n].srcFormat;
+        const enum PixelFormat dstFormat = benchCases[n].dstFormat;
+        const int srcW = benchCases[n].srcW, srcH = benchCases[n].srcH;
+        const int dstW = benchCases[n].dstW, dstH = benchCases[n].dstH;
+        uint8_t *src[4] = {0}, *dst[4] = {0};
+        int srcStride[4], dstStride[4];
+        struct SwsContext *srcContext, *dstContext;
+        int64_t t;
+        int i;
+
+        if ((srcFormat_in != PIX_FMT_NONE && srcFormat_in != srcFormat) ||
+            (dstFormat_in != PIX_FMT_NONE && dstFormat_in != dstFormat))
+            continue;
+
+        av_image_fill_linesizes(srcStride, srcFormat, srcW);
+        av_image_fill_linesizes(dstStride, dstFormat, dstW);
+        for (i = 0; i < 4; i++) {
+            if (srcStride[i] && !(src[i] = av_mallocz(srcStride[i]*srcH+16)))
+                res = -1;
+            if (dstStride[i] && !(dst[i] = av_mallocz(dstStride[i]*dstH+16)))
+                res = -1;
+        }
+        srcContext = sws_getContext(w, h, PIX_FMT_YUVA420P, srcW, srcH,
+                                    srcFormat, SWS_BILINEAR, NULL, NULL, NULL);
+        dstContext = sws_getContext(srcW, srcH, srcFormat, dstW, dstH,
+                                    dstFormat, benchCases[n].flags, NULL, NULL, NULL);
+        if (res || !srcContext || !dstContext) {
+            fprintf(stderr, "Failed to set up %s ---> %s\n",
+                    av_pix_fmt_descriptors[srcFormat].name,
+                    av_pix_fmt_descriptors[dstFormat].name);
+            res = -1;
+        } else {
+            sws_scale(srcContext, ref, refStride, 0, h, src, srcStride);
+            sws_scale(dstContext, src, srcStride, 0, srcH, dst, dstStride);
+
+            t = gettime();
+            for (i = 0; i < iterations; i++)
+                sws_scale(dstContext, src, srcStride, 0, srcH, dst, dstStride);
+            t = gettime() - t;
+
+            printf(" %s %dx%d -> %s %dx%d flags=%d %.3f ms\n",
+                   av_pix_fmt_descriptors[srcFormat].name, srcW, srcH,
+                   av_pix_fmt_descriptors[dstFormat].name, dstW, dstH,
+                   benchCases[n].flags, t / 1000.0 / iterations);
+            fflush(stdout);
+        }
+
+        sws_freeContext(srcContext);
+        sws_freeContext(dstContext);
+        for (i = 0; i < 4; i++) {
+            av_free(src[i]);
+            av_free(dst[i]);
+        }
+    }
+
+    return res;
+}
+
 #define W 96
 #define H 96
 
@@ -386,6 +482,16 @@ int main(int argc, char **argv)
             res = fileTest(src, stride, W, H, fp, srcFormat, dstFormat);
             fclose(fp);
             goto end;
+        } else if (!strcmp(argv[i], "-bench")) {
+            int iterations = atoi(argv[i+1]);
+            if (iterations <= 0) {
+                fprintf(stderr, "invalid number of iterations %s\n", argv[i+1]);
+                goto error;
+            }
+            res = benchTest(src, stride, W, H, iterations, srcFormat, dstFormat);
+            if (res < 0)
+                goto error;
+            goto end;
         } else if (!strcmp(argv[i], "-src")) {
             srcFormat = av_get_pix_fmt(argv[i+1]);
             if (srcFormat == PIX_FMT_NONE) {
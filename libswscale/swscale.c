@@ -1263,6 +1263,8 @@ SwsFunc ff_getSwsFunc(SwsContext *c)
     // ordered per speed fastest first
     if (flags & SWS_CPU_CAPS_MMX2) {
         sws_init_swScale_MMX2(c);
+        if (HAVE_SSE && flags & SWS_CPU_CAPS_SSE2)
+            ff_sws_init_swScale_sse2(c);
         return swScale_MMX2;
     } else if (flags & SWS_CPU_CAPS_3DNOW) {
         sws_init_swScale_3DNow(c);
@@ -1291,6 +1293,8 @@ SwsFunc ff_getSwsFunc(SwsContext *c)
 #else //CONFIG_RUNTIME_CPUDETECT
 #if   COMPILE_TEMPLATE_MMX2
     sws_init_swScale_MMX2(c);
+    if (HAVE_SSE && c->flags & SWS_CPU_CAPS_SSE2)
+        ff_sws_init_swScale_sse2(c);
     return swScale_MMX2;
 #elif COMPILE_TEMPLATE_AMD3DNOW
     sws_init_swScale_3DNow(c);
@@ -1696,6 +1700,86 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t* src[], int srcStride[
     return srcSliceH;
 }
 
+void ff_sws_box_row_c(uint8_t *dst, const uint8_t *src, int srcStride,
+                      int dstW, int boxW, int boxH)
+{
+    const int shift = av_log2(boxW*boxH);
+    const int round = (1<<shift)>>1;
+    int x, i, j;
+
+    for (x=0; x<dstW; x++) {
+        const uint8_t *p= src + x*boxW;
+        int sum= round;
+        for (j=0; j<boxH; j++) {
+            for (i=0; i<boxW; i++)
+                sum+= p[i];
+            p+= srcStride;
+        }
+        dst[x]= sum>>shift;
+    }
+}
+
+static int boxDownscaleWrapper(SwsContext *c, const uint8_t* src[], int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t* dst[], int dstStride[])
+{
+    const int align= c->boxH<<c->chrSrcVSubSample;
+    int plane, y;
+
+    if (srcSliceY % align || (srcSliceH % align && srcSliceY + srcSliceH != c->srcH)) {
+        av_log(c, AV_LOG_ERROR, "box downscaler needs slices aligned to %d lines\n", align);
+        return 0;
+    }
+
+    for (plane=0; plane<4; plane++) {
+        int isChr = plane==1 || plane==2;
+        int width = isChr ? c->chrDstW : c->dstW;
+        int srcY  = isChr ? srcSliceY>>c->chrSrcVSubSample : srcSliceY;
+        int height= isChr ? -((-srcSliceH)>>c->chrSrcVSubSample) : srcSliceH;
+        const uint8_t *srcPtr= src[plane];
+        uint8_t *dstPtr;
+
+        if (!dst[plane] || !src[plane]) continue;
+        dstPtr= dst[plane] + dstStride[plane]*(srcY/c->boxH);
+        for (y=0; y<height; y+=c->boxH) {
+            c->boxRow(dstPtr, srcPtr, srcStride[plane], width, c->boxW, c->boxH);
+            srcPtr+= srcStride[plane]*c->boxH;
+            dstPtr+= dstStride[plane];
+        }
+    }
+    return srcSliceH/c->boxH;
+}
+
+static int boxFactor(int src, int dst)
+{
+    int f= src/dst;
+    return src == f*dst && (f==1 || f==2 || f==4 || f==8) ? f : 0;
+}
+
+void ff_get_box_swscale(SwsContext *c)
+{
+    const enum PixelFormat format = c->srcFormat;
+
+    if (format != c->dstFormat || c->vChrDrop)
+        return;
+    if (!(isGray(format) && !isGray16(format)) &&
+        !(isPlanar8YUV(format) && format != PIX_FMT_NV12 && format != PIX_FMT_NV21))
+        return;
+
+    c->boxW= boxFactor(c->srcW, c->dstW);
+    c->boxH= boxFactor(c->srcH, c->dstH);
+    if (!c->boxW || !c->boxH || c->boxW*c->boxH == 1)
+        return;
+    if (c->chrSrcW != c->chrDstW*c->boxW || c->chrSrcH != c->chrDstH*c->boxH)
+        return;
+
+    c->boxRow = ff_sws_box_row_c;
+#if ARCH_X86 && HAVE_SSE
+    if (c->flags & SWS_CPU_CAPS_SSE2)
+        ff_sws_init_box_sse2(c);
+#endif
+    c->swScale= boxDownscaleWrapper;
+}
+
 int ff_hardcodedcpuflags(void)
 {
     int flags = 0;
@@ -221,6 +221,10 @@ typedef struct SwsContext {
     DECLARE_ALIGNED(8, uint64_t, y_temp);
     int32_t  alpMmxFilter[4*MAX_FILTER_SIZE];
 
+#if HAVE_SSE
+    DECLARE_ALIGNED(16, uint64_t, sse2Coeffs)[8][2]; ///< the MMX coefficients and offsets widened to 128 bits for the SSE2 YUV->RGB code, in the order of the SSE2_* offsets in x86/yuv2rgb_mmx.c.
+#endif
+
 #if HAVE_ALTIVEC
     vector signed short   CY;
     vector signed short   CRV;
@@ -314,6 +318,11 @@ typedef struct SwsContext {
 
     int needs_hcscale; ///< Set if there are chroma planes to be converted.
 
+    int boxW;          ///< Horizontal reduction factor of the box downscaler.
+    int boxH;          ///< Vertical reduction factor of the box downscaler.
+    void (*boxRow)(uint8_t *dst, const uint8_t *src, int srcStride,
+                   int dstW, int boxW, int boxH); ///< Average boxW x boxH blocks of src into one line of dst.
+
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -325,6 +334,8 @@ int ff_yuv2rgb_c_init_tables(SwsContext *c, const int inv_table[4],
 void ff_yuv2rgb_init_tables_altivec(SwsContext *c, const int inv_table[4],
                                     int brightness, int contrast, int saturation);
 SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c);
+void ff_sws_init_swScale_sse2(SwsContext *c);
+void ff_sws_init_box_sse2(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_vis(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_mlib(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_altivec(SwsContext *c);
@@ -454,6 +465,12 @@ extern const AVClass sws_context_class;
  * source and destination formats, bit depths, flags, etc.
  */
 void ff_get_unscaled_swscale(SwsContext *c);
+void ff_get_box_swscale(SwsContext *c);
+/**
+ * C version of SwsContext.boxRow.
+ */
+void ff_sws_box_row_c(uint8_t *dst, const uint8_t *src, int srcStride,
+                      int dstW, int boxW, int boxH);
 
 /**
  * Returns the SWS_CPU_CAPS for the optimized code compiled into swscale.
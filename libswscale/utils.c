@@ -42,6 +42,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/x86_cpu.h"
 #include "libavutil/avutil.h"
+#include "libavutil/cpu.h"
 #include "libavutil/bswap.h"
 #include "libavutil/pixdesc.h"
 
@@ -723,8 +724,13 @@ static int handle_jpeg(enum PixelFormat *format)
 static int update_flags_cpu(int flags)
 {
 #if !CONFIG_RUNTIME_CPUDETECT //ensure that the flags match the compiled variant if cpudetect is off
-    flags &= ~(SWS_CPU_CAPS_MMX|SWS_CPU_CAPS_MMX2|SWS_CPU_CAPS_3DNOW|SWS_CPU_CAPS_ALTIVEC|SWS_CPU_CAPS_BFIN);
+    flags &= ~(SWS_CPU_CAPS_MMX|SWS_CPU_CAPS_MMX2|SWS_CPU_CAPS_3DNOW|SWS_CPU_CAPS_SSE2|SWS_CPU_CAPS_ALTIVEC|SWS_CPU_CAPS_BFIN);
     flags |= ff_hardcodedcpuflags();
+#if ARCH_X86 && HAVE_SSE
+    // the SSE2 functions sit on top of the MMX2 ones, pick them only if the CPU has SSE2
+    if ((flags & SWS_CPU_CAPS_MMX2) && (av_get_cpu_flags() & AV_CPU_FLAG_SSE2))
+        flags |= SWS_CPU_CAPS_SSE2;
+#endif
 #endif /* CONFIG_RUNTIME_CPUDETECT */
     return flags;
 }
@@ -862,6 +868,18 @@ SwsContext *sws_getContext(int srcW, int srcH, enum PixelFormat srcFormat,
         }
     }
 
+    /* exact 2/4/8 times area downscaling */
+    if ((flags & SWS_AREA) && !unscaled && !usesHFilter && !usesVFilter && srcRange == dstRange) {
+        ff_get_box_swscale(c);
+
+        if (c->swScale) {
+            if (flags&SWS_PRINT_INFO)
+                av_log(c, AV_LOG_INFO, "using %dx%d box downscaler for %s\n",
+                       c->boxW, c->boxH, sws_format_name(srcFormat));
+            return c;
+        }
+    }
+
     if (flags & SWS_CPU_CAPS_MMX2) {
         c->canMMX2BeUsed= (dstW >=srcW && (dstW&31)==0 && (srcW&15)==0) ? 1 : 0;
         if (!c->canMMX2BeUsed && dstW >=srcW && (srcW&15)==0 && (flags&SWS_FAST_BILINEAR)) {
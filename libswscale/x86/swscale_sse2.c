@@ -0,0 +1,656 @@
+/*
+ * SSE2 horizontal and vertical scaler
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <assert.h>
+
+#include "config.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+#include "libavutil/x86_cpu.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+DECLARE_ASM_CONST(16, uint16_t, sse2_vrounder)[8] = { 4, 4, 4, 4, 4, 4, 4, 4 };
+DECLARE_ASM_CONST(16, int32_t,  sse2_vrounder_accurate)[4] = { 1<<18, 1<<18, 1<<18, 1<<18 };
+
+/**
+ * One tap of the vertical filter as seen by the SSE2 loops: the coefficient
+ * broadcast over a whole register and the source line(s) it applies to.
+ * In accurate mode, coef holds two interleaved taps for src[0] and src[1].
+ * The list is terminated by an entry with src[0] == NULL.
+ */
+typedef struct VScaleTap {
+    int16_t coef[8];
+    const int16_t *src[16 / sizeof(void *)];
+} VScaleTap;
+
+#define VTAP_SIZE  "32"
+#define VTAP_SRC   "16"
+#if ARCH_X86_64
+#define VTAP_SRC2  "24"
+#else
+#define VTAP_SRC2  "20"
+#endif
+
+static void hScale_SSE2(int16_t *dst, int dstW, const uint8_t *src, int srcW, int xInc,
+                        const int16_t *filter, const int16_t *filterPos, long filterSize)
+{
+    int i;
+
+    assert(filterSize % 4 == 0 && filterSize > 0);
+    if (filterSize == 4) {
+        for (i = 0; i + 2 <= dstW; i += 2) {
+            int res;
+            __asm__ volatile(
+                "pxor             %%xmm7, %%xmm7        \n\t"
+                "movd               (%1), %%xmm0        \n\t"
+                "movd               (%2), %%xmm1        \n\t"
+                "movdqu             (%3), %%xmm2        \n\t"
+                "punpckldq        %%xmm1, %%xmm0        \n\t"
+                "punpcklbw        %%xmm7, %%xmm0        \n\t"
+                "pmaddwd          %%xmm2, %%xmm0        \n\t"
+                "pshufd    $0xB1, %%xmm0, %%xmm1        \n\t"
+                "paddd            %%xmm1, %%xmm0        \n\t"
+                "pshufd    $0x08, %%xmm0, %%xmm0        \n\t"
+                "psrad                $7, %%xmm0        \n\t"
+                "packssdw         %%xmm0, %%xmm0        \n\t"
+                "movd             %%xmm0, %0            \n\t"
+                : "=r"(res)
+                : "r"(src + filterPos[i]), "r"(src + filterPos[i + 1]),
+                  "r"(filter + 4 * i)
+                XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm7")
+            );
+            AV_WN32(dst + i, res);
+        }
+    } else {
+        const x86_reg fstride = 2 * filterSize;
+        const int     tail    = filterSize & 4;
+
+        for (i = 0; i + 2 <= dstW; i += 2) {
+            const uint8_t *s0  = src + filterPos[i];
+            const uint8_t *s1  = src + filterPos[i + 1];
+            const uint8_t *end = s0 + (filterSize & ~7);
+            const int16_t *f   = filter + filterSize * i;
+            int res;
+            __asm__ volatile(
+                "pxor             %%xmm7, %%xmm7        \n\t"
+                "pxor             %%xmm4, %%xmm4        \n\t"
+                "pxor             %%xmm5, %%xmm5        \n\t"
+                ASMALIGN(4)
+                "1:                                     \n\t"
+                "movq               (%1), %%xmm0        \n\t"
+                "movq               (%2), %%xmm1        \n\t"
+                "movdqu             (%3), %%xmm2        \n\t"
+                "movdqu         (%3, %5), %%xmm3        \n\t"
+                "punpcklbw        %%xmm7, %%xmm0        \n\t"
+                "punpcklbw        %%xmm7, %%xmm1        \n\t"
+                "pmaddwd          %%xmm2, %%xmm0        \n\t"
+                "pmaddwd          %%xmm3, %%xmm1        \n\t"
+                "paddd            %%xmm0, %%xmm4        \n\t"
+                "paddd            %%xmm1, %%xmm5        \n\t"
+                "add                  $8, %1            \n\t"
+                "add                  $8, %2            \n\t"
+                "add                 $16, %3            \n\t"
+                "cmp                  %4, %1            \n\t"
+                " jb                  1b                \n\t"
+                "cmpl                 $0, %6            \n\t"
+                " je                  2f                \n\t"
+                "movd               (%1), %%xmm0        \n\t"
+                "movd               (%2), %%xmm1        \n\t"
+                "movq               (%3), %%xmm2        \n\t"
+                "movq           (%3, %5), %%xmm3        \n\t"
+                "punpcklbw        %%xmm7, %%xmm0        \n\t"
+                "punpcklbw        %%xmm7, %%xmm1        \n\t"
+                "pmaddwd          %%xmm2, %%xmm0        \n\t"
+                "pmaddwd          %%xmm3, %%xmm1        \n\t"
+                "paddd            %%xmm0, %%xmm4        \n\t"
+                "paddd            %%xmm1, %%xmm5        \n\t"
+                "2:                                     \n\t"
+                "movdqa           %%xmm4, %%xmm0        \n\t"
+                "punpckldq        %%xmm5, %%xmm4        \n\t"
+                "punpckhdq        %%xmm5, %%xmm0        \n\t"
+                "paddd            %%xmm0, %%xmm4        \n\t"
+                "pshufd    $0x4E, %%xmm4, %%xmm0        \n\t"
+                "paddd            %%xmm0, %%xmm4        \n\t"
+                "psrad                $7, %%xmm4        \n\t"
+                "packssdw         %%xmm4, %%xmm4        \n\t"
+                "movd             %%xmm4, %0            \n\t"
+                : "=r"(res), "+r"(s0), "+r"(s1), "+r"(f)
+                : "r"(end), "r"(fstride), "m"(tail)
+                XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7")
+            );
+            AV_WN32(dst + i, res);
+        }
+    }
+
+    for (; i < dstW; i++) {
+        const int16_t *f = filter + filterSize * i;
+        const uint8_t *s = src + filterPos[i];
+        int j, val = 0;
+        for (j = 0; j < filterSize; j++)
+            val += s[j] * f[j];
+        dst[i] = av_clip_int16(val >> 7);
+    }
+}
+
+/**
+ * Same arithmetic as the MMX YSCALEYUV2YV12X loop (pmulhw products summed
+ * on top of vRounder, >>3), 16 pixels per iteration. width is a multiple of 8.
+ */
+static void vscale_fast_SSE2(const VScaleTap *taps, uint8_t *dest, x86_reg width)
+{
+    x86_reg w16 = width & ~15;
+
+    if (w16)
+    __asm__ volatile(
+        "xor                  %%"REG_a", %%"REG_a"  \n\t"
+        ASMALIGN(4)
+        "1:                                         \n\t"
+        "movdqa  "MANGLE(sse2_vrounder)", %%xmm3    \n\t"
+        "movdqa                   %%xmm3, %%xmm4    \n\t"
+        "mov                          %0, %%"REG_d" \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "2:                                         \n\t"
+        "movdqu               (%%"REG_d"), %%xmm0   \n\t"
+        "movdqu    (%%"REG_S", %%"REG_a", 2), %%xmm2 \n\t"
+        "movdqu  16(%%"REG_S", %%"REG_a", 2), %%xmm5 \n\t"
+        "add              $"VTAP_SIZE", %%"REG_d"   \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "pmulhw                   %%xmm0, %%xmm2    \n\t"
+        "pmulhw                   %%xmm0, %%xmm5    \n\t"
+        "paddw                    %%xmm2, %%xmm3    \n\t"
+        "paddw                    %%xmm5, %%xmm4    \n\t"
+        "test                 %%"REG_S", %%"REG_S"  \n\t"
+        " jnz                         2b            \n\t"
+        "psraw                        $3, %%xmm3    \n\t"
+        "psraw                        $3, %%xmm4    \n\t"
+        "packuswb                 %%xmm4, %%xmm3    \n\t"
+        "movdqu                   %%xmm3, (%1, %%"REG_a") \n\t"
+        "add                         $16, %%"REG_a" \n\t"
+        "cmp                          %2, %%"REG_a" \n\t"
+        " jb                          1b            \n\t"
+        :: "r"(taps), "r"(dest), "g"(w16)
+        : "%"REG_a, "%"REG_d, "%"REG_S, "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm2", "%xmm3", "%xmm4", "%xmm5")
+    );
+
+    if (width & 8)
+    __asm__ volatile(
+        "movdqa  "MANGLE(sse2_vrounder)", %%xmm3    \n\t"
+        "mov                          %0, %%"REG_d" \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "1:                                         \n\t"
+        "movdqu               (%%"REG_d"), %%xmm0   \n\t"
+        "movdqu    (%%"REG_S", %2, 2), %%xmm2       \n\t"
+        "add              $"VTAP_SIZE", %%"REG_d"   \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "pmulhw                   %%xmm0, %%xmm2    \n\t"
+        "paddw                    %%xmm2, %%xmm3    \n\t"
+        "test                 %%"REG_S", %%"REG_S"  \n\t"
+        " jnz                         1b            \n\t"
+        "psraw                        $3, %%xmm3    \n\t"
+        "packuswb                 %%xmm3, %%xmm3    \n\t"
+        "movq                     %%xmm3, (%1, %2)  \n\t"
+        :: "r"(taps), "r"(dest), "r"(w16)
+        : "%"REG_d, "%"REG_S, "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm2", "%xmm3")
+    );
+}
+
+/**
+ * Exact equivalent of yuv2yuvXinC() for the first width & ~7 pixels:
+ * pairs of taps are combined with pmaddwd into 32-bit sums.
+ */
+static void vscale_accurate_SSE2(const VScaleTap *taps, uint8_t *dest, x86_reg width)
+{
+    __asm__ volatile(
+        "xor                  %%"REG_a", %%"REG_a"  \n\t"
+        ASMALIGN(4)
+        "1:                                         \n\t"
+        "movdqa "MANGLE(sse2_vrounder_accurate)", %%xmm4 \n\t"
+        "movdqa                   %%xmm4, %%xmm5    \n\t"
+        "mov                          %0, %%"REG_d" \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "2:                                         \n\t"
+        "movdqu    (%%"REG_S", %%"REG_a", 2), %%xmm0 \n\t"
+        "mov       "VTAP_SRC2"(%%"REG_d"), %%"REG_S" \n\t"
+        "movdqu    (%%"REG_S", %%"REG_a", 2), %%xmm1 \n\t"
+        "movdqu               (%%"REG_d"), %%xmm3   \n\t"
+        "movdqa                   %%xmm0, %%xmm2    \n\t"
+        "punpcklwd                %%xmm1, %%xmm0    \n\t"
+        "punpckhwd                %%xmm1, %%xmm2    \n\t"
+        "add              $"VTAP_SIZE", %%"REG_d"   \n\t"
+        "mov        "VTAP_SRC"(%%"REG_d"), %%"REG_S" \n\t"
+        "pmaddwd                  %%xmm3, %%xmm0    \n\t"
+        "pmaddwd                  %%xmm3, %%xmm2    \n\t"
+        "paddd                    %%xmm0, %%xmm4    \n\t"
+        "paddd                    %%xmm2, %%xmm5    \n\t"
+        "test                 %%"REG_S", %%"REG_S"  \n\t"
+        " jnz                         2b            \n\t"
+        "psrad                       $19, %%xmm4    \n\t"
+        "psrad                       $19, %%xmm5    \n\t"
+        "packssdw                 %%xmm5, %%xmm4    \n\t"
+        "packuswb                 %%xmm4, %%xmm4    \n\t"
+        "movq                     %%xmm4, (%1, %%"REG_a") \n\t"
+        "add                          $8, %%"REG_a" \n\t"
+        "cmp                          %2, %%"REG_a" \n\t"
+        " jb                          1b            \n\t"
+        :: "r"(taps), "r"(dest), "g"(width & ~7)
+        : "%"REG_a, "%"REG_d, "%"REG_S, "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5")
+    );
+}
+
+static void init_taps_fast(VScaleTap *taps, const int16_t *filter,
+                           const int16_t **src, int size, int offset)
+{
+    int i, j;
+    for (i = 0; i < size; i++) {
+        for (j = 0; j < 8; j++)
+            taps[i].coef[j] = filter[i];
+        taps[i].src[0] = src[i] + offset;
+    }
+    taps[i].src[0] = NULL;
+}
+
+static void init_taps_accurate(VScaleTap *taps, const int16_t *filter,
+                               const int16_t **src, int size, int offset)
+{
+    int i, j;
+    for (i = 0; i < size; i += 2) {
+        int last = i + 1 == size;
+        for (j = 0; j < 8; j += 2) {
+            taps[i >> 1].coef[j    ] = filter[i];
+            taps[i >> 1].coef[j + 1] = last ? 0 : filter[i + 1];
+        }
+        taps[i >> 1].src[0] = src[i] + offset;
+        taps[i >> 1].src[1] = src[i + !last] + offset;
+    }
+    taps[i >> 1].src[0] = NULL;
+}
+
+static void vscale_plane_SSE2(SwsContext *c, VScaleTap *taps,
+                              const int16_t *filter, const int16_t **src,
+                              int filterSize, int offset,
+                              uint8_t *dest, int width)
+{
+    if (c->flags & (SWS_ACCURATE_RND | SWS_BITEXACT)) {
+        int i, j;
+
+        init_taps_accurate(taps, filter, src, filterSize, offset);
+        if (width >= 8)
+            vscale_accurate_SSE2(taps, dest, width);
+        for (i = width & ~7; i < width; i++) {
+            int val = 1 << 18;
+            for (j = 0; j < filterSize; j++)
+                val += src[j][i + offset] * filter[j];
+            dest[i] = av_clip_uint8(val >> 19);
+        }
+    } else {
+        init_taps_fast(taps, filter, src, filterSize, offset);
+        vscale_fast_SSE2(taps, dest, (width + 7) & ~7);
+    }
+}
+
+static void yuv2yuvX_SSE2(SwsContext *c, const int16_t *lumFilter, const int16_t **lumSrc, int lumFilterSize,
+                          const int16_t *chrFilter, const int16_t **chrSrc, int chrFilterSize, const int16_t **alpSrc,
+                          uint8_t *dest, uint8_t *uDest, uint8_t *vDest, uint8_t *aDest, long dstW, long chrDstW)
+{
+    DECLARE_ALIGNED(16, VScaleTap, taps)[MAX_FILTER_SIZE + 1];
+
+    if (uDest) {
+        vscale_plane_SSE2(c, taps, chrFilter, chrSrc, chrFilterSize, 0,    uDest, chrDstW);
+        vscale_plane_SSE2(c, taps, chrFilter, chrSrc, chrFilterSize, VOFW, vDest, chrDstW);
+    }
+    if (CONFIG_SWSCALE_ALPHA && aDest)
+        vscale_plane_SSE2(c, taps, lumFilter, alpSrc, lumFilterSize, 0, aDest, dstW);
+
+    vscale_plane_SSE2(c, taps, lumFilter, lumSrc, lumFilterSize, 0, dest, dstW);
+}
+
+void ff_sws_init_swScale_sse2(SwsContext *c)
+{
+    c->hScale   = hScale_SSE2;
+    c->yuv2yuvX = yuv2yuvX_SSE2;
+}
+
+static void box_tail(uint8_t *dst, const uint8_t *src, int srcStride,
+                     int x, int dstW, int boxW, int boxH)
+{
+    if (x < dstW)
+        ff_sws_box_row_c(dst + x, src + x * boxW, srcStride, dstW - x, boxW, boxH);
+}
+
+static void box2x2_SSE2(uint8_t *dst, const uint8_t *src, int srcStride,
+                        int dstW, int boxW, int boxH)
+{
+    x86_reg count = dstW & ~7;
+    uint8_t       *d = dst;
+    const uint8_t *s = src;
+
+    if (count)
+    __asm__ volatile(
+        "pcmpeqw          %%xmm7, %%xmm7        \n\t"
+        "psrlw                $8, %%xmm7        \n\t" // 0x00ff
+        "pcmpeqw          %%xmm6, %%xmm6        \n\t"
+        "psrlw               $15, %%xmm6        \n\t"
+        "psllw                $1, %%xmm6        \n\t" // 2
+        ASMALIGN(4)
+        "1:                                     \n\t"
+        "movdqu             (%1), %%xmm0        \n\t"
+        "movdqu         (%1, %3), %%xmm1        \n\t"
+        "movdqa           %%xmm0, %%xmm2        \n\t"
+        "movdqa           %%xmm1, %%xmm3        \n\t"
+        "psrlw                $8, %%xmm0        \n\t"
+        "psrlw                $8, %%xmm1        \n\t"
+        "pand             %%xmm7, %%xmm2        \n\t"
+        "pand             %%xmm7, %%xmm3        \n\t"
+        "paddw            %%xmm1, %%xmm0        \n\t"
+        "paddw            %%xmm3, %%xmm2        \n\t"
+        "paddw            %%xmm2, %%xmm0        \n\t"
+        "paddw            %%xmm6, %%xmm0        \n\t"
+        "psrlw                $2, %%xmm0        \n\t"
+        "packuswb         %%xmm0, %%xmm0        \n\t"
+        "movq             %%xmm0, (%0)          \n\t"
+        "add                 $16, %1            \n\t"
+        "add                  $8, %0            \n\t"
+        "sub                  $8, %2            \n\t"
+        " jg                  1b                \n\t"
+        : "+r"(d), "+r"(s), "+r"(count)
+        : "r"((x86_reg)srcStride)
+        : "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm6", "%xmm7")
+    );
+    box_tail(dst, src, srcStride, dstW & ~7, dstW, 2, 2);
+}
+
+#define BOX4_ROW(addr)                                  \
+        "movdqu         "addr", %%xmm2          \n\t"   \
+        "movdqa           %%xmm2, %%xmm3        \n\t"   \
+        "punpcklbw        %%xmm7, %%xmm2        \n\t"   \
+        "punpckhbw        %%xmm7, %%xmm3        \n\t"   \
+        "paddw            %%xmm2, %%xmm0        \n\t"   \
+        "paddw            %%xmm3, %%xmm1        \n\t"
+
+static void box4x4_SSE2(uint8_t *dst, const uint8_t *src, int srcStride,
+                        int dstW, int boxW, int boxH)
+{
+    x86_reg count = dstW & ~3;
+    uint8_t       *d = dst;
+    const uint8_t *s = src;
+
+    if (count)
+    __asm__ volatile(
+        "pxor             %%xmm7, %%xmm7        \n\t"
+        "pcmpeqw          %%xmm6, %%xmm6        \n\t"
+        "psrlw               $15, %%xmm6        \n\t" // 1 (words)
+        "pcmpeqd          %%xmm5, %%xmm5        \n\t"
+        "psrld               $31, %%xmm5        \n\t"
+        "pslld                $3, %%xmm5        \n\t" // 8 (dwords)
+        ASMALIGN(4)
+        "1:                                     \n\t"
+        "pxor             %%xmm0, %%xmm0        \n\t"
+        "pxor             %%xmm1, %%xmm1        \n\t"
+        BOX4_ROW("(%1)")
+        BOX4_ROW("(%1, %3)")
+        BOX4_ROW("(%1, %3, 2)")
+        BOX4_ROW("(%1, %4)")
+        "pmaddwd          %%xmm6, %%xmm0        \n\t"
+        "pmaddwd          %%xmm6, %%xmm1        \n\t"
+        "packssdw         %%xmm1, %%xmm0        \n\t"
+        "pmaddwd          %%xmm6, %%xmm0        \n\t"
+        "paddd            %%xmm5, %%xmm0        \n\t"
+        "psrld                $4, %%xmm0        \n\t"
+        "packssdw         %%xmm0, %%xmm0        \n\t"
+        "packuswb         %%xmm0, %%xmm0        \n\t"
+        "movd             %%xmm0, (%0)          \n\t"
+        "add                 $16, %1            \n\t"
+        "add                  $4, %0            \n\t"
+        "sub                  $4, %2            \n\t"
+        " jg                  1b                \n\t"
+        : "+r"(d), "+r"(s), "+r"(count)
+        : "r"((x86_reg)srcStride), "r"((x86_reg)srcStride * 3)
+        : "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm5", "%xmm6", "%xmm7")
+    );
+    box_tail(dst, src, srcStride, dstW & ~3, dstW, 4, 4);
+}
+
+#define BOX8_ROW(addr, addr16)                          \
+        "movdqu         "addr", %%xmm2          \n\t"   \
+        "movdqu       "addr16", %%xmm3          \n\t"   \
+        "psadbw           %%xmm7, %%xmm2        \n\t"   \
+        "psadbw           %%xmm7, %%xmm3        \n\t"   \
+        "paddw            %%xmm2, %%xmm0        \n\t"   \
+        "paddw            %%xmm3, %%xmm1        \n\t"
+
+#define BOX8_ROWS4                                      \
+        BOX8_ROW("(%1)",         "16(%1)")              \
+        BOX8_ROW("(%1, %3)",     "16(%1, %3)")          \
+        BOX8_ROW("(%1, %3, 2)",  "16(%1, %3, 2)")       \
+        BOX8_ROW("(%1, %4)",     "16(%1, %4)")
+
+static void box8x8_SSE2(uint8_t *dst, const uint8_t *src, int srcStride,
+                        int dstW, int boxW, int boxH)
+{
+    x86_reg count   = dstW & ~3;
+    x86_reg stride4 = 4 * (x86_reg)srcStride;
+    uint8_t       *d = dst;
+    const uint8_t *s = src;
+
+    if (count)
+    __asm__ volatile(
+        "pxor             %%xmm7, %%xmm7        \n\t"
+        "pcmpeqd          %%xmm5, %%xmm5        \n\t"
+        "psrld               $31, %%xmm5        \n\t"
+        "pslld                $5, %%xmm5        \n\t" // 32 (dwords)
+        ASMALIGN(4)
+        "1:                                     \n\t"
+        "pxor             %%xmm0, %%xmm0        \n\t"
+        "pxor             %%xmm1, %%xmm1        \n\t"
+        BOX8_ROWS4
+        "add                  %5, %1            \n\t"
+        BOX8_ROWS4
+        "sub                  %5, %1            \n\t"
+        "pshufd    $0x08, %%xmm0, %%xmm0        \n\t"
+        "pshufd    $0x08, %%xmm1, %%xmm1        \n\t"
+        "punpcklqdq       %%xmm1, %%xmm0        \n\t"
+        "paddd            %%xmm5, %%xmm0        \n\t"
+        "psrld                $6, %%xmm0        \n\t"
+        "packssdw         %%xmm0, %%xmm0        \n\t"
+        "packuswb         %%xmm0, %%xmm0        \n\t"
+        "movd             %%xmm0, (%0)          \n\t"
+        "add                 $32, %1            \n\t"
+        "add                  $4, %0            \n\t"
+        "sub                  $4, %2            \n\t"
+        " jg                  1b                \n\t"
+        : "+r"(d), "+r"(s), "+r"(count)
+        : "r"((x86_reg)srcStride), "r"((x86_reg)srcStride * 3), "m"(stride4)
+        : "memory"
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm5", "%xmm7")
+    );
+    box_tail(dst, src, srcStride, dstW & ~3, dstW, 8, 8);
+}
+
+void ff_sws_init_box_sse2(SwsContext *c)
+{
+    if (c->boxW != c->boxH)
+        return;
+    switch (c->boxW) {
+    case 2: c->boxRow = box2x2_SSE2; break;
+    case 4: c->boxRow = box4x4_SSE2; break;
+    case 8: c->boxRow = box8x8_SSE2; break;
+    }
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "libavutil/crc.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+
+#undef exit
+#undef printf
+#undef fprintf
+
+#define TEST_W      856
+#define TEST_H      480
+#define BENCH_W    1280
+#define BENCH_H     720
+#define PADDING      32
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void alloc_frame(uint8_t *data[4], int stride[4], int w, int h)
+{
+    int i;
+
+    memset(data, 0, 4 * sizeof(*data));
+    memset(stride, 0, 4 * sizeof(*stride));
+    for (i = 0; i < 3; i++) {
+        stride[i] = (i ? w >> 1 : w) + PADDING;
+        data[i]   = av_mallocz(stride[i] * (i ? h >> 1 : h));
+        if (!data[i]) {
+            fprintf(stderr, "cannot allocate a %dx%d frame\n", w, h);
+            exit(1);
+        }
+    }
+}
+
+static void free_frame(uint8_t *data[4])
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        av_freep(&data[i]);
+}
+
+/**
+ * Downscale a random yuv420p frame by factor with SWS_AREA, once with the
+ * box kernel picked for the CPU and once with the C one, and compare.
+ */
+static int test_box(int factor, int w, int h, int iterations)
+{
+    const int dstW = w / factor, dstH = h / factor;
+    uint8_t *src[4], *dst[2][4];
+    int srcStride[4], dstStride[4];
+    void (*box_row)(uint8_t *dst, const uint8_t *src, int srcStride,
+                    int dstW, int boxW, int boxH);
+    int64_t t[2] = { 0 };
+    SwsContext *c;
+    AVLFG lfg;
+    uint32_t crc = 0;
+    int i, j, x, y, ret = 0;
+
+    alloc_frame(src, srcStride, w, h);
+    alloc_frame(dst[0], dstStride, dstW, dstH);
+    alloc_frame(dst[1], dstStride, dstW, dstH);
+    av_lfg_init(&lfg, factor);
+    for (i = 0; i < 3; i++)
+        for (y = 0; y < (i ? h >> 1 : h); y++)
+            for (x = 0; x < srcStride[i]; x++)
+                src[i][y * srcStride[i] + x] = av_lfg_get(&lfg);
+
+    c = sws_getContext(w, h, PIX_FMT_YUV420P, dstW, dstH, PIX_FMT_YUV420P,
+                       SWS_AREA, NULL, NULL, NULL);
+    if (!c || c->boxW != factor || c->boxH != factor) {
+        fprintf(stderr, "no %dx%d box downscaler for %dx%d\n",
+                factor, factor, w, h);
+        exit(1);
+    }
+
+    box_row = c->boxRow;
+    for (j = 0; j < 2; j++) {
+        c->boxRow = j ? ff_sws_box_row_c : box_row;
+        t[j] = gettime();
+        for (i = 0; i < FFMAX(iterations, 1); i++)
+            sws_scale(c, (const uint8_t * const *)src, srcStride, 0, h,
+                      dst[j], dstStride);
+        t[j] = gettime() - t[j];
+    }
+
+    for (i = 0; i < 3; i++) {
+        const int lines = i ? dstH >> 1 : dstH;
+        for (y = 0; y < lines; y++) {
+            const int len = i ? dstW >> 1 : dstW;
+            if (memcmp(dst[0][i] + y * dstStride[i],
+                       dst[1][i] + y * dstStride[i], len)) {
+                printf("box %dx%d: plane %d line %d differs from C\n",
+                       factor, factor, i, y);
+                ret = 1;
+                break;
+            }
+        }
+        crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), crc,
+                     dst[1][i], dstStride[i] * lines);
+    }
+
+    if (iterations)
+        printf("box %dx%d %dx%d -> %dx%d: C %.3f ms, %s %.3f ms\n",
+               factor, factor, w, h, dstW, dstH,
+               t[1] / 1000.0 / iterations,
+               box_row == ff_sws_box_row_c ? "C" : "SSE2",
+               t[0] / 1000.0 / iterations);
+    else
+        printf("box %dx%d %dx%d -> %dx%d: CRC=%08x\n",
+               factor, factor, w, h, dstW, dstH, crc);
+
+    sws_freeContext(c);
+    free_frame(src);
+    free_frame(dst[0]);
+    free_frame(dst[1]);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 0, factor, ret = 0;
+
+    if (argc > 1) {
+        if (argc != 3 || strcmp(argv[1], "-b") || (iterations = atoi(argv[2])) <= 0) {
+            fprintf(stderr, "usage: %s [-b iterations]\n"
+                    "Check the SSE2 box downscalers against the C one, or compare\n"
+                    "their speed on %dx%d frames with -b.\n",
+                    argv[0], BENCH_W, BENCH_H);
+            return 1;
+        }
+    }
+
+    for (factor = 2; factor <= 8; factor *= 2) {
+        if (iterations)
+            ret |= test_box(factor, BENCH_W, BENCH_H, iterations);
+        else /* odd chroma widths leave tails for the 8 and 4 pixel loops */
+            ret |= test_box(factor, 2 * factor * (TEST_W / (2 * factor) | 1),
+                            TEST_H, 0);
+    }
+    return ret;
+}
+
+#endif /* TEST */
@@ -61,8 +61,158 @@ DECLARE_ASM_CONST(8, uint64_t, pb_07) = 0x0707070707070707ULL;
 #define RENAME(a) a ## _MMX2
 #include "yuv2rgb_template.c"
 
+#if HAVE_SSE
+/* SSE2 versions of the 32bpp converters, 16 pixels per iteration.
+ * The arithmetic is the one of the MMX YUV2RGB macro, so the output is
+ * identical; the coefficients are taken from c->sse2Coeffs, which
+ * ff_yuv2rgb_c_init_tables() fills along with the MMX ones. */
+#define SSE2_Y_COEFF  "0"
+#define SSE2_VR_COEFF "16"
+#define SSE2_UB_COEFF "32"
+#define SSE2_VG_COEFF "48"
+#define SSE2_UG_COEFF "64"
+#define SSE2_Y_OFFSET "80"
+#define SSE2_U_OFFSET "96"
+#define SSE2_V_OFFSET "112"
+
+#define SSE2_LOAD16                              \
+    "movdqu     (%2), %%xmm6\n\t"                \
+    "movq       (%0), %%xmm0\n\t"                \
+    "movq       (%1), %%xmm1\n\t"                \
+
+#define SSE2_LOAD8                               \
+    "movq       (%2), %%xmm6\n\t"                \
+    "movd       (%0), %%xmm0\n\t"                \
+    "movd       (%1), %%xmm1\n\t"                \
+
+#define YUV2RGB_SSE2                             \
+    "pxor      %%xmm4, %%xmm4\n\t"               \
+    "movdqa    %%xmm6, %%xmm7\n\t"               \
+    "punpcklbw %%xmm4, %%xmm0\n\t"               \
+    "punpcklbw %%xmm4, %%xmm1\n\t"               \
+    "psllw     $8,     %%xmm6\n\t"               \
+    "psrlw     $8,     %%xmm7\n\t"               \
+    "psrlw     $5,     %%xmm6\n\t"               \
+    "psllw     $3,     %%xmm0\n\t"               \
+    "psllw     $3,     %%xmm1\n\t"               \
+    "psllw     $3,     %%xmm7\n\t"               \
+    "psubsw   "SSE2_U_OFFSET"(%4), %%xmm0\n\t"   \
+    "psubsw   "SSE2_V_OFFSET"(%4), %%xmm1\n\t"   \
+    "psubw    "SSE2_Y_OFFSET"(%4), %%xmm6\n\t"   \
+    "psubw    "SSE2_Y_OFFSET"(%4), %%xmm7\n\t"   \
+    "movdqa    %%xmm0, %%xmm2\n\t"               \
+    "movdqa    %%xmm1, %%xmm3\n\t"               \
+    "pmulhw   "SSE2_UG_COEFF"(%4), %%xmm2\n\t"   \
+    "pmulhw   "SSE2_VG_COEFF"(%4), %%xmm3\n\t"   \
+    "pmulhw   "SSE2_Y_COEFF" (%4), %%xmm6\n\t"   \
+    "pmulhw   "SSE2_Y_COEFF" (%4), %%xmm7\n\t"   \
+    "pmulhw   "SSE2_UB_COEFF"(%4), %%xmm0\n\t"   \
+    "pmulhw   "SSE2_VR_COEFF"(%4), %%xmm1\n\t"   \
+    "paddsw    %%xmm3, %%xmm2\n\t"               \
+    "movdqa    %%xmm7, %%xmm3\n\t"               \
+    "movdqa    %%xmm7, %%xmm5\n\t"               \
+    "paddsw    %%xmm0, %%xmm3\n\t"               \
+    "paddsw    %%xmm1, %%xmm5\n\t"               \
+    "paddsw    %%xmm2, %%xmm7\n\t"               \
+    "paddsw    %%xmm6, %%xmm0\n\t"               \
+    "paddsw    %%xmm6, %%xmm1\n\t"               \
+    "paddsw    %%xmm6, %%xmm2\n\t"               \
+    /* pack and interleave even/odd pixels */    \
+    "packuswb  %%xmm1, %%xmm0\n\t"               \
+    "packuswb  %%xmm5, %%xmm3\n\t"               \
+    "packuswb  %%xmm2, %%xmm2\n\t"               \
+    "movdqa    %%xmm0, %%xmm1\n\t"               \
+    "packuswb  %%xmm7, %%xmm7\n\t"               \
+    "punpcklbw %%xmm3, %%xmm0\n\t"               \
+    "punpckhbw %%xmm3, %%xmm1\n\t"               \
+    "punpcklbw %%xmm7, %%xmm2\n\t"               \
+    "pcmpeqd   %%xmm3, %%xmm3\n\t"               \
+
+#define RGB_PACK32_SSE2(red, green, blue, alpha) \
+    "movdqa    %%xmm"blue",  %%xmm5\n\t"         \
+    "movdqa    %%xmm"red",   %%xmm6\n\t"         \
+    "punpckhbw %%xmm"green", %%xmm5\n\t"         \
+    "punpcklbw %%xmm"green", %%xmm"blue"\n\t"    \
+    "punpckhbw %%xmm"alpha", %%xmm6\n\t"         \
+    "punpcklbw %%xmm"alpha", %%xmm"red"\n\t"     \
+    "movdqa    %%xmm"blue",  %%xmm"green"\n\t"   \
+    "movdqa    %%xmm5,       %%xmm"alpha"\n\t"   \
+    "punpcklwd %%xmm"red",   %%xmm"blue"\n\t"    \
+    "punpckhwd %%xmm"red",   %%xmm"green"\n\t"   \
+    "punpcklwd %%xmm6,       %%xmm5\n\t"         \
+    "punpckhwd %%xmm6,       %%xmm"alpha"\n\t"   \
+    "movdqu    %%xmm"blue",   0(%3)\n\t"         \
+    "movdqu    %%xmm"green", 16(%3)\n\t"         \
+
+#define SSE2_STORE16(alpha)                      \
+    "movdqu    %%xmm5,       32(%3)\n\t"         \
+    "movdqu    %%xmm"alpha", 48(%3)\n\t"         \
+
+#define SSE2_STORE8(alpha)
+
+#define YUV2RGB32_SSE2(size, red, blue)                                       \
+    __asm__ volatile (                                                        \
+        SSE2_LOAD##size                                                       \
+        YUV2RGB_SSE2                                                          \
+        RGB_PACK32_SSE2(red, REG_GREEN, blue, REG_ALPHA)                      \
+        SSE2_STORE##size(REG_ALPHA)                                           \
+        :: "r" (pu + x / 2), "r" (pv + x / 2), "r" (py + x),                  \
+           "r" (image + 4 * x), "r" (c->sse2Coeffs)                           \
+        : "memory"                                                            \
+          XMM_CLOBBERS(, "%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                         "%xmm4", "%xmm5", "%xmm6", "%xmm7")                  \
+    );
+
+#define YUV2RGB32_SSE2_FUNC(name, red, blue)                                  \
+static int name(SwsContext *c, const uint8_t *src[], int srcStride[],        \
+                int srcSliceY, int srcSliceH,                                 \
+                uint8_t *dst[], int dstStride[])                              \
+{                                                                             \
+    int x, y, h_size;                                                         \
+                                                                              \
+    h_size = (c->dstW + 7) & ~7;                                              \
+    if (h_size * 4 > FFABS(dstStride[0]))                                     \
+        h_size -= 8;                                                          \
+                                                                              \
+    if (c->srcFormat == PIX_FMT_YUV422P) {                                    \
+        srcStride[1] *= 2;                                                    \
+        srcStride[2] *= 2;                                                    \
+    }                                                                         \
+                                                                              \
+    for (y = 0; y < srcSliceH; y++) {                                         \
+        uint8_t *image    = dst[0] + (y + srcSliceY) * dstStride[0];          \
+        const uint8_t *py = src[0] +               y * srcStride[0];          \
+        const uint8_t *pu = src[1] +        (y >> 1) * srcStride[1];          \
+        const uint8_t *pv = src[2] +        (y >> 1) * srcStride[2];          \
+                                                                              \
+        for (x = 0; x + 16 <= h_size; x += 16)                                \
+            YUV2RGB32_SSE2(16, red, blue)                                     \
+        if (h_size & 8)                                                       \
+            YUV2RGB32_SSE2(8, red, blue)                                      \
+    }                                                                         \
+    return srcSliceH;                                                         \
+}
+
+YUV2RGB32_SSE2_FUNC(yuv420_rgb32_SSE2, REG_RED,  REG_BLUE)
+YUV2RGB32_SSE2_FUNC(yuv420_bgr32_SSE2, REG_BLUE, REG_RED)
+#endif /* HAVE_SSE */
+
 SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c)
 {
+#if HAVE_SSE
+    if (c->flags & SWS_CPU_CAPS_SSE2) {
+        switch (c->dstFormat) {
+        case PIX_FMT_RGB32:
+            if (c->srcFormat != PIX_FMT_YUVA420P)
+                return yuv420_rgb32_SSE2;
+            break;
+        case PIX_FMT_BGR32:
+            if (c->srcFormat != PIX_FMT_YUVA420P)
+                return yuv420_bgr32_SSE2;
+            break;
+        }
+    }
+#endif
     if (c->flags & SWS_CPU_CAPS_MMX2) {
         switch (c->dstFormat) {
         case PIX_FMT_RGB32:
@@ -692,6 +692,16 @@ av_cold int ff_yuv2rgb_c_init_tables(SwsContext *c, const int inv_table[4], int
     c->vgCoeff=   roundToInt16(cgv*8192) * 0x0001000100010001ULL;
     c->ugCoeff=   roundToInt16(cgu*8192) * 0x0001000100010001ULL;
     c->yOffset=   roundToInt16(oy *   8) * 0x0001000100010001ULL;
+#if HAVE_SSE
+    c->sse2Coeffs[0][0] = c->sse2Coeffs[0][1] = c->yCoeff;
+    c->sse2Coeffs[1][0] = c->sse2Coeffs[1][1] = c->vrCoeff;
+    c->sse2Coeffs[2][0] = c->sse2Coeffs[2][1] = c->ubCoeff;
+    c->sse2Coeffs[3][0] = c->sse2Coeffs[3][1] = c->vgCoeff;
+    c->sse2Coeffs[4][0] = c->sse2Coeffs[4][1] = c->ugCoeff;
+    c->sse2Coeffs[5][0] = c->sse2Coeffs[5][1] = c->yOffset;
+    c->sse2Coeffs[6][0] = c->sse2Coeffs[6][1] = c->uOffset;
+    c->sse2Coeffs[7][0] = c->sse2Coeffs[7][1] = c->vOffset;
+#endif
 
     c->yuv2rgb_y_coeff  = (int16_t)roundToInt16(cy <<13);
     c->yuv2rgb_y_offset = (int16_t)roundToInt16(oy << 9);
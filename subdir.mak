@@ -10,10 +10,12 @@ THIS_LIB   := $(SUBDIR)$($(CONFIG_SHARED:yes=S)LIBNAME)
 all-$(CONFIG_STATIC): $(SUBDIR)$(LIBNAME)
 all-$(CONFIG_SHARED): $(SUBDIR)$(SLIBNAME)
 
-$(SUBDIR)%-test.o: $(SUBDIR)%.c
+# make takes the first of these rules whose source exists, so a separate
+# foo-test.c has to come before building foo.c with -DTEST
+$(SUBDIR)%-test.o: $(SUBDIR)%-test.c
 	$(CC) $(CPPFLAGS) $(CFLAGS) -DTEST -c $(CC_O) $^
 
-$(SUBDIR)%-test.o: $(SUBDIR)%-test.c
+$(SUBDIR)%-test.o: $(SUBDIR)%.c
 	$(CC) $(CPPFLAGS) $(CFLAGS) -DTEST -c $(CC_O) $^
 
 $(SUBDIR)x86/%.o: $(SUBDIR)x86/%.asm
@@ -134,6 +134,18 @@ do_video_encoding mpeg4-thread.avi "-b 500k -flags +mv4+part+aic -trellis 1 -mbd
 do_video_decoding
 fi
 
+if [ -n "$do_mpeg4slice" ] ; then
+# the video packets are split between the decoding threads, which has to
+# give the same output as decoding them with a single thread
+do_video_encoding mpeg4-slice.avi "-qscale 8 -flags +mv4+aic -ps 200 -bf 2" "-an -vcodec mpeg4"
+do_video_decoding
+do_video_decoding "-threads 4"
+
+do_video_encoding mpeg4-slice-part.avi "-qscale 8 -flags +mv4+part+aic -ps 200" "-an -vcodec mpeg4"
+do_video_decoding
+do_video_decoding "-threads 4"
+fi
+
 if [ -n "$do_error" ] ; then
 do_video_encoding error-mpeg4-adv.avi "-qscale 7 -flags +mv4+part+aic -mbd rd -ps 250 -error 10" "-an -vcodec mpeg4"
 do_video_decoding
@@ -154,6 +166,14 @@ do_video_encoding mjpeg.avi "-qscale 9" "-an -vcodec mjpeg -pix_fmt yuvj420p"
 do_video_decoding "" "-pix_fmt yuv420p"
 fi
 
+if [ -n "$do_mjpegslice" ] ; then
+# every row is a restart interval, the intervals are decoded in parallel,
+# which has to give the same output as decoding them with a single thread
+do_video_encoding mjpeg-slice.avi "-qscale 9" "-an -vcodec mjpeg -pix_fmt yuvj420p -threads 2"
+do_video_decoding "" "-pix_fmt yuv420p"
+do_video_decoding "-threads 2" "-pix_fmt yuv420p"
+fi
+
 if [ -n "$do_ljpeg" ] ; then
 do_video_encoding ljpeg.avi "" "-an -vcodec ljpeg -strict -1"
 do_video_decoding
@@ -194,6 +214,14 @@ do_video_encoding ffv1.avi "-strict -2" "-an -vcodec ffv1"
 do_video_decoding
 fi
 
+if [ -n "$do_ffv1slice" ] ; then
+do_video_encoding ffv1-slice.avi "-strict -2" "-an -vcodec ffv1 -coder 1 -threads 4"
+do_video_decoding "-threads 3"
+
+do_video_encoding ffv1-slice-golomb.avi "-strict -2" "-an -vcodec ffv1 -coder 0 -threads 4"
+do_video_decoding "-threads 3"
+fi
+
 if [ -n "$do_snow" ] ; then
 do_video_encoding snow.avi "-strict -2" "-an -vcodec snow -qscale 2 -flags +qpel -me_method iter -dia_size 2 -cmp 12 -subcmp 12 -s 128x64"
 do_video_decoding "" "-s 352x288"
@@ -107,6 +107,49 @@ seektest(){
     $target_exec $target_path/tests/seek_test $target_path/$file
 }
 
+httptest(){
+    t="${test#http-}"
+    ref=${base}/ref/http/$t
+    case $t in
+        range_*)    opts="range_size=65536";            t=${t#range_}    ;;
+        parallel_*) opts="range_size=65536 parallel=3"; t=${t#parallel_} ;;
+        redirect_*) opts="range_size=65536 parallel=3"; t=${t#redirect_}
+                    server_opts=redirect ;;
+        *)          opts= ;;
+    esac
+    file=$(echo tests/data/lavf/$t | tr _ '?')
+    file=$(echo $file)
+    log=tests/data/${test#http-}.http.log
+    cleanfiles="$log"
+    set -- $(tests/http_server $file $log $server_opts) || return
+    $target_exec $target_path/tests/seek_test http://127.0.0.1:$1/${file##*/} $opts
+    err=$?
+    kill $2
+    # the exact counts depend on how the data arrives, only check that
+    # the requests did not all need a connection of their own
+    set -- $(cat $log)
+    test $2 -lt $4 && echo "connections reused"
+    # and that the parallel requests did not all wait for the same one
+    case $opts in
+        *parallel*) test $2 -gt 1 && echo "parallel connections" ;;
+    esac
+    return $err
+}
+
+rtptest(){
+    ref=${base}/ref/rtp/${test#rtp-}
+    sdp=tests/data/${test}.sdp
+    cleanfiles="$sdp"
+    # the sender drops and reorders packets in a fixed pattern, the output
+    # only depends on how the receiver puts them back in order, as long as
+    # it never times out waiting for a missing packet
+    set -- $(tests/rtp_sim tests/data/asynth1.sw $sdp) || return
+    framecrc -max_delay 5000000 -i $sdp -acodec copy
+    err=$?
+    kill $1 2>/dev/null
+    return $err
+}
+
 mkdir -p "$outdir"
 
 $command > "$outfile" 2>$errfile
@@ -0,0 +1,286 @@
+/*
+ * Minimal HTTP/1.1 server for the http protocol tests
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Serves one file for any GET request, honoring byte ranges and keep-alive,
+ * and keeps count of the connections and requests it got in a log file so
+ * that the tests can check that connections are reused. With "redirect",
+ * every fourth request is redirected to the file under another path.
+ *
+ * The server puts itself in the background once it listens and prints its
+ * port and pid. It exits when killed or after some time without requests.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAX_CLIENTS  32
+#define REQUEST_SIZE 4096
+#define IDLE_TIMEOUT 60
+#define REDIRECT_RATE 4
+
+typedef struct {
+    int fd;
+    char request[REQUEST_SIZE];
+    int request_len;
+    char header[512];
+    int header_len, header_pos;
+    long long pos, end;         /* part of the file left to send */
+    int close;                  /* close once the response is sent */
+} Client;
+
+static FILE *file;
+static long long file_size;
+static const char *log_name;
+static int nb_connections, nb_requests;
+static int port, redirect;
+
+static void write_log(void)
+{
+    FILE *f = fopen(log_name, "w");
+    if (f) {
+        fprintf(f, "connections: %d\nrequests: %d\n", nb_connections, nb_requests);
+        fclose(f);
+    }
+}
+
+static void parse_request(Client *c)
+{
+    char *range, *conn;
+    long long start = 0, end = file_size - 1;
+    int partial = 0;
+
+    nb_requests++;
+    write_log();
+
+    c->close = !!strstr(c->request, " HTTP/1.0\r\n");
+    if ((conn = strstr(c->request, "\r\nConnection:"))) {
+        conn += 13;
+        conn += strspn(conn, " ");
+        if (!strncasecmp(conn, "close", 5))
+            c->close = 1;
+        else if (!strncasecmp(conn, "keep-alive", 10))
+            c->close = 0;
+    }
+    if ((range = strstr(c->request, "\r\nRange: bytes="))) {
+        char *p;
+        range += 15;
+        start = strtoll(range, &p, 10);
+        if (*p == '-' && p[1] >= '0' && p[1] <= '9')
+            end = strtoll(p + 1, NULL, 10);
+        if (end > file_size - 1)
+            end = file_size - 1;
+        partial = 1;
+    }
+
+    if (redirect && nb_requests % REDIRECT_RATE == 0) {
+        char *name = strchr(c->request, ' '), *name_end;
+        if (!name || !(name_end = strchr(++name, ' ')))
+            name = name_end = c->request;
+        while (memchr(name, '/', name_end - name))
+            name = memchr(name, '/', name_end - name) + 1;
+        c->header_len = snprintf(c->header, sizeof(c->header),
+                                 "HTTP/1.1 302 Found\r\n"
+                                 "Location: http://127.0.0.1:%d/moved%d/%.*s\r\n"
+                                 "Content-Length: 0\r\n\r\n", port, nb_requests,
+                                 (int)(name_end - name), name);
+        c->pos = c->end = 0;
+    } else if (start > end) {
+        c->header_len = snprintf(c->header, sizeof(c->header),
+                                 "HTTP/1.1 416 Requested Range Not Satisfiable\r\n"
+                                 "Content-Range: bytes */%lld\r\n"
+                                 "Content-Length: 0\r\n\r\n", file_size);
+        c->pos = c->end = 0;
+    } else if (partial) {
+        c->header_len = snprintf(c->header, sizeof(c->header),
+                                 "HTTP/1.1 206 Partial Content\r\n"
+                                 "Content-Length: %lld\r\n"
+                                 "Content-Range: bytes %lld-%lld/%lld\r\n"
+                                 "%s\r\n", end - start + 1, start, end, file_size,
+                                 c->close ? "Connection: close\r\n" : "");
+        c->pos = start;
+        c->end = end + 1;
+    } else {
+        c->header_len = snprintf(c->header, sizeof(c->header),
+                                 "HTTP/1.1 200 OK\r\n"
+                                 "Content-Length: %lld\r\n"
+                                 "%s\r\n", file_size,
+                                 c->close ? "Connection: close\r\n" : "");
+        c->pos = 0;
+        c->end = file_size;
+    }
+    c->header_pos = 0;
+}
+
+/* return non zero if the connection is to be closed */
+static int client_read(Client *c)
+{
+    char *end;
+    int len = read(c->fd, c->request + c->request_len,
+                   sizeof(c->request) - 1 - c->request_len);
+
+    if (len <= 0)
+        return 1;
+    c->request_len += len;
+    c->request[c->request_len] = 0;
+    if (!(end = strstr(c->request, "\r\n\r\n")))
+        return c->request_len >= sizeof(c->request) - 1;
+
+    /* requests are not pipelined by the client, anything else is dropped */
+    end[2] = 0;
+    parse_request(c);
+    c->request_len = 0;
+    return 0;
+}
+
+static int client_write(Client *c)
+{
+    char buf[16384];
+    int len;
+
+    if (c->header_pos < c->header_len) {
+        len = write(c->fd, c->header + c->header_pos, c->header_len - c->header_pos);
+        if (len < 0)
+            return errno != EAGAIN;
+        c->header_pos += len;
+        return c->header_pos >= c->header_len && c->pos >= c->end && c->close;
+    }
+    len = c->end - c->pos < sizeof(buf) ? c->end - c->pos : sizeof(buf);
+    fseeko(file, c->pos, SEEK_SET);
+    len = fread(buf, 1, len, file);
+    len = write(c->fd, buf, len);
+    if (len < 0)
+        return errno != EAGAIN;
+    c->pos += len;
+    return c->pos >= c->end && c->close;
+}
+
+int main(int argc, char **argv)
+{
+    Client clients[MAX_CLIENTS];
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int server_fd, i, one = 1;
+    pid_t pid;
+
+    if (argc != 3 && (argc != 4 || strcmp(argv[3], "redirect"))) {
+        printf("usage: %s file logfile [redirect]\n", argv[0]);
+        return 1;
+    }
+    redirect = argc == 4;
+    if (!(file = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseeko(file, 0, SEEK_END);
+    file_size = ftello(file);
+    log_name  = argv[2];
+
+    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(server_fd, MAX_CLIENTS) ||
+        getsockname(server_fd, (struct sockaddr *)&addr, &addr_len)) {
+        perror("http_server");
+        return 1;
+    }
+    port = ntohs(addr.sin_port);
+    write_log();
+
+    if ((pid = fork()) < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid) {
+        printf("%d %d\n", port, (int)pid);
+        return 0;
+    }
+    fclose(stdout);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    for (;;) {
+        struct timeval tv = { IDLE_TIMEOUT, 0 };
+        fd_set rfds, wfds;
+        int max_fd = server_fd, ret;
+
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_SET(server_fd, &rfds);
+        for (i = 0; i < MAX_CLIENTS; i++) {
+            Client *c = &clients[i];
+            if (c->fd < 0)
+                continue;
+            FD_SET(c->fd, &rfds);
+            if (c->header_pos < c->header_len || c->pos < c->end)
+                FD_SET(c->fd, &wfds);
+            if (c->fd > max_fd)
+                max_fd = c->fd;
+        }
+        ret = select(max_fd + 1, &rfds, &wfds, NULL, &tv);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+
+        if (FD_ISSET(server_fd, &rfds)) {
+            int fd = accept(server_fd, NULL, NULL);
+            for (i = 0; i < MAX_CLIENTS && clients[i].fd >= 0; i++)
+                ;
+            if (fd >= 0 && i < MAX_CLIENTS) {
+                memset(&clients[i], 0, sizeof(clients[i]));
+                clients[i].fd = fd;
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                nb_connections++;
+                write_log();
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+        for (i = 0; i < MAX_CLIENTS; i++) {
+            Client *c = &clients[i];
+            if (c->fd < 0)
+                continue;
+            if ((FD_ISSET(c->fd, &rfds) && client_read(c)) ||
+                (FD_ISSET(c->fd, &wfds) && client_write(c))) {
+                close(c->fd);
+                c->fd = -1;
+            }
+        }
+    }
+    return 0;
+}
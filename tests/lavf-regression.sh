@@ -75,6 +75,54 @@ if [ -n "$do_ts" ] ; then
 do_lavf ts
 fi
 
+if [ -n "$do_ts_cbr" ] ; then
+# constant bitrate multiplex, the PCRs must match the packet positions
+file=${outfile}lavf_cbr.ts
+do_ffmpeg $file -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -f mpegts -muxrate 4000000
+$target_exec $target_path/tools/pcr-analyze $target_path/$file 4000000 >> $logfile
+do_ffmpeg_crc $file -i $target_path/$file
+fi
+
+if [ -n "$do_ts_programs" ] ; then
+# the same streams in two programs, each with its own PMT and PCRs
+src=${outfile}lavf_programs_src.ts
+do_ffmpeg $src -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -f mpegts
+file=${outfile}lavf_programs.ts
+$target_exec $target_path/tools/ts-programs $target_path/$src $target_path/$file 2 8000000
+do_md5sum $file >> $logfile
+wc -c $file >> $logfile
+$target_exec $target_path/tools/pcr-analyze $target_path/$file 8000000 >> $logfile
+do_ffmpeg_crc $file -i $target_path/$file
+fi
+
+if [ -n "$do_ts_discard" ] ; then
+# two programs in 192 byte packets with damaged sync bytes in each, only the
+# second program is read so the packets of the first are dropped unparsed
+src=${outfile}lavf_discard_src.ts
+do_ffmpeg $src -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -f mpegts
+$target_exec $target_path/tools/ts-programs $target_path/$src $target_path/${outfile}lavf_discard_2prg.ts 2
+file=${outfile}lavf_discard.ts
+$target_exec $target_path/tools/ts-trailer $target_path/${outfile}lavf_discard_2prg.ts $target_path/$file 192 1000 1045
+do_md5sum $file >> $logfile
+wc -c $file >> $logfile
+do_ffmpeg_crc $file -programid 2 -i $target_path/$file
+fi
+
+if [ -n "$do_applehttp" ] ; then
+# cut a transport stream into segments at packet boundaries, the way a
+# segmenter would, and read them back through a local playlist
+file=${outfile}hls.ts
+do_ffmpeg $file -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -f mpegts
+playlist=$target_path/${outfile}lavf.m3u8
+printf '#EXTM3U\n#EXT-X-TARGETDURATION:1\n' > $playlist
+for i in 0 1 2 3 4 5 6 7 8 9 ; do
+    dd if=$target_path/$file of=$target_path/${outfile}hls$i.ts bs=188 skip=$((i * 220)) count=220 2>/dev/null
+    printf '#EXTINF:1,\nhls%d.ts\n' $i >> $playlist
+done
+echo '#EXT-X-ENDLIST' >> $playlist
+do_ffmpeg_crc ${outfile}lavf.m3u8 -i $playlist
+fi
+
 if [ -n "$do_swf" ] ; then
 do_lavf swf -an
 fi
@@ -91,6 +139,34 @@ if [ -n "$do_mov" ] ; then
 do_lavf mov "-acodec pcm_alaw"
 fi
 
+if [ -n "$do_mov_faststart" ] ; then
+# moving the moov in front of the mdat while muxing must give the same file
+# as tools/qt-faststart does afterwards
+file=${outfile}lavf_faststart.mov
+do_ffmpeg $file -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -fflags faststart
+src=${outfile}lavf_faststart_src.mov
+do_ffmpeg $src -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src
+$target_exec $target_path/tools/qt-faststart $target_path/$src $target_path/${outfile}lavf_qt-faststart.mov > /dev/null
+cmp $target_path/$file $target_path/${outfile}lavf_qt-faststart.mov >> $logfile 2>&1
+do_ffmpeg_crc $file -i $target_path/$file
+fi
+
+if [ -n "$do_mov_frag" ] ; then
+# fragments cut on the video key frames, the audio runs end wherever the
+# video key frames fall
+file=${outfile}lavf_frag.mov
+do_ffmpeg $file -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -bf 2 -g 6 -acodec pcm_alaw -fflags frag -fragdur 200000
+$ffmpeg $FFMPEG_OPTS -i $target_path/$file -f framecrc - >> $logfile
+fi
+
+if [ -n "$do_mov_frag_pipe" ] ; then
+# the samples of the first fragment are in the moov, the other fragments
+# have to follow them when the file cannot be seeked
+file=${outfile}lavf_frag_pipe.mov
+do_ffmpeg $file -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -bf 2 -g 6 -acodec pcm_alaw -fflags frag -fragdur 200000
+$ffmpeg $FFMPEG_OPTS -i pipe: -f framecrc - < $target_path/$file >> $logfile
+fi
+
 if [ -n "$do_dv_fmt" ] ; then
 do_lavf dv "-ar 48000 -r 25 -s pal -ac 2"
 fi
@@ -107,6 +183,16 @@ if [ -n "$do_mkv" ] ; then
 do_lavf mkv
 fi
 
+if [ -n "$do_mkv_nocues" ] ; then
+# the cues are only written to seekable output, seeking has to find the
+# clusters by itself
+file=${outfile}lavf.nocues.mkv
+$ffmpeg $FFMPEG_OPTS -t 1 -qscale 10 -f image2 -vcodec pgmyuv -i $raw_src -f s16le -i $pcm_src -f matroska - > $target_path/$file
+do_md5sum $file >> $logfile
+wc -c $file >> $logfile
+do_ffmpeg_crc $file -i $target_path/$file
+fi
+
 
 # streamed images
 # mjpeg
@@ -210,6 +296,13 @@ if [ -n "$do_ogg" ] ; then
 do_audio_only ogg
 fi
 
+if [ -n "$do_ogg_flac" ] ; then
+# long enough for the packets to span many pages, some of them continued
+file=${outfile}lavf.flac.ogg
+do_ffmpeg $file -f s16le -i $pcm_src -acodec flac -compression_level 2
+do_ffmpeg_crc $file -i $target_path/$file
+fi
+
 if [ -n "$do_rso" ] ; then
 do_audio_only rso
 fi
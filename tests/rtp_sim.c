@@ -0,0 +1,263 @@
+/*
+ * RTP sender simulating packet loss and reordering for the rtp tests
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Sends 16 bit mono audio as L16 RTP packets to the local host, with a
+ * fixed pattern of swapped, dropped, late and duplicated packets. The
+ * receiver gives up on the missing packets only when its reordering queue
+ * is full, so that its output does not depend on the timing; the delay it
+ * waits for them is set far longer than the test.
+ *
+ * The sender writes the SDP describing the stream, puts itself in the
+ * background and prints its pid. It starts sending once the receiver
+ * listens on the port, and ends the stream with an RTCP BYE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define PACKET_SAMPLES 441
+#define NB_PACKETS     200
+#define PAYLOAD_TYPE   11          /* L16, 44100 Hz, mono */
+#define FIRST_SEQ      65500       /* wrap around early */
+#define FIRST_TS       1000000
+#define SSRC           0x12345678
+#define START_TIMEOUT  10           /* in seconds */
+
+#define DROP      -1
+#define DUPLICATE -2
+
+/* what happens to a packet: one of the above, or the number of packets
+ * sent before it arrives */
+static const struct {
+    int packet, action;
+} events[] = {
+    {  11, 1 },         /* swapped with the next one */
+    {  34, 3 },         /* late across the sequence number wrap */
+    {  60, DROP },      /* given up on once the receiver queue is full */
+    {  80, 15 },        /* arrives after the receiver gave up on it */
+    { 100, DUPLICATE },
+    { 120, 3 },
+    { 121, DUPLICATE }, /* queued twice while 120 is missing */
+    { 150, DROP },
+    { 198, DROP },      /* the queue is flushed at the end */
+};
+
+#define NB_EVENTS (sizeof(events) / sizeof(*events))
+
+static int rtp_sock, rtcp_sock;
+static struct sockaddr_in rtp_addr, rtcp_addr;
+
+static int find_ports(void)
+{
+    struct sockaddr_in addr;
+    int port, fd[2], ok;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (port = 20000 + (getpid() % 10000) * 2; port < 65534; port += 2) {
+        fd[0] = socket(AF_INET, SOCK_DGRAM, 0);
+        fd[1] = socket(AF_INET, SOCK_DGRAM, 0);
+        addr.sin_port = htons(port);
+        ok = !bind(fd[0], (struct sockaddr *)&addr, sizeof(addr));
+        addr.sin_port = htons(port + 1);
+        ok = ok && !bind(fd[1], (struct sockaddr *)&addr, sizeof(addr));
+        close(fd[0]);
+        close(fd[1]);
+        if (ok)
+            return port;
+    }
+    return -1;
+}
+
+/* return non zero once the receiver has bound the port */
+static int receiver_listening(int port)
+{
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0), ret;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+    ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) && errno == EADDRINUSE;
+    close(fd);
+    return ret;
+}
+
+/* usleep() is not part of POSIX.1-2001 without the XSI extensions */
+static void sleep_us(int us)
+{
+    struct timespec ts = { us / 1000000, us % 1000000 * 1000 };
+    while (nanosleep(&ts, &ts) && errno == EINTR)
+        ;
+}
+
+static void wr32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >>  8;
+    p[3] = v;
+}
+
+static void send_sr(void)
+{
+    uint8_t buf[28];
+
+    buf[0] = 0x80;
+    buf[1] = 200;                     /* SR */
+    buf[2] = 0;
+    buf[3] = 6;
+    wr32(buf +  4, SSRC);
+    wr32(buf +  8, 3500000000U);      /* NTP time */
+    wr32(buf + 12, 0);
+    wr32(buf + 16, FIRST_TS);
+    wr32(buf + 20, 0);                /* packet count */
+    wr32(buf + 24, 0);                /* octet count */
+    sendto(rtcp_sock, buf, sizeof(buf), 0,
+           (struct sockaddr *)&rtcp_addr, sizeof(rtcp_addr));
+}
+
+static void send_bye(void)
+{
+    uint8_t buf[8];
+
+    buf[0] = 0x81;
+    buf[1] = 203;                     /* BYE */
+    buf[2] = 0;
+    buf[3] = 1;
+    wr32(buf + 4, SSRC);
+    sendto(rtcp_sock, buf, sizeof(buf), 0,
+           (struct sockaddr *)&rtcp_addr, sizeof(rtcp_addr));
+}
+
+static void send_packet(const uint8_t *samples, int n)
+{
+    uint8_t buf[12 + PACKET_SAMPLES * 2];
+    int i;
+
+    buf[0] = 0x80;
+    buf[1] = PAYLOAD_TYPE;
+    buf[2] = (FIRST_SEQ + n) >> 8;
+    buf[3] = FIRST_SEQ + n;
+    wr32(buf + 4, FIRST_TS + n * PACKET_SAMPLES);
+    wr32(buf + 8, SSRC);
+    /* L16 is big endian, the input is little endian */
+    for (i = 0; i < PACKET_SAMPLES; i++) {
+        buf[12 + 2 * i]     = samples[(n * PACKET_SAMPLES + i) * 2 + 1];
+        buf[12 + 2 * i + 1] = samples[(n * PACKET_SAMPLES + i) * 2];
+    }
+    sendto(rtp_sock, buf, sizeof(buf), 0,
+           (struct sockaddr *)&rtp_addr, sizeof(rtp_addr));
+    sleep_us(1000);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t samples[NB_PACKETS * PACKET_SAMPLES * 2];
+    FILE *f;
+    int port, i, n;
+    pid_t pid;
+
+    if (argc != 3) {
+        printf("usage: %s input.sw output.sdp\n", argv[0]);
+        return 1;
+    }
+    if (!(f = fopen(argv[1], "rb")) ||
+        fread(samples, sizeof(samples), 1, f) != 1) {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    if ((port = find_ports()) < 0) {
+        fprintf(stderr, "no free port\n");
+        return 1;
+    }
+    if (!(f = fopen(argv[2], "w"))) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(f, "v=0\r\n"
+               "o=- 0 0 IN IP4 127.0.0.1\r\n"
+               "s=rtp_sim\r\n"
+               "c=IN IP4 127.0.0.1\r\n"
+               "t=0 0\r\n"
+               "m=audio %d RTP/AVP %d\r\n", port, PAYLOAD_TYPE);
+    fclose(f);
+
+    rtp_sock  = socket(AF_INET, SOCK_DGRAM, 0);
+    rtcp_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&rtp_addr, 0, sizeof(rtp_addr));
+    rtp_addr.sin_family      = AF_INET;
+    rtp_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    rtp_addr.sin_port        = htons(port);
+    rtcp_addr = rtp_addr;
+    rtcp_addr.sin_port       = htons(port + 1);
+
+    if ((pid = fork()) < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid) {
+        printf("%d\n", (int)pid);
+        return 0;
+    }
+    fclose(stdout);
+
+    for (i = 0; !receiver_listening(port) || !receiver_listening(port + 1); i++) {
+        if (i >= START_TIMEOUT * 100)
+            return 1;
+        sleep_us(10000);
+    }
+
+    send_sr();
+    sleep_us(10000);
+    for (n = 0; n < NB_PACKETS; n++) {
+        int action = 0;
+        for (i = 0; i < NB_EVENTS; i++)
+            if (events[i].packet == n)
+                action = events[i].action;
+        if (action <= 0 && action != DROP)
+            send_packet(samples, n);
+        if (action == DUPLICATE)
+            send_packet(samples, n);
+        for (i = 0; i < NB_EVENTS; i++)
+            if (events[i].action > 0 && events[i].packet + events[i].action == n)
+                send_packet(samples, events[i].packet);
+    }
+
+    /* let the receiver process the last packets before ending */
+    sleep_us(100000);
+    send_bye();
+    return 0;
+}
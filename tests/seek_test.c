@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "libavutil/common.h"
+#include "libavcodec/opt.h"
 #include "libavformat/avformat.h"
 
 #undef exit
@@ -57,6 +58,51 @@ static void ts_str(char buffer[60], int64_t ts, AVRational base)
     snprintf(buffer, 60, "%9f", tsval);
 }
 
+/**
+ * Open the input with options of its protocol given as name=value.
+ */
+static int open_input(AVFormatContext **ic, const char *filename,
+                      char **opts, int nb_opts, AVFormatParameters *ap)
+{
+    AVProbeData pd = { filename, NULL, 0 };
+    AVInputFormat *fmt;
+    URLContext *h;
+    ByteIOContext *pb;
+    int i, ret;
+
+    if (!nb_opts)
+        return av_open_input_file(ic, filename, NULL, 0, ap);
+
+    if ((ret = url_alloc(&h, filename, URL_RDONLY)) < 0)
+        return ret;
+    for (i = 0; i < nb_opts; i++) {
+        char *val = strchr(opts[i], '=');
+        if (!val || !h->prot->priv_data_class) {
+            fprintf(stderr, "invalid protocol option %s\n", opts[i]);
+            return AVERROR(EINVAL);
+        }
+        *val++ = 0;
+        if ((ret = av_set_string3(h->priv_data, opts[i], val, 0, NULL)) < 0) {
+            fprintf(stderr, "cannot set %s to %s\n", opts[i], val);
+            return ret;
+        }
+    }
+    if ((ret = url_connect(h)) < 0 || (ret = url_fdopen(&pb, h)) < 0)
+        return ret;
+
+    /* what av_open_input_file() would probe first */
+    if (!(pd.buf = av_mallocz(2048 + AVPROBE_PADDING_SIZE)))
+        return AVERROR(ENOMEM);
+    pd.buf_size = get_buffer(pb, pd.buf, 2048);
+    fmt = av_probe_input_format(&pd, 1);
+    av_free(pd.buf);
+    if (!fmt)
+        return AVERROR_NOFMT;
+    if ((ret = url_fseek(pb, 0, SEEK_SET)) < 0)
+        return ret;
+    return av_open_input_stream(ic, pb, filename, fmt, ap);
+}
+
 int main(int argc, char **argv)
 {
     const char *filename;
@@ -71,15 +117,15 @@ int main(int argc, char **argv)
     /* initialize libavcodec, and register all codecs and formats */
     av_register_all();
 
-    if (argc != 2) {
-        printf("usage: %s input_file\n"
+    if (argc < 2) {
+        printf("usage: %s input_file [protocol_option=value ...]\n"
                "\n", argv[0]);
         exit(1);
     }
 
     filename = argv[1];
 
-    ret = av_open_input_file(&ic, filename, NULL, 0, ap);
+    ret = open_input(&ic, filename, argv + 2, argc - 2, ap);
     if (ret < 0) {
         fprintf(stderr, "cannot open %s\n", filename);
         exit(1);
@@ -0,0 +1,220 @@
+/*
+ * MPEG-TS PCR analyzer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Checks the PCRs of a transport stream against the position of the
+ * packets carrying them. In a constant bitrate stream, every PCR must match
+ * the time at which its packet is sent at the mux rate; the difference is
+ * the PCR accuracy (jitter), which ISO/IEC 13818-1 bounds to 500 ns. The
+ * interval between two PCRs of a program must not exceed 100 ms, 40 ms for
+ * DVB. The programs of the first PAT are listed with their first PMT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define FFMIN(a,b) ((a) > (b) ? (b) : (a))
+#define FFMAX(a,b) ((a) > (b) ? (a) : (b))
+
+#define TS_PACKET_SIZE 188
+#define NB_PID_MAX     8192
+#define PCR_FREQ       27000000LL
+/* the PCR refers to the arrival of the last byte of its base */
+#define PCR_BYTE_OFFSET 11
+#define MAX_PROGRAMS   64
+
+typedef struct {
+    int nb_pcrs;
+    int64_t first_pcr, first_pos;
+    int64_t last_pcr, last_pos;
+    int64_t max_interval;       /* in 27MHz units */
+    int64_t max_jitter;         /* in 27MHz units */
+} PidStats;
+
+static PidStats *stats[NB_PID_MAX];
+
+static struct {
+    int number, pmt_pid;
+    char desc[256];             /* PCR pid and streams, empty until the PMT is seen */
+} programs[MAX_PROGRAMS];
+static int nb_programs = -1;    /* -1 until the PAT is seen */
+
+static int usage(void)
+{
+    fprintf(stderr, "pcr-analyze file [mux_rate]\n"
+                    "Print the PCR interval and accuracy of each PCR pid of an MPEG-TS file.\n"
+                    "The accuracy is checked against the given mux rate in bit/s,\n"
+                    "or the rate between the first and last PCRs of the pid.\n");
+    return 1;
+}
+
+/* return the PCR of a packet, or -1 if there is none */
+static int64_t get_pcr(const uint8_t *p)
+{
+    if (!(p[3] & 0x20) || p[4] < 7 || !(p[5] & 0x10))
+        return -1;
+    return ((int64_t)p[6] << 25 | p[7] << 17 | p[8] << 9 | p[9] << 1 |
+            p[10] >> 7) * 300 + ((p[10] & 1) << 8 | p[11]);
+}
+
+/* return the section starting in a packet, or NULL if there is none */
+static const uint8_t *get_section(const uint8_t *p, int *len)
+{
+    int off = 4;
+
+    if (!(p[1] & 0x40) || !(p[3] & 0x10))
+        return NULL;
+    if (p[3] & 0x20)
+        off += 1 + p[4];
+    if (off >= TS_PACKET_SIZE || (off += 1 + p[off]) > TS_PACKET_SIZE - 3)
+        return NULL;
+    p += off;
+    *len = FFMIN((p[1] & 0x0f) << 8 | p[2], TS_PACKET_SIZE - off - 3) + 3;
+    return p;
+}
+
+static void parse_psi(const uint8_t *packet, int pid)
+{
+    const uint8_t *p, *end;
+    int len, i;
+
+    if (!(p = get_section(packet, &len)))
+        return;
+    end = p + len - 4;                  /* CRC */
+    if (!pid && nb_programs < 0 && p[0] == 0x00) {
+        nb_programs = 0;
+        for (p += 8; p + 4 <= end && nb_programs < MAX_PROGRAMS; p += 4) {
+            int number = p[0] << 8 | p[1];
+            if (!number)                /* network PID */
+                continue;
+            programs[nb_programs].number  = number;
+            programs[nb_programs].pmt_pid = (p[2] & 0x1f) << 8 | p[3];
+            nb_programs++;
+        }
+        return;
+    }
+    for (i = 0; i < nb_programs; i++) {
+        char *desc = programs[i].desc;
+        int n;
+        if (pid != programs[i].pmt_pid || p[0] != 0x02 || *desc ||
+            (p[3] << 8 | p[4]) != programs[i].number)
+            continue;
+        n = snprintf(desc, sizeof(programs[i].desc), "pcr pid 0x%04x, streams",
+                     (p[8] & 0x1f) << 8 | p[9]);
+        for (p += 12 + ((p[10] & 0x0f) << 8 | p[11]); p + 5 <= end;
+             p += 5 + ((p[3] & 0x0f) << 8 | p[4]))
+            n += snprintf(desc + n, FFMAX((int)sizeof(programs[i].desc) - n, 0),
+                          " 0x%04x (type 0x%02x)",
+                          (p[1] & 0x1f) << 8 | p[2], p[0]);
+    }
+}
+
+/* expected PCR at pos for the given rate, relative to the first PCR */
+static int64_t expected_pcr(const PidStats *st, int64_t pos, int64_t rate)
+{
+    return st->first_pcr + ((pos - st->first_pos) * 8 * PCR_FREQ + rate / 2) / rate;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t packet[TS_PACKET_SIZE];
+    int64_t rate = argc > 2 ? strtoll(argv[2], NULL, 10) : 0;
+    int64_t pos = 0, nb_packets = 0, nb_null = 0, pcr;
+    int pid, pass, i;
+    FILE *f;
+
+    if (argc < 2 || argc > 3 || rate < 0)
+        return usage();
+    if (!(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    /* the first pass gets the rate of each pid, the second the accuracy */
+    for (pass = 0; pass < 2; pass++) {
+        fseek(f, 0, SEEK_SET);
+        for (pos = 0; fread(packet, TS_PACKET_SIZE, 1, f) == 1; pos += TS_PACKET_SIZE) {
+            PidStats *st;
+
+            if (packet[0] != 0x47) {
+                fprintf(stderr, "sync lost at %"PRId64"\n", pos);
+                return 1;
+            }
+            pid = (packet[1] & 0x1f) << 8 | packet[2];
+            if (!pass) {
+                nb_packets++;
+                nb_null += pid == 0x1fff;
+                parse_psi(packet, pid);
+            }
+            if ((pcr = get_pcr(packet)) < 0 || (pass && !stats[pid]))
+                continue;
+            if (!stats[pid] && !(stats[pid] = calloc(1, sizeof(PidStats)))) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            st = stats[pid];
+            if (!pass) {
+                if (!st->nb_pcrs) {
+                    st->first_pcr = pcr;
+                    st->first_pos = pos + PCR_BYTE_OFFSET;
+                } else if (pcr - st->last_pcr > st->max_interval) {
+                    st->max_interval = pcr - st->last_pcr;
+                }
+                st->last_pcr = pcr;
+                st->last_pos = pos + PCR_BYTE_OFFSET;
+                st->nb_pcrs++;
+            } else {
+                int64_t r = rate ? rate : (st->last_pos - st->first_pos) * 8 *
+                                          PCR_FREQ / (st->last_pcr - st->first_pcr);
+                int64_t jitter = llabs(pcr - expected_pcr(st, pos + PCR_BYTE_OFFSET, r));
+                if (jitter > st->max_jitter)
+                    st->max_jitter = jitter;
+            }
+        }
+        /* the rate of a pid cannot be measured from a single PCR */
+        for (pid = 0; pid < NB_PID_MAX && !pass && !rate; pid++)
+            if (stats[pid] && stats[pid]->last_pcr == stats[pid]->first_pcr) {
+                free(stats[pid]);
+                stats[pid] = NULL;
+            }
+    }
+    fclose(f);
+
+    printf("packets %"PRId64", null packets %"PRId64"\n", nb_packets, nb_null);
+    for (i = 0; i < nb_programs; i++)
+        printf("program %d: pmt pid 0x%04x, %s\n", programs[i].number,
+               programs[i].pmt_pid, *programs[i].desc ? programs[i].desc : "no PMT");
+    for (pid = 0; pid < NB_PID_MAX; pid++) {
+        PidStats *st = stats[pid];
+        int64_t r;
+        if (!st)
+            continue;
+        r = st->last_pcr == st->first_pcr ? rate :
+            (st->last_pos - st->first_pos) * 8 * PCR_FREQ / (st->last_pcr - st->first_pcr);
+        printf("pid 0x%04x: %d PCRs, max interval %"PRId64" us, "
+               "rate %"PRId64" bit/s, max jitter %"PRId64" ns\n",
+               pid, st->nb_pcrs, st->max_interval / 27, r,
+               st->max_jitter * 1000 / 27);
+        free(st);
+    }
+    return 0;
+}
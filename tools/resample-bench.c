@@ -0,0 +1,155 @@
+/*
+ * audio resampler benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libavutil/lfg.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+#define FRAME_SIZE 1024
+
+static int usage(void)
+{
+    fprintf(stderr, "resample-bench [in_rate out_rate channels seconds filter_length linear]\n"
+                    "Resample generated audio once per deinterleaved channel with av_resample()\n"
+                    "and once interleaved with av_resample_interleaved(), print the speeds\n"
+                    "and check that both give the same output.\n");
+    return 1;
+}
+
+/**
+ * Resample nb_frames frames of FRAME_SIZE samples the way a player does,
+ * carrying the unconsumed input over to the next call.
+ * @return the number of output samples per channel
+ */
+static int run(struct AVResampleContext *c, short *dst, const short *src,
+               int channels, int nb_frames, int max_out, int interleaved,
+               int64_t *time)
+{
+    short *in  = av_malloc(2 * FRAME_SIZE * channels * sizeof(*in));
+    short *tmp = av_malloc(2 * FRAME_SIZE * sizeof(*tmp));
+    short *out = av_malloc(max_out * channels * sizeof(*out));
+    int in_len = 0, out_len = 0, frame, ch, i, n = 0;
+    int64_t start = av_gettime();
+
+    for (frame = 0; frame < nb_frames; frame++) {
+        int consumed;
+
+        memcpy(in + in_len * channels, src + frame * FRAME_SIZE * channels,
+               FRAME_SIZE * channels * sizeof(*in));
+        in_len += FRAME_SIZE;
+
+        if (interleaved) {
+            n = av_resample_interleaved(c, out, in, &consumed, in_len,
+                                        max_out, channels, 1);
+        } else {
+            for (ch = 0; ch < channels; ch++) {
+                short *o = out + ch * max_out;
+                for (i = 0; i < in_len; i++)
+                    tmp[i] = in[i * channels + ch];
+                n = av_resample(c, o, tmp, &consumed, in_len, max_out,
+                                ch == channels - 1);
+            }
+            /* interleave for the comparison, a player would do it too */
+            for (ch = 0; ch < channels; ch++)
+                for (i = 0; i < n; i++)
+                    dst[(out_len + i) * channels + ch] = out[ch * max_out + i];
+        }
+        if (interleaved)
+            memcpy(dst + out_len * channels, out, n * channels * sizeof(*out));
+        out_len += n;
+
+        in_len -= consumed;
+        memmove(in, in + consumed * channels, in_len * channels * sizeof(*in));
+    }
+
+    *time = av_gettime() - start;
+    av_free(in);
+    av_free(tmp);
+    av_free(out);
+    return out_len;
+}
+
+int main(int argc, char **argv)
+{
+    int in_rate       = argc > 1 ? atoi(argv[1]) : 44100;
+    int out_rate      = argc > 2 ? atoi(argv[2]) : 48000;
+    int channels      = argc > 3 ? atoi(argv[3]) : 2;
+    int seconds       = argc > 4 ? atoi(argv[4]) : 10;
+    int filter_length = argc > 5 ? atoi(argv[5]) : 16;
+    int linear        = argc > 6 ? atoi(argv[6]) : 0;
+    int nb_frames, nb_samples, max_out, len[2], i, ch;
+    int64_t time[2];
+    short *src, *dst[2];
+    AVLFG lfg;
+
+    if (in_rate <= 0 || out_rate <= 0 || channels <= 0 || channels > 8 ||
+        seconds <= 0 || filter_length <= 0)
+        return usage();
+
+    nb_frames  = (int64_t)in_rate * seconds / FRAME_SIZE;
+    nb_samples = nb_frames * FRAME_SIZE;
+    /* enough to consume a whole frame and what was left of the previous one */
+    max_out    = 2LL * FRAME_SIZE * out_rate / in_rate + 16;
+    src    = av_malloc(nb_samples * channels * sizeof(*src));
+    dst[0] = av_malloc(((int64_t)nb_samples * out_rate / in_rate + max_out) * channels * sizeof(*src));
+    dst[1] = av_malloc(((int64_t)nb_samples * out_rate / in_rate + max_out) * channels * sizeof(*src));
+    if (!src || !dst[0] || !dst[1]) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* a different tone per channel plus some noise */
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (i = 0; i < nb_samples; i++)
+        for (ch = 0; ch < channels; ch++)
+            src[i * channels + ch] = 16000 * sin(2 * M_PI * (440 << ch) * i / in_rate) +
+                                     (int)(av_lfg_get(&lfg) & 0x3FF) - 0x200;
+
+    for (i = 0; i < 2; i++) {
+        struct AVResampleContext *c = av_resample_init(out_rate, in_rate, filter_length,
+                                                       10, linear, 0.8);
+        if (!c) {
+            fprintf(stderr, "av_resample_init() failed\n");
+            return 1;
+        }
+        len[i] = run(c, dst[i], src, channels, nb_frames, max_out, i, &time[i]);
+        av_resample_close(c);
+        printf("%-12s %d->%d Hz, %d channels: %8.2f Msamples/s (%"PRId64" us)\n",
+               i ? "interleaved" : "per channel", in_rate, out_rate, channels,
+               (double)nb_samples * channels / FFMAX(time[i], 1), time[i]);
+    }
+
+    if (len[0] != len[1] ||
+        memcmp(dst[0], dst[1], len[0] * channels * sizeof(*src))) {
+        printf("output mismatch\n");
+        return 1;
+    }
+    printf("outputs match, %d samples per channel\n", len[0]);
+
+    av_free(src);
+    av_free(dst[0]);
+    av_free(dst[1]);
+    return 0;
+}
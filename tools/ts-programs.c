@@ -0,0 +1,143 @@
+/*
+ * MPEG-TS multiple program remuxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Copies all the streams of a file into each of several programs of an
+ * MPEG-TS multiplex, so that the muxer has to interleave the services and
+ * give each of them its own PMT and PCRs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libavutil/avstring.h"
+#include "libavformat/avformat.h"
+
+#define MAX_PROGRAMS 16
+
+#undef printf
+#undef fprintf
+
+static int usage(void)
+{
+    fprintf(stderr, "ts-programs input output nb_programs [mux_rate]\n"
+                    "Remux all the streams of the input once per program into an MPEG-TS\n"
+                    "file, with program numbers starting at 1, at the given mux rate in\n"
+                    "bit/s or with a variable bitrate.\n");
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *ic = NULL, *oc;
+    AVPacket pkt;
+    int nb_programs = argc > 3 ? atoi(argv[3]) : 0;
+    int i, j, ret;
+
+    if (argc < 4 || argc > 5 || nb_programs < 1 || nb_programs > MAX_PROGRAMS)
+        return usage();
+
+    av_register_all();
+
+    if ((ret = av_open_input_file(&ic, argv[1], NULL, 0, NULL)) < 0) {
+        fprintf(stderr, "%s: error %d opening the input\n", argv[1], ret);
+        return 1;
+    }
+    if ((ret = av_find_stream_info(ic)) < 0) {
+        fprintf(stderr, "%s: error %d finding the streams\n", argv[1], ret);
+        return 1;
+    }
+
+    oc = avformat_alloc_context();
+    if (!oc || !(oc->oformat = av_guess_format("mpegts", NULL, NULL))) {
+        fprintf(stderr, "cannot allocate the mpegts muxer\n");
+        return 1;
+    }
+    av_strlcpy(oc->filename, argv[2], sizeof(oc->filename));
+    oc->mux_rate  = argc > 4 ? atoi(argv[4]) : 0;
+    oc->max_delay = 700000;
+
+    for (j = 0; j < nb_programs; j++) {
+        AVProgram *program = av_new_program(oc, j + 1);
+        char name[32];
+
+        if (!program)
+            return 1;
+        snprintf(name, sizeof(name), "Program %d", j + 1);
+        av_metadata_set2(&program->metadata, "name", name, 0);
+        program->stream_index = av_malloc(ic->nb_streams *
+                                          sizeof(*program->stream_index));
+        if (!program->stream_index)
+            return 1;
+        for (i = 0; i < ic->nb_streams; i++) {
+            AVStream *st = av_new_stream(oc, oc->nb_streams);
+            if (!st)
+                return 1;
+            avcodec_copy_context(st->codec, ic->streams[i]->codec);
+            st->time_base           = ic->streams[i]->time_base;
+            st->sample_aspect_ratio = st->codec->sample_aspect_ratio;
+            program->stream_index[program->nb_stream_indexes++] = st->index;
+        }
+    }
+
+    if (av_set_parameters(oc, NULL) < 0 ||
+        url_fopen(&oc->pb, argv[2], URL_WRONLY) < 0) {
+        fprintf(stderr, "%s: cannot open the output\n", argv[2]);
+        return 1;
+    }
+    if ((ret = av_write_header(oc)) < 0) {
+        fprintf(stderr, "%s: error %d writing the header\n", argv[2], ret);
+        return 1;
+    }
+
+    while (av_read_frame(ic, &pkt) >= 0) {
+        for (j = 0; j < nb_programs; j++) {
+            AVPacket copy = pkt;
+            /* the muxer may keep the packet, give each program its own data */
+            if (!(copy.data = av_malloc(pkt.size + FF_INPUT_BUFFER_PADDING_SIZE)))
+                return 1;
+            memcpy(copy.data, pkt.data, pkt.size);
+            copy.destruct     = av_destruct_packet;
+            copy.stream_index = pkt.stream_index + j * ic->nb_streams;
+            if ((ret = av_interleaved_write_frame(oc, &copy)) < 0) {
+                fprintf(stderr, "%s: error %d writing a packet\n", argv[2], ret);
+                return 1;
+            }
+        }
+        av_free_packet(&pkt);
+    }
+
+    av_write_trailer(oc);
+    url_fclose(oc->pb);
+    for (i = 0; i < oc->nb_streams; i++) {
+        av_freep(&oc->streams[i]->codec->extradata);
+        av_freep(&oc->streams[i]->codec);
+        av_freep(&oc->streams[i]);
+    }
+    for (j = 0; j < oc->nb_programs; j++) {
+        av_metadata_free(&oc->programs[j]->metadata);
+        av_freep(&oc->programs[j]->stream_index);
+        av_freep(&oc->programs[j]);
+    }
+    av_freep(&oc->programs);
+    av_free(oc);
+    av_close_input_file(ic);
+    return 0;
+}
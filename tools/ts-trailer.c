@@ -0,0 +1,88 @@
+/*
+ * MPEG-TS packet trailer and sync damage tool
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Copies a 188 byte packet transport stream into 192 (M2TS, with a packet
+ * counter in place of the arrival time) or 204 byte packets (with a zeroed
+ * Reed-Solomon parity), and clears the sync byte of the given packets, to
+ * exercise the demuxer on other packet sizes and lost sync.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define TS_PACKET_SIZE 188
+#define MAX_DAMAGED    16
+
+static int usage(void)
+{
+    fprintf(stderr, "ts-trailer input output packet_size [damaged_packet...]\n"
+                    "Copy a 188 byte packet MPEG-TS file into 188, 192 or 204 byte\n"
+                    "packets, clearing the sync byte of the given packets (from 0).\n");
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t packet[TS_PACKET_SIZE + 16] = { 0 };
+    int64_t damaged[MAX_DAMAGED], n;
+    int size = argc > 3 ? atoi(argv[3]) : 0;
+    int nb_damaged = argc - 4, i;
+    FILE *in, *out;
+
+    if (argc < 4 || nb_damaged > MAX_DAMAGED ||
+        (size != TS_PACKET_SIZE && size != 192 && size != 204))
+        return usage();
+    for (i = 0; i < nb_damaged; i++)
+        damaged[i] = strtoll(argv[i + 4], NULL, 10);
+    if (!(in = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (!(out = fopen(argv[2], "wb"))) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    for (n = 0; fread(packet, TS_PACKET_SIZE, 1, in) == 1; n++) {
+        if (packet[0] != 0x47) {
+            fprintf(stderr, "sync lost at packet %"PRId64"\n", n);
+            return 1;
+        }
+        for (i = 0; i < nb_damaged; i++)
+            if (damaged[i] == n)
+                packet[0] = 0;
+        if (size == 192) {
+            packet[188] = n >> 24;
+            packet[189] = n >> 16;
+            packet[190] = n >>  8;
+            packet[191] = n;
+        }
+        if (fwrite(packet, size, 1, out) != 1) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+    fclose(in);
+    fclose(out);
+    return 0;
+}